@@ -0,0 +1,513 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Drives BitrateController with the receiver reports a capture would get over a bottleneck link,
+// and checks how the target follows the capacity of the link.
+// The link capacity comes from bandwidth traces, either generated ones or recorded ones with a
+// line per period of "<duration in ms> <capacity in kbps>". Everything is simulated in steps of
+// frames, so the same trace always gives the same result.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 BitrateControllerSimulation.cpp ..\Shared\Media\BitrateController.cpp
+//
+// Usage: BitrateControllerSimulation [-v] [trace.txt ...]
+
+#include "../Shared/Media/BitrateController.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace MixedRemoteViewCompositor::Media;
+
+namespace
+{
+    // The controller bounds CaptureEngine configures, for a 1080p profile.
+    const uint32_t MinBitrate = 500000;
+    const uint32_t MaxBitrate = 8000000;
+
+    const double FrameRate = 30;
+    const double FrameMS = 1000 / FrameRate;
+
+    // One way delay of the link without a queue, and of the reports coming back.
+    const double PropagationMS = 20;
+
+    // NetworkMediaSourceImpl sends a report about once a second.
+    const double ReportMS = 1000;
+
+    // Frames that arrive later than this after capture count as late.
+    const double LatencyBudgetMS = 500;
+
+    // Content that needs less than the target, a static scene is encoded well under it.
+    const double UnlimitedScene = 1e12;
+
+    struct Period
+    {
+        double DurationMS;
+        double CapacityBps;
+        // Bitrate the content needs, the encoder never produces more than this.
+        double SceneBps;
+    };
+
+    struct Sample
+    {
+        double TimeMS;
+        double CapacityBps;
+        double SceneBps;
+        uint32_t Target;
+        double ThroughputBps;
+        int64_t hnsJitter;
+        uint32_t Received;
+        uint32_t QueueDepth;
+        BitrateController::UsageState State;
+    };
+
+    struct Result
+    {
+        std::vector<Sample> Reports;
+        double SentBits = 0;
+        double UsableBits = 0;
+        uint32_t Frames = 0;
+        uint32_t LateFrames = 0;
+    };
+
+    struct Trace
+    {
+        std::string Name;
+        std::vector<Period> Periods;
+        // Scenario checks, only for the generated traces.
+        bool (*Check)(const Result&);
+    };
+
+    struct Frame
+    {
+        double CaptureMS;
+        double ArrivalMS;
+        double Bits;
+    };
+
+    class Link
+    {
+    public:
+        explicit Link(const std::vector<Period>& periods) :
+            periods(periods)
+        {
+            double start = 0;
+            for (const Period& period : periods)
+            {
+                starts.push_back(start);
+                start += period.DurationMS;
+            }
+            duration = start;
+        }
+
+        double Duration() const { return duration; }
+
+        const Period& At(double ms) const
+        {
+            size_t i = std::upper_bound(starts.begin(), starts.end(), ms) - starts.begin();
+            return periods[i > 0 ? i - 1 : 0];
+        }
+
+        // When the last bit of a frame handed to the link at sendMS has arrived.
+        double Send(double sendMS, double bits)
+        {
+            double t = sendMS > free ? sendMS : free;
+            while (bits > 0)
+            {
+                // Capacity only changes on whole milliseconds in the traces.
+                double bitsPerMS = At(t).CapacityBps / 1000;
+                double next = std::floor(t) + 1;
+                double available = bitsPerMS * (next - t);
+                if (available >= bits)
+                {
+                    t += bits / bitsPerMS;
+                    break;
+                }
+                bits -= available;
+                t = next;
+            }
+
+            free = t;
+            return t + PropagationMS;
+        }
+
+    private:
+        std::vector<Period> periods;
+        std::vector<double> starts;
+        double duration = 0;
+        double free = 0;
+    };
+
+    // What NetworkMediaSourceStreamImpl keeps for the report of the current interval.
+    class Receiver
+    {
+    public:
+        void Arrive(const Frame& frame)
+        {
+            // RFC 3550 interarrival jitter, in 100ns units as the stream keeps it.
+            int64_t hnsArrival = static_cast<int64_t>(frame.ArrivalMS * 10000);
+            int64_t hnsTimestamp = static_cast<int64_t>(frame.CaptureMS * 10000);
+            if (hasLast)
+            {
+                int64_t hnsTransit = (hnsArrival - hnsLastArrival) - (hnsTimestamp - hnsLastTimestamp);
+                if (hnsTransit < 0)
+                {
+                    hnsTransit = -hnsTransit;
+                }
+                hnsJitter += (hnsTransit - hnsJitter) / 16;
+            }
+            hasLast = true;
+            hnsLastArrival = hnsArrival;
+            hnsLastTimestamp = hnsTimestamp;
+
+            bytes += static_cast<uint32_t>(frame.Bits / 8);
+            received++;
+
+            // Presented on the timeline of the first frame, frames that arrive ahead of it wait in the queue.
+            if (presentOffsetMS < 0)
+            {
+                presentOffsetMS = frame.ArrivalMS - frame.CaptureMS;
+            }
+            double presentMS = frame.CaptureMS + presentOffsetMS;
+            if (presentMS > frame.ArrivalMS)
+            {
+                queued.push_back(presentMS);
+            }
+        }
+
+        Sample Report(double nowMS, double intervalMS)
+        {
+            while (!queued.empty() && queued.front() <= nowMS)
+            {
+                queued.pop_front();
+            }
+
+            Sample sample = {};
+            sample.TimeMS = nowMS;
+            sample.ThroughputBps = bytes * 8.0 * 1000 / intervalMS;
+            sample.hnsJitter = hnsJitter;
+            sample.Received = received;
+            sample.QueueDepth = static_cast<uint32_t>(queued.size());
+
+            bytes = 0;
+            received = 0;
+
+            return sample;
+        }
+
+    private:
+        bool hasLast = false;
+        int64_t hnsLastArrival = 0;
+        int64_t hnsLastTimestamp = 0;
+        int64_t hnsJitter = 0;
+
+        uint32_t bytes = 0;
+        uint32_t received = 0;
+
+        double presentOffsetMS = -1;
+        std::deque<double> queued;
+    };
+
+    Result Simulate(const Trace& trace)
+    {
+        Link link(trace.Periods);
+        Receiver receiver;
+
+        BitrateController controller;
+        controller.Configure(MinBitrate, MaxBitrate, MaxBitrate);
+
+        Result result;
+        std::deque<Frame> inFlight;
+        double nextReportMS = ReportMS;
+
+        for (uint32_t i = 0; i * FrameMS < link.Duration(); i++)
+        {
+            double nowMS = i * FrameMS;
+
+            // Reports reach the sender a propagation delay after the receiver sent them.
+            while (nextReportMS + PropagationMS <= nowMS)
+            {
+                while (!inFlight.empty() && inFlight.front().ArrivalMS <= nextReportMS)
+                {
+                    receiver.Arrive(inFlight.front());
+                    inFlight.pop_front();
+                }
+
+                Sample sample = receiver.Report(nextReportMS, ReportMS);
+                sample.CapacityBps = link.At(nextReportMS).CapacityBps;
+                sample.SceneBps = link.At(nextReportMS).SceneBps;
+
+                controller.OnReceiverReport(
+                    static_cast<int64_t>(ReportMS * 10000),
+                    sample.hnsJitter,
+                    static_cast<uint32_t>(sample.ThroughputBps * ReportMS / 8000),
+                    sample.Received,
+                    0,
+                    sample.QueueDepth);
+
+                sample.Target = controller.GetTargetBitrate();
+                sample.State = controller.GetUsageState();
+                result.Reports.push_back(sample);
+
+                nextReportMS += ReportMS;
+            }
+
+            const Period& period = link.At(nowMS);
+            double bitrate = controller.GetTargetBitrate();
+            if (bitrate > period.SceneBps)
+            {
+                bitrate = period.SceneBps;
+            }
+
+            Frame frame;
+            frame.CaptureMS = nowMS;
+            frame.Bits = bitrate / FrameRate;
+            frame.ArrivalMS = link.Send(nowMS, frame.Bits);
+            inFlight.push_back(frame);
+
+            result.Frames++;
+            result.SentBits += frame.Bits;
+            result.UsableBits += (std::min)(period.CapacityBps, (std::min)(period.SceneBps, double(MaxBitrate))) / FrameRate;
+            if (frame.ArrivalMS - frame.CaptureMS > LatencyBudgetMS)
+            {
+                result.LateFrames++;
+            }
+        }
+
+        return result;
+    }
+
+    // Reports from fromMS up to toMS.
+    std::vector<Sample> Between(const Result& result, double fromMS, double toMS)
+    {
+        std::vector<Sample> samples;
+        for (const Sample& sample : result.Reports)
+        {
+            if (sample.TimeMS > fromMS && sample.TimeMS <= toMS)
+            {
+                samples.push_back(sample);
+            }
+        }
+        return samples;
+    }
+
+    // Seconds after fromMS until the target first satisfies the condition, or -1.
+    template <typename Condition>
+    double SecondsUntil(const Result& result, double fromMS, Condition condition)
+    {
+        for (const Sample& sample : result.Reports)
+        {
+            if (sample.TimeMS > fromMS && condition(sample))
+            {
+                return (sample.TimeMS - fromMS) / 1000;
+            }
+        }
+        return -1;
+    }
+
+    bool Expect(bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            printf("    FAILED: %s\n", what);
+        }
+        return condition;
+    }
+
+    // 20 s of a static scene on a fast link, then the scene starts moving.
+    // The target has to stay where it was, and not have decayed towards what the static scene needed.
+    bool CheckStaticScene(const Result& result)
+    {
+        bool held = true;
+        for (const Sample& sample : Between(result, 0, 20000))
+        {
+            held &= sample.Target == MaxBitrate;
+        }
+        bool passed = Expect(held, "target held while the scene is static");
+
+        double seconds = SecondsUntil(result, 20000, [](const Sample& s) { return s.ThroughputBps >= 0.9 * MaxBitrate; });
+        passed &= Expect(seconds >= 0 && seconds <= 2, "throughput back at the target within 2 s of the scene moving");
+        return passed;
+    }
+
+    // Capacity drops from 12 to 3 Mbps for 20 s and comes back.
+    bool CheckCapacityStep(const Result& result)
+    {
+        bool passed = true;
+
+        double down = SecondsUntil(result, 20000, [](const Sample& s) { return s.Target <= 3000000; });
+        passed &= Expect(down >= 0 && down <= 5, "target under the new capacity within 5 s of the drop");
+
+        bool settled = true;
+        for (const Sample& sample : Between(result, 30000, 40000))
+        {
+            settled &= sample.Target >= 1500000;
+        }
+        passed &= Expect(settled, "target stays above half the capacity once settled");
+
+        double up = SecondsUntil(result, 40000, [](const Sample& s) { return s.Target >= 0.9 * MaxBitrate; });
+        passed &= Expect(up >= 0 && up <= 30, "target back near the maximum within 30 s of the capacity coming back");
+        return passed;
+    }
+
+    // Capacity moving between 2 and 12 Mbps every half second, as on a busy wireless link.
+    bool CheckVariable(const Result& result)
+    {
+        bool aboveMin = true;
+        for (const Sample& sample : result.Reports)
+        {
+            aboveMin &= sample.Target > MinBitrate;
+        }
+        bool passed = Expect(aboveMin, "target never falls to the minimum");
+        passed &= Expect(result.SentBits >= 0.5 * result.UsableBits, "at least half of the capacity used");
+        return passed;
+    }
+
+    std::vector<Trace> GenerateTraces()
+    {
+        std::vector<Trace> traces;
+
+        Trace still = { "static scene", {}, CheckStaticScene };
+        still.Periods.push_back({ 20000, 20000000, 300000 });
+        still.Periods.push_back({ 20000, 20000000, UnlimitedScene });
+        traces.push_back(still);
+
+        Trace step = { "capacity step", {}, CheckCapacityStep };
+        step.Periods.push_back({ 20000, 12000000, UnlimitedScene });
+        step.Periods.push_back({ 20000, 3000000, UnlimitedScene });
+        step.Periods.push_back({ 40000, 12000000, UnlimitedScene });
+        traces.push_back(step);
+
+        // Fixed seed, so the trace is the same on every run.
+        Trace variable = { "variable capacity", {}, CheckVariable };
+        uint32_t state = 12345;
+        for (int i = 0; i < 240; i++)
+        {
+            state = state * 1664525u + 1013904223u;
+            double capacity = 2000000 + (state >> 8) % 10000000;
+            variable.Periods.push_back({ 500, capacity, UnlimitedScene });
+        }
+        traces.push_back(variable);
+
+        return traces;
+    }
+
+    bool ReadTrace(const char* path, Trace& trace)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            fprintf(stderr, "Could not open %s\n", path);
+            return false;
+        }
+
+        trace.Name = path;
+        trace.Check = nullptr;
+
+        double durationMS, kbps;
+        while (file >> durationMS >> kbps)
+        {
+            trace.Periods.push_back({ durationMS, kbps * 1000, UnlimitedScene });
+        }
+
+        if (trace.Periods.empty())
+        {
+            fprintf(stderr, "%s has no periods\n", path);
+            return false;
+        }
+
+        return true;
+    }
+
+    const char* StateName(BitrateController::UsageState state)
+    {
+        switch (state)
+        {
+        case BitrateController::UsageState::Overuse:
+            return "overuse";
+        case BitrateController::UsageState::Underuse:
+            return "underuse";
+        default:
+            return "normal";
+        }
+    }
+
+    bool Report(const Trace& trace, bool verbose)
+    {
+        Result result = Simulate(trace);
+
+        uint32_t minTarget = MaxBitrate;
+        for (const Sample& sample : result.Reports)
+        {
+            minTarget = (std::min)(minTarget, sample.Target);
+        }
+
+        printf("%s: %u frames, %.1f%% late, %.1f%% of the usable capacity sent, lowest target %.2f Mbps\n",
+            trace.Name.c_str(),
+            result.Frames,
+            100.0 * result.LateFrames / result.Frames,
+            100.0 * result.SentBits / result.UsableBits,
+            minTarget / 1e6);
+
+        if (verbose)
+        {
+            printf("    %8s %10s %10s %10s %10s %6s %8s\n", "time s", "capacity", "target", "received", "jitter ms", "queue", "state");
+            for (const Sample& sample : result.Reports)
+            {
+                printf("    %8.0f %10.2f %10.2f %10.2f %10.1f %6u %8s\n",
+                    sample.TimeMS / 1000,
+                    sample.CapacityBps / 1e6,
+                    sample.Target / 1e6,
+                    sample.ThroughputBps / 1e6,
+                    sample.hnsJitter / 10000.0,
+                    sample.QueueDepth,
+                    StateName(sample.State));
+            }
+        }
+
+        return trace.Check == nullptr || trace.Check(result);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool verbose = false;
+    std::vector<Trace> traces;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = true;
+            continue;
+        }
+
+        Trace trace;
+        if (!ReadTrace(argv[i], trace))
+        {
+            return 1;
+        }
+        traces.push_back(trace);
+    }
+
+    if (traces.empty())
+    {
+        traces = GenerateTraces();
+    }
+
+    printf("Bitrate %.1f to %.1f Mbps, %.0f fps, %.0f ms propagation delay, frames later than %.0f ms are late.\n\n",
+        MinBitrate / 1e6, MaxBitrate / 1e6, FrameRate, PropagationMS, LatencyBudgetMS);
+
+    bool passed = true;
+    for (const Trace& trace : traces)
+    {
+        passed &= Report(trace, verbose);
+    }
+
+    return passed ? 0 : 1;
+}
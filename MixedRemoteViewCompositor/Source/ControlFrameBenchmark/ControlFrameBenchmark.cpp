@@ -0,0 +1,399 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Measures what a header only control message costs to send, like the start, stop and keyframe
+// requests ConnectionImpl::SendPayloadType sends, by time and heap allocations per message.
+// - new buffer and bundle: a buffer and a bundle are made for every message, like before the
+//   control frames were cached.
+// - cached frame, queued: every message shares the frame built for its type, and the write is
+//   queued on the send queue, like SendPayloadType from any other thread.
+// - cached frame, inline: the same from a thread already on the send queue, so it runs inline.
+// The send queue is a serial executor on its own worker thread, like SerialWorkQueue, and the
+// socket is a buffer in memory, so only the cost of the send path is measured. The receiving
+// side checks every header that was written.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 ControlFrameBenchmark.cpp
+// or:
+//     g++ -std=c++14 -O2 -pthread ControlFrameBenchmark.cpp
+//
+// Usage: ControlFrameBenchmark [messages per case]
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::atomic<long long> s_allocations(0);
+}
+
+// counts every heap allocation of the process, the cases are measured one at a time
+void* operator new(size_t size)
+{
+    s_allocations++;
+
+    void* p = malloc(size > 0 ? size : 1);
+    if (nullptr == p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // PayloadType values from MixedRemoteViewCompositor.idl
+    const uint32_t PayloadType_RequestMediaDescription = 6;
+    const uint32_t PayloadType_RequestMediaStart = 7;
+    const uint32_t PayloadType_RequestMediaStop = 8;
+    const uint32_t PayloadType_RequestKeyFrame = 18;
+    const uint32_t PayloadType_ENDOFLIST = 20;
+
+    const uint32_t ControlTypes[] =
+    {
+        PayloadType_RequestMediaDescription,
+        PayloadType_RequestMediaStart,
+        PayloadType_RequestKeyFrame,
+        PayloadType_RequestMediaStop,
+    };
+    const int NumControlTypes = sizeof(ControlTypes) / sizeof(ControlTypes[0]);
+
+    struct PayloadHeader
+    {
+        uint32_t ePayloadType;
+        uint32_t cbPayloadSize;
+    };
+
+    typedef std::vector<uint8_t> Buffer;
+    typedef std::list<std::shared_ptr<const Buffer>> Bundle;
+
+    enum class SendMode
+    {
+        NewBundle,
+        CachedQueued,
+        CachedInline
+    };
+
+    // The socket's output stream, writes land in order in memory.
+    class Socket
+    {
+    public:
+        explicit Socket(size_t capacity)
+        {
+            _written.reserve(capacity);
+        }
+
+        void Write(const Buffer& buffer)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _written.insert(_written.end(), buffer.begin(), buffer.end());
+        }
+
+        const std::vector<uint8_t>& GetWritten() const { return _written; }
+
+    private:
+        std::mutex _mutex;
+        std::vector<uint8_t> _written;
+    };
+
+    // One worker thread that runs its items in order, and runs an item inline when queued
+    // from that thread.
+    class SendQueue
+    {
+    public:
+        SendQueue()
+            : _isStopping(false)
+            , _worker([this]() { Work(); })
+        {
+        }
+
+        ~SendQueue()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _isStopping = true;
+            }
+            _available.notify_one();
+            _worker.join();
+        }
+
+        void Run(std::function<void()>&& workItem)
+        {
+            if (std::this_thread::get_id() == _worker.get_id())
+            {
+                workItem();
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _workItems.push_back(std::move(workItem));
+            }
+            _available.notify_one();
+        }
+
+        // waits until everything queued so far has run
+        void Drain()
+        {
+            std::mutex mutex;
+            std::condition_variable drained;
+            bool isDrained = false;
+            Run([&]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                isDrained = true;
+                drained.notify_one();
+            });
+
+            std::unique_lock<std::mutex> lock(mutex);
+            drained.wait(lock, [&]() { return isDrained; });
+        }
+
+    private:
+        void Work()
+        {
+            for (;;)
+            {
+                std::function<void()> workItem;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _available.wait(lock, [this]() { return _isStopping || !_workItems.empty(); });
+                    if (_workItems.empty())
+                    {
+                        return;
+                    }
+
+                    workItem = std::move(_workItems.front());
+                    _workItems.pop_front();
+                }
+
+                workItem();
+            }
+        }
+
+        std::mutex _mutex;
+        std::condition_variable _available;
+        std::deque<std::function<void()>> _workItems;
+        bool _isStopping;
+        std::thread _worker;
+    };
+
+    std::shared_ptr<const Buffer> MakeFrame(uint32_t payloadType)
+    {
+        PayloadHeader header;
+        header.ePayloadType = payloadType;
+        header.cbPayloadSize = 0;
+
+        std::shared_ptr<Buffer> spFrame = std::make_shared<Buffer>(sizeof(header));
+        memcpy(spFrame->data(), &header, sizeof(header));
+        return spFrame;
+    }
+
+    class Connection
+    {
+    public:
+        Connection(Socket& socket)
+            : _socket(socket)
+            , _controlFrames(PayloadType_ENDOFLIST)
+        {
+        }
+
+        // before the control frames were cached
+        void SendNewBundle(uint32_t payloadType)
+        {
+            std::shared_ptr<Bundle> spBundle = std::make_shared<Bundle>();
+            spBundle->push_back(MakeFrame(payloadType));
+
+            _sendQueue.Run([this, spBundle]()
+            {
+                for (const std::shared_ptr<const Buffer>& spBuffer : *spBundle)
+                {
+                    _socket.Write(*spBuffer);
+                }
+            });
+        }
+
+        // ConnectionImpl::SendPayloadType
+        void SendPayloadType(uint32_t payloadType)
+        {
+            std::shared_ptr<const Buffer> spFrame = GetControlFrame(payloadType);
+
+            _sendQueue.Run([this, spFrame]()
+            {
+                _socket.Write(*spFrame);
+            });
+        }
+
+        SendQueue& GetSendQueue() { return _sendQueue; }
+
+    private:
+        std::shared_ptr<const Buffer> GetControlFrame(uint32_t payloadType)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+
+            std::shared_ptr<const Buffer>& spFrame = _controlFrames[payloadType];
+            if (nullptr == spFrame)
+            {
+                spFrame = MakeFrame(payloadType);
+            }
+            return spFrame;
+        }
+
+        Socket& _socket;
+        std::mutex _lock;
+        std::vector<std::shared_ptr<const Buffer>> _controlFrames;
+
+        // last, so its worker is done before the rest goes away
+        SendQueue _sendQueue;
+    };
+
+    struct Result
+    {
+        double NanosecondsPerMessage;
+        double AllocationsPerMessage;
+        bool IsValid;
+    };
+
+    bool CheckWritten(const std::vector<uint8_t>& written, int numMessages)
+    {
+        if (written.size() != (size_t)numMessages * sizeof(PayloadHeader))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < numMessages; i++)
+        {
+            PayloadHeader header;
+            memcpy(&header, &written[i * sizeof(header)], sizeof(header));
+            if (header.ePayloadType != ControlTypes[i % NumControlTypes] || 0 != header.cbPayloadSize)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Result Measure(SendMode mode, int numMessages)
+    {
+        Socket socket((numMessages + NumControlTypes) * sizeof(PayloadHeader));
+        Connection connection(socket);
+
+        // build the frames up front, like after the first message of each type
+        for (int i = 0; i < NumControlTypes; i++)
+        {
+            connection.SendPayloadType(ControlTypes[i]);
+        }
+        connection.GetSendQueue().Drain();
+        size_t warmup = socket.GetWritten().size();
+
+        auto send = [&]()
+        {
+            for (int i = 0; i < numMessages; i++)
+            {
+                uint32_t payloadType = ControlTypes[i % NumControlTypes];
+                if (SendMode::NewBundle == mode)
+                {
+                    connection.SendNewBundle(payloadType);
+                }
+                else
+                {
+                    connection.SendPayloadType(payloadType);
+                }
+            }
+        };
+
+        long long allocations = s_allocations;
+        Clock::time_point start = Clock::now();
+
+        if (SendMode::CachedInline == mode)
+        {
+            connection.GetSendQueue().Run(send);
+        }
+        else
+        {
+            send();
+        }
+        connection.GetSendQueue().Drain();
+
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        allocations = s_allocations - allocations;
+
+        std::vector<uint8_t> written(socket.GetWritten().begin() + warmup, socket.GetWritten().end());
+
+        Result result;
+        result.NanosecondsPerMessage = seconds * 1e9 / numMessages;
+        result.AllocationsPerMessage = (double)allocations / numMessages;
+        result.IsValid = CheckWritten(written, numMessages);
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int numMessages = argc > 1 ? atoi(argv[1]) : 1000000;
+    if (numMessages <= 0)
+    {
+        fprintf(stderr, "Usage: ControlFrameBenchmark [messages per case]\n");
+        return 1;
+    }
+
+    struct Run
+    {
+        const char* Name;
+        SendMode Mode;
+    };
+
+    const Run runs[] =
+    {
+        { "new buffer and bundle", SendMode::NewBundle },
+        { "cached frame, queued", SendMode::CachedQueued },
+        { "cached frame, inline", SendMode::CachedInline },
+    };
+
+    printf("%d control messages per case:\n", numMessages);
+    printf("    %-24s %14s %14s\n", "", "ns/message", "allocs/message");
+
+    bool passed = true;
+    for (const Run& run : runs)
+    {
+        Result result = Measure(run.Mode, numMessages);
+        printf("    %-24s %14.1f %14.2f%s\n", run.Name,
+            result.NanosecondsPerMessage, result.AllocationsPerMessage,
+            result.IsValid ? "" : "  FAILED");
+
+        passed &= result.IsValid;
+    }
+
+    if (!passed)
+    {
+        printf("\nThe written headers did not match the messages sent.\n");
+        return 1;
+    }
+
+    return 0;
+}
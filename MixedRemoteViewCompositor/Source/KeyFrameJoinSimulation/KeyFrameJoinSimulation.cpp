@@ -0,0 +1,343 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Simulates a receiver joining a capture and asking for keyframes, and measures how long it
+// waits for a frame it can decode.
+// The capture side forces keyframes through KeyFrameRequestLimiter like CaptureEngine does, the
+// sink holds back delta frames after a keyframe request like NetworkMediaSinkStream does, and the
+// encoder also puts out a keyframe every GOP. Each case runs with the old handling, where the
+// receiver sent a keyframe request along with the start request and a request inside the minimum
+// interval was dropped, and with the current one, where the start request is enough and a request
+// inside the interval is deferred to its end.
+// Everything is simulated in steps of a millisecond, so it always gives the same result.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 KeyFrameJoinSimulation.cpp
+// or:
+//     g++ -std=c++14 -O2 KeyFrameJoinSimulation.cpp
+//
+// Usage: KeyFrameJoinSimulation [GOP in seconds]
+
+#include "../Shared/Media/KeyFrameRequestLimiter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+using namespace MixedRemoteViewCompositor::Media;
+
+namespace
+{
+    const double FrameRate = 30;
+    const double FrameMS = 1000 / FrameRate;
+
+    // c_hnsMinKeyFrameInterval in CaptureEngine.cpp
+    const int MinKeyFrameIntervalMS = 500;
+
+    // One way delay of the link, and how long a frame takes from capture to the sink.
+    const int DelayMS = 20;
+    const int EncodeMS = 15;
+
+    // Requests the source stream sends after flushing, counted from the join.
+    const int FirstRequestMS = 100;
+    const int LastRequestMS = 900;
+    const int RequestStepMS = 100;
+
+    // Requests in a burst, like a lossy link that makes the source flush again and again.
+    const int BurstRequests = 3;
+    const int BurstSpacingMS = 100;
+
+    const int HnsPerMS = 10000;
+
+    enum class Policy
+    {
+        Drop,
+        Defer
+    };
+
+    enum class Message
+    {
+        RequestMediaStart,
+        RequestKeyFrame
+    };
+
+    struct TimedMessage
+    {
+        int TimeMS;
+        Message Type;
+    };
+
+    struct TimedSample
+    {
+        int TimeMS;
+        bool IsKeyFrame;
+    };
+
+    struct Result
+    {
+        // from sending the last request until a keyframe arrives, -1 when none did
+        int WaitMS;
+        // delta frames the sink held back
+        int HeldFrames;
+    };
+
+    class Simulation
+    {
+    public:
+        Simulation(Policy policy, int gopFrames)
+            : _policy(policy)
+            , _gopFrames(gopFrames)
+            , _limiter((int64_t)MinKeyFrameIntervalMS * HnsPerMS)
+            , _lastForcedMS(0)
+            , _hasForced(false)
+            , _forceNext(false)
+            , _deferredMS(-1)
+            , _isConnected(false)
+            , _waitForKeyFrame(false)
+        {
+        }
+
+        // requests are the receiver's send times, the first one is the start request
+        Result Run(const std::vector<int>& requestsMS)
+        {
+            std::deque<TimedMessage> messages;
+            for (size_t i = 0; i < requestsMS.size(); i++)
+            {
+                Message type = i == 0 ? Message::RequestMediaStart : Message::RequestKeyFrame;
+                messages.push_back({ requestsMS[i] + DelayMS, type });
+
+                // the source used to ask for a keyframe right after the start request
+                if (i == 0 && Policy::Drop == _policy)
+                {
+                    messages.push_back({ requestsMS[i] + DelayMS, Message::RequestKeyFrame });
+                }
+            }
+
+            int lastRequestMS = requestsMS.back();
+            int endMS = lastRequestMS + 2 * _gopFrames * (int)FrameMS + 1000;
+
+            std::deque<TimedSample> toSink;
+            std::deque<TimedSample> toReceiver;
+            int frame = 0;
+            Result result = { -1, 0 };
+
+            for (int now = 0; now < endMS && result.WaitMS < 0; now++)
+            {
+                while (!messages.empty() && messages.front().TimeMS == now)
+                {
+                    OnMessage(messages.front().Type, now);
+                    messages.pop_front();
+                }
+
+                if (now == _deferredMS)
+                {
+                    _deferredMS = -1;
+                    _forceNext |= _limiter.ForceDeferred((int64_t)now * HnsPerMS);
+                }
+
+                if (now == (int)(frame * FrameMS))
+                {
+                    bool isKeyFrame = _forceNext || frame % _gopFrames == 0;
+                    _forceNext = false;
+                    toSink.push_back({ now + EncodeMS, isKeyFrame });
+                    frame++;
+                }
+
+                while (!toSink.empty() && toSink.front().TimeMS == now)
+                {
+                    TimedSample sample = toSink.front();
+                    toSink.pop_front();
+
+                    if (_waitForKeyFrame && sample.IsKeyFrame)
+                    {
+                        _waitForKeyFrame = false;
+                    }
+
+                    if (!_isConnected)
+                    {
+                        continue;
+                    }
+
+                    if (_waitForKeyFrame)
+                    {
+                        result.HeldFrames++;
+                        continue;
+                    }
+
+                    toReceiver.push_back({ now + DelayMS, sample.IsKeyFrame });
+                }
+
+                // the receiver flushed when it sent the request, so only a keyframe after it helps
+                while (!toReceiver.empty() && toReceiver.front().TimeMS == now)
+                {
+                    if (toReceiver.front().IsKeyFrame && now > lastRequestMS)
+                    {
+                        result.WaitMS = now - lastRequestMS;
+                    }
+                    toReceiver.pop_front();
+                }
+            }
+
+            return result;
+        }
+
+    private:
+        void OnMessage(Message type, int now)
+        {
+            // NetworkMediaSinkImpl
+            if (Message::RequestMediaStart == type)
+            {
+                _isConnected = true;
+            }
+            else if (_isConnected)
+            {
+                _waitForKeyFrame = true;
+            }
+
+            // CaptureEngineImpl::ForceKeyFrame
+            if (Policy::Drop == _policy)
+            {
+                if (_hasForced && now - _lastForcedMS < MinKeyFrameIntervalMS)
+                {
+                    return;
+                }
+
+                _lastForcedMS = now;
+                _hasForced = true;
+                _forceNext = true;
+                return;
+            }
+
+            int64_t hnsNow = (int64_t)now * HnsPerMS;
+            switch (_limiter.Request(hnsNow))
+            {
+            case KeyFrameRequestLimiter::Decision::ForceNow:
+                _forceNext = true;
+                break;
+            case KeyFrameRequestLimiter::Decision::Defer:
+                _deferredMS = now + (int)((_limiter.GetDelay(hnsNow) + HnsPerMS - 1) / HnsPerMS);
+                break;
+            case KeyFrameRequestLimiter::Decision::AlreadyDeferred:
+                break;
+            }
+        }
+
+    private:
+        Policy _policy;
+        int _gopFrames;
+
+        KeyFrameRequestLimiter _limiter;
+        int _lastForcedMS;
+        bool _hasForced;
+        bool _forceNext;
+        int _deferredMS;
+
+        bool _isConnected;
+        bool _waitForKeyFrame;
+    };
+
+    int Percentile(std::vector<int> values, double p)
+    {
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(p * (values.size() - 1))];
+    }
+
+    // Runs the requests at every phase of the GOP, returns false when a receiver never got a keyframe.
+    bool RunCase(const char* name, Policy policy, int gopFrames, const std::vector<int>& requestsMS, int& maxWaitMS)
+    {
+        std::vector<int> waits;
+        std::vector<int> held;
+        int gopMS = (int)(gopFrames * FrameMS);
+        for (int phaseMS = 0; phaseMS < gopMS; phaseMS += 5)
+        {
+            std::vector<int> shifted;
+            for (int requestMS : requestsMS)
+            {
+                shifted.push_back(requestMS + phaseMS);
+            }
+
+            Simulation simulation(policy, gopFrames);
+            Result result = simulation.Run(shifted);
+            if (result.WaitMS < 0)
+            {
+                printf("    %-44s FAILED, no keyframe arrived\n", name);
+                return false;
+            }
+
+            waits.push_back(result.WaitMS);
+            held.push_back(result.HeldFrames);
+        }
+
+        maxWaitMS = std::max(maxWaitMS, Percentile(waits, 1.0));
+
+        printf("    %-44s %7d %7d %7d %10d\n", name,
+            Percentile(waits, 0.5), Percentile(waits, 0.9), Percentile(waits, 1.0), Percentile(held, 1.0));
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double gopSeconds = argc > 1 ? atof(argv[1]) : 2;
+    int gopFrames = (int)(gopSeconds * FrameRate + 0.5);
+    if (gopFrames <= 0)
+    {
+        fprintf(stderr, "Usage: KeyFrameJoinSimulation [GOP in seconds]\n");
+        return 1;
+    }
+
+    printf("%d fps, a keyframe every %d frames, %d ms each way, forced keyframes at least %d ms apart.\n",
+        (int)FrameRate, gopFrames, DelayMS, MinKeyFrameIntervalMS);
+    printf("Wait in ms from the last request to a keyframe, over every phase of the GOP:\n");
+    printf("    %-44s %7s %7s %7s %10s\n", "", "median", "p90", "max", "max held");
+
+    const Policy policies[] = { Policy::Drop, Policy::Defer };
+    const char* policyNames[] = { "dropped", "deferred" };
+
+    bool passed = true;
+    int maxDeferredWaitMS = 0;
+    for (int p = 0; p < 2; p++)
+    {
+        int maxWaitMS = 0;
+        char name[64];
+
+        snprintf(name, sizeof(name), "join, %s", policyNames[p]);
+        passed &= RunCase(name, policies[p], gopFrames, { 0 }, maxWaitMS);
+
+        // a request after the join, like a source stream that flushed its backlog
+        for (int requestMS = FirstRequestMS; requestMS <= LastRequestMS; requestMS += RequestStepMS)
+        {
+            snprintf(name, sizeof(name), "join, request after %d ms, %s", requestMS, policyNames[p]);
+            passed &= RunCase(name, policies[p], gopFrames, { 0, requestMS }, maxWaitMS);
+        }
+
+        std::vector<int> burst = { 0 };
+        for (int i = 0; i < BurstRequests; i++)
+        {
+            burst.push_back(1000 + i * BurstSpacingMS);
+        }
+        snprintf(name, sizeof(name), "%d requests %d ms apart, %s", BurstRequests, BurstSpacingMS, policyNames[p]);
+        passed &= RunCase(name, policies[p], gopFrames, burst, maxWaitMS);
+
+        printf("\n");
+
+        if (Policy::Defer == policies[p])
+        {
+            maxDeferredWaitMS = maxWaitMS;
+        }
+    }
+
+    // a deferred keyframe waits out the interval, then the next frame, the encoder and the link
+    int boundMS = MinKeyFrameIntervalMS + (int)FrameMS + 1 + EncodeMS + 2 * DelayMS;
+    printf("Longest wait with deferred requests: %d ms, bound %d ms.\n", maxDeferredWaitMS, boundMS);
+
+    if (!passed || maxDeferredWaitMS > boundMS)
+    {
+        printf("\nA receiver waited longer than the bound for a keyframe.\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -93,6 +93,7 @@ the queue.
 //
 //-------------------------------------------------------------------
 #include "linklist.h"
+#include "WorkQueue.h"
 
 MIDL_INTERFACE("5cff332d-d364-42b3-9c45-242a20a64330")
 ILockable
@@ -125,6 +126,7 @@ protected:
         : m_OnProcessQueue(static_cast<T *>(this)
         , &OpQueue::ProcessQueueAsync)
         , m_parent(parent)
+        , m_fProcessPending(false)
     {
     }
 
@@ -136,6 +138,8 @@ protected:
     OpList m_OpQueue;   // Queue of operations.
     ComPtr<ILockable> m_parent;
     AsyncCallback<T> m_OnProcessQueue;  // ProcessQueueAsync callback.
+    SerialWorkQueue m_WorkQueue;        // Serial executor for this queue.
+    bool m_fProcessPending;             // ProcessQueue was called from the executor.
 };
 
 
@@ -166,7 +170,9 @@ HRESULT OpQueue<T, TOperation>::QueueOperation(TOperation* pOp)
 // Process the next operation on the queue.
 // Protected method.
 //
-// Note: This method dispatches the operation to a work queue.
+// Note: This method dispatches the operation to a work queue. When it
+// is called from that work queue, the pending dispatch loop picks up
+// the next operation instead.
 //-------------------------------------------------------------------
 
 template <class T, class TOperation>
@@ -175,12 +181,21 @@ HRESULT OpQueue<T, TOperation>::ProcessQueue()
     HRESULT hr = S_OK;
     if (m_OpQueue.GetCount() > 0)
     {
-        hr = MFPutWorkItem2(
-            MFASYNC_CALLBACK_QUEUE_STANDARD,    // Use the standard work queue.
-            0,                                  // Default priority
-            &m_OnProcessQueue,                  // Callback method.
-            nullptr                             // State object.
-            );
+        if (m_WorkQueue.IsCurrentThread())
+        {
+            m_fProcessPending = true;
+
+            return S_OK;
+        }
+
+        hr = m_WorkQueue.Initialize();
+        if (SUCCEEDED(hr))
+        {
+            hr = m_WorkQueue.PutWorkItem(
+                &m_OnProcessQueue,                  // Callback method.
+                nullptr                             // State object.
+                );
+        }
     }
     return hr;
 }
@@ -197,32 +212,40 @@ template <class T, class TOperation>
 HRESULT OpQueue<T, TOperation>::ProcessQueueAsync(IMFAsyncResult* pResult)
 {
     HRESULT hr = S_OK;
-    TOperation* pOp = nullptr;
 
     auto lock = m_parent->Lock();
 
-    if (m_OpQueue.GetCount() > 0)
+    auto dispatch = m_WorkQueue.EnterDispatch();
+
+    do
     {
-        hr = m_OpQueue.GetFront(&pOp);
+        TOperation* pOp = nullptr;
 
-        if (SUCCEEDED(hr))
-        {
-            hr = ValidateOperation(pOp);
-        }
-        if (SUCCEEDED(hr))
+        m_fProcessPending = false;
+
+        if (m_OpQueue.GetCount() > 0)
         {
-            hr = m_OpQueue.RemoveFront(nullptr);
+            hr = m_OpQueue.GetFront(&pOp);
+
+            if (SUCCEEDED(hr))
+            {
+                hr = ValidateOperation(pOp);
+            }
+            if (SUCCEEDED(hr))
+            {
+                hr = m_OpQueue.RemoveFront(nullptr);
+            }
+            if (SUCCEEDED(hr))
+            {
+                (void)DispatchOperation(pOp);
+            }
         }
-        if (SUCCEEDED(hr))
+
+        if (pOp != nullptr)
         {
-            (void)DispatchOperation(pOp);
+            pOp->Release();
         }
-    }
-
-    if (pOp != nullptr)
-    {
-        pOp->Release();
-    }
+    } while (SUCCEEDED(hr) && m_fProcessPending);
 
     return hr;
 }
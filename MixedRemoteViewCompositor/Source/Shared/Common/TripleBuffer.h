@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+Lock-free triple buffer for handing the latest value from one producer
+thread to one consumer thread.
+
+The producer writes into its own slot and publishes it. Publishing swaps
+that slot with the shared slot and marks it as new. The consumer swaps
+the shared slot with its own slot only when a new value is there. Each
+side owns one slot, so neither side waits for the other. Values that
+are published before the consumer gets to them are overwritten, so the
+consumer always sees the freshest completed value.
+
+Only standard C++ is used here, so the index logic can be built and
+tested outside of the Windows build.
+*/
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+        : _writeIndex(0)
+        , _sharedIndex(1)
+        , _readIndex(2)
+    {
+    }
+
+    // producer: slot to fill before calling Publish
+    T& GetWriteSlot()
+    {
+        return _slots[_writeIndex];
+    }
+
+    // producer: hands the write slot to the consumer and takes a free one
+    void Publish()
+    {
+        uint8_t previous = _sharedIndex.exchange(_writeIndex | c_newFlag, std::memory_order_acq_rel);
+
+        _writeIndex = previous & c_indexMask;
+    }
+
+    // consumer: true if a value was published since the last call
+    bool HasNew() const
+    {
+        return 0 != (_sharedIndex.load(std::memory_order_acquire) & c_newFlag);
+    }
+
+    // consumer: moves the latest published slot into the read slot,
+    // returns false and keeps the current read slot if nothing is new
+    bool Acquire()
+    {
+        if (!HasNew())
+        {
+            return false;
+        }
+
+        uint8_t previous = _sharedIndex.exchange(_readIndex, std::memory_order_acq_rel);
+
+        _readIndex = previous & c_indexMask;
+
+        return true;
+    }
+
+    // consumer: slot returned by the last successful Acquire
+    T& GetReadSlot()
+    {
+        return _slots[_readIndex];
+    }
+
+private:
+    TripleBuffer(const TripleBuffer&);
+    TripleBuffer& operator=(const TripleBuffer&);
+
+    static const uint8_t c_indexMask = 0x3;
+    static const uint8_t c_newFlag = 0x4;
+
+    T _slots[3];
+
+    uint8_t _writeIndex;                // owned by the producer
+    std::atomic<uint8_t> _sharedIndex;  // last published slot and the new flag
+    uint8_t _readIndex;                 // owned by the consumer
+};
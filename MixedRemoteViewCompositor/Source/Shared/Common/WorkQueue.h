@@ -0,0 +1,189 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+/*
+SerialWorkQueue is a per-object executor for the media pipeline.
+
+Every instance is a Media Foundation serial work queue layered on the
+shared multithreaded platform queue. The worker threads are owned by
+Media Foundation and bounded by the platform. Items put on one instance
+are still dispatched one at a time and in the order they were queued.
+This keeps the work for a stream from running in parallel on several
+threads, which the generic thread pool does not guarantee.
+
+Work that is queued from a thread already dispatching for the same
+instance can run inline with Run(). That skips a hop through the
+platform queue. Callbacks that are not queued through Run/RunAsync have
+to mark their dispatch with EnterDispatch() for this to work.
+*/
+class SerialWorkQueue
+{
+public:
+    // Marks the calling thread as dispatching for a queue until it goes
+    // out of scope. Nested scopes restore the outer owner.
+    class DispatchScope
+    {
+    public:
+        DispatchScope(_In_ SerialWorkQueue* pQueue)
+            : _pQueue(pQueue)
+            , _dwPrevThreadId(pQueue->_dwDispatchThreadId.exchange(GetCurrentThreadId()))
+        {
+        }
+
+        DispatchScope(DispatchScope&& other)
+            : _pQueue(other._pQueue)
+            , _dwPrevThreadId(other._dwPrevThreadId)
+        {
+            other._pQueue = nullptr;
+        }
+
+        ~DispatchScope()
+        {
+            if (nullptr != _pQueue)
+            {
+                _pQueue->_dwDispatchThreadId = _dwPrevThreadId;
+            }
+        }
+
+    private:
+        DispatchScope(const DispatchScope&);
+        DispatchScope& operator=(const DispatchScope&);
+
+        SerialWorkQueue* _pQueue;
+        DWORD _dwPrevThreadId;
+    };
+
+    SerialWorkQueue()
+        : _dwQueueId(MFASYNC_CALLBACK_QUEUE_UNDEFINED)
+        , _dwDispatchThreadId(0)
+    {
+    }
+
+    ~SerialWorkQueue()
+    {
+        Shutdown();
+    }
+
+    HRESULT Initialize()
+    {
+        if (MFASYNC_CALLBACK_QUEUE_UNDEFINED != _dwQueueId)
+        {
+            return S_OK;
+        }
+
+        return MFAllocateSerialWorkQueue(MFASYNC_CALLBACK_QUEUE_MULTITHREADED, &_dwQueueId);
+    }
+
+    void Shutdown()
+    {
+        if (MFASYNC_CALLBACK_QUEUE_UNDEFINED != _dwQueueId)
+        {
+            MFUnlockWorkQueue(_dwQueueId);
+
+            _dwQueueId = MFASYNC_CALLBACK_QUEUE_UNDEFINED;
+        }
+    }
+
+    DWORD GetId() const
+    {
+        return _dwQueueId;
+    }
+
+    // true while the calling thread is dispatching an item for this queue
+    bool IsCurrentThread() const
+    {
+        return _dwDispatchThreadId == GetCurrentThreadId();
+    }
+
+    DispatchScope EnterDispatch()
+    {
+        return DispatchScope(this);
+    }
+
+    HRESULT PutWorkItem(
+        _In_ IMFAsyncCallback* pCallback,
+        _In_opt_ IUnknown* pState)
+    {
+        if (MFASYNC_CALLBACK_QUEUE_UNDEFINED == _dwQueueId)
+        {
+            return MF_E_SHUTDOWN;
+        }
+
+        return MFPutWorkItem2(_dwQueueId, 0, pCallback, pState);
+    }
+
+    // Always queues the work, even when called from this queue.
+    HRESULT RunAsync(
+        _In_ std::function<HRESULT()>&& workItem)
+    {
+        Microsoft::WRL::ComPtr<WorkItemCallback> spCallback =
+            Microsoft::WRL::Make<WorkItemCallback>(this, std::move(workItem));
+        if (nullptr == spCallback)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        return PutWorkItem(spCallback.Get(), nullptr);
+    }
+
+    // Runs the work inline when already on this queue, queues it otherwise.
+    HRESULT Run(
+        _In_ std::function<HRESULT()>&& workItem)
+    {
+        if (IsCurrentThread())
+        {
+            return workItem();
+        }
+
+        return RunAsync(std::move(workItem));
+    }
+
+private:
+    class WorkItemCallback
+        : public Microsoft::WRL::RuntimeClass
+        < Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>
+        , IMFAsyncCallback >
+    {
+    public:
+        WorkItemCallback(
+            _In_ SerialWorkQueue* pQueue,
+            _In_ std::function<HRESULT()>&& workItem)
+            : _pQueue(pQueue)
+            , _workItem(std::move(workItem))
+        {
+        }
+
+        // IMFAsyncCallback methods
+        STDMETHODIMP GetParameters(DWORD*, DWORD*)
+        {
+            // Implementation of this method is optional.
+            return E_NOTIMPL;
+        }
+
+        STDMETHODIMP Invoke(IMFAsyncResult* pAsyncResult)
+        {
+            UNREFERENCED_PARAMETER(pAsyncResult);
+
+            // the work item holds a reference to the owner of the queue
+            auto dispatch = _pQueue->EnterDispatch();
+
+            return _workItem();
+        }
+
+    private:
+        SerialWorkQueue* _pQueue;
+        std::function<HRESULT()> _workItem;
+    };
+
+private:
+    SerialWorkQueue(const SerialWorkQueue&);
+    SerialWorkQueue& operator=(const SerialWorkQueue&);
+
+    DWORD _dwQueueId;
+    std::atomic<DWORD> _dwDispatchThreadId;
+};
@@ -0,0 +1,162 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "BitrateController.h"
+
+#include <algorithm>
+
+using namespace MixedRemoteViewCompositor::Media;
+
+// growth per report while the path is not congested
+const double c_flIncreaseFactor = 1.08;
+
+// on overuse, drop just under what actually made it through
+const double c_flDecreaseFactor = 0.85;
+
+// jitter above the smoothed trend by this much (100ns units) counts as a growing queue
+const double c_hnsOveruseThreshold = 50000.0;
+const double c_flJitterSmoothing = 0.2;
+
+// receiver is holding more than this many samples, it is falling behind
+const uint32_t c_cMaxQueueDepth = 4;
+
+// loss based bounds, as fraction of samples dropped by the receiver
+const double c_flHighDropRatio = 0.10;
+const double c_flLowDropRatio = 0.02;
+
+// receiver got less than this fraction of the estimate, the encoder is not filling it
+const double c_flAppLimitedRatio = 0.8;
+
+// encoder is only reconfigured when the target moves by more than this fraction
+const double c_flApplyHysteresis = 0.05;
+
+BitrateController::BitrateController()
+    : _minBitrate(0)
+    , _maxBitrate(0)
+    , _estimatedBitrate(0)
+    , _appliedBitrate(0)
+    , _smoothedJitter(0.0)
+    , _hasJitter(false)
+    , _usageState(UsageState::Normal)
+{
+}
+
+void BitrateController::Configure(
+    uint32_t minBitrate,
+    uint32_t maxBitrate,
+    uint32_t startBitrate)
+{
+    _minBitrate = (std::min)(minBitrate, maxBitrate);
+    _maxBitrate = maxBitrate;
+    _estimatedBitrate = (std::max)(_minBitrate, (std::min)(startBitrate, _maxBitrate));
+    _appliedBitrate = _estimatedBitrate;
+
+    _smoothedJitter = 0.0;
+    _hasJitter = false;
+    _usageState = UsageState::Normal;
+}
+
+bool BitrateController::OnReceiverReport(
+    int64_t hnsInterval,
+    int64_t hnsArrivalJitter,
+    uint32_t cbReceived,
+    uint32_t cSamplesReceived,
+    uint32_t cSamplesDropped,
+    uint32_t cQueueDepth)
+{
+    if (hnsInterval <= 0 || _maxBitrate == 0)
+    {
+        return false;
+    }
+
+    // what the receiver actually got during the interval
+    double measuredBitrate = (static_cast<double>(cbReceived) * 8.0 * 10000000.0) / static_cast<double>(hnsInterval);
+
+    // delay based estimate
+    _usageState = DetectUsage(hnsArrivalJitter, cQueueDepth);
+
+    double delayBitrate = static_cast<double>(_estimatedBitrate);
+    switch (_usageState)
+    {
+    case UsageState::Overuse:
+        delayBitrate = (std::min)(delayBitrate, measuredBitrate) * c_flDecreaseFactor;
+        break;
+    case UsageState::Normal:
+        // a static scene encodes well under the target, what made it through says nothing
+        // about the path then, so only probe upward when the target is actually being used
+        if (measuredBitrate >= delayBitrate * c_flAppLimitedRatio)
+        {
+            delayBitrate *= c_flIncreaseFactor;
+        }
+        break;
+    case UsageState::Underuse:
+        // queues are draining, hold until they settle
+        break;
+    }
+
+    // loss based estimate
+    double lossBitrate = static_cast<double>(_estimatedBitrate);
+    uint32_t cSamples = cSamplesReceived + cSamplesDropped;
+    if (cSamples > 0)
+    {
+        double dropRatio = static_cast<double>(cSamplesDropped) / static_cast<double>(cSamples);
+        if (dropRatio > c_flHighDropRatio)
+        {
+            lossBitrate *= (1.0 - 0.5 * dropRatio);
+        }
+        else if (dropRatio < c_flLowDropRatio)
+        {
+            lossBitrate *= c_flIncreaseFactor;
+        }
+    }
+
+    double target = (std::min)(delayBitrate, lossBitrate);
+    target = (std::max)(static_cast<double>(_minBitrate), (std::min)(target, static_cast<double>(_maxBitrate)));
+
+    _estimatedBitrate = static_cast<uint32_t>(target);
+
+    double delta = static_cast<double>(_estimatedBitrate) - static_cast<double>(_appliedBitrate);
+    if (delta < 0)
+    {
+        delta = -delta;
+    }
+
+    // always let the bounds through so we can settle on them
+    bool atBound = (_estimatedBitrate == _minBitrate || _estimatedBitrate == _maxBitrate) && _estimatedBitrate != _appliedBitrate;
+    if (atBound || delta > static_cast<double>(_appliedBitrate) * c_flApplyHysteresis)
+    {
+        _appliedBitrate = _estimatedBitrate;
+
+        return true;
+    }
+
+    return false;
+}
+
+BitrateController::UsageState BitrateController::DetectUsage(
+    int64_t hnsArrivalJitter,
+    uint32_t cQueueDepth)
+{
+    double jitter = static_cast<double>(hnsArrivalJitter);
+    if (!_hasJitter)
+    {
+        _smoothedJitter = jitter;
+        _hasJitter = true;
+
+        return (cQueueDepth > c_cMaxQueueDepth) ? UsageState::Overuse : UsageState::Normal;
+    }
+
+    double gradient = jitter - _smoothedJitter;
+    _smoothedJitter += c_flJitterSmoothing * gradient;
+
+    if (cQueueDepth > c_cMaxQueueDepth || gradient > c_hnsOveruseThreshold)
+    {
+        return UsageState::Overuse;
+    }
+    else if (gradient < -c_hnsOveruseThreshold)
+    {
+        return UsageState::Underuse;
+    }
+
+    return UsageState::Normal;
+}
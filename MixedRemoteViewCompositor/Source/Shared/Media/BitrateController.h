@@ -0,0 +1,66 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cstdint>
+
+namespace MixedRemoteViewCompositor
+{
+    namespace Media
+    {
+        // Sender side rate control driven by receiver reports.
+        // Follows the shape of GCC (draft-ietf-rmcat-gcc): a delay based detector
+        // looks at the trend of the receiver's arrival jitter and queue depth, a loss
+        // based detector looks at samples the receiver had to drop, and the target is
+        // the lower of the two. Measured throughput only bounds the estimate on
+        // overuse; while the encoder is not filling the target it is held instead.
+        // No platform dependencies so it can be driven from recorded reports, see
+        // BitrateControllerSimulation.
+        class BitrateController
+        {
+        public:
+            enum class UsageState
+            {
+                Normal,
+                Overuse,
+                Underuse
+            };
+
+            BitrateController();
+
+            void Configure(
+                uint32_t minBitrate,
+                uint32_t maxBitrate,
+                uint32_t startBitrate);
+
+            // returns true when the target moved far enough that the encoder should be updated
+            bool OnReceiverReport(
+                int64_t hnsInterval,
+                int64_t hnsArrivalJitter,
+                uint32_t cbReceived,
+                uint32_t cSamplesReceived,
+                uint32_t cSamplesDropped,
+                uint32_t cQueueDepth);
+
+            uint32_t GetTargetBitrate() const { return _appliedBitrate; }
+            uint32_t GetEstimatedBitrate() const { return _estimatedBitrate; }
+            UsageState GetUsageState() const { return _usageState; }
+
+        private:
+            UsageState DetectUsage(
+                int64_t hnsArrivalJitter,
+                uint32_t cQueueDepth);
+
+        private:
+            uint32_t _minBitrate;
+            uint32_t _maxBitrate;
+            uint32_t _estimatedBitrate;
+            uint32_t _appliedBitrate;
+
+            double _smoothedJitter;
+            bool _hasJitter;
+            UsageState _usageState;
+        };
+    }
+}
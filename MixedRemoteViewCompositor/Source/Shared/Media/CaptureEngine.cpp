@@ -8,6 +8,12 @@ ActivatableStaticOnlyFactory(CaptureEngineStaticsImpl);
 
 typedef IAsyncOperationCompletedHandler<HSTRING*> IDeviceInformationOperationCompletedHandler;
 
+// minimum time between forced keyframes, in 100ns units
+const LONGLONG c_hnsMinKeyFrameInterval = 5000000;
+
+// lower bound for the bitrate controller, the profile bitrate is the upper bound
+const UINT32 c_uMinVideoBitrate = 500000;
+
 inline HRESULT FindResolutionsFromMediaProperties(
     _In_ IVectorView<ABI::Windows::Media::MediaProperties::IMediaEncodingProperties*>* propertiesList,
     _Out_ ResolutionList *resolutionList) throw()
@@ -149,6 +155,9 @@ CaptureEngineImpl::CaptureEngineImpl()
     , _audioEffectAdded(false)
     , _captureStarted(false)
     , _mediaCapture(nullptr)
+    , _spConnection(nullptr)
+    , _keyFrameLimiter(c_hnsMinKeyFrameInterval)
+    , _spKeyFrameTimer(nullptr)
     , _spSpatialCoordinateSystem(nullptr)
 {
 }
@@ -209,6 +218,23 @@ HRESULT CaptureEngineImpl::Close(void)
 
     _captureStarted = false;
 
+    if (nullptr != _spKeyFrameTimer)
+    {
+        LOG_RESULT(_spKeyFrameTimer->Cancel());
+
+        _spKeyFrameTimer.Reset();
+    }
+
+    _keyFrameLimiter.Reset();
+
+    if (nullptr != _spConnection)
+    {
+        LOG_RESULT(_spConnection->remove_Received(_bundleReceivedEventToken));
+
+        _spConnection.Reset();
+        _spConnection = nullptr;
+    }
+
     LOG_RESULT(_mediaCapture->remove_Failed(_failedEventToken));
     LOG_RESULT(_mediaCapture->remove_RecordLimitationExceeded(_recordLimitExceededEventToken));
 
@@ -417,6 +443,11 @@ HRESULT CaptureEngineImpl::StartAsync(
         ComPtr<IVideoEncodingProperties> videoEncodingProperties;
         IFR(mediaEncodingProfile->get_Video(&videoEncodingProperties));
 
+        // start at the profile bitrate and let receiver reports move it down from there
+        UINT32 uBitrate = 0;
+        IFR(videoEncodingProperties->get_Bitrate(&uBitrate));
+        _bitrateController.Configure(c_uMinVideoBitrate, uBitrate, uBitrate);
+
         // create the custome sink
         ComPtr<NetworkMediaSinkImpl> networkSink;
         IFR(Microsoft::WRL::Details::MakeAndInitialize<NetworkMediaSinkImpl>(
@@ -490,6 +521,23 @@ HRESULT CaptureEngineImpl::StartAsync(
         EventRegistrationToken recordLimitExceededToken;
         IFR(_mediaCapture->add_RecordLimitationExceeded(recordLimiteExceededEventCallback.Get(), &recordLimitExceededToken));
 
+        // a restart must not leave the previous registration behind, or requests get handled twice
+        if (nullptr != _spConnection)
+        {
+            LOG_RESULT(_spConnection->remove_Received(_bundleReceivedEventToken));
+
+            _spConnection.Reset();
+        }
+
+        // keyframe requests from the receiver are honored by the encoder
+        auto bundleReceivedCallback =
+            Callback<IBundleReceivedEventHandler, CaptureEngineImpl>(this, &CaptureEngineImpl::OnBundleReceived);
+        EventRegistrationToken bundleReceivedToken;
+        IFR(spConnection->add_Received(bundleReceivedCallback.Get(), &bundleReceivedToken));
+
+        _spConnection = spConnection;
+        _bundleReceivedEventToken = bundleReceivedToken;
+
         auto startRecordAsync = Callback<IAsyncActionCompletedHandler>(
             [this, spThis, networkSink](_In_ IAsyncAction *asyncResult, _In_ AsyncStatus asyncStatus) -> HRESULT
         {
@@ -573,6 +621,181 @@ HRESULT CaptureEngineImpl::OnRecordLimitationExceeded(
     return _evtClosed.InvokeAll(spThis.Get());
 }
 
+_Use_decl_annotations_
+HRESULT CaptureEngineImpl::OnBundleReceived(
+    IConnection *sender,
+    IBundleReceivedArgs *args)
+{
+    PayloadType type;
+    IFR(args->get_PayloadType(&type));
+
+    // a new viewer also needs a keyframe to start decoding
+    if (PayloadType_RequestKeyFrame == type
+        ||
+        PayloadType_RequestMediaStart == type)
+    {
+        LOG_RESULT(ForceKeyFrame());
+    }
+    else if (PayloadType_SendReceiverReport == type)
+    {
+        ComPtr<IDataBundle> spDataBundle;
+        IFR(args->get_DataBundle(&spDataBundle));
+
+        LOG_RESULT(ProcessReceiverReport(spDataBundle.Get()));
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CaptureEngineImpl::ForceKeyFrame()
+{
+    auto lock = _lock.Lock();
+
+    if (nullptr == _mediaCapture || !_captureStarted)
+    {
+        return S_OK;
+    }
+
+    // requests from a lossy receiver can arrive in bursts, the sink holds back
+    // delta frames after each one, so a limited request still needs its keyframe
+    LONGLONG hnsNow = MFGetSystemTime();
+    switch (_keyFrameLimiter.Request(hnsNow))
+    {
+    case KeyFrameRequestLimiter::Decision::AlreadyDeferred:
+        return S_OK;
+    case KeyFrameRequestLimiter::Decision::Defer:
+        Log(Log_Level_Info, L"CaptureEngineImpl::ForceKeyFrame() - rate limited, deferred\n");
+
+        return ScheduleKeyFrame(_keyFrameLimiter.GetDelay(hnsNow));
+    default:
+        break;
+    }
+
+    Log(Log_Level_Info, L"CaptureEngineImpl::ForceKeyFrame()\n");
+
+    return SetVideoEncoderProperty(CODECAPI_AVEncVideoForceKeyFrame, 1);
+}
+
+_Use_decl_annotations_
+HRESULT CaptureEngineImpl::ScheduleKeyFrame(
+    LONGLONG hnsDelay)
+{
+    ComPtr<IThreadPoolTimerStatics> spTimerStatics;
+    IFR(Windows::Foundation::GetActivationFactory(
+        Wrappers::HStringReference(RuntimeClass_Windows_System_Threading_ThreadPoolTimer).Get(),
+        &spTimerStatics));
+
+    ComPtr<CaptureEngineImpl> spThis(this);
+    auto timerElapsed = Callback<ITimerElapsedHandler>(
+        [this, spThis](IThreadPoolTimer* timer) -> HRESULT
+    {
+        auto lock = _lock.Lock();
+
+        // Close cancels the timer, but it may already be running
+        if (timer != _spKeyFrameTimer.Get())
+        {
+            return S_OK;
+        }
+
+        _spKeyFrameTimer.Reset();
+
+        if (nullptr == _mediaCapture || !_captureStarted || !_keyFrameLimiter.ForceDeferred(MFGetSystemTime()))
+        {
+            return S_OK;
+        }
+
+        Log(Log_Level_Info, L"CaptureEngineImpl::ForceKeyFrame() - deferred\n");
+
+        return SetVideoEncoderProperty(CODECAPI_AVEncVideoForceKeyFrame, 1);
+    });
+
+    ABI::Windows::Foundation::TimeSpan delay;
+    delay.Duration = hnsDelay;
+
+    HRESULT hr = spTimerStatics->CreateTimer(timerElapsed.Get(), delay, &_spKeyFrameTimer);
+    if (FAILED(hr))
+    {
+        // no timer, so force it now rather than leave the receiver waiting
+        LOG_RESULT(hr);
+
+        _keyFrameLimiter.ForceDeferred(MFGetSystemTime());
+
+        return SetVideoEncoderProperty(CODECAPI_AVEncVideoForceKeyFrame, 1);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CaptureEngineImpl::ProcessReceiverReport(
+    IDataBundle* dataBundle)
+{
+    NULL_CHK(dataBundle);
+
+    DataBundleImpl* pBundleImpl = static_cast<DataBundleImpl*>(dataBundle);
+
+    ULONG cbTotalSize = 0;
+    IFR(pBundleImpl->get_TotalSize(&cbTotalSize));
+    if (cbTotalSize != sizeof(MediaReceiverReport))
+    {
+        IFR(MF_E_UNSUPPORTED_FORMAT);
+    }
+
+    // other listeners see the same bundle, so copy instead of consuming it
+    MediaReceiverReport report;
+    DWORD cbCopied = 0;
+    IFR(pBundleImpl->CopyTo(0, sizeof(report), &report, &cbCopied));
+
+    auto lock = _lock.Lock();
+
+    if (nullptr == _mediaCapture || !_captureStarted)
+    {
+        return S_OK;
+    }
+
+    if (!_bitrateController.OnReceiverReport(
+        report.hnsInterval,
+        report.hnsArrivalJitter,
+        report.cbReceived,
+        report.cSamplesReceived,
+        report.cSamplesDropped,
+        report.cQueueDepth))
+    {
+        return S_OK;
+    }
+
+    UINT32 uBitrate = _bitrateController.GetTargetBitrate();
+
+    Log(Log_Level_Info, L"CaptureEngineImpl::ProcessReceiverReport() - bitrate: %d\n", uBitrate);
+
+    return SetVideoEncoderProperty(CODECAPI_AVEncCommonMeanBitRate, uBitrate);
+}
+
+_Use_decl_annotations_
+HRESULT CaptureEngineImpl::SetVideoEncoderProperty(
+    REFGUID propertyId,
+    UINT32 value)
+{
+    NULL_CHK_HR(_mediaCapture, E_NOT_SET);
+
+    ComPtr<ABI::Windows::Foundation::IPropertyValueStatics> spPropertyValueStatics;
+    IFR(Windows::Foundation::GetActivationFactory(
+        Wrappers::HStringReference(RuntimeClass_Windows_Foundation_PropertyValue).Get(),
+        &spPropertyValueStatics));
+
+    ComPtr<ABI::Windows::Foundation::IPropertyValue> spPropVal;
+    IFR(spPropertyValueStatics->CreateUInt32(value, &spPropVal));
+
+    ComPtr<IInspectable> spInspectable;
+    IFR(spPropVal.As(&spInspectable));
+
+    return _mediaCapture->SetEncoderProperty(
+        MediaStreamType::MediaStreamType_VideoRecord,
+        propertyId,
+        spInspectable.Get());
+}
+
 
 // Factory method
 _Use_decl_annotations_
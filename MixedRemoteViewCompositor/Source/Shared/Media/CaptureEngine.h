@@ -67,6 +67,21 @@ namespace MixedRemoteViewCompositor
             HRESULT OnRecordLimitationExceeded(
                 _In_ ABI::Windows::Media::Capture::IMediaCapture *sender);
 
+            // connection callbacks
+            HRESULT OnBundleReceived(
+                _In_ ABI::MixedRemoteViewCompositor::Network::IConnection *sender,
+                _In_ ABI::MixedRemoteViewCompositor::Network::IBundleReceivedArgs *args);
+
+        private:
+            HRESULT ForceKeyFrame();
+            HRESULT ScheduleKeyFrame(
+                _In_ LONGLONG hnsDelay);
+            HRESULT ProcessReceiverReport(
+                _In_ ABI::MixedRemoteViewCompositor::Network::IDataBundle* dataBundle);
+            HRESULT SetVideoEncoderProperty(
+                _In_ REFGUID propertyId,
+                _In_ UINT32 value);
+
         private:
             Wrappers::CriticalSection _lock;
 
@@ -83,6 +98,13 @@ namespace MixedRemoteViewCompositor
             EventRegistrationToken _failedEventToken;
             EventRegistrationToken _recordLimitExceededEventToken;
 
+            ComPtr<ABI::MixedRemoteViewCompositor::Network::IConnection> _spConnection;
+            EventRegistrationToken _bundleReceivedEventToken;
+            KeyFrameRequestLimiter _keyFrameLimiter;
+            ComPtr<ABI::Windows::System::Threading::IThreadPoolTimer> _spKeyFrameTimer;
+
+            BitrateController _bitrateController;
+
             EventSource<ABI::MixedRemoteViewCompositor::Plugin::IClosedEventHandler> _evtClosed;
 
             ComPtr<NetworkMediaSinkImpl> _networkMediaSink;
@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cstdint>
+
+namespace MixedRemoteViewCompositor
+{
+    namespace Media
+    {
+        // Spaces out the keyframes forced for receiver requests.
+        // A request inside the minimum interval is deferred to the end of it instead
+        // of dropped, the receiver is holding back delta frames until a keyframe
+        // arrives and would otherwise wait for the encoder's next natural one.
+        // Any number of requests inside the interval make a single deferred keyframe.
+        // No platform dependencies so it can be driven from a simulation, see
+        // KeyFrameJoinSimulation.
+        class KeyFrameRequestLimiter
+        {
+        public:
+            enum class Decision
+            {
+                ForceNow,
+                Defer,          // schedule ForceDeferred after GetDelay
+                AlreadyDeferred // a deferred keyframe covers this request too
+            };
+
+            explicit KeyFrameRequestLimiter(int64_t hnsMinInterval)
+                : _hnsMinInterval(hnsMinInterval)
+                , _hnsLastKeyFrame(0)
+                , _hasKeyFrame(false)
+                , _isDeferred(false)
+            {
+            }
+
+            Decision Request(int64_t hnsNow)
+            {
+                if (_isDeferred)
+                {
+                    return Decision::AlreadyDeferred;
+                }
+
+                if (_hasKeyFrame && hnsNow - _hnsLastKeyFrame < _hnsMinInterval)
+                {
+                    _isDeferred = true;
+
+                    return Decision::Defer;
+                }
+
+                OnKeyFrame(hnsNow);
+
+                return Decision::ForceNow;
+            }
+
+            // time left until a deferred keyframe may be forced
+            int64_t GetDelay(int64_t hnsNow) const
+            {
+                int64_t hnsDelay = _hnsLastKeyFrame + _hnsMinInterval - hnsNow;
+
+                return hnsDelay > 0 ? hnsDelay : 0;
+            }
+
+            // returns true when the deferred keyframe should be forced now
+            bool ForceDeferred(int64_t hnsNow)
+            {
+                if (!_isDeferred)
+                {
+                    return false;
+                }
+
+                OnKeyFrame(hnsNow);
+
+                return true;
+            }
+
+            // forget the history, for a new capture
+            void Reset()
+            {
+                _hasKeyFrame = false;
+                _isDeferred = false;
+            }
+
+            bool IsDeferred() const { return _isDeferred; }
+
+        private:
+            void OnKeyFrame(int64_t hnsNow)
+            {
+                _hnsLastKeyFrame = hnsNow;
+                _hasKeyFrame = true;
+                _isDeferred = false;
+            }
+
+        private:
+            int64_t _hnsMinInterval;
+            int64_t _hnsLastKeyFrame;
+            bool _hasKeyFrame;
+            bool _isDeferred;
+        };
+    }
+}
@@ -57,6 +57,15 @@ public:
     }
 };
 
+class KeyFrameFunc
+{
+public:
+    HRESULT operator()(_In_ IMFStreamSink* pStream) const
+    {
+        return static_cast<NetworkMediaSinkStreamImpl*>(pStream)->RequestKeyFrame();
+    }
+};
+
 static HRESULT AddAttribute(
     _In_ GUID guidKey, 
     _In_ IPropertyValue* propValue, 
@@ -293,6 +302,10 @@ HRESULT NetworkMediaSinkImpl::RuntimeClassInitialize(
         case PayloadType_RequestMediaStop:
             IFC(ForEach(_streams, ConnectedFunc(false, _llStartTime)));
             break;
+        case PayloadType_RequestKeyFrame:
+            // the encoder itself is driven by the CaptureEngine
+            IFC(ForEach(_streams, KeyFrameFunc()));
+            break;
         };
     
     done:
@@ -90,10 +90,10 @@ NetworkMediaSinkStreamImpl::NetworkMediaSinkStreamImpl()
     , _isPlayerConnected(false)
     , _fIsVideo(false)
     , _fGetFirstSampleTime(false)
+    , _fWaitForKeyFrame(false)
     , _adjustedStartTime(0)
     , _spConnection(nullptr)
     , _spParentMediaSink(nullptr)
-    , _workQueueId(0)
     , _workQueueCB(this, &NetworkMediaSinkStreamImpl::OnDispatchWorkItem)
 {
     ZeroMemory(&_currentSubtype, sizeof(_currentSubtype));
@@ -116,7 +116,7 @@ HRESULT NetworkMediaSinkStreamImpl::RuntimeClassInitialize(
 
     // Create the event queue helper.
     IFR(MFCreateEventQueue(&_eventQueue));
-    IFR(MFAllocateSerialWorkQueue(MFASYNC_CALLBACK_QUEUE_STANDARD, &_workQueueId));
+    IFR(_workQueue.Initialize());
 
     _dwStreamId = id;
     _spConnection = pConnection;
@@ -559,7 +559,7 @@ HRESULT NetworkMediaSinkStreamImpl::Shutdown()
             _eventQueue->Shutdown();
         }
 
-        MFUnlockWorkQueue(_workQueueId);
+        _workQueue.Shutdown();
 
         _sampleQueue.Clear();
 
@@ -608,6 +608,22 @@ done:
     return HandleError(hr);
 }
 
+HRESULT NetworkMediaSinkStreamImpl::RequestKeyFrame()
+{
+    auto lock = _lock.Lock();
+
+    IFR(CheckShutdown());
+
+    if (_fIsVideo && _isPlayerConnected)
+    {
+        Log(Log_Level_Info, L"NetworkMediaSinkStreamImpl::RequestKeyFrame() - waiting for next clean point\n");
+
+        _fWaitForKeyFrame = true;
+    }
+
+    return S_OK;
+}
+
 // Puts an async operation on the work queue.
 _Use_decl_annotations_
 HRESULT NetworkMediaSinkStreamImpl::QueueAsyncOperation(
@@ -617,7 +633,7 @@ HRESULT NetworkMediaSinkStreamImpl::QueueAsyncOperation(
     spOp.Attach(new (std::nothrow) AsyncOperation(op)); // Created with ref count = 1
     NULL_CHK_HR(spOp.Get(), E_OUTOFMEMORY);
 
-    return MFPutWorkItem2(_workQueueId, 0, &_workQueueCB, spOp.Get());
+    return _workQueue.PutWorkItem(&_workQueueCB, spOp.Get());
 }
 
 _Use_decl_annotations_
@@ -627,6 +643,8 @@ HRESULT NetworkMediaSinkStreamImpl::OnDispatchWorkItem(
     // Called by work queue thread. Need to hold the critical section.
     auto lock = _lock.Lock();
 
+    auto dispatch = _workQueue.EnterDispatch();
+
     Log(Log_Level_All, L"NetworkMediaSinkStreamImpl::OnDispatchWorkItem() begin...\n");
 
     HRESULT hr = S_OK;
@@ -785,7 +803,15 @@ HRESULT NetworkMediaSinkStreamImpl::ProcessSamplesFromQueue(
         ComPtr<IMFSample> spMediaSample;
         if (SUCCEEDED(spUnknown.As(&spMediaSample)))
         {
-            if (!fFlush)
+            // delta frames are useless to a receiver waiting on a keyframe
+            if (_fWaitForKeyFrame
+                &&
+                MFGetAttributeUINT32(spMediaSample.Get(), MFSampleExtension_CleanPoint, 0))
+            {
+                _fWaitForKeyFrame = false;
+            }
+
+            if (!fFlush && !_fWaitForKeyFrame)
             {
                 IFR(PrepareSample(spMediaSample.Get(), false, &spDataBundle));
                 fProcessingSample = true;
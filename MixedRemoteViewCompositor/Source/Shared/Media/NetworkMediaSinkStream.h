@@ -98,6 +98,7 @@ namespace MixedRemoteViewCompositor
             HRESULT Shutdown();
 
             HRESULT ConnectedFunc(_In_ bool fConnected, _In_ LONGLONG llCurrentTime);
+            HRESULT RequestKeyFrame();
             HRESULT CheckShutdown() const
             {
                 if (_state == SinkStreamState_Stopped)
@@ -167,6 +168,7 @@ namespace MixedRemoteViewCompositor
             DWORD _dwStreamId;          // streamId
             bool _fIsVideo;             // for video type streams, we have special data to send
             bool _fGetFirstSampleTime;  // wait for the first keyframe
+            bool _fWaitForKeyFrame;     // receiver asked for a keyframe, hold back delta frames until one arrives
 
             SinkStreamState _state;         // current state of the sink
             bool _isShutdown;           // Flag to indicate if Shutdown() method was called.
@@ -180,7 +182,7 @@ namespace MixedRemoteViewCompositor
             ComPtr<IMFMediaType> _currentType;
             GUID _currentSubtype;
 
-            DWORD _workQueueId;     // ID of the work queue for asynchronous operations.
+            SerialWorkQueue _workQueue;     // Serial work queue for asynchronous operations.
             AsyncCallback<NetworkMediaSinkStreamImpl> _workQueueCB;     // Callback for the work queue.
             ComPtr<IMFMediaEventQueue>  _eventQueue;    // Event queue
             ComPtrList<IUnknown>        _sampleQueue;   // Queue to hold samples and markers.
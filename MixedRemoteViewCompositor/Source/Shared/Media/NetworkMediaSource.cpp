@@ -83,6 +83,7 @@ NetworkMediaSourceImpl::NetworkMediaSourceImpl()
     , _spConnection(nullptr)
     , _eSourceState(SourceStreamState_Invalid)
     , _flRate(1.0f)
+    , _hnsLastReceiverReport(0)
 {
 }
 
@@ -737,6 +738,8 @@ HRESULT NetworkMediaSourceImpl::DoStart(
 
         _eSourceState = SourceStreamState_Starting;
 
+        // the capture side forces a keyframe for the start request, so the first frame
+        // does not wait for the encoder's next natural one
         IFC(SendStartRequest());
 
         _eSourceState = SourceStreamState_Started;
@@ -921,6 +924,71 @@ HRESULT NetworkMediaSourceImpl::SendStopRequest()
     return _spConnection->SendPayloadType(PayloadType_RequestMediaStop);
 }
 
+_Use_decl_annotations_
+HRESULT NetworkMediaSourceImpl::SendReceiverReport(
+    NetworkMediaSourceStreamImpl* pStream)
+{
+    NULL_CHK(pStream);
+    NULL_CHK_HR(_spConnection, E_POINTER);
+
+    LONGLONG hnsNow = MFGetSystemTime();
+    if (_hnsLastReceiverReport == 0)
+    {
+        // first sample only opens the interval
+        _hnsLastReceiverReport = hnsNow;
+
+        MediaReceiverReport report;
+        return pStream->FillReceiverReport(hnsNow, &report);
+    }
+
+    if (hnsNow - _hnsLastReceiverReport < c_hnsReceiverReportInterval)
+    {
+        return S_OK;
+    }
+
+    _hnsLastReceiverReport = hnsNow;
+
+    Log(Log_Level_Info, L"NetworkMediaSourceImpl::SendReceiverReport()\n");
+
+    const DWORD c_cbReportSize = sizeof(PayloadHeader) + sizeof(MediaReceiverReport);
+
+    ComPtr<IDataBuffer> spDataBuffer;
+    IFR(MakeAndInitialize<DataBufferImpl>(&spDataBuffer, c_cbReportSize));
+
+    ComPtr<IBuffer> spBuffer;
+    IFR(spDataBuffer.As(&spBuffer));
+
+    BYTE* pBuffer = GetDataType<BYTE*>(spBuffer.Get());
+    NULL_CHK(pBuffer);
+
+    PayloadHeader* pOpHeader = reinterpret_cast<PayloadHeader*>(pBuffer);
+    pOpHeader->ePayloadType = PayloadType_SendReceiverReport;
+    pOpHeader->cbPayloadSize = sizeof(MediaReceiverReport);
+
+    MediaReceiverReport* pReport = reinterpret_cast<MediaReceiverReport*>(pBuffer + sizeof(PayloadHeader));
+    IFR(pStream->FillReceiverReport(hnsNow, pReport));
+
+    IFR(spDataBuffer->put_CurrentLength(c_cbReportSize));
+
+    ComPtr<IDataBundle> spBundle;
+    IFR(MakeAndInitialize<DataBundleImpl>(&spBundle));
+    IFR(spBundle->AddBuffer(spDataBuffer.Get()));
+
+    // don't hold up the receive path waiting on the write
+    ComPtr<IAsyncAction> spSendAction;
+    return _spConnection->SendBundleAsync(spBundle.Get(), &spSendAction);
+}
+
+_Use_decl_annotations_
+HRESULT NetworkMediaSourceImpl::SendKeyFrameRequest()
+{
+    Log(Log_Level_Info, L"NetworkMediaSourceImpl::SendKeyFrameRequest()\n");
+
+    NULL_CHK_HR(_spConnection, E_POINTER);
+
+    return _spConnection->SendPayloadType(PayloadType_RequestKeyFrame);
+}
+
 
 // Helper methods to handle received network bundles
 _Use_decl_annotations_
@@ -1140,6 +1208,12 @@ HRESULT NetworkMediaSourceImpl::ProcessMediaSample(
 
         // Forward sample to a proper stream.
         IFC(pStreamImpl->ProcessSample(&sampleHead, (sampleHead.cbCameraDataSize > 0) ? &sampleTransforms : nullptr, spSample.Get()));
+
+        // feedback for the sender's bitrate control
+        if (pStreamImpl->IsVideo())
+        {
+            LOG_RESULT(SendReceiverReport(pStreamImpl));
+        }
     }
 
 done:
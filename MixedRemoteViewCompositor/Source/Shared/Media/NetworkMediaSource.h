@@ -133,6 +133,9 @@ namespace MixedRemoteViewCompositor
             _Acquires_lock_(_lock)
                 Wrappers::CriticalSection::SyncLock Lock() { return _lock.Lock(); }
 
+            // ask the sender for an immediate keyframe, used by streams that lost their reference frame
+            HRESULT SendKeyFrameRequest();
+
             // OpQueue
             __override HRESULT DispatchOperation(_In_ SourceOperation* pOp);
             __override HRESULT ValidateOperation(_In_ SourceOperation* pOp);
@@ -184,6 +187,7 @@ namespace MixedRemoteViewCompositor
             HRESULT SendDescribeRequest();
             HRESULT SendStartRequest();
             HRESULT SendStopRequest();
+            HRESULT SendReceiverReport(_In_ NetworkMediaSourceStreamImpl* pStream);
 
             HRESULT ProcessCaptureReady();
             HRESULT ProcessMediaDescription(_In_ IDataBundle* pBundle);
@@ -228,6 +232,8 @@ namespace MixedRemoteViewCompositor
             StreamContainer _streams; // Collection of streams associated with the source
 
             float _flRate;
+
+            LONGLONG _hnsLastReceiverReport;
         };
 
         class NetworkMediaSourceStaticsImpl
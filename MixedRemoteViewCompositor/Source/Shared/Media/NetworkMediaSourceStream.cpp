@@ -50,6 +50,13 @@ NetworkMediaSourceStreamImpl::NetworkMediaSourceStreamImpl(NetworkMediaSourceImp
     , _fWaitingForCleanPoint(true)
     , _hnsStartDroppingAt(0)
     , _hnsAmountToDrop(0)
+    , _hnsReportStart(0)
+    , _hnsLastArrival(0)
+    , _hnsLastTimestamp(0)
+    , _hnsArrivalJitter(0)
+    , _cbReceived(0)
+    , _cSamplesReceived(0)
+    , _cSamplesDropped(0)
 {
 }
 
@@ -575,6 +582,27 @@ HRESULT NetworkMediaSourceStreamImpl::ProcessSample(
     // Set sample attributes
     IFC(SetSampleAttributes(pSampleHeader, pSampleTransforms, pSample));
 
+    // interarrival jitter, same estimator as RTP (RFC 3550 6.4.1)
+    {
+        LONGLONG hnsArrival = MFGetSystemTime();
+        if (_hnsLastArrival != 0)
+        {
+            LONGLONG hnsTransit = (hnsArrival - _hnsLastArrival) - (pSampleHeader->hnsTimestamp - _hnsLastTimestamp);
+            if (hnsTransit < 0)
+            {
+                hnsTransit = -hnsTransit;
+            }
+            _hnsArrivalJitter += (hnsTransit - _hnsArrivalJitter) / 16;
+        }
+        _hnsLastArrival = hnsArrival;
+        _hnsLastTimestamp = pSampleHeader->hnsTimestamp;
+
+        DWORD cbSample = 0;
+        LOG_RESULT(pSample->GetTotalLength(&cbSample));
+        _cbReceived += cbSample;
+        _cSamplesReceived++;
+    }
+
     // Check if we are in propper state if so deliver the sample otherwise just skip it and don't treat it as an error.
     if (_eSourceState == SourceStreamState_Started)
     {
@@ -813,6 +841,7 @@ HRESULT NetworkMediaSourceStreamImpl::DeliverSamples()
             else
             {
                 _fDiscontinuity = true;
+                _cSamplesDropped++;
             }
         }
         else if (SUCCEEDED(spEntry.As(&spMediaType)))
@@ -918,10 +947,37 @@ bool NetworkMediaSourceStreamImpl::ShouldDropSample(
     return fDrop;
 }
 
+_Use_decl_annotations_
+HRESULT NetworkMediaSourceStreamImpl::FillReceiverReport(
+    LONGLONG hnsNow,
+    MediaReceiverReport* pReport)
+{
+    NULL_CHK(pReport);
+
+    IFR(CheckShutdown());
+
+    pReport->dwStreamId = _dwId;
+    pReport->hnsInterval = (_hnsReportStart != 0) ? hnsNow - _hnsReportStart : 0;
+    pReport->hnsArrivalJitter = _hnsArrivalJitter;
+    pReport->cbReceived = _cbReceived;
+    pReport->cSamplesReceived = _cSamplesReceived;
+    pReport->cSamplesDropped = _cSamplesDropped;
+    pReport->cQueueDepth = _samples.GetCount();
+
+    // jitter is a running estimate, everything else is per interval
+    _hnsReportStart = hnsNow;
+    _cbReceived = 0;
+    _cSamplesReceived = 0;
+    _cSamplesDropped = 0;
+
+    return S_OK;
+}
+
 _Use_decl_annotations_
 void NetworkMediaSourceStreamImpl::CleanSampleQueue()
 {
     auto pos = _samples.FrontPosition();
+    DWORD cQueued = _samples.GetCount();
 
     ComPtr<IMFSample> spSample;
     if (_fVideo)
@@ -930,10 +986,12 @@ void NetworkMediaSourceStreamImpl::CleanSampleQueue()
         ComPtr<IUnknown> spEntry;
         for (; SUCCEEDED(_samples.GetItemPos(pos, &spEntry)); pos = _samples.Next(pos))
         {
-            if (SUCCEEDED(spEntry.As(&spSample)) 
+            ComPtr<IMFSample> spCandidate;
+            if (SUCCEEDED(spEntry.As(&spCandidate)) 
                 && 
-                MFGetAttributeUINT32(spSample.Get(), MFSampleExtension_CleanPoint, 0))
+                MFGetAttributeUINT32(spCandidate.Get(), MFSampleExtension_CleanPoint, 0))
             {
+                spSample = spCandidate;
                 break;
             }
         }
@@ -941,10 +999,17 @@ void NetworkMediaSourceStreamImpl::CleanSampleQueue()
 
     _samples.Clear();
 
+    _cSamplesDropped += (spSample != nullptr) ? cQueued - 1 : cQueued;
+
     if (spSample != nullptr)
     {
         LOG_RESULT_MSG(_samples.InsertFront(spSample.Get()), L"adding sample to list");
     }
+    else if (_fVideo)
+    {
+        // nothing left to decode from, ask the sender for a new keyframe
+        LOG_RESULT_MSG(static_cast<NetworkMediaSourceImpl*>(_spSource.Get())->SendKeyFrameRequest(), L"requesting keyframe");
+    }
 }
 
 _Use_decl_annotations_
@@ -73,10 +73,16 @@ namespace MixedRemoteViewCompositor
             HRESULT ProcessFormatChange(__in IMFMediaType* pMediaType);
             HRESULT SetActive(bool fActive);
             bool IsActive() const { return _fActive; }
+            bool IsVideo() const { return _fVideo; }
             SourceStreamState GetState() const { return _eSourceState; }
 
             DWORD get_StreamId() { return _dwId; }
 
+            // fills the stats collected since the last report and starts a new interval
+            HRESULT FillReceiverReport(
+                _In_ LONGLONG hnsNow,
+                _Out_ MediaReceiverReport* pReport);
+
         private:
             class MediaSourceLock;
 
@@ -129,6 +135,15 @@ namespace MixedRemoteViewCompositor
             bool                        _fWaitingForCleanPoint;
             LONGLONG                    _hnsStartDroppingAt;
             LONGLONG                    _hnsAmountToDrop;
+
+            // receiver report stats
+            LONGLONG                    _hnsReportStart;
+            LONGLONG                    _hnsLastArrival;
+            LONGLONG                    _hnsLastTimestamp;
+            LONGLONG                    _hnsArrivalJitter;
+            DWORD                       _cbReceived;
+            DWORD                       _cSamplesReceived;
+            DWORD                       _cSamplesDropped;
         };
     }
 }
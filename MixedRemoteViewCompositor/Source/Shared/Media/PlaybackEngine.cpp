@@ -37,6 +37,59 @@ static HRESULT ConvertMFVideoInterlaceModeToD3D(
     return hr;
 }
 
+// reads the timestamp and camera matrices carried by a decoded sample
+static void ReadSampleTransforms(
+    _In_ IMFSample* pSample,
+    _Inout_ MediaSampleArgs* pSampleargs)
+{
+    LONGLONG timestamp;
+    HRESULT hr = pSample->GetSampleTime(&timestamp);
+    if (SUCCEEDED(hr))
+    {
+        pSampleargs->timestamp = timestamp;
+    }
+
+    UINT32 blobSize;
+
+    // get sample matrix data
+    using float4x4 = Windows::Foundation::Numerics::float4x4;
+
+    if (SUCCEEDED(hr))
+    {
+        float4x4 cameraViewTransform;;
+        hr = pSample->GetBlob(MFSampleExtension_Spatial_CameraViewTransform, (UINT8*)&cameraViewTransform, sizeof(cameraViewTransform), &blobSize);
+        if (SUCCEEDED(hr))
+        {
+            hr = pSample->GetBlob(Spatial_CameraTransform, (UINT8*)&pSampleargs->cameraCoordinate, sizeof(pSampleargs->cameraCoordinate), &blobSize);
+
+            float4x4 viewCameraTransform;
+            if (SUCCEEDED(hr) && Windows::Foundation::Numerics::invert(cameraViewTransform, &viewCameraTransform))
+            {
+                pSampleargs->cameraViewTransform = viewCameraTransform * pSampleargs->cameraCoordinate;
+            }
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        float4x4 projection;
+        hr = pSample->GetBlob(MFSampleExtension_Spatial_CameraProjectionTransform, (UINT8*)&projection, sizeof(projection), &blobSize);
+        if (SUCCEEDED(hr))
+        {
+            pSampleargs->cameraProjection = projection;
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        pSampleargs->timestamp = 0;
+        ZeroMemory(&pSampleargs->cameraViewTransform, sizeof(pSampleargs->cameraViewTransform));
+        ZeroMemory(&pSampleargs->cameraProjection, sizeof(pSampleargs->cameraProjection));
+        ZeroMemory(&pSampleargs->cameraCoordinate, sizeof(pSampleargs->cameraCoordinate));
+        ZeroMemory(&pSampleargs->cameraAffine, sizeof(pSampleargs->cameraAffine));
+    }
+}
+
 //ActivatableClass(PlaybackEngineImpl);
 ActivatableStaticOnlyFactory(PlaybackEngineStaticsImpl);
 
@@ -287,10 +340,21 @@ HRESULT PlaybackEngineImpl::OnReadSample(
         _playbackStarted = false;
     }
 
-    // since we don't render, store the data
-    _latestMediaSample[dwStreamIndex].Sample = pSample;
-    _latestMediaSample[dwStreamIndex].StreamFlags = dwStreamFlags;
-    _latestMediaSample[dwStreamIndex].Timestamp = llTimestamp;
+    // since we don't render, hand the frame to the render thread
+    if (nullptr != pSample)
+    {
+        PlaybackFrame& frame = _videoFrames.GetWriteSlot();
+        frame.Sample = pSample;
+        frame.StreamFlags = dwStreamFlags;
+        frame.Args.videoTexture = nullptr;
+        frame.Args.width = _videoWidth;
+        frame.Args.height = _videoHeight;
+        frame.Args.timestamp = llTimestamp;
+
+        ReadSampleTransforms(pSample, &frame.Args);
+
+        _videoFrames.Publish();
+    }
 
     if (_waitForFirstVideoSample)
     {
@@ -489,28 +553,25 @@ HRESULT PlaybackEngineImpl::GetFrameData(MediaSampleArgs* pSampleargs)
     NULL_CHK(pSampleargs);
     NULL_CHK(pSampleargs->videoTexture);
 
-    HRESULT hr = MF_E_CAPTURE_NO_SAMPLES_IN_QUEUE;
-
-    ComPtr<IMFSample> spSample;
-
-    if (nullptr != _latestMediaSample[0].Sample)
+    if (!_isInitialized)
     {
-        auto lock = _lock.Lock();
-
-        pSampleargs->timestamp = _latestMediaSample[0].Timestamp;
-        IFR(_latestMediaSample[0].Sample.As(&spSample));
+        return E_NOT_VALID_STATE;
     }
-    else
+
+    // take the newest completed frame, nothing to do if it was already shown
+    if (!_videoFrames.Acquire())
     {
         return E_NOT_SET;
     }
 
-    if (!_isInitialized)
+    PlaybackFrame& frame = _videoFrames.GetReadSlot();
+    if (nullptr == frame.Sample)
     {
-        hr = E_NOT_VALID_STATE;
-        goto done;
+        return E_NOT_SET;
     }
 
+    HRESULT hr = S_OK;
+
     if (_waitForFirstVideoSample)
     {
         ComPtr<FormatChangedEventArgsImpl> args = Make<FormatChangedEventArgsImpl>(_videoWidth, _videoHeight);
@@ -522,107 +583,60 @@ HRESULT PlaybackEngineImpl::GetFrameData(MediaSampleArgs* pSampleargs)
         _waitForFirstVideoSample = false;
     }
 
-    if (nullptr != spSample)
-    {
-        DirectXManagerImpl* pDxImpl = static_cast<DirectXManagerImpl*>(_dxManager.Get());
-        NULL_CHK_HR(pDxImpl, E_POINTER);
+    DirectXManagerImpl* pDxImpl = static_cast<DirectXManagerImpl*>(_dxManager.Get());
+    NULL_CHK_HR(pDxImpl, E_POINTER);
 
-        ComPtr<ID3D11DeviceContext> context;
-        context = pDxImpl->GetDeviceContext();
-        if (nullptr == context)
-        {
-            hr = E_POINTER;
-            goto done;
-        }
+    ComPtr<ID3D11DeviceContext> context;
+    context = pDxImpl->GetDeviceContext();
+    if (nullptr == context)
+    {
+        hr = E_POINTER;
+        goto done;
+    }
 
-        ComPtr<IMFMediaBuffer> spBuffer;
-        hr = spSample.Get()->GetBufferByIndex(0, &spBuffer);
-        if (FAILED(hr))
-        {
-            goto done;
-        }
+    ComPtr<IMFMediaBuffer> spBuffer;
+    hr = frame.Sample->GetBufferByIndex(0, &spBuffer);
+    if (FAILED(hr))
+    {
+        goto done;
+    }
 
-        byte* srcBuffer = nullptr;
-        hr = spBuffer->Lock(&srcBuffer, nullptr, nullptr);
-        if (SUCCEEDED(hr))
+    byte* srcBuffer = nullptr;
+    hr = spBuffer->Lock(&srcBuffer, nullptr, nullptr);
+    if (SUCCEEDED(hr))
+    {
+        if (nullptr != srcBuffer)
         {
-            if (nullptr != srcBuffer)
+            ID3D11Texture2D* pTexture =
+                static_cast<ID3D11Texture2D*>(pSampleargs->videoTexture);
+            if (nullptr != pTexture)
             {
-                ID3D11Texture2D* pTexture =
-                    static_cast<ID3D11Texture2D*>(pSampleargs->videoTexture);
-                if (nullptr != pTexture)
-                {
-                    D3D11_TEXTURE2D_DESC desc;
-                    pTexture->GetDesc(&desc);
+                D3D11_TEXTURE2D_DESC desc;
+                pTexture->GetDesc(&desc);
 
-                    int stride = desc.Width * 4;
+                int stride = desc.Width * 4;
 
-                    context->UpdateSubresource(pTexture, 0, nullptr, srcBuffer, stride, 0);
-                }
+                context->UpdateSubresource(pTexture, 0, nullptr, srcBuffer, stride, 0);
             }
-
-            spBuffer->Unlock();
         }
 
-        if (SUCCEEDED(hr))
-        {
-            // pass data onto caller object
-            pSampleargs->width = _videoWidth;
-            pSampleargs->height = _videoHeight;
-
-            LONGLONG timestamp;
-            HRESULT hr = spSample->GetSampleTime(&timestamp);
-            if (SUCCEEDED(hr))
-            {
-                pSampleargs->timestamp = timestamp;
-            }
-
-            UINT32 blobSize;
-
-            // get sample matrix data
-            using float4x4 = Windows::Foundation::Numerics::float4x4;
-
-            if (SUCCEEDED(hr))
-            {
-                float4x4 cameraViewTransform;;
-                hr = spSample->GetBlob(MFSampleExtension_Spatial_CameraViewTransform, (UINT8*)&cameraViewTransform, sizeof(cameraViewTransform), &blobSize);
-                if (SUCCEEDED(hr))
-                {
-                    hr = spSample->GetBlob(Spatial_CameraTransform, (UINT8*)&pSampleargs->cameraCoordinate, sizeof(pSampleargs->cameraCoordinate), &blobSize);
-
-                    float4x4 viewCameraTransform;
-                    if (SUCCEEDED(hr) && Windows::Foundation::Numerics::invert(cameraViewTransform, &viewCameraTransform))
-                    {
-                        pSampleargs->cameraViewTransform = viewCameraTransform * pSampleargs->cameraCoordinate;
-                    }
-                }
-            }
-
-            if (SUCCEEDED(hr))
-            {
-                float4x4 projection;
-                hr = spSample->GetBlob(MFSampleExtension_Spatial_CameraProjectionTransform, (UINT8*)&projection, sizeof(projection), &blobSize);
-                if (SUCCEEDED(hr))
-                {
-                    pSampleargs->cameraProjection = projection;
-                }
-            }
+        spBuffer->Unlock();
+    }
 
-            if (FAILED(hr))
-            {
-                pSampleargs->timestamp = 0;
-                ZeroMemory(&pSampleargs->cameraViewTransform, sizeof(pSampleargs->cameraViewTransform));
-                ZeroMemory(&pSampleargs->cameraProjection, sizeof(pSampleargs->cameraProjection));
-                ZeroMemory(&pSampleargs->cameraCoordinate, sizeof(pSampleargs->cameraCoordinate));
-                ZeroMemory(&pSampleargs->cameraAffine, sizeof(pSampleargs->cameraAffine));
-            }
-        }
+    if (SUCCEEDED(hr))
+    {
+        // pass data onto caller object, the transforms were read with the sample.
+        // Unity creates the texture and passes it in, so the plugin has no textures
+        // of its own to ring; the frame is uploaded into Unity's and the prepared
+        // args copied over, which is one small struct copy per shown frame
+        IUnknown* pVideoTexture = pSampleargs->videoTexture;
+        *pSampleargs = frame.Args;
+        pSampleargs->videoTexture = pVideoTexture;
     }
 
 done:
-    _latestMediaSample[0].StreamFlags = 0;
-    _latestMediaSample[0].Timestamp = 0;
-    _latestMediaSample[0].Sample.Reset();
+    // the uploaded sample can go back to the reader
+    frame.Sample.Reset();
 
     return hr;
 }
@@ -9,29 +9,20 @@ namespace MixedRemoteViewCompositor
     {
         const USHORT MaxRetryAmount = 15;
 
-        class ProcessMediaSample
-            : public Microsoft::WRL::RuntimeClass
-            < Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>
-            , IUnknown >
+        // decoded frame and the metadata handed to Unity with it,
+        // filled on the reader thread so the render thread only uploads
+        struct PlaybackFrame
         {
-        public:
-            ProcessMediaSample()
-                : StreamFlags(-1)
-                , Timestamp(0)
+            PlaybackFrame()
+                : StreamFlags(0)
                 , Sample(nullptr)
             {
-            }
-
-            ProcessMediaSample(DWORD dwStreamFlags, LONGLONG llTimestamp, IMFSample* pSample)
-                : StreamFlags(dwStreamFlags)
-                , Timestamp(llTimestamp)
-                , Sample(pSample)
-            {
+                ZeroMemory(&Args, sizeof(Args));
             }
 
             DWORD StreamFlags;
-            LONGLONG Timestamp;
             ComPtr<IMFSample> Sample;
+            MixedRemoteViewCompositor::Plugin::MediaSampleArgs Args;
         };
 
         class FormatChangedEventArgsImpl
@@ -274,7 +265,8 @@ namespace MixedRemoteViewCompositor
             ComPtr<ID3D11VideoDevice> _videoDevice;
             ComPtr<ID3D11VideoContext> _videoContext;
 
-            ProcessMediaSample _latestMediaSample[2];
+            // written by the source reader, read by the render thread
+            TripleBuffer<PlaybackFrame> _videoFrames;
         };
 
         class PlaybackEngineStaticsImpl
@@ -93,13 +93,8 @@ HRESULT ConnectionImpl::RuntimeClassInitialize(
     ZeroMemory(&_receivedHeader, sizeof(PayloadHeader));
     _receivedHeader.ePayloadType = PayloadType_Unknown;
 
-    // create a thread to send data
-    ComPtr<IThreadPoolStatics> threadPoolStatics;
-    IFR(Windows::Foundation::GetActivationFactory(
-        Wrappers::HStringReference(RuntimeClass_Windows_System_Threading_ThreadPool).Get(),
-        &threadPoolStatics));
-
-    IFR(threadPoolStatics.As(&_threadPoolStatics));
+    // create a queue to send data
+    IFR(_sendQueue.Initialize());
 
     return WaitForHeader();
 }
@@ -254,34 +249,45 @@ HRESULT ConnectionImpl::SendPayloadType(
 {
     Log(Log_Level_Info, L"ConnectionImpl::SendRequest(%d)\n", payloadType);
 
-    // send an PayloadType header, contains no payload.
-    ComPtr<IDataBuffer> dataBuffer;
-    IFR(MakeAndInitialize<DataBufferImpl>(&dataBuffer, sizeof(PayloadHeader)));
+    // header only messages skip the bundle and share a cached frame
+    ComPtr<IBuffer> spControlFrame;
+    {
+        auto lock = _lock.Lock();
 
-    ComPtr<IDataBundle> dataBundle;
-    IFR(MakeAndInitialize<DataBundleImpl>(&dataBundle));
+        IFR(CheckClosed());
 
-    // cast to IBufferByteAccess
-    ComPtr<Windows::Storage::Streams::IBufferByteAccess> spByteAccess;
-    IFR(dataBuffer.As(&spByteAccess));
+        IFR(GetControlFrame(payloadType, &spControlFrame));
+    }
 
-    // get the raw byte pointer
-    BYTE* buffer = nullptr;
-    IFR(spByteAccess->Buffer(&buffer));
-    NULL_CHK(buffer);
+    // the write still goes through the send queue, so it never lands inside a bundle,
+    // this returns once it is queued for the same reason as SendBundle
+    ComPtr<ConnectionImpl> spThis(this);
+    auto workItem =
+        [this, spThis, spControlFrame]() -> HRESULT
+    {
+        ComPtr<IOutputStream> spOutputStream;
+        {
+            auto lock = _lock.Lock();
 
-    // cast to the dataPtr
-    PayloadHeader* pOpHeader = reinterpret_cast<PayloadHeader*>(buffer);
-    NULL_CHK(pOpHeader);
+            IFR(CheckClosed());
 
-    pOpHeader->cbPayloadSize = 0;
-    pOpHeader->ePayloadType = payloadType;
+            IFR(_streamSocket->get_OutputStream(&spOutputStream));
+        }
 
-    IFR(dataBuffer->put_CurrentLength(sizeof(PayloadHeader)));
+        ComPtr<IStreamWriteOperation> spWriteOperation;
+        IFR(spOutputStream->WriteAsync(spControlFrame.Get(), &spWriteOperation));
 
-    IFR(dataBundle->AddBuffer(dataBuffer.Get()));
+        return StartAsyncThen(
+            spWriteOperation.Get(),
+            [this, spThis](_In_ HRESULT hr, _In_ IStreamWriteOperation *asyncResult, _In_ AsyncStatus asyncStatus) -> HRESULT
+        {
+            LOG_RESULT(hr);
+
+            return S_OK;
+        });
+    };
 
-    return SendBundle(dataBundle.Get());
+    return _sendQueue.Run(workItem);
 }
 
 _Use_decl_annotations_
@@ -292,37 +298,11 @@ HRESULT ConnectionImpl::SendBundle(
 
     NULL_CHK(dataBundle);
 
-    // get the output stream for socket
-    ComPtr<IOutputStream> spOutputStream;
-    {
-        auto lock = _lock.Lock();
-
-        IFR(CheckClosed());
-
-        IFR(_streamSocket->get_OutputStream(&spOutputStream));
-    }
-
-    DataBundleImpl* bundleImpl = static_cast<DataBundleImpl*>(dataBundle);
-    NULL_CHK_HR(bundleImpl, E_INVALIDARG);
-
-    DataBundleImpl::Container buffers;
-    IFR(bundleImpl->get_Buffers(&buffers));
-
-    // send one buffer at a time syncronously
-    DataBundleImpl::Iterator iter = buffers.begin();
-    for (; iter != buffers.end(); ++iter)
-    {
-        ComPtr<IBuffer> rawBuffer;
-        IFR((*iter).As(&rawBuffer));
-
-        ComPtr<IStreamWriteOperation> writeOperation;
-        IFR(spOutputStream->WriteAsync(rawBuffer.Get(), &writeOperation));
-
-        HRESULT hr = SyncWait<UINT32, UINT32>(writeOperation.Get(), 1);
-        IFR(hr);
-    }
-
-    return S_OK;
+    // writes only go to the socket from _sendQueue, so the buffers of this bundle never
+    // interleave with another send. This returns once the write is queued, bundle handlers
+    // call it with _lock held and the queued write needs _lock, failures are logged.
+    ComPtr<IAsyncAction> spSendAction;
+    return SendBundleAsync(dataBundle, &spSendAction);
 }
 
 _Use_decl_annotations_
@@ -351,8 +331,7 @@ HRESULT ConnectionImpl::SendBundleAsync(
     ComPtr<IDataBundle> spDataBundle(dataBundle);
     ComPtr<ConnectionImpl> spThis(this);
     auto workItem =
-        Microsoft::WRL::Callback<ABI::Windows::System::Threading::IWorkItemHandler>(
-            [this, spThis, spDataBundle, spWriteAction](IAsyncAction* asyncAction) -> HRESULT
+        [this, spThis, spDataBundle, spWriteAction]() -> HRESULT
     {
         ComPtr<IOutputStream> spOutputStream;
         DataBundleImpl::Container buffers;
@@ -413,22 +392,10 @@ HRESULT ConnectionImpl::SendBundleAsync(
         }
 
         return S_OK;
-    });
-
-    ComPtr<IAsyncAction> workerAsync;
-    IFR(_threadPoolStatics->RunAsync(workItem.Get(), &workerAsync));
-
-    IFR(StartAsyncThen(
-        workerAsync.Get(),
-        [this, spThis, spWriteAction](_In_ HRESULT hr, _In_ IAsyncAction *asyncResult, _In_ AsyncStatus asyncStatus) -> HRESULT
-    {
-        if (FAILED(hr))
-        {
-            spWriteAction->SignalCompleted(hr);
-        }
+    };
 
-        return S_OK;
-    }));
+    // runs inline when the caller is already sending from this queue
+    IFR(_sendQueue.Run(workItem));
 
     // hand off async op
     return spWriteAction.CopyTo(sendAction);
@@ -589,6 +556,45 @@ HRESULT ConnectionImpl::ProcessHeaderBuffer(
     return dataBundle.Reset();
 }
 
+_Use_decl_annotations_
+HRESULT ConnectionImpl::GetControlFrame(
+    PayloadType payloadType,
+    IBuffer** controlFrame)
+{
+    NULL_CHK(controlFrame);
+
+    *controlFrame = nullptr;
+
+    if (PayloadType_Unknown == payloadType
+        ||
+        PayloadType_ENDOFLIST <= payloadType)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    // frames are only written on first use, afterwards every send shares the same buffer
+    ComPtr<IBuffer>& spFrame = _controlFrames[payloadType];
+    if (nullptr == spFrame)
+    {
+        ComPtr<DataBufferImpl> spDataBuffer;
+        IFR(MakeAndInitialize<DataBufferImpl>(&spDataBuffer, sizeof(PayloadHeader)));
+
+        BYTE* buffer = nullptr;
+        IFR(spDataBuffer->get_Buffer(&buffer));
+        NULL_CHK(buffer);
+
+        PayloadHeader* pOpHeader = reinterpret_cast<PayloadHeader*>(buffer);
+        pOpHeader->cbPayloadSize = 0;
+        pOpHeader->ePayloadType = payloadType;
+
+        IFR(spDataBuffer->put_CurrentLength(sizeof(PayloadHeader)));
+
+        IFR(spDataBuffer.As(&spFrame));
+    }
+
+    return spFrame.CopyTo(controlFrame);
+}
+
 _Use_decl_annotations_
 HRESULT ConnectionImpl::NotifyBundleComplete(
     PayloadType payloadType,
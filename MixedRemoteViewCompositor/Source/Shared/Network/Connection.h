@@ -179,6 +179,9 @@ namespace MixedRemoteViewCompositor
             HRESULT ProcessHeaderBuffer(
                 _In_ PayloadHeader* header,
                 _In_ ABI::MixedRemoteViewCompositor::Network::IDataBuffer *dataBuffer);
+            HRESULT GetControlFrame(
+                _In_ PayloadType payloadType,
+                _COM_Outptr_ ABI::Windows::Storage::Streams::IBuffer** controlFrame);
 
         private:
             Wrappers::CriticalSection _lock;
@@ -187,11 +190,16 @@ namespace MixedRemoteViewCompositor
             UINT16      _concurrentFailedBuffers;
             UINT16      _concurrentFailedBundles;
 
-            ComPtr<IThreadPoolStatics> _threadPoolStatics;
+            // every write to the socket goes through here, one send at a time, so the buffers
+            // of a bundle never interleave with another bundle or a control frame
+            SerialWorkQueue _sendQueue;
             ComPtr<ABI::Windows::Networking::Sockets::IStreamSocket>    _streamSocket;
 
             ComPtr<MixedRemoteViewCompositor::Network::DataBufferImpl>  _spHeaderBuffer;
 
+            // serialized header-only frames, built once per type and never modified after
+            ComPtr<ABI::Windows::Storage::Streams::IBuffer> _controlFrames[PayloadType_ENDOFLIST];
+
             // currently bundle that is incoming
             PayloadHeader _receivedHeader;
             ComPtr<ABI::MixedRemoteViewCompositor::Network::IDataBundle>    _receivedBundle;
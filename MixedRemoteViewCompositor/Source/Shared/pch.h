@@ -59,6 +59,7 @@
 #include <mfmediacapture.h>
 #include <mfmediaengine.h>
 #include <mfreadwrite.h>
+#include <codecapi.h>
 #pragma comment(lib, "mf")
 #pragma comment(lib, "mfplat")
 #pragma comment(lib, "mfuuid")
@@ -134,6 +135,8 @@ using namespace ABI::Windows::System::Threading;
 #include "ErrorHandling.h"
 #include "AsyncOperations.h"
 #include "LinkList.h"
+#include "WorkQueue.h"
+#include "TripleBuffer.h"
 
 #include "MixedRemoteViewCompositor.h"
 using namespace ABI::MixedRemoteViewCompositor;
@@ -158,6 +161,8 @@ using namespace ABI::MixedRemoteViewCompositor::Media;
 #include "NetworkMediaSink.h"
 #include "MrcAudioEffectDefinition.h"
 #include "MrcVideoEffectDefinition.h"
+#include "BitrateController.h"
+#include "KeyFrameRequestLimiter.h"
 #include "CaptureEngine.h"
 #include "NetworkMediaSourceStream.h"
 #include "NetworkMediaSource.h"
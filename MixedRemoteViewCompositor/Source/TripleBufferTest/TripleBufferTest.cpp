@@ -0,0 +1,232 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Tests for TripleBuffer, the hand-off PlaybackEngine uses between the source reader thread
+// and the render thread.
+// The single threaded tests check which slot each side ends up with. The threaded test has a
+// producer publish frames as fast as it can while a consumer acquires them, and checks that
+// every acquired frame is complete, newer than the one before, and never held by the producer.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 TripleBufferTest.cpp
+// or:
+//     g++ -std=c++14 -O2 -pthread TripleBufferTest.cpp
+//
+// Usage: TripleBufferTest [seconds]
+
+#include "../Shared/Common/TripleBuffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace
+{
+    // Large enough that a torn copy would show up as words from different frames.
+    const int FrameWords = 256;
+
+    enum
+    {
+        Nobody,
+        Producer,
+        Consumer
+    };
+
+    struct Frame
+    {
+        Frame() :
+            Sequence(0),
+            Words(),
+            Owner(Nobody)
+        {
+        }
+
+        uint64_t Sequence;
+        uint64_t Words[FrameWords];
+        // Set by the side holding the slot, to catch both sides holding the same one.
+        std::atomic<int> Owner;
+    };
+
+    std::atomic<int> failures{ 0 };
+
+    void Expect(bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            printf("FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    void TestNothingPublished()
+    {
+        TripleBuffer<int> buffer;
+
+        Expect(!buffer.HasNew(), "nothing new before the first publish");
+        Expect(!buffer.Acquire(), "acquire fails before the first publish");
+    }
+
+    void TestPublishAcquire()
+    {
+        TripleBuffer<int> buffer;
+
+        buffer.GetWriteSlot() = 1;
+        buffer.Publish();
+
+        Expect(buffer.HasNew(), "new value after publish");
+        Expect(buffer.Acquire(), "acquire after publish");
+        Expect(buffer.GetReadSlot() == 1, "acquire returns the published value");
+
+        Expect(!buffer.HasNew(), "nothing new after acquire");
+        Expect(!buffer.Acquire(), "second acquire fails");
+        Expect(buffer.GetReadSlot() == 1, "failed acquire keeps the read slot");
+    }
+
+    void TestNewestWins()
+    {
+        TripleBuffer<int> buffer;
+
+        for (int i = 1; i <= 5; i++)
+        {
+            buffer.GetWriteSlot() = i;
+            buffer.Publish();
+        }
+
+        Expect(buffer.Acquire(), "acquire after several publishes");
+        Expect(buffer.GetReadSlot() == 5, "acquire returns the newest value");
+        Expect(!buffer.Acquire(), "older values are gone");
+    }
+
+    void TestDistinctSlots()
+    {
+        TripleBuffer<int> buffer;
+
+        // Each side keeps its slot across the other side's calls.
+        for (int i = 1; i <= 10; i++)
+        {
+            buffer.GetWriteSlot() = i;
+            buffer.Publish();
+
+            if (i % 3 == 0)
+            {
+                Expect(buffer.Acquire(), "acquire after publish");
+                Expect(buffer.GetReadSlot() == i, "acquire returns the value just published");
+            }
+
+            Expect(&buffer.GetWriteSlot() != &buffer.GetReadSlot(), "producer and consumer never share a slot");
+
+            buffer.GetWriteSlot() = -1;
+            if (i % 3 == 0)
+            {
+                Expect(buffer.GetReadSlot() == i, "writing does not change the read slot");
+            }
+        }
+    }
+
+    void TestConcurrent(double seconds)
+    {
+        TripleBuffer<Frame> buffer;
+
+        std::atomic<bool> done{ false };
+        uint64_t published = 0;
+
+        std::thread producer([&]()
+        {
+            uint64_t sequence = 0;
+            while (!done.load(std::memory_order_relaxed))
+            {
+                Frame& frame = buffer.GetWriteSlot();
+
+                int owner = frame.Owner.exchange(Producer);
+                if (owner == Consumer)
+                {
+                    printf("FAILED: producer got the slot the consumer holds\n");
+                    failures++;
+                }
+
+                sequence++;
+                for (int i = 0; i < FrameWords; i++)
+                {
+                    frame.Words[i] = sequence;
+                }
+                frame.Sequence = sequence;
+
+                frame.Owner.store(Nobody);
+                buffer.Publish();
+            }
+            published = sequence;
+        });
+
+        uint64_t acquired = 0;
+        uint64_t torn = 0;
+        uint64_t reordered = 0;
+        uint64_t overlapped = 0;
+        uint64_t last = 0;
+
+        auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+        while (std::chrono::steady_clock::now() < end)
+        {
+            if (!buffer.Acquire())
+            {
+                continue;
+            }
+
+            Frame& frame = buffer.GetReadSlot();
+            if (frame.Owner.exchange(Consumer) == Producer)
+            {
+                overlapped++;
+            }
+
+            for (int i = 0; i < FrameWords; i++)
+            {
+                if (frame.Words[i] != frame.Sequence)
+                {
+                    torn++;
+                    break;
+                }
+            }
+
+            if (frame.Sequence <= last)
+            {
+                reordered++;
+            }
+            last = frame.Sequence;
+            acquired++;
+
+            frame.Owner.store(Nobody);
+        }
+
+        done = true;
+        producer.join();
+
+        printf("concurrent: %llu frames published, %llu acquired in %.1f s\n",
+            (unsigned long long)published, (unsigned long long)acquired, seconds);
+
+        Expect(acquired > 0, "consumer acquired frames");
+        Expect(torn == 0, "no torn frames");
+        Expect(reordered == 0, "acquired frames are newer than the one before");
+        Expect(overlapped == 0, "consumer never gets the slot the producer holds");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+
+    TestNothingPublished();
+    TestPublishAcquire();
+    TestNewestWins();
+    TestDistinctSlots();
+    TestConcurrent(seconds);
+
+    if (failures > 0)
+    {
+        printf("%d checks failed\n", failures.load());
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,456 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Compares how media samples move through the generic thread pool and through per stream
+// serial executors like SerialWorkQueue, by latency per sample and by thread switches.
+// A few streams each produce a sample every millisecond. A sample goes through the stages of
+// the sink stream and ends with the write on the connection's send queue, every stage queues
+// the next one on the same executor, like NetworkMediaSinkStream and SendBundleAsync do.
+// - thread pool: every stage is its own work item on a shared pool, a lock per stream keeps
+//   the stages of a stream from running at the same time, like OpQueue on the WinRT thread pool.
+// - serial, queued: every stream has a serial executor on a bounded set of workers, and every
+//   stage is queued on it, like SerialWorkQueue::RunAsync.
+// - serial, inline: the same, but a stage queued from its own executor runs right away, like
+//   SerialWorkQueue::Run.
+// A thread switch is a stage that runs on another thread than the stage before it. Context
+// switches of the process are counted too where the platform reports them.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 WorkQueueBenchmark.cpp
+// or:
+//     g++ -std=c++14 -O2 -pthread WorkQueueBenchmark.cpp
+//
+// Usage: WorkQueueBenchmark [seconds per mode]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const int NumStreams = 4;
+    const int SampleIntervalUS = 1000;
+
+    // ProcessSample, PrepareSample and the write, each touching the sample once.
+    const int NumStages = 3;
+    const int SampleBytes = 16 * 1024;
+
+    enum class DispatchMode
+    {
+        ThreadPool,
+        SerialQueued,
+        SerialInline
+    };
+
+    long long ContextSwitches()
+    {
+#if defined(_WIN32)
+        return -1;
+#else
+        rusage usage;
+        if (0 != getrusage(RUSAGE_SELF, &usage))
+        {
+            return -1;
+        }
+        return usage.ru_nvcsw + usage.ru_nivcsw;
+#endif
+    }
+
+    // The shared pool, the WinRT thread pool or the platform work queue under the serial ones.
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(int numThreads)
+            : _isStopping(false)
+        {
+            for (int i = 0; i < numThreads; i++)
+            {
+                _threads.emplace_back([this]() { Work(); });
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _isStopping = true;
+            }
+            _available.notify_all();
+
+            for (std::thread& thread : _threads)
+            {
+                thread.join();
+            }
+        }
+
+        void Submit(std::function<void()>&& workItem)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _workItems.push_back(std::move(workItem));
+            }
+            _available.notify_one();
+        }
+
+    private:
+        void Work()
+        {
+            for (;;)
+            {
+                std::function<void()> workItem;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _available.wait(lock, [this]() { return _isStopping || !_workItems.empty(); });
+                    if (_workItems.empty())
+                    {
+                        return;
+                    }
+
+                    workItem = std::move(_workItems.front());
+                    _workItems.pop_front();
+                }
+
+                workItem();
+            }
+        }
+
+        std::mutex _mutex;
+        std::condition_variable _available;
+        std::deque<std::function<void()>> _workItems;
+        std::vector<std::thread> _threads;
+        bool _isStopping;
+    };
+
+    // Runs its items one at a time and in order on the pool, one pool item per queued item,
+    // like a Media Foundation serial work queue.
+    class SerialExecutor
+    {
+    public:
+        explicit SerialExecutor(ThreadPool& pool)
+            : _pool(pool)
+            , _isScheduled(false)
+        {
+        }
+
+        void RunAsync(std::function<void()>&& workItem)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _workItems.push_back(std::move(workItem));
+            if (!_isScheduled)
+            {
+                _isScheduled = true;
+                _pool.Submit([this]() { DispatchOne(); });
+            }
+        }
+
+        void Run(std::function<void()>&& workItem)
+        {
+            if (_dispatchThread == std::this_thread::get_id())
+            {
+                workItem();
+                return;
+            }
+
+            RunAsync(std::move(workItem));
+        }
+
+    private:
+        void DispatchOne()
+        {
+            std::function<void()> workItem;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                workItem = std::move(_workItems.front());
+                _workItems.pop_front();
+            }
+
+            _dispatchThread = std::this_thread::get_id();
+            workItem();
+            _dispatchThread = std::thread::id();
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_workItems.empty())
+            {
+                _isScheduled = false;
+            }
+            else
+            {
+                _pool.Submit([this]() { DispatchOne(); });
+            }
+        }
+
+        ThreadPool& _pool;
+        std::mutex _mutex;
+        std::deque<std::function<void()>> _workItems;
+        bool _isScheduled;
+        std::atomic<std::thread::id> _dispatchThread;
+    };
+
+    struct Stream
+    {
+        explicit Stream(ThreadPool& pool)
+            : Executor(pool)
+            , Sample(SampleBytes, 1)
+            , Written(SampleBytes)
+            , Checksum(0)
+        {
+        }
+
+        SerialExecutor Executor;
+        // OpQueue's lock, only used in the thread pool mode
+        std::mutex Lock;
+
+        std::vector<unsigned char> Sample;
+        std::vector<unsigned char> Written;
+        unsigned Checksum;
+    };
+
+    struct Result
+    {
+        std::vector<double> Latencies;
+        long long ThreadSwitches = 0;
+        long long ContextSwitches = -1;
+    };
+
+    class Pipeline
+    {
+    public:
+        Pipeline(DispatchMode mode, int numSamples, int numThreads)
+            : _mode(mode)
+            , _queued(numSamples)
+            , _latencies(numSamples)
+            , _threadSwitches(0)
+            , _remaining(numSamples)
+            , _pool(numThreads)
+        {
+            for (int i = 0; i < NumStreams; i++)
+            {
+                _streams.emplace_back(new Stream(_pool));
+            }
+        }
+
+        void Queue(int streamIndex, int sample)
+        {
+            _queued[sample] = Clock::now();
+            Schedule(*_streams[streamIndex], sample, 0, std::thread::id(), false);
+        }
+
+        void Wait(Result& result)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_doneMutex);
+                _done.wait(lock, [this]() { return 0 == _remaining; });
+            }
+
+            result.Latencies = _latencies;
+            result.ThreadSwitches = _threadSwitches;
+        }
+
+    private:
+        // previous is the thread of the stage before, fromExecutor when queued from it
+        void Schedule(Stream& stream, int sample, int stage, std::thread::id previous, bool fromExecutor)
+        {
+            auto workItem = [this, &stream, sample, stage, previous]()
+            {
+                RunStage(stream, sample, stage, previous);
+            };
+
+            switch (_mode)
+            {
+            case DispatchMode::ThreadPool:
+                _pool.Submit(workItem);
+                break;
+            case DispatchMode::SerialQueued:
+                stream.Executor.RunAsync(workItem);
+                break;
+            case DispatchMode::SerialInline:
+                if (fromExecutor)
+                {
+                    stream.Executor.Run(workItem);
+                }
+                else
+                {
+                    stream.Executor.RunAsync(workItem);
+                }
+                break;
+            }
+        }
+
+        void RunStage(Stream& stream, int sample, int stage, std::thread::id previous)
+        {
+            std::unique_lock<std::mutex> lock(stream.Lock, std::defer_lock);
+            if (DispatchMode::ThreadPool == _mode)
+            {
+                lock.lock();
+            }
+
+            std::thread::id current = std::this_thread::get_id();
+            if (stage > 0 && current != previous)
+            {
+                _threadSwitches++;
+            }
+
+            // touch the sample like the stage would
+            if (NumStages - 1 == stage)
+            {
+                std::copy(stream.Sample.begin(), stream.Sample.end(), stream.Written.begin());
+            }
+            else
+            {
+                for (unsigned char value : stream.Sample)
+                {
+                    stream.Checksum = stream.Checksum * 31 + value;
+                }
+            }
+
+            if (lock.owns_lock())
+            {
+                lock.unlock();
+            }
+
+            if (stage + 1 < NumStages)
+            {
+                Schedule(stream, sample, stage + 1, current, true);
+                return;
+            }
+
+            _latencies[sample] = std::chrono::duration<double, std::micro>(Clock::now() - _queued[sample]).count();
+
+            std::lock_guard<std::mutex> doneLock(_doneMutex);
+            if (0 == --_remaining)
+            {
+                _done.notify_all();
+            }
+        }
+
+        DispatchMode _mode;
+        std::vector<std::unique_ptr<Stream>> _streams;
+
+        std::vector<Clock::time_point> _queued;
+        std::vector<double> _latencies;
+        std::atomic<long long> _threadSwitches;
+
+        std::mutex _doneMutex;
+        std::condition_variable _done;
+        int _remaining;
+
+        // last, so its workers are done before the streams go away
+        ThreadPool _pool;
+    };
+
+    Result Measure(DispatchMode mode, int seconds, int numThreads)
+    {
+        int samplesPerStream = seconds * 1000000 / SampleIntervalUS;
+        Result result;
+
+        long long contextSwitches = ContextSwitches();
+        {
+            Pipeline pipeline(mode, samplesPerStream * NumStreams, numThreads);
+
+            // one thread per stream, like the capture delivering samples to each sink stream
+            std::vector<std::thread> producers;
+            Clock::time_point start = Clock::now();
+            for (int s = 0; s < NumStreams; s++)
+            {
+                producers.emplace_back([&pipeline, s, samplesPerStream, start]()
+                {
+                    for (int i = 0; i < samplesPerStream; i++)
+                    {
+                        std::this_thread::sleep_until(start + std::chrono::microseconds((long long)i * SampleIntervalUS));
+                        pipeline.Queue(s, i * NumStreams + s);
+                    }
+                });
+            }
+
+            for (std::thread& producer : producers)
+            {
+                producer.join();
+            }
+
+            pipeline.Wait(result);
+        }
+
+        if (contextSwitches >= 0)
+        {
+            result.ContextSwitches = ContextSwitches() - contextSwitches;
+        }
+
+        return result;
+    }
+
+    double Percentile(std::vector<double> values, double p)
+    {
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(p * (values.size() - 1))];
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 3;
+    if (seconds <= 0)
+    {
+        fprintf(stderr, "Usage: WorkQueueBenchmark [seconds per mode]\n");
+        return 1;
+    }
+
+    int numThreads = std::max(2, (int)std::thread::hardware_concurrency());
+
+    struct Run
+    {
+        const char* Name;
+        DispatchMode Mode;
+    };
+
+    const Run runs[] =
+    {
+        { "thread pool", DispatchMode::ThreadPool },
+        { "serial, queued", DispatchMode::SerialQueued },
+        { "serial, inline", DispatchMode::SerialInline },
+    };
+
+    printf("%d streams, a sample every %d us each, %d stages per sample, %d worker threads, %d s per mode.\n",
+        NumStreams, SampleIntervalUS, NumStages, numThreads, seconds);
+    printf("Latency in us from queuing a sample to its write:\n");
+    printf("    %-16s %9s %9s %9s %9s %16s %16s\n", "", "samples", "median", "p99", "max", "thread switches", "context switches");
+
+    for (const Run& run : runs)
+    {
+        Result result = Measure(run.Mode, seconds, numThreads);
+
+        double samples = (double)result.Latencies.size();
+        printf("    %-16s %9d %9.1f %9.1f %9.1f %16.2f", run.Name, (int)result.Latencies.size(),
+            Percentile(result.Latencies, 0.5),
+            Percentile(result.Latencies, 0.99),
+            Percentile(result.Latencies, 1.0),
+            result.ThreadSwitches / samples);
+
+        if (result.ContextSwitches >= 0)
+        {
+            printf(" %16.2f\n", result.ContextSwitches / samples);
+        }
+        else
+        {
+            printf(" %16s\n", "n/a");
+        }
+    }
+
+    printf("Thread and context switches are per sample.\n");
+
+    return 0;
+}
@@ -0,0 +1,317 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Simulates how VideoEncoder places audio on the video timeline, and measures the A/V sync error of
+// the recording.
+// A synthetic camera queues frames and a synthetic microphone queues blocks of a quiet tone with a
+// loud burst at the start of every second of wall time. The blocks go through AudioRing and
+// AudioTimeline the way the encoder thread drains them. Afterwards the bursts are found in the
+// recorded audio and compared with where the same wall time is on the video timeline.
+// The audio clock can drift from the wall clock, callbacks can jitter, the camera can run off its
+// nominal rate and the audio can pause. Each block is stamped with the wall time of its first sample;
+// a fixed delay between capturing a block and stamping it would show up as a constant offset.
+// Every run uses a fixed seed, so the numbers are the same each time.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 AVSyncSimulation.cpp
+//
+// Usage: AVSyncSimulation [seconds per run]
+
+#include "../CompositorDLL/AudioRing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const int64_t HNSPerSecond = 10000000;
+
+    // AUDIO_SAMPLE_RATE, AUDIO_CHANNELS and AUDIO_CHANNEL_SIZE in CompositorConstants.h.
+    const int SampleRate = 48000;
+    const int Channels = 2;
+    const int BlockSamples = 1024;
+
+    // AudioRingSize, MaxAudioDriftHNS and MaxAudioGapHNS in VideoEncoder.h.
+    const int RingBlocks = 64;
+    const int64_t MaxDriftHNS = 20 * 10000;
+    const int64_t MaxGapHNS = 200 * 10000;
+
+    // The timeline the encoder writes video on.
+    const double NominalFPS = 60;
+
+    // Bursts before this are not measured, the timeline needs a moment to settle.
+    const double WarmUp = 2;
+    const double BurstSeconds = 0.05;
+    const int16_t ToneAmplitude = 1000;
+    const int16_t BurstAmplitude = 20000;
+
+    // Audio has to stay this close to the video, in ms.
+    const double MaxSyncError = 25;
+
+    struct Scenario
+    {
+        const char* Name;
+        // Audio clock against the wall clock.
+        double AudioDriftPPM;
+        // Standard deviation of when callbacks and frames arrive, in ms.
+        double JitterMS;
+        // Rate the camera really delivers at.
+        double CameraFPS;
+        // Wall time span without audio callbacks, like the engine pausing its audio.
+        double PauseStart;
+        double PauseSeconds;
+    };
+
+    struct Result
+    {
+        int Bursts = 0;
+        int Missed = 0;
+        double MeanError = 0;
+        double MaxError = 0;
+        // Recorded audio length minus video length, in ms.
+        double LengthDifference = 0;
+    };
+
+    // VideoEncoder::DrainAudio and WriteAudio, writing into memory instead of the sink writer.
+    class Encoder
+    {
+    public:
+        Encoder() :
+            ring(BlockSamples * Channels * sizeof(int16_t), RingBlocks),
+            timeline(SampleRate, MaxDriftHNS, MaxGapHNS)
+        {
+        }
+
+        AudioRing ring;
+        AudioTimeline timeline;
+        int64_t videoClockOffset = 0;
+        int64_t numFramesRecorded = 0;
+        std::vector<int16_t> recorded;
+
+        // QueueVideoFrame: how far the video timeline is from the wall clock, smoothed over a few frames.
+        int64_t QueueVideoFrame(int64_t now)
+        {
+            int64_t sampleTime = numFramesRecorded * (int64_t)(HNSPerSecond / NominalFPS);
+
+            int64_t clockOffset = sampleTime - now;
+            if (numFramesRecorded > 0)
+            {
+                clockOffset = videoClockOffset + (clockOffset - videoClockOffset) / 8;
+            }
+            videoClockOffset = clockOffset;
+
+            numFramesRecorded++;
+            return sampleTime;
+        }
+
+        void DrainAudio()
+        {
+            int64_t timestamp;
+            const uint8_t* block;
+            while ((block = ring.Front(timestamp)) != nullptr)
+            {
+                int64_t blockTime = timestamp + videoClockOffset;
+                int64_t correction = timeline.Place(blockTime);
+
+                if (correction > 0)
+                {
+                    WriteAudio(nullptr, correction);
+                }
+
+                int64_t skipped = std::min(std::max(-correction, (int64_t)0), (int64_t)BlockSamples);
+                WriteAudio((const int16_t*)block + skipped * Channels, BlockSamples - skipped);
+
+                ring.Pop();
+            }
+        }
+
+    private:
+        void WriteAudio(const int16_t* data, int64_t numSamples)
+        {
+            timeline.Advance(numSamples);
+            if (data == nullptr)
+            {
+                recorded.insert(recorded.end(), (size_t)(numSamples * Channels), 0);
+            }
+            else
+            {
+                recorded.insert(recorded.end(), data, data + numSamples * Channels);
+            }
+        }
+    };
+
+    // Microphone sample at a wall time: a quiet 1 kHz tone, loud for BurstSeconds after every whole second.
+    int16_t Tone(double wallTime)
+    {
+        double phase = std::sin(2 * 3.14159265358979 * 1000 * wallTime);
+        bool burst = wallTime - std::floor(wallTime) < BurstSeconds;
+        return (int16_t)((burst ? BurstAmplitude : ToneAmplitude) * phase);
+    }
+
+    Result Run(const Scenario& scenario, double seconds, unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::normal_distribution<double> jitter(0, scenario.JitterMS / 1000);
+
+        Encoder encoder;
+
+        // Wall and video timeline time of every frame.
+        std::vector<double> frameWall;
+        std::vector<double> frameVideo;
+
+        double audioRate = SampleRate * (1 + scenario.AudioDriftPPM * 1e-6);
+        double pollInterval = (double)BlockSamples / SampleRate;
+
+        int frame = 0;
+        int block = 0;
+        double frameTime = 0;
+        // Blocks are delivered once their last sample is captured.
+        double blockTime = BlockSamples / audioRate;
+        double nextPoll = 0;
+        std::vector<int16_t> samples(BlockSamples * Channels);
+
+        while (true)
+        {
+            double now = std::min(std::min(frameTime, blockTime), nextPoll);
+            if (now > seconds)
+            {
+                break;
+            }
+
+            if (now == frameTime)
+            {
+                int64_t sampleTime = encoder.QueueVideoFrame((int64_t)(frameTime * HNSPerSecond));
+                frameWall.push_back(frameTime);
+                frameVideo.push_back((double)sampleTime / HNSPerSecond);
+                frame++;
+                frameTime = frame / scenario.CameraFPS + jitter(random);
+                encoder.DrainAudio();
+            }
+            else if (now == blockTime)
+            {
+                double blockStart = block * BlockSamples / audioRate;
+                bool paused = blockStart >= scenario.PauseStart && blockStart < scenario.PauseStart + scenario.PauseSeconds;
+                if (!paused)
+                {
+                    for (int i = 0; i < BlockSamples; i++)
+                    {
+                        int16_t value = Tone(blockStart + i / audioRate);
+                        samples[i * Channels] = value;
+                        samples[i * Channels + 1] = value;
+                    }
+                    encoder.ring.Push((const uint8_t*)samples.data(), (int64_t)(blockStart * HNSPerSecond));
+                }
+                block++;
+                blockTime = (block + 1) * BlockSamples / audioRate + std::abs(jitter(random));
+            }
+            else
+            {
+                encoder.DrainAudio();
+                nextPoll += pollInterval;
+            }
+        }
+        encoder.DrainAudio();
+
+        Result result;
+
+        // Find each burst in the recording and compare it with the video timeline at the same wall time.
+        const std::vector<int16_t>& recorded = encoder.recorded;
+        size_t numSamples = recorded.size() / Channels;
+        size_t f = 0;
+        for (int second = (int)std::ceil(WarmUp); second < seconds - 1; second++)
+        {
+            if (second >= scenario.PauseStart - 1 && second < scenario.PauseStart + scenario.PauseSeconds + 1)
+            {
+                continue;
+            }
+
+            while (f + 2 < frameWall.size() && frameWall[f + 1] < second)
+            {
+                f++;
+            }
+            double videoTime = frameVideo[f] + (second - frameWall[f]) / (frameWall[f + 1] - frameWall[f]) * (frameVideo[f + 1] - frameVideo[f]);
+
+            // Search around where the burst should be, half a second either way.
+            size_t from = (size_t)std::max(0.0, (videoTime - 0.5) * SampleRate);
+            size_t to = std::min(numSamples, (size_t)((videoTime + 0.5) * SampleRate));
+            size_t onset = to;
+            for (size_t i = from; i < to; i++)
+            {
+                if (std::abs(recorded[i * Channels]) > (BurstAmplitude + ToneAmplitude) / 2)
+                {
+                    onset = i;
+                    break;
+                }
+            }
+
+            if (onset == to)
+            {
+                result.Missed++;
+                continue;
+            }
+
+            double error = ((double)onset / SampleRate - videoTime) * 1000;
+            result.MeanError += error;
+            result.MaxError = std::max(result.MaxError, std::abs(error));
+            result.Bursts++;
+        }
+
+        if (result.Bursts > 0)
+        {
+            result.MeanError /= result.Bursts;
+        }
+
+        double videoLength = frame / NominalFPS;
+        result.LengthDifference = ((double)numSamples / SampleRate - videoLength) * 1000;
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 600;
+    if (seconds < WarmUp + 10)
+    {
+        fprintf(stderr, "Usage: AVSyncSimulation [seconds per run, at least %.0f]\n", WarmUp + 10);
+        return 1;
+    }
+
+    const Scenario scenarios[] =
+    {
+        { "ideal clocks", 0, 0, 60, 1e9, 0 },
+        { "2 ms jitter", 0, 2, 60, 1e9, 0 },
+        { "audio clock +300 ppm, 2 ms jitter", 300, 2, 60, 1e9, 0 },
+        { "audio clock -300 ppm, 2 ms jitter", -300, 2, 60, 1e9, 0 },
+        { "camera at 59.94 fps, 2 ms jitter", 0, 2, 59.94, 1e9, 0 },
+        { "audio paused for 2 s, 2 ms jitter", 100, 2, 60, seconds / 2, 2 },
+    };
+
+    printf("%.0f s per run, a burst every second, errors in ms of audio after video:\n", seconds);
+    printf("    %-36s %8s %8s %8s %8s %14s\n", "", "bursts", "missed", "mean", "max", "audio - video");
+
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+    {
+        const Scenario& scenario = scenarios[i];
+        Result result = Run(scenario, seconds, 12345 + (unsigned)i);
+        bool ok = result.Missed == 0 && result.Bursts > 0 && result.MaxError <= MaxSyncError;
+
+        printf("    %-36s %8d %8d %8.2f %8.2f %14.1f%s\n",
+            scenario.Name, result.Bursts, result.Missed, result.MeanError, result.MaxError, result.LengthDifference,
+            ok ? "" : "  FAILED");
+
+        passed &= ok;
+    }
+
+    if (!passed)
+    {
+        printf("\nA burst was lost or more than %.0f ms from the video.\n", MaxSyncError);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Simulates the clock mapping of TimeSynchronizer on a remote clock that drifts, with samples that
+// arrive with jitter and now and then after a network delay spike.
+// Each run feeds the same samples to ClockModel and to the moving average of the offset it
+// replaced, and measures how far each mapping is from the true one, the remote clock plus the
+// mean delivery delay, once the first WarmUp seconds are over. It also reports the uncertainty
+// ClockModel gives next to the standard deviation of the jitter.
+// Every run uses a fixed seed, so the numbers are the same each time.
+//
+// Only depends on standard C++ and Windows.h, build it with:
+//     cl /EHsc /O2 /I..\SharedHeaders ClockModelSimulation.cpp
+//
+// Usage: ClockModelSimulation [seconds per run]
+
+#include <Windows.h>
+
+#include "../CompositorDLL/TimeSynchronizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Camera frames and poses both arrive at about this rate.
+    const double SampleRate = 60;
+
+    // Errors before the samples span the window of ClockModel are not counted.
+    const double WarmUp = 10;
+
+    // Where the clocks are when the run starts, in seconds since they started.
+    const double RemoteStart = 500;
+    const double LocalStart = 3600;
+
+    // Delivery delay without jitter.
+    const double BaseDelay = 0.010;
+
+    // ClockModel has to stay this close to the true mapping after warm up, on average and at worst.
+    const double MaxMeanError = 0.0005;
+    const double MaxError = 0.002;
+
+    // And report an uncertainty this close to the jitter, relative to it.
+    const double UncertaintyTolerance = 0.25;
+
+    struct Scenario
+    {
+        const char* Name;
+        double DriftPPM;
+        // Standard deviation of the delivery delay.
+        double Jitter;
+        // Fraction of samples that come late by SpikeDelay.
+        double SpikeRate;
+        double SpikeDelay;
+    };
+
+    // TimeSynchronizer before ClockModel: a moving average of the offset over the last 60 samples, in float.
+    class MovingAverageClock
+    {
+    public:
+        void AddSample(double remoteTime, double localTime)
+        {
+            float newDelta = (float)localTime - (float)remoteTime;
+            numSamples++;
+            float t = 1.0f / std::min((float)numSamples, 60.0f);
+            delta = (1 - t) * delta + t * newDelta;
+        }
+
+        double ToLocal(double remoteTime)
+        {
+            return (float)remoteTime + delta;
+        }
+
+    private:
+        float delta = 0;
+        int numSamples = 0;
+    };
+
+    struct Result
+    {
+        double MeanError = 0;
+        double MaxError = 0;
+        double OldMeanError = 0;
+        double OldMaxError = 0;
+        double MeanUncertainty = 0;
+    };
+
+    Result Run(const Scenario& scenario, double seconds, unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::normal_distribution<double> jitter(0, scenario.Jitter);
+        std::uniform_real_distribution<double> unit(0, 1);
+
+        ClockModel model;
+        MovingAverageClock old;
+
+        double drift = scenario.DriftPPM * 1e-6;
+
+        Result result;
+        int measured = 0;
+        for (int i = 0; i < (int)(seconds * SampleRate); i++)
+        {
+            double elapsed = i / SampleRate;
+            double remoteTime = RemoteStart + elapsed;
+
+            // What the mapping should give: when the sample leaves the remote side on the local clock, plus the mean delay.
+            double trueLocal = LocalStart + elapsed * (1 + drift) + BaseDelay;
+
+            double delay = BaseDelay + jitter(random);
+            if (unit(random) < scenario.SpikeRate)
+            {
+                delay += scenario.SpikeDelay;
+            }
+
+            model.AddSample(remoteTime, trueLocal - BaseDelay + delay);
+            old.AddSample(remoteTime, trueLocal - BaseDelay + delay);
+
+            if (elapsed < WarmUp)
+            {
+                continue;
+            }
+
+            double error = std::abs(model.ToLocal(remoteTime) - trueLocal);
+            double oldError = std::abs(old.ToLocal(remoteTime) - trueLocal);
+
+            result.MeanError += error;
+            result.MaxError = std::max(result.MaxError, error);
+            result.OldMeanError += oldError;
+            result.OldMaxError = std::max(result.OldMaxError, oldError);
+            result.MeanUncertainty += model.GetUncertainty();
+            measured++;
+        }
+
+        result.MeanError /= measured;
+        result.OldMeanError /= measured;
+        result.MeanUncertainty /= measured;
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 120;
+    if (seconds <= WarmUp)
+    {
+        fprintf(stderr, "Usage: ClockModelSimulation [seconds per run, more than %.0f]\n", WarmUp);
+        return 1;
+    }
+
+    const Scenario scenarios[] =
+    {
+        { "no drift, 4 ms jitter", 0, 0.004, 0, 0 },
+        { "no drift, 4 ms jitter, 2% spikes of 100 ms", 0, 0.004, 0.02, 0.100 },
+        { "50 ppm drift, 4 ms jitter, 2% spikes of 100 ms", 50, 0.004, 0.02, 0.100 },
+        { "200 ppm drift, 4 ms jitter, 2% spikes of 100 ms", 200, 0.004, 0.02, 0.100 },
+        { "-200 ppm drift, 4 ms jitter, 2% spikes of 100 ms", -200, 0.004, 0.02, 0.100 },
+        { "200 ppm drift, 1 ms jitter", 200, 0.001, 0, 0 },
+        { "200 ppm drift, 4 ms jitter, 10% spikes of 250 ms", 200, 0.004, 0.10, 0.250 },
+    };
+
+    printf("%.0f s per run at %.0f Hz, errors after the first %.0f s, in ms:\n", seconds, SampleRate, WarmUp);
+    printf("    %-50s %9s %9s %9s %9s %12s\n", "", "mean", "max", "old mean", "old max", "uncertainty");
+
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+    {
+        const Scenario& scenario = scenarios[i];
+        Result result = Run(scenario, seconds, 12345 + (unsigned)i);
+        bool ok = result.MeanError <= MaxMeanError && result.MaxError <= MaxError &&
+            result.MeanError < result.OldMeanError &&
+            std::abs(result.MeanUncertainty - scenario.Jitter) <= UncertaintyTolerance * scenario.Jitter;
+
+        printf("    %-50s %9.3f %9.3f %9.3f %9.3f %12.3f%s\n",
+            scenario.Name,
+            result.MeanError * 1000,
+            result.MaxError * 1000,
+            result.OldMeanError * 1000,
+            result.OldMaxError * 1000,
+            result.MeanUncertainty * 1000,
+            ok ? "" : "  FAILED");
+
+        passed &= ok;
+    }
+
+    if (!passed)
+    {
+        printf("\nClockModel was more than %.1f ms off on average or %.1f ms at worst, not closer than the moving average,\n"
+            "or its uncertainty was not within %.0f%% of the jitter.\n", MaxMeanError * 1000, MaxError * 1000, UncertaintyTolerance * 100);
+        return 1;
+    }
+
+    return 0;
+}
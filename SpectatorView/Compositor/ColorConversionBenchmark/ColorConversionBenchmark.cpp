@@ -0,0 +1,236 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Checks that the SSE4.1 paths of ColorConversion give the same output bit for bit as the scalar
+// reference, and measures both.
+// Every conversion runs both ways on random frames and on frames of extreme values, for every even
+// width from 2 to 1920, with padded strides so rows that do not fill a whole vector are covered.
+// Bytes past the width of a row must be left alone. Then each conversion is timed at 1080p.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 ColorConversionBenchmark.cpp ..\CompositorDLL\ColorConversion.cpp
+//
+// Usage: ColorConversionBenchmark [max width]
+
+#include "../CompositorDLL/ColorConversion.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const int CheckHeight = 4;
+    const int BenchmarkWidth = 1920;
+    const int BenchmarkHeight = 1080;
+    const int BenchmarkFrames = 50;
+
+    // Extra bytes at the end of every row, filled with this value.
+    const int RowPadding = 16;
+    const uint8_t Canary = 0xA5;
+
+    typedef ColorConversion::Matrix Matrix;
+
+    struct Frame
+    {
+        Frame(int width, int height, int bytesPerPixel, int heightDivisor = 1) :
+            Width(width * bytesPerPixel),
+            Stride(width * bytesPerPixel + RowPadding),
+            Rows(height / heightDivisor),
+            Bytes(Stride * Rows, Canary)
+        {
+        }
+
+        uint8_t* Data() { return Bytes.data(); }
+
+        // True if no byte past the width of a row was written.
+        bool PaddingIntact() const
+        {
+            for (int row = 0; row < Rows; row++)
+            {
+                for (int i = Width; i < Stride; i++)
+                {
+                    if (Bytes[row * Stride + i] != Canary)
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        void Fill(std::mt19937& random, bool extremes)
+        {
+            std::uniform_int_distribution<int> byte(0, 255);
+            for (int row = 0; row < Rows; row++)
+            {
+                for (int i = 0; i < Width; i++)
+                {
+                    int value = byte(random);
+                    Bytes[row * Stride + i] = (uint8_t)(extremes ? ((value & 1) ? 255 : 0) : value);
+                }
+            }
+        }
+
+        int Width;
+        int Stride;
+        int Rows;
+        std::vector<uint8_t> Bytes;
+    };
+
+    // One conversion, from a source of SourceBPP bytes per pixel to frames the conversion writes.
+    struct Conversion
+    {
+        const char* Name;
+        int SourceBPP;
+        // Planes written, each with its bytes per pixel and how many rows share one row of it.
+        int DestBPP[2];
+        int DestHeightDivisor[2];
+        std::function<void(Frame& source, Frame* dest, int width, int height, Matrix matrix)> Run;
+    };
+
+    std::vector<Conversion> Conversions()
+    {
+        return
+        {
+            { "RGBA to NV12", 4, { 1, 1 }, { 1, 2 }, [](Frame& s, Frame* d, int w, int h, Matrix m)
+                { ColorConversion::RGBAToNV12(s.Data(), s.Stride, d[0].Data(), d[0].Stride, d[1].Data(), d[1].Stride, w, h, m); } },
+            { "NV12 to RGBA", 1, { 4, 0 }, { 1, 1 }, [](Frame& s, Frame* d, int w, int h, Matrix m)
+                {
+                    // The UV plane is the second half of the source, half as many rows.
+                    ColorConversion::NV12ToRGBA(s.Data(), s.Stride, s.Data() + s.Stride * h, s.Stride, d[0].Data(), d[0].Stride, w, h, m);
+                } },
+            { "RGBA to UYVY", 4, { 2, 0 }, { 1, 1 }, [](Frame& s, Frame* d, int w, int h, Matrix m)
+                { ColorConversion::RGBAToUYVY(s.Data(), s.Stride, d[0].Data(), d[0].Stride, w, h, m); } },
+            { "UYVY to RGBA", 2, { 4, 0 }, { 1, 1 }, [](Frame& s, Frame* d, int w, int h, Matrix m)
+                { ColorConversion::UYVYToRGBA(s.Data(), s.Stride, d[0].Data(), d[0].Stride, w, h, m); } },
+            { "RGBA to YUY2", 4, { 2, 0 }, { 1, 1 }, [](Frame& s, Frame* d, int w, int h, Matrix m)
+                { ColorConversion::RGBAToYUY2(s.Data(), s.Stride, d[0].Data(), d[0].Stride, w, h, m); } },
+            { "YUY2 to RGBA", 2, { 4, 0 }, { 1, 1 }, [](Frame& s, Frame* d, int w, int h, Matrix m)
+                { ColorConversion::YUY2ToRGBA(s.Data(), s.Stride, d[0].Data(), d[0].Stride, w, h, m); } },
+        };
+    }
+
+    Frame MakeSource(const Conversion& conversion, int width, int height)
+    {
+        // NV12 sources carry the UV plane below the Y plane.
+        int rows = conversion.SourceBPP == 1 ? height + height / 2 : height;
+        return Frame(width, rows, conversion.SourceBPP);
+    }
+
+    std::vector<Frame> MakeDest(const Conversion& conversion, int width, int height)
+    {
+        std::vector<Frame> planes;
+        for (int i = 0; i < 2 && conversion.DestBPP[i] > 0; i++)
+        {
+            planes.emplace_back(width, height, conversion.DestBPP[i], conversion.DestHeightDivisor[i]);
+        }
+        return planes;
+    }
+
+    // False after printing the first width where the two paths differ.
+    bool CheckExact(const Conversion& conversion, Matrix matrix, int maxWidth, std::mt19937& random)
+    {
+        for (int width = 2; width <= maxWidth; width += 2)
+        {
+            for (int pass = 0; pass < 2; pass++)
+            {
+                Frame source = MakeSource(conversion, width, CheckHeight);
+                source.Fill(random, pass == 1);
+
+                std::vector<Frame> scalar = MakeDest(conversion, width, CheckHeight);
+                std::vector<Frame> simd = MakeDest(conversion, width, CheckHeight);
+
+                ColorConversion::SetSIMDEnabled(false);
+                conversion.Run(source, scalar.data(), width, CheckHeight, matrix);
+                ColorConversion::SetSIMDEnabled(true);
+                conversion.Run(source, simd.data(), width, CheckHeight, matrix);
+
+                for (size_t i = 0; i < scalar.size(); i++)
+                {
+                    if (scalar[i].Bytes != simd[i].Bytes)
+                    {
+                        printf("    FAILED: output differs from the scalar reference at width %d%s\n", width, pass == 1 ? " (extremes)" : "");
+                        return false;
+                    }
+                    if (!simd[i].PaddingIntact())
+                    {
+                        printf("    FAILED: wrote past the end of a row at width %d\n", width);
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    double MillisecondsPerFrame(const Conversion& conversion, bool simd)
+    {
+        Frame source = MakeSource(conversion, BenchmarkWidth, BenchmarkHeight);
+        std::mt19937 random(1);
+        source.Fill(random, false);
+        std::vector<Frame> dest = MakeDest(conversion, BenchmarkWidth, BenchmarkHeight);
+
+        ColorConversion::SetSIMDEnabled(simd);
+
+        // Once to warm up.
+        conversion.Run(source, dest.data(), BenchmarkWidth, BenchmarkHeight, Matrix::BT601);
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < BenchmarkFrames; i++)
+        {
+            conversion.Run(source, dest.data(), BenchmarkWidth, BenchmarkHeight, Matrix::BT601);
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        ColorConversion::SetSIMDEnabled(true);
+        return ms / BenchmarkFrames;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int maxWidth = argc > 1 ? atoi(argv[1]) : BenchmarkWidth;
+    if (maxWidth < 2)
+    {
+        fprintf(stderr, "Usage: ColorConversionBenchmark [max width]\n");
+        return 1;
+    }
+
+    if (!ColorConversion::IsSIMDSupported())
+    {
+        printf("SSE4.1 is not supported on this CPU, only the scalar path runs.\n");
+    }
+
+    std::vector<Conversion> conversions = Conversions();
+    std::mt19937 random(12345);
+
+    printf("Bit exactness against the scalar reference, widths 2 to %d, BT.601 and BT.709:\n", maxWidth);
+    bool passed = true;
+    for (const Conversion& conversion : conversions)
+    {
+        bool exact = CheckExact(conversion, Matrix::BT601, maxWidth, random) &&
+            CheckExact(conversion, Matrix::BT709, maxWidth, random);
+        printf("    %-14s %s\n", conversion.Name, exact ? "exact" : "DIFFERENT");
+        passed &= exact;
+    }
+
+    printf("\nTime per %dx%d frame:\n", BenchmarkWidth, BenchmarkHeight);
+    printf("    %-14s %10s %10s %8s\n", "", "scalar ms", "SSE4.1 ms", "speedup");
+    for (const Conversion& conversion : conversions)
+    {
+        double scalar = MillisecondsPerFrame(conversion, false);
+        double simd = MillisecondsPerFrame(conversion, true);
+        printf("    %-14s %10.2f %10.2f %7.1fx\n", conversion.Name, scalar, simd, scalar / simd);
+    }
+
+    return passed ? 0 : 1;
+}
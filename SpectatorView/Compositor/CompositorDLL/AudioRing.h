@@ -0,0 +1,191 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+/*
+Single producer, single consumer ring of fixed size audio blocks.
+
+The engine's audio thread pushes blocks with the time they were captured,
+the encoder thread drains them. Neither side takes a lock, and a full ring
+drops the new block instead of blocking the audio thread.
+
+Only standard C++ is used here, so the ring can be built and tested
+outside of the Windows build.
+*/
+class AudioRing
+{
+public:
+    AudioRing(int blockSize, int numBlocks)
+        : blockSize(blockSize)
+        , numBlocks(numBlocks)
+        , buffer(new uint8_t[blockSize * numBlocks])
+        , timeStamps(new int64_t[numBlocks])
+    {
+        Reset();
+    }
+
+    ~AudioRing()
+    {
+        delete[] buffer;
+        delete[] timeStamps;
+    }
+
+    // Drops every block. Only call this while neither side is using the ring.
+    void Reset()
+    {
+        head.store(0);
+        tail.store(0);
+    }
+
+    int GetBlockSize()
+    {
+        return blockSize;
+    }
+
+    // producer: false if the ring is full and the block was dropped
+    bool Push(const uint8_t* block, int64_t timeStamp)
+    {
+        uint32_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) >= (uint32_t)numBlocks)
+        {
+            return false;
+        }
+
+        int index = currentTail % numBlocks;
+        memcpy(buffer + index * blockSize, block, blockSize);
+        timeStamps[index] = timeStamp;
+
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer: oldest block, valid until Pop. nullptr if the ring is empty.
+    const uint8_t* Front(int64_t& timeStamp)
+    {
+        uint32_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+
+        int index = currentHead % numBlocks;
+        timeStamp = timeStamps[index];
+        return buffer + index * blockSize;
+    }
+
+    // consumer: hands the block from Front back to the producer
+    void Pop()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool IsEmpty()
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    AudioRing(const AudioRing&);
+    AudioRing& operator=(const AudioRing&);
+
+    const int blockSize;
+    const int numBlocks;
+    uint8_t* buffer;
+    int64_t* timeStamps;
+
+    // Block counters, they wrap around safely since only their difference is used.
+    std::atomic<uint32_t> head;     // next block to read, owned by the consumer
+    std::atomic<uint32_t> tail;     // next block to write, owned by the producer
+};
+
+/*
+Places audio on the recording timeline one sample at a time.
+
+Sample times come from the number of samples written, so they never
+accumulate rounding errors. Each block's capture time is compared with
+where the timeline expects it. Callback jitter is smoothed out, and once
+the timeline is off by more than maxDrift, silence is inserted or samples
+are skipped to bring it back. Gaps longer than maxGap, like the engine
+pausing its audio, are closed right away.
+*/
+class AudioTimeline
+{
+public:
+    AudioTimeline(int sampleRate, int64_t maxDriftHNS, int64_t maxGapHNS)
+        : sampleRate(sampleRate)
+        , maxDrift(maxDriftHNS)
+        , maxGap(maxGapHNS)
+    {
+        Reset();
+    }
+
+    void Reset()
+    {
+        samplesWritten = 0;
+        smoothedError = 0;
+        started = false;
+    }
+
+    // Samples of silence to write before a block that belongs at blockTime (positive),
+    // or samples to skip from the start of the block (negative).
+    int64_t Place(int64_t blockTime)
+    {
+        int64_t error = blockTime - GetTime();
+
+        if (!started || error > maxGap || error < -maxGap)
+        {
+            started = true;
+            smoothedError = 0;
+            return ToSamples(error);
+        }
+
+        smoothedError += (error - smoothedError) / ErrorSmoothing;
+        if (smoothedError > maxDrift || smoothedError < -maxDrift)
+        {
+            int64_t correction = ToSamples(smoothedError);
+            smoothedError = 0;
+            return correction;
+        }
+
+        return 0;
+    }
+
+    void Advance(int64_t samples)
+    {
+        samplesWritten += samples;
+    }
+
+    // Time of the next sample in 100ns units.
+    int64_t GetTime()
+    {
+        return ToTime(samplesWritten);
+    }
+
+    int64_t ToTime(int64_t samples)
+    {
+        return (samples / sampleRate) * HNSPerSecond + ((samples % sampleRate) * HNSPerSecond) / sampleRate;
+    }
+
+    int64_t ToSamples(int64_t time)
+    {
+        return (time / HNSPerSecond) * sampleRate + ((time % HNSPerSecond) * sampleRate) / HNSPerSecond;
+    }
+
+private:
+    static const int64_t HNSPerSecond = 10000000;
+    // Blocks the drift estimate averages over.
+    static const int64_t ErrorSmoothing = 16;
+
+    const int sampleRate;
+    const int64_t maxDrift;
+    const int64_t maxGap;
+
+    int64_t samplesWritten;
+    int64_t smoothedError;
+    bool started;
+};
@@ -0,0 +1,479 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "ColorConversion.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <smmintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace
+{
+    struct Coefficients
+    {
+        // RGB to YUV.
+        int16_t yr, yg, yb;
+        int16_t ur, ug, ub;
+        int16_t vr, vg, vb;
+
+        // YUV to RGB.
+        int16_t cy, rv, gu, gv, bu;
+    };
+
+    // Conversion requires > 8 bit precision.
+    // https://msdn.microsoft.com/en-us/library/ms893078.aspx
+    const Coefficients BT601Coefficients = { 66, 129, 25, -38, -74, 112, 112, -94, -18, 298, 409, -100, -208, 516 };
+    const Coefficients BT709Coefficients = { 47, 157, 16, -26, -87, 112, 112, -102, -10, 298, 459, -55, -136, 541 };
+
+    // Byte offsets inside a 4 byte macro pixel of a packed 4:2:2 format.
+    struct PackedLayout
+    {
+        int y0, u, y1, v;
+    };
+
+    const PackedLayout UYVYLayout = { 1, 0, 3, 2 };
+    const PackedLayout YUY2Layout = { 0, 1, 2, 3 };
+
+    bool simdEnabled = true;
+
+    const Coefficients& GetCoefficients(ColorConversion::Matrix matrix)
+    {
+        return (matrix == ColorConversion::Matrix::BT709) ? BT709Coefficients : BT601Coefficients;
+    }
+
+    bool UseSIMD()
+    {
+        return simdEnabled && ColorConversion::IsSIMDSupported();
+    }
+
+#pragma region Scalar
+    inline uint8_t Clamp(int value)
+    {
+        return (uint8_t)std::min(std::max(value, 0), 255);
+    }
+
+    inline uint8_t ToY(const Coefficients& k, int r, int g, int b)
+    {
+        return Clamp(((k.yr * r + k.yg * g + k.yb * b + 128) >> 8) + 16);
+    }
+
+    inline uint8_t ToU(const Coefficients& k, int r, int g, int b)
+    {
+        return Clamp(((k.ur * r + k.ug * g + k.ub * b + 128) >> 8) + 128);
+    }
+
+    inline uint8_t ToV(const Coefficients& k, int r, int g, int b)
+    {
+        return Clamp(((k.vr * r + k.vg * g + k.vb * b + 128) >> 8) + 128);
+    }
+
+    inline void ToRGBA(const Coefficients& k, int y, int u, int v, uint8_t* rgba)
+    {
+        int c = y - 16;
+        int d = u - 128;
+        int e = v - 128;
+
+        rgba[0] = Clamp((k.cy * c + k.rv * e + 128) >> 8);
+        rgba[1] = Clamp((k.cy * c + k.gu * d + k.gv * e + 128) >> 8);
+        rgba[2] = Clamp((k.cy * c + k.bu * d + 128) >> 8);
+        rgba[3] = 255;
+    }
+
+    void RGBAToNV12Rows(const Coefficients& k, const uint8_t* src0, const uint8_t* src1,
+        uint8_t* y0, uint8_t* y1, uint8_t* uv, int x, int width)
+    {
+        for (; x < width; x += 2)
+        {
+            const uint8_t* p00 = src0 + x * 4;
+            const uint8_t* p01 = p00 + 4;
+            const uint8_t* p10 = src1 + x * 4;
+            const uint8_t* p11 = p10 + 4;
+
+            y0[x] = ToY(k, p00[0], p00[1], p00[2]);
+            y0[x + 1] = ToY(k, p01[0], p01[1], p01[2]);
+            y1[x] = ToY(k, p10[0], p10[1], p10[2]);
+            y1[x + 1] = ToY(k, p11[0], p11[1], p11[2]);
+
+            int r = (p00[0] + p01[0] + p10[0] + p11[0] + 2) >> 2;
+            int g = (p00[1] + p01[1] + p10[1] + p11[1] + 2) >> 2;
+            int b = (p00[2] + p01[2] + p10[2] + p11[2] + 2) >> 2;
+
+            uv[x] = ToU(k, r, g, b);
+            uv[x + 1] = ToV(k, r, g, b);
+        }
+    }
+
+    void NV12ToRGBARow(const Coefficients& k, const uint8_t* y, const uint8_t* uv, uint8_t* rgba, int x, int width)
+    {
+        for (; x < width; x += 2)
+        {
+            ToRGBA(k, y[x], uv[x], uv[x + 1], rgba + x * 4);
+            ToRGBA(k, y[x + 1], uv[x], uv[x + 1], rgba + x * 4 + 4);
+        }
+    }
+
+    void RGBAToPackedRow(const Coefficients& k, const PackedLayout& layout, const uint8_t* rgba, uint8_t* packed, int x, int width)
+    {
+        for (; x < width; x += 2)
+        {
+            const uint8_t* p0 = rgba + x * 4;
+            const uint8_t* p1 = p0 + 4;
+            uint8_t* macroPixel = packed + x * 2;
+
+            int r = (p0[0] + p1[0] + 1) >> 1;
+            int g = (p0[1] + p1[1] + 1) >> 1;
+            int b = (p0[2] + p1[2] + 1) >> 1;
+
+            macroPixel[layout.y0] = ToY(k, p0[0], p0[1], p0[2]);
+            macroPixel[layout.y1] = ToY(k, p1[0], p1[1], p1[2]);
+            macroPixel[layout.u] = ToU(k, r, g, b);
+            macroPixel[layout.v] = ToV(k, r, g, b);
+        }
+    }
+
+    void PackedToRGBARow(const Coefficients& k, const PackedLayout& layout, const uint8_t* packed, uint8_t* rgba, int x, int width)
+    {
+        for (; x < width; x += 2)
+        {
+            const uint8_t* macroPixel = packed + x * 2;
+
+            ToRGBA(k, macroPixel[layout.y0], macroPixel[layout.u], macroPixel[layout.v], rgba + x * 4);
+            ToRGBA(k, macroPixel[layout.y1], macroPixel[layout.u], macroPixel[layout.v], rgba + x * 4 + 4);
+        }
+    }
+#pragma endregion Scalar
+
+#pragma region SSE4.1
+    // Two 16 bit coefficients for _mm_madd_epi16, lo multiplies the even lane.
+    inline __m128i CoefficientPair(int16_t lo, int16_t hi)
+    {
+        return _mm_set1_epi32((int)((uint32_t)(uint16_t)lo | ((uint32_t)(uint16_t)hi << 16)));
+    }
+
+    // 8 Y, U and V values in 16 bit lanes to 8 RGBA pixels.
+    inline void StoreRGBA8(const Coefficients& k, __m128i y, __m128i u, __m128i v, uint8_t* rgba)
+    {
+        const __m128i c = _mm_sub_epi16(y, _mm_set1_epi16(16));
+        const __m128i d = _mm_sub_epi16(u, _mm_set1_epi16(128));
+        const __m128i e = _mm_sub_epi16(v, _mm_set1_epi16(128));
+        const __m128i one = _mm_set1_epi16(1);
+        const __m128i round = _mm_set1_epi32(128);
+
+        const __m128i kR = CoefficientPair(k.cy, k.rv);
+        const __m128i kG = CoefficientPair(k.cy, k.gu);
+        const __m128i kGV = CoefficientPair(k.gv, 128);
+        const __m128i kB = CoefficientPair(k.cy, k.bu);
+
+        const __m128i ceLo = _mm_unpacklo_epi16(c, e);
+        const __m128i ceHi = _mm_unpackhi_epi16(c, e);
+        const __m128i cdLo = _mm_unpacklo_epi16(c, d);
+        const __m128i cdHi = _mm_unpackhi_epi16(c, d);
+        const __m128i e1Lo = _mm_unpacklo_epi16(e, one);
+        const __m128i e1Hi = _mm_unpackhi_epi16(e, one);
+
+        __m128i rLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ceLo, kR), round), 8);
+        __m128i rHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ceHi, kR), round), 8);
+        __m128i gLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdLo, kG), _mm_madd_epi16(e1Lo, kGV)), 8);
+        __m128i gHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdHi, kG), _mm_madd_epi16(e1Hi, kGV)), 8);
+        __m128i bLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdLo, kB), round), 8);
+        __m128i bHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdHi, kB), round), 8);
+
+        // Saturating packs clamp to 0..255.
+        const __m128i zero = _mm_setzero_si128();
+        __m128i r = _mm_packus_epi16(_mm_packs_epi32(rLo, rHi), zero);
+        __m128i g = _mm_packus_epi16(_mm_packs_epi32(gLo, gHi), zero);
+        __m128i b = _mm_packus_epi16(_mm_packs_epi32(bLo, bHi), zero);
+        __m128i a = _mm_set1_epi8((char)0xFF);
+
+        __m128i rg = _mm_unpacklo_epi8(r, g);
+        __m128i ba = _mm_unpacklo_epi8(b, a);
+
+        _mm_storeu_si128((__m128i*)rgba, _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128((__m128i*)(rgba + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+
+    // 8 RGBA pixels to 8 Y values in 16 bit lanes.
+    inline __m128i LoadY8(const Coefficients& k, const uint8_t* rgba)
+    {
+        const __m128i kY = _mm_setr_epi16(k.yr, k.yg, k.yb, 0, k.yr, k.yg, k.yb, 0);
+        const __m128i round = _mm_set1_epi32(128);
+        const __m128i offset = _mm_set1_epi32(16);
+
+        __m128i p0 = _mm_loadu_si128((const __m128i*)rgba);
+        __m128i p1 = _mm_loadu_si128((const __m128i*)(rgba + 16));
+
+        __m128i s0 = _mm_madd_epi16(_mm_cvtepu8_epi16(p0), kY);
+        __m128i s1 = _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(p0, 8)), kY);
+        __m128i s2 = _mm_madd_epi16(_mm_cvtepu8_epi16(p1), kY);
+        __m128i s3 = _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(p1, 8)), kY);
+
+        __m128i y03 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(s0, s1), round), 8), offset);
+        __m128i y47 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(s2, s3), round), 8), offset);
+
+        return _mm_packs_epi32(y03, y47);
+    }
+
+    // Two pairs of pixel sums [P0, P1] (RGBA in 16 bit lanes) to 4 averaged pixels, shift 1 for 2 pixels, 2 for 4.
+    inline __m128i AveragePairs(__m128i p01, __m128i p23, __m128i round, int shift)
+    {
+        __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(p01, p23), _mm_unpackhi_epi64(p01, p23));
+        return _mm_srli_epi16(_mm_add_epi16(sum, round), shift);
+    }
+
+    // 4 averaged pixels (two per register) to U0 V0 U1 V1 U2 V2 U3 V3 in the low 8 bytes.
+    inline __m128i ToUV4(const Coefficients& k, __m128i avg01, __m128i avg23)
+    {
+        const __m128i kU = _mm_setr_epi16(k.ur, k.ug, k.ub, 0, k.ur, k.ug, k.ub, 0);
+        const __m128i kV = _mm_setr_epi16(k.vr, k.vg, k.vb, 0, k.vr, k.vg, k.vb, 0);
+        const __m128i round = _mm_set1_epi32(128);
+        const __m128i offset = _mm_set1_epi32(128);
+
+        __m128i u = _mm_hadd_epi32(_mm_madd_epi16(avg01, kU), _mm_madd_epi16(avg23, kU));
+        __m128i v = _mm_hadd_epi32(_mm_madd_epi16(avg01, kV), _mm_madd_epi16(avg23, kV));
+
+        u = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(u, round), 8), offset);
+        v = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(v, round), 8), offset);
+
+        __m128i uv = _mm_unpacklo_epi16(_mm_packs_epi32(u, u), _mm_packs_epi32(v, v));
+        return _mm_packus_epi16(uv, _mm_setzero_si128());
+    }
+
+    // Byte shuffle that widens the selected bytes of a 16 byte register to 16 bit lanes.
+    inline __m128i WidenMask(const int* offsets)
+    {
+        return _mm_setr_epi8(
+            (char)offsets[0], (char)0x80, (char)offsets[1], (char)0x80, (char)offsets[2], (char)0x80, (char)offsets[3], (char)0x80,
+            (char)offsets[4], (char)0x80, (char)offsets[5], (char)0x80, (char)offsets[6], (char)0x80, (char)offsets[7], (char)0x80);
+    }
+
+    int RGBAToNV12RowsSSE41(const Coefficients& k, const uint8_t* src0, const uint8_t* src1,
+        uint8_t* y0, uint8_t* y1, uint8_t* uv, int width)
+    {
+        const __m128i round = _mm_set1_epi16(2);
+
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            const uint8_t* p0 = src0 + x * 4;
+            const uint8_t* p1 = src1 + x * 4;
+
+            __m128i yRow0 = LoadY8(k, p0);
+            __m128i yRow1 = LoadY8(k, p1);
+            _mm_storel_epi64((__m128i*)(y0 + x), _mm_packus_epi16(yRow0, yRow0));
+            _mm_storel_epi64((__m128i*)(y1 + x), _mm_packus_epi16(yRow1, yRow1));
+
+            __m128i a0 = _mm_loadu_si128((const __m128i*)p0);
+            __m128i a1 = _mm_loadu_si128((const __m128i*)(p0 + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i*)p1);
+            __m128i b1 = _mm_loadu_si128((const __m128i*)(p1 + 16));
+
+            // Sum the two rows per pixel, then each horizontal pair.
+            __m128i s01 = _mm_add_epi16(_mm_cvtepu8_epi16(a0), _mm_cvtepu8_epi16(b0));
+            __m128i s23 = _mm_add_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(a0, 8)), _mm_cvtepu8_epi16(_mm_srli_si128(b0, 8)));
+            __m128i s45 = _mm_add_epi16(_mm_cvtepu8_epi16(a1), _mm_cvtepu8_epi16(b1));
+            __m128i s67 = _mm_add_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(a1, 8)), _mm_cvtepu8_epi16(_mm_srli_si128(b1, 8)));
+
+            __m128i avg01 = AveragePairs(s01, s23, round, 2);
+            __m128i avg23 = AveragePairs(s45, s67, round, 2);
+
+            _mm_storel_epi64((__m128i*)(uv + x), ToUV4(k, avg01, avg23));
+        }
+
+        return x;
+    }
+
+    int NV12ToRGBARowSSE41(const Coefficients& k, const uint8_t* y, const uint8_t* uv, uint8_t* rgba, int width)
+    {
+        const int uOffsets[8] = { 0, 0, 2, 2, 4, 4, 6, 6 };
+        const int vOffsets[8] = { 1, 1, 3, 3, 5, 5, 7, 7 };
+        const __m128i uMask = WidenMask(uOffsets);
+        const __m128i vMask = WidenMask(vOffsets);
+
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            __m128i yValues = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(y + x)));
+            __m128i uvValues = _mm_loadl_epi64((const __m128i*)(uv + x));
+
+            StoreRGBA8(k, yValues, _mm_shuffle_epi8(uvValues, uMask), _mm_shuffle_epi8(uvValues, vMask), rgba + x * 4);
+        }
+
+        return x;
+    }
+
+    int RGBAToPackedRowSSE41(const Coefficients& k, const PackedLayout& layout, const uint8_t* rgba, uint8_t* packed, int width)
+    {
+        const __m128i round = _mm_set1_epi16(1);
+        const bool chromaFirst = (layout.u == 0);
+
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            const uint8_t* p = rgba + x * 4;
+
+            __m128i yValues = LoadY8(k, p);
+            __m128i yBytes = _mm_packus_epi16(yValues, yValues);
+
+            __m128i a0 = _mm_loadu_si128((const __m128i*)p);
+            __m128i a1 = _mm_loadu_si128((const __m128i*)(p + 16));
+
+            __m128i avg01 = AveragePairs(_mm_cvtepu8_epi16(a0), _mm_cvtepu8_epi16(_mm_srli_si128(a0, 8)), round, 1);
+            __m128i avg23 = AveragePairs(_mm_cvtepu8_epi16(a1), _mm_cvtepu8_epi16(_mm_srli_si128(a1, 8)), round, 1);
+            __m128i uvBytes = ToUV4(k, avg01, avg23);
+
+            // UYVY interleaves U Y V Y, YUY2 interleaves Y U Y V.
+            __m128i macroPixels = chromaFirst ? _mm_unpacklo_epi8(uvBytes, yBytes) : _mm_unpacklo_epi8(yBytes, uvBytes);
+            _mm_storeu_si128((__m128i*)(packed + x * 2), macroPixels);
+        }
+
+        return x;
+    }
+
+    int PackedToRGBARowSSE41(const Coefficients& k, const PackedLayout& layout, const uint8_t* packed, uint8_t* rgba, int width)
+    {
+        int yOffsets[8], uOffsets[8], vOffsets[8];
+        for (int i = 0; i < 8; i++)
+        {
+            int macroPixel = (i / 2) * 4;
+            yOffsets[i] = macroPixel + ((i % 2 == 0) ? layout.y0 : layout.y1);
+            uOffsets[i] = macroPixel + layout.u;
+            vOffsets[i] = macroPixel + layout.v;
+        }
+
+        const __m128i yMask = WidenMask(yOffsets);
+        const __m128i uMask = WidenMask(uOffsets);
+        const __m128i vMask = WidenMask(vOffsets);
+
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            __m128i values = _mm_loadu_si128((const __m128i*)(packed + x * 2));
+
+            StoreRGBA8(k, _mm_shuffle_epi8(values, yMask), _mm_shuffle_epi8(values, uMask), _mm_shuffle_epi8(values, vMask), rgba + x * 4);
+        }
+
+        return x;
+    }
+#pragma endregion SSE4.1
+
+    void RGBAToPacked(const PackedLayout& layout, const uint8_t* rgba, int rgbaStride, uint8_t* packed, int packedStride,
+        int width, int height, ColorConversion::Matrix matrix)
+    {
+        const Coefficients& k = GetCoefficients(matrix);
+        const bool simd = UseSIMD();
+
+        for (int row = 0; row < height; row++)
+        {
+            const uint8_t* src = rgba + (ptrdiff_t)row * rgbaStride;
+            uint8_t* dst = packed + (ptrdiff_t)row * packedStride;
+
+            int x = simd ? RGBAToPackedRowSSE41(k, layout, src, dst, width) : 0;
+            RGBAToPackedRow(k, layout, src, dst, x, width);
+        }
+    }
+
+    void PackedToRGBA(const PackedLayout& layout, const uint8_t* packed, int packedStride, uint8_t* rgba, int rgbaStride,
+        int width, int height, ColorConversion::Matrix matrix)
+    {
+        const Coefficients& k = GetCoefficients(matrix);
+        const bool simd = UseSIMD();
+
+        for (int row = 0; row < height; row++)
+        {
+            const uint8_t* src = packed + (ptrdiff_t)row * packedStride;
+            uint8_t* dst = rgba + (ptrdiff_t)row * rgbaStride;
+
+            int x = simd ? PackedToRGBARowSSE41(k, layout, src, dst, width) : 0;
+            PackedToRGBARow(k, layout, src, dst, x, width);
+        }
+    }
+}
+
+void ColorConversion::RGBAToNV12(const uint8_t* rgba, int rgbaStride, uint8_t* yPlane, int yStride, uint8_t* uvPlane, int uvStride,
+    int width, int height, Matrix matrix)
+{
+    const Coefficients& k = GetCoefficients(matrix);
+    const bool simd = UseSIMD();
+
+    for (int row = 0; row < height; row += 2)
+    {
+        const uint8_t* src0 = rgba + (ptrdiff_t)row * rgbaStride;
+        const uint8_t* src1 = src0 + rgbaStride;
+        uint8_t* y0 = yPlane + (ptrdiff_t)row * yStride;
+        uint8_t* y1 = y0 + yStride;
+        uint8_t* uv = uvPlane + (ptrdiff_t)(row / 2) * uvStride;
+
+        int x = simd ? RGBAToNV12RowsSSE41(k, src0, src1, y0, y1, uv, width) : 0;
+        RGBAToNV12Rows(k, src0, src1, y0, y1, uv, x, width);
+    }
+}
+
+void ColorConversion::NV12ToRGBA(const uint8_t* yPlane, int yStride, const uint8_t* uvPlane, int uvStride, uint8_t* rgba, int rgbaStride,
+    int width, int height, Matrix matrix)
+{
+    const Coefficients& k = GetCoefficients(matrix);
+    const bool simd = UseSIMD();
+
+    for (int row = 0; row < height; row++)
+    {
+        const uint8_t* y = yPlane + (ptrdiff_t)row * yStride;
+        const uint8_t* uv = uvPlane + (ptrdiff_t)(row / 2) * uvStride;
+        uint8_t* dst = rgba + (ptrdiff_t)row * rgbaStride;
+
+        int x = simd ? NV12ToRGBARowSSE41(k, y, uv, dst, width) : 0;
+        NV12ToRGBARow(k, y, uv, dst, x, width);
+    }
+}
+
+void ColorConversion::RGBAToUYVY(const uint8_t* rgba, int rgbaStride, uint8_t* uyvy, int uyvyStride,
+    int width, int height, Matrix matrix)
+{
+    RGBAToPacked(UYVYLayout, rgba, rgbaStride, uyvy, uyvyStride, width, height, matrix);
+}
+
+void ColorConversion::UYVYToRGBA(const uint8_t* uyvy, int uyvyStride, uint8_t* rgba, int rgbaStride,
+    int width, int height, Matrix matrix)
+{
+    PackedToRGBA(UYVYLayout, uyvy, uyvyStride, rgba, rgbaStride, width, height, matrix);
+}
+
+void ColorConversion::RGBAToYUY2(const uint8_t* rgba, int rgbaStride, uint8_t* yuy2, int yuy2Stride,
+    int width, int height, Matrix matrix)
+{
+    RGBAToPacked(YUY2Layout, rgba, rgbaStride, yuy2, yuy2Stride, width, height, matrix);
+}
+
+void ColorConversion::YUY2ToRGBA(const uint8_t* yuy2, int yuy2Stride, uint8_t* rgba, int rgbaStride,
+    int width, int height, Matrix matrix)
+{
+    PackedToRGBA(YUY2Layout, yuy2, yuy2Stride, rgba, rgbaStride, width, height, matrix);
+}
+
+bool ColorConversion::IsSIMDSupported()
+{
+    static const bool supported = []()
+    {
+        // SSE4.1 is bit 19 of ECX for leaf 1.
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 19)) != 0;
+#else
+        unsigned int eax, ebx, ecx, edx;
+        return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1 << 19)) != 0;
+#endif
+    }();
+
+    return supported;
+}
+
+void ColorConversion::SetSIMDEnabled(bool enabled)
+{
+    simdEnabled = enabled;
+}
@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// CPU conversions between RGBA and the YUV layouts the compositor works with.
+// The fixed point math matches YUV2RGB.hlsl and YUVHelper.cginc (studio range, 8 bit coefficients),
+// so frames converted here look the same as frames converted on the GPU.
+//
+// NV12: full resolution Y plane followed by an interleaved UV plane at half resolution.
+// UYVY: U0 Y0 V0 Y1 (http://www.fourcc.org/yuv.php#UYVY)
+// YUY2: Y0 U0 Y1 V0 (http://www.fourcc.org/yuv.php#YUY2)
+//
+// Chroma for subsampled formats is the rounded average of the pixels it covers.
+// Width and height must be even. Strides are in bytes.
+//
+// SyntheticFrameProvider uses it to make its UYVY test pattern. Only standard C++ and SSE
+// intrinsics are used here, so the conversions can be checked and measured outside of the
+// Windows build, see ColorConversionBenchmark.
+
+#pragma once
+
+#include <cstdint>
+
+class ColorConversion
+{
+public:
+    enum class Matrix
+    {
+        BT601,
+        BT709
+    };
+
+    static void RGBAToNV12(const uint8_t* rgba, int rgbaStride, uint8_t* yPlane, int yStride, uint8_t* uvPlane, int uvStride,
+        int width, int height, Matrix matrix = Matrix::BT601);
+    static void NV12ToRGBA(const uint8_t* yPlane, int yStride, const uint8_t* uvPlane, int uvStride, uint8_t* rgba, int rgbaStride,
+        int width, int height, Matrix matrix = Matrix::BT601);
+
+    static void RGBAToUYVY(const uint8_t* rgba, int rgbaStride, uint8_t* uyvy, int uyvyStride,
+        int width, int height, Matrix matrix = Matrix::BT601);
+    static void UYVYToRGBA(const uint8_t* uyvy, int uyvyStride, uint8_t* rgba, int rgbaStride,
+        int width, int height, Matrix matrix = Matrix::BT601);
+
+    static void RGBAToYUY2(const uint8_t* rgba, int rgbaStride, uint8_t* yuy2, int yuy2Stride,
+        int width, int height, Matrix matrix = Matrix::BT601);
+    static void YUY2ToRGBA(const uint8_t* yuy2, int yuy2Stride, uint8_t* rgba, int rgbaStride,
+        int width, int height, Matrix matrix = Matrix::BT601);
+
+    // SSE4.1 is used when the CPU supports it. Disabling it runs the scalar reference,
+    // which gives the same output bit for bit.
+    static bool IsSIMDSupported();
+    static void SetSIMDEnabled(bool enabled);
+};
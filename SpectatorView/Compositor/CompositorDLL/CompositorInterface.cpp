@@ -12,25 +12,93 @@ CompositorInterface::CompositorInterface()
     outputPath = std::wstring(myDocumentsPath) + L"\\HologramCapture\\";
 
     DirectoryHelper::CreateOutputDirectory(outputPath);
+}
+
+CompositorInterface::~CompositorInterface()
+{
+}
 
+IFrameProvider* CompositorInterface::CreateFrameProvider()
+{
+    switch (captureConfig.Provider)
+    {
 #if USE_DECKLINK || USE_DECKLINK_SHUTTLE
-    frameProvider = new DeckLinkManager();
+    case FrameProviderType::DeckLink:
+    case FrameProviderType::DeckLinkShuttle:
+        return new DeckLinkManager(captureConfig);
 #endif
 #if USE_ELGATO
-    frameProvider = new ElgatoFrameProvider();
+    case FrameProviderType::Elgato:
+        return new ElgatoFrameProvider(captureConfig);
 #endif
 #if USE_OPENCV
-    frameProvider = new OpenCVFrameProvider();
+    case FrameProviderType::OpenCV:
+        return new OpenCVFrameProvider(captureConfig);
+#endif
+#if USE_SYNTHETIC_FRAMES
+    case FrameProviderType::Synthetic:
+        return new SyntheticFrameProvider(captureConfig);
 #endif
+    default:
+        return nullptr;
+    }
 }
 
-CompositorInterface::~CompositorInterface()
+bool CompositorInterface::SetCaptureConfig(const CaptureConfig& config)
 {
-    delete[] photoBytes;
+    if (!config.IsValid())
+    {
+        OutputDebugString(L"ERROR: invalid capture config, or its frame provider is not built.\n");
+        return false;
+    }
+
+    // Buffers are sized from the config, so it cannot change under a running capture.
+    if ((frameProvider != nullptr && frameProvider->IsEnabled()) ||
+        (videoEncoder != nullptr && videoEncoder->IsRecording()))
+    {
+        return false;
+    }
+
+    bool frameSizeChanged = (config.FrameWidth != captureConfig.FrameWidth || config.FrameHeight != captureConfig.FrameHeight);
+    bool videoChanged = frameSizeChanged || config.VideoFPS != captureConfig.VideoFPS;
+
+    captureConfig = config;
+
+    // Providers size their frame ring when they are created, the next Initialize makes a new one.
+    if (frameProvider != nullptr)
+    {
+        frameProvider->Dispose();
+        delete frameProvider;
+        frameProvider = nullptr;
+    }
+
+    if (frameSizeChanged)
+    {
+        FreeVideoBuffers();
+        VideoTextureBuffer.ReleaseTextures();
+    }
+
+    if (videoChanged && videoEncoder != nullptr)
+    {
+        delete videoEncoder;
+        videoEncoder = nullptr;
+
+        if (_device != nullptr)
+        {
+            InitializeVideoEncoder(_device);
+        }
+    }
+
+    return true;
 }
 
 bool CompositorInterface::Initialize(ID3D11Device* device, ID3D11ShaderResourceView* colorSRV, ID3D11Texture2D* outputTexture)
 {
+    if (frameProvider == nullptr)
+    {
+        frameProvider = CreateFrameProvider();
+    }
+
     if (frameProvider == nullptr)
     {
         return false;
@@ -67,10 +135,7 @@ void CompositorInterface::UpdateFrameProvider()
 
 void CompositorInterface::Update()
 {
-    if (videoEncoder != nullptr)
-    {
-        videoEncoder->Update();
-    }
+    // Recorded frames are written on the video encoder's own thread.
 }
 
 void CompositorInterface::StopFrameProvider()
@@ -135,10 +200,11 @@ void CompositorInterface::GetPose(XMFLOAT3& position, XMFLOAT4& rotation, int fr
     // Update time synchronizer.
     float captureTime = GetTimeFromFrame(captureFrameIndex);
 
-    PoseData* poseData = poseCache.GetLatestPose();
-    if (poseData != nullptr)
+    PoseData poseData;
+    bool hasLatestPose = poseCache.GetLatestPose(poseData);
+    if (hasLatestPose)
     {
-        timeSynchronizer.Update(GetCaptureFrameIndex(), captureTime, poseData->Index, poseData->TimeStamp);
+        timeSynchronizer.Update(GetCaptureFrameIndex(), captureTime, poseData.Index, poseData.TimeStamp);
     }
 
     // Set camera transform for the currently composited frame.
@@ -156,34 +222,108 @@ void CompositorInterface::GetPose(XMFLOAT3& position, XMFLOAT4& rotation, int fr
         poseTime = std::numeric_limits<float>::max();
     }
 
-    poseCache.GetPose(position, rotation, poseTime);
+    PoseLookup lookup;
+    poseCache.GetPose(position, rotation, poseTime, &lookup);
+
+    if (telemetry.IsRecording())
+    {
+        LARGE_INTEGER time;
+        QueryPerformanceCounter(&time);
+
+        TelemetryRecord record = {};
+        record.Time = time.QuadPart;
+        record.CompositeFrame = CurrentCompositeFrame;
+        record.CaptureFrame = captureFrameIndex;
+        record.FrameStep = step;
+
+        FrameStats frameStats;
+        if (frameProvider != nullptr && frameProvider->GetFrameStats(frameStats))
+        {
+            record.CapturedFrames = frameStats.CapturedFrames;
+            record.DroppedFrames = frameStats.DroppedFrames;
+        }
+        else
+        {
+            record.CapturedFrames = -1;
+            record.DroppedFrames = -1;
+        }
+
+        record.EncoderQueueDepth = (videoEncoder != nullptr && videoEncoder->IsRecording()) ? videoEncoder->GetQueueDepth() : -1;
+        record.LatestPoseIndex = hasLatestPose ? poseData.Index : -1;
+        record.SelectedPose = lookup.SelectedIndex;
+        record.CameraTime = cameraTime;
+        record.PoseTime = poseTime;
+        record.LatestPoseTime = hasLatestPose ? poseData.TimeStamp : 0;
+        record.InterpolationSpan = lookup.InterpolationSpan;
+        record.PoseTimeUncertainty = timeSynchronizer.GetPoseTimeUncertainty();
+        record.PredictionTime = lookup.PredictionTime;
+
+        if (hasLatestPose)
+        {
+            record.LatestPosition[0] = poseData.Position.x;
+            record.LatestPosition[1] = poseData.Position.y;
+            record.LatestPosition[2] = poseData.Position.z;
+            record.LatestRotation[0] = poseData.Rotation.x;
+            record.LatestRotation[1] = poseData.Rotation.y;
+            record.LatestRotation[2] = poseData.Rotation.z;
+            record.LatestRotation[3] = poseData.Rotation.w;
+        }
+
+        telemetry.Write(record);
+    }
+}
+
+bool CompositorInterface::StartTelemetry()
+{
+    int index = telemetryIndex + 1;
+    std::wstring telemetryPath = DirectoryHelper::FindUniqueFileName(outputPath, L"Telemetry", L".svtl", index);
+
+    if (!telemetry.Start(telemetryPath))
+    {
+        return false;
+    }
+
+    telemetryIndex = index;
+    return true;
 }
 
 #pragma region
-void CompositorInterface::TakePicture(ID3D11Texture2D* outputTexture)
+void CompositorInterface::TakePicture(int count)
+{
+    queuedPhotos += count;
+}
+
+// Call from render thread.
+void CompositorInterface::UpdatePhotoCapture(ID3D11Texture2D* outputTexture)
 {
-    if (outputTexture == nullptr || _device == nullptr)
+    if (_device == nullptr)
     {
         return;
     }
 
-    ID3D11DeviceContext* context;
-    _device->GetImmediateContext(&context);
+    // Hand photos the GPU has finished copying to the encoders.
+    photoCapture.Update(_device);
 
-    // Get bytes from texture because screengrab does not support texture format provided by Unity.
-    DirectXHelper::GetBytesFromTexture(_device, outputTexture, FRAME_BPP, photoBytes);
-    ID3D11Texture2D* tex = DirectXHelper::CreateTexture(_device, photoBytes, FRAME_WIDTH, FRAME_HEIGHT, FRAME_BPP, DXGI_FORMAT_B8G8R8A8_UNORM_SRGB);
+    if (queuedPhotos <= 0 || outputTexture == nullptr)
+    {
+        return;
+    }
 
-    photoIndex++;
-    std::wstring photoPath = DirectoryHelper::FindUniqueFileName(outputPath, L"Photo", L".png", photoIndex);
+    // Claim the index first, the file is only written once the photo has been encoded.
+    int index = photoIndex + 1;
+    std::wstring photoPath = DirectoryHelper::FindUniqueFileName(outputPath, L"Photo", PhotoCapture::GetExtension(photoFormat), index);
 
-    //TODO: Save each channel?
-    DirectX::SaveWICTextureToFile(context, tex, GUID_ContainerFormatPng, photoPath.c_str());
+    // If all staging textures are busy, the photo is taken on a later frame.
+    if (photoCapture.Capture(_device, outputTexture, photoPath, photoFormat))
+    {
+        photoIndex = index;
+        queuedPhotos--;
+    }
 }
 
 bool CompositorInterface::InitializeVideoEncoder(ID3D11Device* device)
 {
-    videoEncoder = new VideoEncoder(FRAME_WIDTH, FRAME_HEIGHT, FRAME_WIDTH * FRAME_BPP, VIDEO_FPS,
+    videoEncoder = new VideoEncoder(captureConfig.FrameWidth, captureConfig.FrameHeight, captureConfig.GetFrameStride(), captureConfig.VideoFPS,
         AUDIO_BUFSIZE, AUDIO_SAMPLE_RATE, AUDIO_CHANNELS, AUDIO_BPS);
 
     return videoEncoder->Initialize(device);
@@ -254,7 +394,7 @@ void CompositorInterface::AllocateVideoBuffers()
 
     for (int i = 0; i < NUM_VIDEO_BUFFERS; i++)
     {
-        videoBytes[i] = new byte[(int)(1.5f * FRAME_WIDTH * FRAME_HEIGHT)];
+        videoBytes[i] = new byte[captureConfig.GetVideoBufferSize()];
     }
 }
 
@@ -299,6 +439,6 @@ void CompositorInterface::RecordAudioFrameAsync(BYTE* audioFrame, LONGLONG frame
         return;
     }
 
-    videoEncoder->QueueAudioFrame(audioFrame);
+    videoEncoder->QueueAudioFrame(audioFrame, frameTime);
 }
 #pragma endregion Recording
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include "DeckLinkManager.h"
 #include "ElgatoFrameProvider.h"
 #include "OpenCVFrameProvider.h"
+#include "SyntheticFrameProvider.h"
 
 #include "DirectXHelper.h"
 
@@ -22,7 +23,9 @@
 #include "VideoEncoder.h"
 
 #include "BufferedTextureFetch.h"
+#include "PhotoCapture.h"
 #include "PoseCache.h"
+#include "TelemetryRecorder.h"
 #include "TimeSynchronizer.h"
 
 class CompositorInterface
@@ -33,6 +36,15 @@ public:
     ~CompositorInterface();
 
     DLLEXPORT bool Initialize(ID3D11Device* device, ID3D11ShaderResourceView* colorSRV, ID3D11Texture2D* outputTexture);
+
+    // Capture settings for the next Initialize. Fails while capturing or recording,
+    // or if the config is invalid or names a frame provider that is not built.
+    DLLEXPORT bool SetCaptureConfig(const CaptureConfig& config);
+    DLLEXPORT const CaptureConfig& GetCaptureConfig()
+    {
+        return captureConfig;
+    }
+
     DLLEXPORT void UpdateFrameProvider();
     DLLEXPORT void Update();
     DLLEXPORT void StopFrameProvider();
@@ -51,7 +63,13 @@ public:
     }
 
     // Recording
-    DLLEXPORT void TakePicture(ID3D11Texture2D* outputTexture);
+    // Photos are taken one per frame by UpdatePhotoCapture, so a burst captures consecutive frames.
+    DLLEXPORT void TakePicture(int count = 1);
+    DLLEXPORT void UpdatePhotoCapture(ID3D11Texture2D* outputTexture);
+    DLLEXPORT void SetPhotoFormat(PhotoCapture::Format format)
+    {
+        photoFormat = format;
+    }
     DLLEXPORT bool InitializeVideoEncoder(ID3D11Device* device);
     DLLEXPORT void StartRecording();
     DLLEXPORT void StopRecording();
@@ -83,7 +101,7 @@ public:
 
     DLLEXPORT int LastPoseSelectedIndex()
     {
-        return poseCache.LastSelectedIndex;
+        return poseCache.GetLastSelectedIndex();
     }
 
     DLLEXPORT void ResetPoseCache()
@@ -92,8 +110,28 @@ public:
         timeSynchronizer.Reset();
     }
 
+    // Call from the thread that calls GetPose.
+    DLLEXPORT void SetPosePrediction(PosePredictor::Mode mode, float horizon, float decayTime)
+    {
+        poseCache.SetPrediction(mode, horizon, decayTime);
+    }
+
+    // Telemetry
+    // Records pose and frame timing of every GetPose call to a new file in the output directory.
+    // Call from the thread that calls GetPose.
+    DLLEXPORT bool StartTelemetry();
+    DLLEXPORT void StopTelemetry()
+    {
+        telemetry.Stop();
+    }
+    DLLEXPORT bool IsRecordingTelemetry()
+    {
+        return telemetry.IsRecording();
+    }
+
 private:
-    IFrameProvider* frameProvider;
+    CaptureConfig captureConfig;
+    IFrameProvider* frameProvider = nullptr;
     std::wstring outputPath;
     ID3D11Device* _device;
 
@@ -107,19 +145,27 @@ private:
     int lastVideoFrame = -1;
     BufferedTextureFetch VideoTextureBuffer;
     VideoEncoder* videoEncoder = nullptr;
-    byte* photoBytes = new byte[FRAME_BUFSIZE];
+    PhotoCapture photoCapture;
+    PhotoCapture::Format photoFormat = (PhotoCapture::Format)PHOTO_FORMAT;
+    int queuedPhotos = 0;
     byte** videoBytes = nullptr;
     int videoBufferIndex = 0;
 
     void AllocateVideoBuffers();
     void FreeVideoBuffers();
 
+    IFrameProvider* CreateFrameProvider();
+
     // Pose
     PoseCache poseCache;
     TimeSynchronizer timeSynchronizer;
 
     int CurrentCompositeFrame = 0;
 
+    // Telemetry
+    TelemetryRecorder telemetry;
+    int telemetryIndex = -1;
+
     // Abstracts time in seconds from frame index based on known duration.
     float GetTimeFromFrame(int frame)
     {
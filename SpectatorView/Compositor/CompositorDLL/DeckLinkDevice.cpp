@@ -33,22 +33,20 @@
 
 using namespace std;
 
-DeckLinkDevice::DeckLinkDevice(IDeckLink* device) :
+DeckLinkDevice::DeckLinkDevice(IDeckLink* device, const CaptureConfig& config) :
+    config(config),
     m_deckLink(device),
     m_deckLinkInput(NULL),
     m_deckLinkOutput(NULL),
     m_supportsFormatDetection(false),
     m_refCount(1),
     m_currentlyCapturing(false),
-    m_playbackTimeScale(600)
+    m_playbackTimeScale(600),
+    frameRing(config.GetFrameBufferSize(), config.CachedFrames)
 {
-    for (int i = 0; i < MAX_NUM_CACHED_BUFFERS; i++)
-    {
-        bufferCache[i].buffer = new BYTE[FRAME_BUFSIZE];
-        bufferCache[i].timeStamp = 0;
-    }
-
-    captureFrameIndex = 0;
+    rawBuffer = new BYTE[config.GetRawFrameBufferSize()];
+    latestBuffer = new BYTE[config.GetFrameBufferSize()];
+    outputBuffer = new BYTE[config.GetFrameBufferSize()];
 
     if (m_deckLink != NULL)
     {
@@ -86,11 +84,7 @@ DeckLinkDevice::~DeckLinkDevice()
     DeleteCriticalSection(&m_outputCriticalSection);
     DeleteCriticalSection(&m_frameAccessCriticalSection);
 
-    for (int i = 0; i < MAX_NUM_CACHED_BUFFERS; i++)
-    {
-        delete[] bufferCache[i].buffer;
-    }
-
+    delete[] rawBuffer;
     delete[] latestBuffer;
     delete[] outputBuffer;
 }
@@ -156,16 +150,11 @@ bool DeckLinkDevice::Init(ID3D11ShaderResourceView* colorSRV)
     IDeckLinkDisplayMode*           displayMode = NULL;
     BSTR                            deviceNameBSTR = NULL;
 
-    ZeroMemory(rawBuffer, FRAME_BUFSIZE_RAW);
-    ZeroMemory(latestBuffer, FRAME_BUFSIZE);
-    ZeroMemory(outputBuffer, FRAME_BUFSIZE);
+    ZeroMemory(rawBuffer, config.GetRawFrameBufferSize());
+    ZeroMemory(latestBuffer, config.GetFrameBufferSize());
+    ZeroMemory(outputBuffer, config.GetFrameBufferSize());
 
-    for (int i = 0; i < MAX_NUM_CACHED_BUFFERS; i++)
-    {
-        ZeroMemory(bufferCache[i].buffer, FRAME_BUFSIZE);
-    }
-
-    captureFrameIndex = 0;
+    frameRing.Reset();
 
     _colorSRV = colorSRV;
 
@@ -200,7 +189,7 @@ bool DeckLinkDevice::Init(ID3D11ShaderResourceView* colorSRV)
     // 1080i output causes horizontal artifacts on screen.
     if (m_deckLinkOutput != NULL)
     {
-        m_deckLinkOutput->CreateVideoFrame(FRAME_WIDTH, FRAME_HEIGHT, FRAME_WIDTH * FRAME_BPP, bmdFormat8BitBGRA, bmdFrameFlagDefault, &outputFrame);
+        m_deckLinkOutput->CreateVideoFrame(config.FrameWidth, config.FrameHeight, config.GetFrameStride(), bmdFormat8BitBGRA, bmdFrameFlagDefault, &outputFrame);
         outputFrame->GetBytes((void**)&outputBuffer);
     }
 
@@ -228,7 +217,15 @@ bool DeckLinkDevice::StartCapture(BMDDisplayMode videoDisplayMode)
     m_deckLinkInput->SetCallback(this);
 
     // Set the video input mode
-    if (m_deckLinkInput->EnableVideoInput(videoDisplayMode, bmdFormat8BitYUV, videoInputFlags) != S_OK)
+    BMDPixelFormat bmdPixelFormat = bmdFormat8BitYUV;
+    pixelFormat = PixelFormat::YUV;
+    if (config.PixelFormat == CapturePixelFormat::BGRA)
+    {
+        bmdPixelFormat = bmdFormat8BitBGRA;
+        pixelFormat = PixelFormat::BGRA;
+    }
+
+    if (m_deckLinkInput->EnableVideoInput(videoDisplayMode, bmdPixelFormat, videoInputFlags) != S_OK)
     {
         OutputDebugString(L"Unable to set the chosen video mode.\n");
         return false;
@@ -246,6 +243,8 @@ bool DeckLinkDevice::StartCapture(BMDDisplayMode videoDisplayMode)
         supportsOutput = false;
     }
 
+    frameRing.Reset();
+
     // Start the capture
     if (m_deckLinkInput->StartStreams() != S_OK)
     {
@@ -254,7 +253,6 @@ bool DeckLinkDevice::StartCapture(BMDDisplayMode videoDisplayMode)
     }
 
     m_currentlyCapturing = true;
-    captureFrameIndex = 0;
 
     return true;
 }
@@ -294,7 +292,7 @@ HRESULT DeckLinkDevice::VideoInputFormatChanged(/* in */ BMDVideoInputFormatChan
     OutputDebugString(L"\n");
 
     // If we do not have the correct dimension frames - loop until user changes camera settings.
-    if (newMode->GetWidth() != FRAME_WIDTH || newMode->GetHeight() != FRAME_HEIGHT)
+    if (newMode->GetWidth() != config.FrameWidth || newMode->GetHeight() != config.FrameHeight)
     {
         OutputDebugString(L"Invalid frame dimensions detected.\n");
         OutputDebugString(L"Actual Frame Dimensions: ");
@@ -304,9 +302,9 @@ HRESULT DeckLinkDevice::VideoInputFormatChanged(/* in */ BMDVideoInputFormatChan
         OutputDebugString(L"\n");
 
         OutputDebugString(L"Expected Frame Dimensions: ");
-        OutputDebugString(std::to_wstring(FRAME_WIDTH).c_str());
+        OutputDebugString(std::to_wstring(config.FrameWidth).c_str());
         OutputDebugString(L", ");
-        OutputDebugString(std::to_wstring(FRAME_HEIGHT).c_str());
+        OutputDebugString(std::to_wstring(config.FrameHeight).c_str());
         OutputDebugString(L"\n");
 
         LeaveCriticalSection(&m_captureCardCriticalSection);
@@ -379,27 +377,28 @@ HRESULT DeckLinkDevice::VideoInputFrameArrived(/* in */ IDeckLinkVideoInputFrame
 
     EnterCriticalSection(&m_captureCardCriticalSection);
 
-    if (frame->GetBytes((void**)&localFrameBuffer) == S_OK)
-    {
-        captureFrameIndex++;
-        BYTE* buffer = bufferCache[captureFrameIndex % MAX_NUM_CACHED_BUFFERS].buffer;
-
-        memcpy(buffer, localFrameBuffer, frame->GetRowBytes() * frame->GetHeight());
-    }
-    
-
+    // Get frame time.
     LONGLONG t;
     frame->GetStreamTime(&t, &frameDuration, S2HNS);
 
-    
-    // Get frame time.
-    bufferCache[captureFrameIndex % MAX_NUM_CACHED_BUFFERS].timeStamp = t;
+    if (frame->GetBytes((void**)&localFrameBuffer) == S_OK)
+    {
+        // Null if the render thread is still reading the oldest frame, this frame is dropped then.
+        BYTE* buffer = frameRing.BeginWrite();
+        if (buffer != nullptr)
+        {
+            memcpy(buffer, localFrameBuffer, std::min(frame->GetRowBytes() * frame->GetHeight(), (long)frameRing.GetFrameSize()));
+            frameRing.Publish(t);
+        }
+    }
 
     dirtyFrame = false;
 
-    if (supportsOutput && m_deckLinkOutput != NULL && outputFrame != NULL)
+    // Do not wait for the render thread while it fetches the output texture,
+    // the previous output frame stays on screen instead.
+    if (supportsOutput && m_deckLinkOutput != NULL && outputFrame != NULL &&
+        TryEnterCriticalSection(&m_outputCriticalSection))
     {
-        EnterCriticalSection(&m_outputCriticalSection);
         m_deckLinkOutput->DisplayVideoFrameSync(outputFrame);
         LeaveCriticalSection(&m_outputCriticalSection);
     }
@@ -414,10 +413,11 @@ void DeckLinkDevice::Update(int compositeFrameIndex)
     if (_colorSRV != nullptr &&
         device != nullptr)
     {
-        const BufferCache& buffer = bufferCache[compositeFrameIndex % MAX_NUM_CACHED_BUFFERS];
-        if (buffer.buffer != nullptr)
+        const BYTE* buffer = frameRing.AcquireFrame(compositeFrameIndex);
+        if (buffer != nullptr)
         {
-            DirectXHelper::UpdateSRV(device, _colorSRV, buffer.buffer, FRAME_WIDTH * FRAME_BPP);
+            DirectXHelper::UpdateSRV(device, _colorSRV, buffer, config.GetFrameStride());
+            frameRing.ReleaseFrame();
         }
 
         if (supportsOutput && device != nullptr && _outputTexture != nullptr)
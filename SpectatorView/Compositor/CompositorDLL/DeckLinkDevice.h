@@ -35,6 +35,8 @@
 #include "DirectXHelper.h"
 #include <string>
 #include "BufferedTextureFetch.h"
+#include "FrameRing.h"
+#include "CaptureConfig.h"
 
 class DeckLinkDevice : public IDeckLinkInputCallback
 {
@@ -58,25 +60,19 @@ private:
     CRITICAL_SECTION          m_frameAccessCriticalSection;
     CRITICAL_SECTION          m_outputCriticalSection;
 
+    CaptureConfig config;
+
     BYTE* localFrameBuffer;
-    BYTE* rawBuffer = new BYTE[FRAME_BUFSIZE_RAW];
+    BYTE* rawBuffer;
 
-    BYTE* latestBuffer = new BYTE[FRAME_BUFSIZE];
-    BYTE* outputBuffer = new BYTE[FRAME_BUFSIZE];
+    BYTE* latestBuffer;
+    BYTE* outputBuffer;
 
     IDeckLinkMutableVideoFrame* outputFrame = NULL;
 
     BMDTimeValue frameDuration = 0;
 
-    class BufferCache
-    {
-    public:
-        BYTE * buffer;
-        LONGLONG timeStamp;
-    };
-
-    BufferCache bufferCache[MAX_NUM_CACHED_BUFFERS];
-    int captureFrameIndex;
+    FrameRing frameRing;
 
     bool dirtyFrame = true;
 
@@ -87,7 +83,7 @@ private:
     BufferedTextureFetch outputTextureBuffer;
 
 public:
-    DeckLinkDevice(IDeckLink* device);
+    DeckLinkDevice(IDeckLink* device, const CaptureConfig& config);
     virtual ~DeckLinkDevice();
 
     bool                                Init(ID3D11ShaderResourceView* colorSRV);
@@ -112,7 +108,7 @@ public:
 
     LONGLONG GetTimestamp(int frame)
     {
-        return bufferCache[frame % MAX_NUM_CACHED_BUFFERS].timeStamp;
+        return frameRing.GetTimestamp(frame);
     }
 
     LONGLONG GetDurationHNS()
@@ -122,7 +118,12 @@ public:
 
     int GetCaptureFrameIndex()
     {
-        return captureFrameIndex;
+        return frameRing.GetLatestFrame();
+    }
+
+    void GetFrameStats(FrameStats& stats)
+    {
+        frameRing.GetStats(stats);
     }
 
     bool OutputYUV();
@@ -6,7 +6,8 @@
 
 #if USE_DECKLINK || USE_DECKLINK_SHUTTLE
 
-DeckLinkManager::DeckLinkManager()
+DeckLinkManager::DeckLinkManager(const CaptureConfig& config) :
+    config(config)
 {
     deckLinkDiscovery = new DeckLinkDeviceDiscovery();
     if (!deckLinkDiscovery->Enable())
@@ -38,7 +39,7 @@ HRESULT DeckLinkManager::Initialize(ID3D11ShaderResourceView* srv)
         deckLink = deckLinkDiscovery->GetDeckLink();
         if (deckLink != nullptr)
         {
-            deckLinkDevice = new DeckLinkDevice(deckLink);
+            deckLinkDevice = new DeckLinkDevice(deckLink, config);
             if (deckLinkDevice != nullptr)
             {
                 deckLinkDevice->Init(srv);
@@ -51,26 +52,21 @@ HRESULT DeckLinkManager::Initialize(ID3D11ShaderResourceView* srv)
                     //TODO: The DeckLink device must have a valid starting format to autodetect the actual format.
                     //      However, if you select a valid format that is less than your output format, your frames will be downsized.
                     //      Update the videoDisplayMode if your camera's output does not meet this selection criteria.
+                    bool shuttle = (config.Provider == FrameProviderType::DeckLinkShuttle);
                     BMDDisplayMode videoDisplayMode;
-                    if (FRAME_HEIGHT < 1080)
+                    if (config.FrameHeight < 1080)
                     {
                         videoDisplayMode = bmdModeHD720p5994;
                     }
-                    else if (FRAME_HEIGHT >= 1080 && FRAME_HEIGHT < 2160)
+                    else if (config.FrameHeight >= 1080 && config.FrameHeight < 2160)
                     {
-                        videoDisplayMode = bmdModeHD1080p5994;
-#if USE_DECKLINK_SHUTTLE
-                        videoDisplayMode = bmdModeHD1080p2398;
-#endif
+                        videoDisplayMode = shuttle ? bmdModeHD1080p2398 : bmdModeHD1080p5994;
                     }
-                    else if (FRAME_HEIGHT == 2160)
+                    else if (config.FrameHeight == 2160)
                     {
-                        videoDisplayMode = bmdMode4K2160p5994;
-#if USE_DECKLINK_SHUTTLE
-                        videoDisplayMode = bmdMode4K2160p2398;
-#endif
+                        videoDisplayMode = shuttle ? bmdMode4K2160p2398 : bmdMode4K2160p5994;
                     }
-                    else if (FRAME_HEIGHT > 2160)
+                    else if (config.FrameHeight > 2160)
                     {
                         videoDisplayMode = bmdMode4kDCI2398;
                     }
@@ -160,5 +156,16 @@ int DeckLinkManager::GetCaptureFrameIndex()
     return 0;
 }
 
+bool DeckLinkManager::GetFrameStats(FrameStats& stats)
+{
+    if (IsEnabled())
+    {
+        deckLinkDevice->GetFrameStats(stats);
+        return true;
+    }
+
+    return false;
+}
+
 #endif
 
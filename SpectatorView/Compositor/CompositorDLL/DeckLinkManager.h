@@ -11,7 +11,7 @@
 class DeckLinkManager : public IFrameProvider
 {
 public:
-    DeckLinkManager();
+    DeckLinkManager(const CaptureConfig& config);
     ~DeckLinkManager();
 
     // Inherited via IFrameProvider
@@ -29,7 +29,10 @@ public:
 
     virtual int GetCaptureFrameIndex() override;
 
+    virtual bool GetFrameStats(FrameStats& stats) override;
+
 private:
+    CaptureConfig config;
     DeckLinkDeviceDiscovery* deckLinkDiscovery = nullptr;
     DeckLinkDevice* deckLinkDevice = nullptr;
     IDeckLink* deckLink = nullptr;
@@ -6,7 +6,8 @@
 
 #if USE_ELGATO
 
-ElgatoFrameProvider::ElgatoFrameProvider()
+ElgatoFrameProvider::ElgatoFrameProvider(const CaptureConfig& config) :
+    config(config)
 {
 }
 
@@ -38,7 +39,7 @@ HRESULT ElgatoFrameProvider::Initialize(ID3D11ShaderResourceView* colorSRV)
 
     HRESULT hr = E_PENDING;
 
-    frameCallback = new ElgatoSampleCallback(_device);
+    frameCallback = new ElgatoSampleCallback(_device, config);
 
     hr = InitGraph();
     if (FAILED(hr))
@@ -121,23 +122,23 @@ HRESULT ElgatoFrameProvider::InitGraph()
     hr = filter->GetSettingsEx(&settings);
     _ASSERT(SUCCEEDED(hr));
 
-    if (FRAME_HEIGHT == 1080)
+    if (config.FrameHeight == 1080)
     {
         settings.Settings.profile = VIDEO_CAPTURE_FILTER_VID_ENC_PROFILE_1080;
     }
-    else if (FRAME_HEIGHT == 720)
+    else if (config.FrameHeight == 720)
     {
         settings.Settings.profile = VIDEO_CAPTURE_FILTER_VID_ENC_PROFILE_720;
     }
-    else if (FRAME_HEIGHT == 480)
+    else if (config.FrameHeight == 480)
     {
         settings.Settings.profile = VIDEO_CAPTURE_FILTER_VID_ENC_PROFILE_480;
     }
-    else if (FRAME_HEIGHT == 360)
+    else if (config.FrameHeight == 360)
     {
         settings.Settings.profile = VIDEO_CAPTURE_FILTER_VID_ENC_PROFILE_360;
     }
-    else if (FRAME_HEIGHT == 240)
+    else if (config.FrameHeight == 240)
     {
         settings.Settings.profile = VIDEO_CAPTURE_FILTER_VID_ENC_PROFILE_240;
     }
@@ -245,17 +246,17 @@ HRESULT ElgatoFrameProvider::SetSampleGrabberParameters()
     amt.subtype = MEDIASUBTYPE_UYVY;
     amt.formattype = FORMAT_VideoInfo;
     amt.bFixedSizeSamples = TRUE;
-    amt.lSampleSize = FRAME_WIDTH * FRAME_HEIGHT * FRAME_BPP_RAW;
+    amt.lSampleSize = config.GetRawFrameBufferSize();
     amt.bTemporalCompression = FALSE;
     
     VIDEOINFOHEADER vih;
     ZeroMemory(&vih, sizeof(VIDEOINFOHEADER));
-    vih.rcTarget.right = FRAME_WIDTH;
-    vih.rcTarget.bottom = FRAME_HEIGHT;
-    vih.AvgTimePerFrame = (REFERENCE_TIME)((1.0f / 30.0f) * S2HNS);
-    vih.bmiHeader.biWidth = FRAME_WIDTH;
-    vih.bmiHeader.biHeight = FRAME_HEIGHT;
-    vih.bmiHeader.biSizeImage = FRAME_WIDTH * FRAME_HEIGHT * FRAME_BPP_RAW;
+    vih.rcTarget.right = config.FrameWidth;
+    vih.rcTarget.bottom = config.FrameHeight;
+    vih.AvgTimePerFrame = (REFERENCE_TIME)GetDurationHNS();
+    vih.bmiHeader.biWidth = config.FrameWidth;
+    vih.bmiHeader.biHeight = config.FrameHeight;
+    vih.bmiHeader.biSizeImage = config.GetRawFrameBufferSize();
         
     amt.pbFormat = (BYTE*)&vih;
     
@@ -51,6 +51,7 @@ private:
     ID3D11ShaderResourceView* _colorSRV;
     ID3D11Device* _device;
 
+    CaptureConfig config;
     bool isEnabled = false;
 
     HRESULT InitGraph();
@@ -80,7 +81,7 @@ private:
     IElgatoVideoCaptureFilter6 *filter = NULL;
 
 public:
-    ElgatoFrameProvider();
+    ElgatoFrameProvider(const CaptureConfig& config);
     ~ElgatoFrameProvider();
 
     virtual HRESULT Initialize(ID3D11ShaderResourceView* colorSRV) override;
@@ -97,7 +98,7 @@ public:
 
     virtual LONGLONG GetDurationHNS()
     {
-        return (LONGLONG)((1.0f / 30.0f) * S2HNS);
+        return config.GetCaptureDurationHNS(30);
     }
 
     virtual int GetCaptureFrameIndex()
@@ -110,6 +111,17 @@ public:
         return 0;
     }
 
+    virtual bool GetFrameStats(FrameStats& stats) override
+    {
+        if (frameCallback != nullptr)
+        {
+            frameCallback->GetFrameStats(stats);
+            return true;
+        }
+
+        return false;
+    }
+
     virtual void Update(int compositeFrameIndex) override;
 
     virtual bool IsEnabled() override;
@@ -5,28 +5,17 @@
 #include "ElgatoSampleCallback.h"
 
 
-ElgatoSampleCallback::ElgatoSampleCallback(ID3D11Device* device) :
-    _device(device)
+ElgatoSampleCallback::ElgatoSampleCallback(ID3D11Device* device, const CaptureConfig& config) :
+    _device(device),
+    config(config),
+    frameRing(config.GetFrameBufferSize(), config.CachedFrames)
 {
     QueryPerformanceFrequency(&freq);
-
-    for (int i = 0; i < MAX_NUM_CACHED_BUFFERS; i++)
-    {
-        bufferCache[i].buffer = new BYTE[FRAME_BUFSIZE];
-        bufferCache[i].timeStamp = 0;
-    }
-
-    captureFrameIndex = 0;
 }
 
 ElgatoSampleCallback::~ElgatoSampleCallback()
 {
     isEnabled = false;
-
-    for (int i = 0; i < MAX_NUM_CACHED_BUFFERS; i++)
-    {
-        delete[] bufferCache[i].buffer;
-    }
 }
 
 STDMETHODIMP ElgatoSampleCallback::BufferCB(double time, BYTE *pBuffer, long length)
@@ -45,17 +34,19 @@ STDMETHODIMP ElgatoSampleCallback::BufferCB(double time, BYTE *pBuffer, long len
     }
 
     int copyLength = length;
-    if (copyLength > FRAME_BUFSIZE)
+    if (copyLength > frameRing.GetFrameSize())
     {
         // This might happen if the camera is outputting 4K but the system is expecting 1080.
-        copyLength = FRAME_BUFSIZE;
+        copyLength = frameRing.GetFrameSize();
     }
 
-    captureFrameIndex++;
-    BYTE* buffer = bufferCache[captureFrameIndex % MAX_NUM_CACHED_BUFFERS].buffer;
-    memcpy(buffer, pBuffer, copyLength);
-
-    bufferCache[captureFrameIndex % MAX_NUM_CACHED_BUFFERS].timeStamp = (latestTimeStamp * S2HNS) / freq.QuadPart;
+    // Null if the render thread is still reading the oldest frame, this frame is dropped then.
+    BYTE* buffer = frameRing.BeginWrite();
+    if (buffer != nullptr)
+    {
+        memcpy(buffer, pBuffer, copyLength);
+        frameRing.Publish((latestTimeStamp * S2HNS) / freq.QuadPart);
+    }
 
     return S_OK;
 }
@@ -63,9 +54,10 @@ STDMETHODIMP ElgatoSampleCallback::BufferCB(double time, BYTE *pBuffer, long len
 // Call this from the Render thread.
 void ElgatoSampleCallback::UpdateSRV(ID3D11ShaderResourceView* srv, int compositeFrameIndex)
 {
-    const BufferCache& buffer = bufferCache[compositeFrameIndex % MAX_NUM_CACHED_BUFFERS];
-    if (buffer.buffer != nullptr)
+    const BYTE* buffer = frameRing.AcquireFrame(compositeFrameIndex);
+    if (buffer != nullptr)
     {
-        DirectXHelper::UpdateSRV(_device, srv, buffer.buffer, FRAME_WIDTH * FRAME_BPP);
+        DirectXHelper::UpdateSRV(_device, srv, buffer, config.GetFrameStride());
+        frameRing.ReleaseFrame();
     }
 }
@@ -6,19 +6,14 @@
 #include <dshow.h>
 
 #include "DirectXHelper.h"
+#include "FrameRing.h"
+#include "CaptureConfig.h"
 
 class ElgatoSampleCallback : public ISampleGrabberCB
 {
 private:
-    class BufferCache
-    {
-    public:
-        BYTE * buffer;
-        LONGLONG timeStamp;
-    };
-
-    BufferCache bufferCache[MAX_NUM_CACHED_BUFFERS];
-    int captureFrameIndex = 0;
+    CaptureConfig config;
+    FrameRing frameRing;
 
     ULONG m_cRef = 0;
 
@@ -33,17 +28,22 @@ private:
     bool isEnabled = false;
 
 public:
-    ElgatoSampleCallback(ID3D11Device* device);
+    ElgatoSampleCallback(ID3D11Device* device, const CaptureConfig& config);
     ~ElgatoSampleCallback();
 
     LONGLONG GetTimestamp(int frame)
     {
-        return bufferCache[frame % MAX_NUM_CACHED_BUFFERS].timeStamp;
+        return frameRing.GetTimestamp(frame);
     }
 
     int GetCaptureFrameIndex()
     {
-        return captureFrameIndex;
+        return frameRing.GetLatestFrame();
+    }
+
+    void GetFrameStats(FrameStats& stats)
+    {
+        frameRing.GetStats(stats);
     }
 
     STDMETHODIMP_(ULONG) AddRef() 
@@ -0,0 +1,217 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+struct FrameStats
+{
+    int CapturedFrames;
+    // Frames that were overwritten before the renderer used them,
+    // or never stored because the renderer was still reading their slot.
+    int DroppedFrames;
+    // Time from a frame being published to the renderer first using it.
+    int64_t LastLatencyHNS;
+    int64_t AverageLatencyHNS;
+};
+
+/*
+Ring of the latest captured frames, shared by the frame providers.
+
+The capture thread fills the slot for the next frame and publishes it.
+The render thread looks frames up by index: frame N lives in slot
+N % numSlots, so new frames overwrite the oldest ones. Neither side
+takes a lock. The renderer marks the slot it is reading, and the
+capture thread drops a frame rather than overwrite that slot.
+
+Only standard C++ is used here, so the ring can be built and tested
+outside of the Windows build.
+*/
+class FrameRing
+{
+public:
+    FrameRing(int frameSize, int numSlots)
+        : frameSize(frameSize)
+        , numSlots(numSlots)
+        , slots(new Slot[numSlots])
+    {
+        for (int i = 0; i < numSlots; i++)
+        {
+            slots[i].Buffer = new uint8_t[frameSize];
+        }
+
+        Reset();
+    }
+
+    ~FrameRing()
+    {
+        for (int i = 0; i < numSlots; i++)
+        {
+            delete[] slots[i].Buffer;
+        }
+
+        delete[] slots;
+    }
+
+    // Clears all frames and counters. Only call this while nothing is captured.
+    void Reset()
+    {
+        for (int i = 0; i < numSlots; i++)
+        {
+            memset(slots[i].Buffer, 0, frameSize);
+            slots[i].Frame.store(-1);
+            slots[i].TimeStamp.store(0);
+            slots[i].PublishTime.store(0);
+            slots[i].Consumed.store(true);
+        }
+
+        writeFrame = 0;
+        latestFrame.store(0);
+        readingSlot.store(-1);
+
+        capturedFrames.store(0);
+        droppedFrames.store(0);
+        lastLatency.store(0);
+        totalLatency.store(0);
+        numLatencySamples.store(0);
+    }
+
+    int GetFrameSize()
+    {
+        return frameSize;
+    }
+
+    // capture thread: buffer to fill for the next frame,
+    // nullptr if the renderer is still reading the slot and the frame has to be dropped
+    uint8_t* BeginWrite()
+    {
+        writeFrame = latestFrame.load(std::memory_order_relaxed) + 1;
+
+        int index = writeFrame % numSlots;
+        Slot& slot = slots[index];
+
+        // Invalidate the slot before checking for the renderer, so that either
+        // the renderer sees the slot is gone or we see the renderer.
+        int previous = slot.Frame.exchange(-1);
+        if (readingSlot.load() == index)
+        {
+            slot.Frame.store(previous);
+            droppedFrames++;
+            return nullptr;
+        }
+
+        if (previous >= 0 && !slot.Consumed.load())
+        {
+            droppedFrames++;
+        }
+
+        return slot.Buffer;
+    }
+
+    // capture thread: makes the buffer from BeginWrite the latest frame
+    void Publish(int64_t timeStamp)
+    {
+        Slot& slot = slots[writeFrame % numSlots];
+
+        slot.TimeStamp.store(timeStamp, std::memory_order_relaxed);
+        slot.PublishTime.store(Now(), std::memory_order_relaxed);
+        slot.Consumed.store(false, std::memory_order_relaxed);
+        slot.Frame.store(writeFrame, std::memory_order_release);
+
+        latestFrame.store(writeFrame, std::memory_order_release);
+        capturedFrames++;
+    }
+
+    // render thread: frame data until ReleaseFrame,
+    // nullptr if the frame has not been captured yet or was overwritten
+    const uint8_t* AcquireFrame(int frame)
+    {
+        if (frame <= 0)
+        {
+            return nullptr;
+        }
+
+        int index = frame % numSlots;
+        Slot& slot = slots[index];
+
+        readingSlot.store(index);
+        if (slot.Frame.load() != frame)
+        {
+            readingSlot.store(-1);
+            return nullptr;
+        }
+
+        if (!slot.Consumed.exchange(true))
+        {
+            int64_t latency = Now() - slot.PublishTime.load(std::memory_order_relaxed);
+            lastLatency.store(latency, std::memory_order_relaxed);
+            totalLatency.fetch_add(latency, std::memory_order_relaxed);
+            numLatencySamples.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return slot.Buffer;
+    }
+
+    // render thread: hands the slot from AcquireFrame back to the capture thread
+    void ReleaseFrame()
+    {
+        readingSlot.store(-1, std::memory_order_release);
+    }
+
+    int GetLatestFrame()
+    {
+        return latestFrame.load(std::memory_order_acquire);
+    }
+
+    int64_t GetTimestamp(int frame)
+    {
+        return slots[frame % numSlots].TimeStamp.load(std::memory_order_relaxed);
+    }
+
+    void GetStats(FrameStats& stats)
+    {
+        int64_t samples = numLatencySamples.load(std::memory_order_relaxed);
+
+        stats.CapturedFrames = capturedFrames.load(std::memory_order_relaxed);
+        stats.DroppedFrames = droppedFrames.load(std::memory_order_relaxed);
+        stats.LastLatencyHNS = lastLatency.load(std::memory_order_relaxed);
+        stats.AverageLatencyHNS = (samples > 0) ? totalLatency.load(std::memory_order_relaxed) / samples : 0;
+    }
+
+private:
+    FrameRing(const FrameRing&);
+    FrameRing& operator=(const FrameRing&);
+
+    struct Slot
+    {
+        uint8_t* Buffer;
+        std::atomic<int> Frame;             // -1 while empty or being written
+        std::atomic<int64_t> TimeStamp;     // capture time reported by the provider
+        std::atomic<int64_t> PublishTime;   // HNS on the steady clock
+        std::atomic<bool> Consumed;
+    };
+
+    static int64_t Now()
+    {
+        typedef std::chrono::duration<int64_t, std::ratio<1, 10000000>> hns;
+        return std::chrono::duration_cast<hns>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    const int frameSize;
+    const int numSlots;
+    Slot* slots;
+
+    int writeFrame;                     // owned by the capture thread
+    std::atomic<int> latestFrame;
+    std::atomic<int> readingSlot;       // slot the renderer holds, -1 for none
+
+    std::atomic<int> capturedFrames;
+    std::atomic<int> droppedFrames;
+    std::atomic<int64_t> lastLatency;
+    std::atomic<int64_t> totalLatency;
+    std::atomic<int64_t> numLatencySamples;
+};
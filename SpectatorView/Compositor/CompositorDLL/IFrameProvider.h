@@ -3,10 +3,14 @@
 
 #pragma once
 #include "stdafx.h"
+#include "FrameRing.h"
+#include "CaptureConfig.h"
 
 class IFrameProvider
 {
 public:
+    virtual ~IFrameProvider() { }
+
     virtual HRESULT Initialize(ID3D11ShaderResourceView* srv) = 0;
     
     virtual LONGLONG GetTimestamp(int frame) = 0;
@@ -23,4 +27,7 @@ public:
     virtual void SetOutputTexture(ID3D11Texture2D* outputTexture) { }
 
     virtual int GetCaptureFrameIndex() = 0;
+
+    // Capture statistics, false if the provider does not keep them.
+    virtual bool GetFrameStats(FrameStats& stats) { return false; }
 };
\ No newline at end of file
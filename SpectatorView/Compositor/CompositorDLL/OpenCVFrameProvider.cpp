@@ -6,32 +6,22 @@
 
 #if USE_OPENCV
 
-OpenCVFrameProvider::OpenCVFrameProvider()
+OpenCVFrameProvider::OpenCVFrameProvider(const CaptureConfig& config) :
+    config(config),
+    frameRing(config.GetFrameBufferSize(), config.CachedFrames)
 {
     QueryPerformanceFrequency(&freq);
-    rgbaFrame = cv::Mat(FRAME_HEIGHT, FRAME_WIDTH, CV_8UC4);
+    rgbaFrame = cv::Mat(config.FrameHeight, config.FrameWidth, CV_8UC4);
 
     for (int i = 0; i < 4; i++)
     {
         rgbaConversion[i * 2] = i;
         rgbaConversion[(i * 2) + 1] = i;
     }
-
-    for (int i = 0; i < MAX_NUM_CACHED_BUFFERS; i++)
-    {
-        bufferCache[i].buffer = new BYTE[FRAME_BUFSIZE];
-        bufferCache[i].timeStamp = 0;
-    }
-
-    captureFrameIndex = 0;
 }
 
 OpenCVFrameProvider::~OpenCVFrameProvider()
 {
-    for (int i = 0; i < MAX_NUM_CACHED_BUFFERS; i++)
-    {
-        delete[] bufferCache[i].buffer;
-    }
 }
 
 HRESULT OpenCVFrameProvider::Initialize(ID3D11ShaderResourceView* srv)
@@ -50,12 +40,7 @@ HRESULT OpenCVFrameProvider::Initialize(ID3D11ShaderResourceView* srv)
     HRESULT hr = E_PENDING;
     videoCapture = new cv::VideoCapture(CAMERA_ID);
 
-    for (int i = 0; i < MAX_NUM_CACHED_BUFFERS; i++)
-    {
-        ZeroMemory(bufferCache[i].buffer, FRAME_BUFSIZE);
-    }
-
-    captureFrameIndex = 0;
+    frameRing.Reset();
 
     if (videoCapture->open(CAMERA_ID))
     {
@@ -63,8 +48,12 @@ HRESULT OpenCVFrameProvider::Initialize(ID3D11ShaderResourceView* srv)
         // This must be called after opening.
         // Note: This may fail, and your capture will resume at the camera's native resolution.
         // In this case, the Update loop will print an error with the expected frame resolution.
-        videoCapture->set(cv::CAP_PROP_FRAME_WIDTH, FRAME_WIDTH);
-        videoCapture->set(cv::CAP_PROP_FRAME_HEIGHT, FRAME_HEIGHT);
+        videoCapture->set(cv::CAP_PROP_FRAME_WIDTH, config.FrameWidth);
+        videoCapture->set(cv::CAP_PROP_FRAME_HEIGHT, config.FrameHeight);
+        if (config.CaptureFPS > 0)
+        {
+            videoCapture->set(cv::CAP_PROP_FPS, config.CaptureFPS);
+        }
 
         if (IsEnabled())
         {
@@ -94,49 +83,60 @@ void OpenCVFrameProvider::Update(int compositeFrameIndex)
         return;
     }
 
-    concurrency::create_task([=]
+    // Skip grabbing this frame if the previous grab is still running.
+    bool wasGrabbing = false;
+    if (isGrabbing.compare_exchange_strong(wasGrabbing, true))
     {
-        if (videoCapture->grab())
+        concurrency::create_task([=]
         {
-            LARGE_INTEGER time;
-            QueryPerformanceCounter(&time);
-
-            if (videoCapture->retrieve(frame))
+            if (videoCapture->grab())
             {
-                latestTimeStamp = time.QuadPart;
-
-                double width = videoCapture->get(cv::CAP_PROP_FRAME_WIDTH);
-                double height = videoCapture->get(cv::CAP_PROP_FRAME_HEIGHT);
-
-                if (width != FRAME_WIDTH)
-                {
-                    OutputDebugString(L"ERROR: captured width does not equal FRAME_WIDTH.  Expecting: ");
-                    OutputDebugString(std::to_wstring(width).c_str());
-                    OutputDebugString(L"\n");
-                }
+                LARGE_INTEGER time;
+                QueryPerformanceCounter(&time);
 
-                if (height != FRAME_HEIGHT)
+                if (videoCapture->retrieve(frame))
                 {
-                    OutputDebugString(L"ERROR: captured height does not equal FRAME_HEIGHT.  Expecting: ");
-                    OutputDebugString(std::to_wstring(height).c_str());
-                    OutputDebugString(L"\n");
+                    latestTimeStamp = time.QuadPart;
+
+                    double width = videoCapture->get(cv::CAP_PROP_FRAME_WIDTH);
+                    double height = videoCapture->get(cv::CAP_PROP_FRAME_HEIGHT);
+
+                    if (width != config.FrameWidth)
+                    {
+                        OutputDebugString(L"ERROR: captured width does not equal the configured width.  Expecting: ");
+                        OutputDebugString(std::to_wstring(width).c_str());
+                        OutputDebugString(L"\n");
+                    }
+
+                    if (height != config.FrameHeight)
+                    {
+                        OutputDebugString(L"ERROR: captured height does not equal the configured height.  Expecting: ");
+                        OutputDebugString(std::to_wstring(height).c_str());
+                        OutputDebugString(L"\n");
+                    }
+
+                    // Convert from rgb to rgba
+                    mixChannels(&frame, 2, &rgbaFrame, 1, rgbaConversion, 4);
+
+                    // Null if the render thread is still reading the oldest frame, this frame is dropped then.
+                    BYTE* buffer = frameRing.BeginWrite();
+                    if (buffer != nullptr)
+                    {
+                        memcpy(buffer, rgbaFrame.data, config.GetFrameBufferSize());
+                        frameRing.Publish((latestTimeStamp * S2HNS) / freq.QuadPart);
+                    }
                 }
-
-                // Convert from rgb to rgba
-                mixChannels(&frame, 2, &rgbaFrame, 1, rgbaConversion, 4);
-
-                captureFrameIndex++;
-                BYTE* buffer = bufferCache[captureFrameIndex % MAX_NUM_CACHED_BUFFERS].buffer;
-                memcpy(buffer, rgbaFrame.data, FRAME_BUFSIZE);
-                bufferCache[captureFrameIndex % MAX_NUM_CACHED_BUFFERS].timeStamp = (latestTimeStamp * S2HNS) / freq.QuadPart;
             }
-        }
-    });
 
-    const BufferCache& buffer = bufferCache[compositeFrameIndex % MAX_NUM_CACHED_BUFFERS];
-    if (buffer.buffer != nullptr)
+            isGrabbing = false;
+        });
+    }
+
+    const BYTE* buffer = frameRing.AcquireFrame(compositeFrameIndex);
+    if (buffer != nullptr)
     {
-        DirectXHelper::UpdateSRV(_device, _colorSRV, buffer.buffer, FRAME_WIDTH * FRAME_BPP);
+        DirectXHelper::UpdateSRV(_device, _colorSRV, buffer, config.GetFrameStride());
+        frameRing.ReleaseFrame();
     }
 }
 
@@ -147,8 +147,6 @@ void OpenCVFrameProvider::Dispose()
         videoCapture->release();
         videoCapture = nullptr;
     }
-
-    captureFrameIndex = 0;
 }
 #endif
 
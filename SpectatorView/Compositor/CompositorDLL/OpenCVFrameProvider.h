@@ -5,6 +5,7 @@
 #if USE_OPENCV
 #include "IFrameProvider.h"
 #include <mutex>
+#include <atomic>
 
 //TODO: Update with the 3.x version of OpenCV you are using.
 #pragma comment(lib, "opencv_world341")
@@ -34,18 +35,14 @@ private:
     cv::Mat rgbaFrame;
     int rgbaConversion[8];
 
-    class BufferCache
-    {
-    public:
-        BYTE * buffer;
-        LONGLONG timeStamp;
-    };
+    CaptureConfig config;
+    FrameRing frameRing;
 
-    BufferCache bufferCache[MAX_NUM_CACHED_BUFFERS];
-    int captureFrameIndex = 0;
+    // Only one grab runs at a time, it is the single writer of the frame ring.
+    std::atomic<bool> isGrabbing{ false };
 
 public:
-    OpenCVFrameProvider();
+    OpenCVFrameProvider(const CaptureConfig& config);
     ~OpenCVFrameProvider();
 
     // Inherited via IFrameProvider
@@ -61,17 +58,23 @@ public:
 
     virtual LONGLONG GetTimestamp(int frame)
     {
-        return bufferCache[frame % MAX_NUM_CACHED_BUFFERS].timeStamp;
+        return frameRing.GetTimestamp(frame);
     }
 
     virtual LONGLONG GetDurationHNS()
     {
-        return (LONGLONG)((1.0f / 60.0f) * S2HNS);
+        return config.GetCaptureDurationHNS(60);
     }
 
     virtual int GetCaptureFrameIndex()
     {
-        return captureFrameIndex;
+        return frameRing.GetLatestFrame();
+    }
+
+    virtual bool GetFrameStats(FrameStats& stats)
+    {
+        frameRing.GetStats(stats);
+        return true;
     }
 };
 #endif
@@ -0,0 +1,196 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "stdafx.h"
+#include "PhotoCapture.h"
+#include "PhotoEncoder.h"
+
+PhotoCapture::PhotoCapture()
+{
+}
+
+PhotoCapture::~PhotoCapture()
+{
+    encodeTasks.wait();
+    ReleaseStagingTextures();
+}
+
+bool PhotoCapture::Capture(ID3D11Device* device, ID3D11Texture2D* texture, const std::wstring& path, Format format)
+{
+    if (device == nullptr || texture == nullptr)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < NUM_PHOTO_STAGING_TEXTURES; i++)
+    {
+        StagingTexture& staging = stagingTextures[i];
+        if (staging.Copied)
+        {
+            continue;
+        }
+
+        if (!CreateStagingTexture(device, texture, staging))
+        {
+            return false;
+        }
+
+        ID3D11DeviceContext* context;
+        device->GetImmediateContext(&context);
+        context->CopyResource(staging.Texture, texture);
+        context->Release();
+
+        staging.Copied = true;
+        staging.Path = path;
+        staging.PhotoFormat = format;
+        return true;
+    }
+
+    return false;
+}
+
+void PhotoCapture::Update(ID3D11Device* device)
+{
+    if (device == nullptr)
+    {
+        return;
+    }
+
+    ID3D11DeviceContext* context;
+    device->GetImmediateContext(&context);
+
+    for (int i = 0; i < NUM_PHOTO_STAGING_TEXTURES; i++)
+    {
+        StagingTexture& staging = stagingTextures[i];
+        if (!staging.Copied)
+        {
+            continue;
+        }
+
+        // Leave the copy on the GPU until the encoders catch up.
+        if (pendingEncodes >= MAX_PENDING_PHOTOS)
+        {
+            break;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mapResource;
+        HRESULT hr = context->Map(staging.Texture, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapResource);
+        if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+        {
+            // Try again next frame.
+            continue;
+        }
+
+        staging.Copied = false;
+        if (FAILED(hr))
+        {
+            OutputDebugString(L"ERROR: could not read back photo texture.\n");
+            continue;
+        }
+
+        D3D11_TEXTURE2D_DESC desc;
+        staging.Texture->GetDesc(&desc);
+
+        UINT rowBytes = desc.Width * FRAME_BPP;
+        BYTE* pixels = new BYTE[rowBytes * desc.Height];
+        for (UINT y = 0; y < desc.Height; y++)
+        {
+            memcpy(pixels + y * rowBytes, (BYTE*)mapResource.pData + y * mapResource.RowPitch, rowBytes);
+        }
+
+        context->Unmap(staging.Texture, 0);
+
+        pendingEncodes++;
+        std::wstring path = staging.Path;
+        Format format = staging.PhotoFormat;
+        UINT width = desc.Width;
+        UINT height = desc.Height;
+
+        PhotoEncoder::Settings settings;
+        settings.PhotoFormat = (format == Format::JPEG) ? PhotoEncoder::Format::JPEG : PhotoEncoder::Format::PNG;
+        settings.JpegQuality = PHOTO_JPEG_QUALITY;
+
+        encodeTasks.run([=]
+        {
+            // WIC needs COM on the worker thread.
+            HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+            if (FAILED(PhotoEncoder::Encode(pixels, width, height, settings, path.c_str())))
+            {
+                OutputDebugString(L"ERROR: could not save photo.\n");
+                DeleteFile(path.c_str());
+            }
+
+            if (SUCCEEDED(hrCom))
+            {
+                CoUninitialize();
+            }
+
+            delete[] pixels;
+            pendingEncodes--;
+        });
+    }
+
+    context->Release();
+}
+
+int PhotoCapture::GetPendingCount()
+{
+    int pending = pendingEncodes;
+    for (int i = 0; i < NUM_PHOTO_STAGING_TEXTURES; i++)
+    {
+        if (stagingTextures[i].Copied)
+        {
+            pending++;
+        }
+    }
+
+    return pending;
+}
+
+bool PhotoCapture::CreateStagingTexture(ID3D11Device* device, ID3D11Texture2D* texture, StagingTexture& staging)
+{
+    D3D11_TEXTURE2D_DESC existingDesc;
+    texture->GetDesc(&existingDesc);
+
+    if (staging.Texture != nullptr)
+    {
+        D3D11_TEXTURE2D_DESC stagingDesc;
+        staging.Texture->GetDesc(&stagingDesc);
+
+        if (stagingDesc.Width == existingDesc.Width &&
+            stagingDesc.Height == existingDesc.Height &&
+            stagingDesc.Format == existingDesc.Format)
+        {
+            return true;
+        }
+
+        // The output texture was recreated with a different size or format.
+        SafeRelease(staging.Texture);
+    }
+
+    D3D11_TEXTURE2D_DESC textureDesc;
+    ZeroMemory(&textureDesc, sizeof(textureDesc));
+    textureDesc.Width = existingDesc.Width;
+    textureDesc.Height = existingDesc.Height;
+    textureDesc.MipLevels = existingDesc.MipLevels;
+    textureDesc.ArraySize = existingDesc.ArraySize;
+    textureDesc.Format = existingDesc.Format;
+    textureDesc.SampleDesc.Count = existingDesc.SampleDesc.Count;
+    textureDesc.SampleDesc.Quality = existingDesc.SampleDesc.Quality;
+    textureDesc.Usage = D3D11_USAGE_STAGING;
+    textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    textureDesc.MiscFlags = 0;
+
+    device->CreateTexture2D(&textureDesc, NULL, &staging.Texture);
+    return staging.Texture != nullptr;
+}
+
+void PhotoCapture::ReleaseStagingTextures()
+{
+    for (int i = 0; i < NUM_PHOTO_STAGING_TEXTURES; i++)
+    {
+        SafeRelease(stagingTextures[i].Texture);
+        stagingTextures[i].Copied = false;
+    }
+}
@@ -0,0 +1,59 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+#include "stdafx.h"
+
+#include <atomic>
+#include <string>
+#include <ppl.h>
+
+// Saves photos without stalling the render thread.
+// Capture copies the texture to a staging texture on the GPU. Update reads staging textures back
+// once the GPU is done with them, which is usually the next frame, and hands the pixels to
+// the thread pool to be encoded and written to disk.
+class PhotoCapture
+{
+#define NUM_PHOTO_STAGING_TEXTURES 2
+// Photos read back but not saved yet, each one holds a full frame in memory.
+#define MAX_PENDING_PHOTOS 8
+public:
+    enum class Format
+    {
+        PNG = PHOTO_FORMAT_PNG,
+        JPEG = PHOTO_FORMAT_JPEG
+    };
+
+    PhotoCapture();
+    ~PhotoCapture();
+
+    // render thread: false if every staging texture is still waiting for a readback.
+    bool Capture(ID3D11Device* device, ID3D11Texture2D* texture, const std::wstring& path, Format format);
+
+    // render thread: call once per frame to read back finished copies.
+    void Update(ID3D11Device* device);
+
+    // Photos captured but not written to disk yet.
+    int GetPendingCount();
+
+    static const wchar_t* GetExtension(Format format)
+    {
+        return (format == Format::JPEG) ? L".jpg" : L".png";
+    }
+
+private:
+    struct StagingTexture
+    {
+        ID3D11Texture2D* Texture = nullptr;
+        bool Copied = false;
+        std::wstring Path;
+        Format PhotoFormat;
+    };
+
+    StagingTexture stagingTextures[NUM_PHOTO_STAGING_TEXTURES];
+    std::atomic<int> pendingEncodes{ 0 };
+    concurrency::task_group encodeTasks;
+
+    bool CreateStagingTexture(ID3D11Device* device, ID3D11Texture2D* texture, StagingTexture& staging);
+    void ReleaseStagingTextures();
+};
@@ -0,0 +1,123 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "PhotoEncoder.h"
+
+namespace
+{
+    template <class Interface>
+    void Release(Interface*& pInterface)
+    {
+        if (pInterface != nullptr)
+        {
+            pInterface->Release();
+            pInterface = nullptr;
+        }
+    }
+}
+
+// Unity's output texture is read as sRGB BGRA, like the synchronous path used to save it.
+// Alpha is dropped, the same as ScreenGrab does for screenshots.
+HRESULT PhotoEncoder::Encode(const BYTE* pixels, UINT width, UINT height, const Settings& settings, IStream* stream)
+{
+    IWICImagingFactory* factory = nullptr;
+    IWICBitmapEncoder* encoder = nullptr;
+    IWICBitmapFrameEncode* frame = nullptr;
+    IPropertyBag2* props = nullptr;
+    IWICMetadataQueryWriter* metaWriter = nullptr;
+    IWICBitmap* source = nullptr;
+    IWICFormatConverter* converter = nullptr;
+
+    bool jpeg = (settings.PhotoFormat == Format::JPEG);
+    WICPixelFormatGUID targetFormat = GUID_WICPixelFormat24bppBGR;
+
+    HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+    if (SUCCEEDED(hr)) { hr = factory->CreateEncoder(jpeg ? GUID_ContainerFormatJpeg : GUID_ContainerFormatPng, nullptr, &encoder); }
+    if (SUCCEEDED(hr)) { hr = encoder->Initialize(stream, WICBitmapEncoderNoCache); }
+    if (SUCCEEDED(hr)) { hr = encoder->CreateNewFrame(&frame, &props); }
+
+    if (SUCCEEDED(hr))
+    {
+        PROPBAG2 option = {};
+        VARIANT value;
+        VariantInit(&value);
+
+        if (jpeg)
+        {
+            option.pstrName = const_cast<wchar_t*>(L"ImageQuality");
+            value.vt = VT_R4;
+            value.fltVal = settings.JpegQuality;
+        }
+        else
+        {
+            option.pstrName = const_cast<wchar_t*>(L"FilterOption");
+            value.vt = VT_UI1;
+            value.bVal = (BYTE)settings.PngFilter;
+        }
+
+        (void)props->Write(1, &option, &value);
+        hr = frame->Initialize(props);
+    }
+
+    if (SUCCEEDED(hr)) { hr = frame->SetSize(width, height); }
+    if (SUCCEEDED(hr)) { hr = frame->SetResolution(72, 72); }
+    if (SUCCEEDED(hr)) { hr = frame->SetPixelFormat(&targetFormat); }
+    if (SUCCEEDED(hr) && targetFormat != GUID_WICPixelFormat24bppBGR)
+    {
+        hr = E_FAIL;
+    }
+
+    if (SUCCEEDED(hr) && SUCCEEDED(frame->GetMetadataQueryWriter(&metaWriter)))
+    {
+        PROPVARIANT value;
+        PropVariantInit(&value);
+
+        if (jpeg)
+        {
+            // EXIF color space of sRGB
+            value.vt = VT_UI2;
+            value.uiVal = 1;
+            (void)metaWriter->SetMetadataByName(L"System.Image.ColorSpace", &value);
+        }
+        else
+        {
+            value.vt = VT_UI1;
+            value.bVal = 0;
+            (void)metaWriter->SetMetadataByName(L"/sRGB/RenderingIntent", &value);
+        }
+    }
+
+    UINT stride = width * 4;
+    if (SUCCEEDED(hr)) { hr = factory->CreateBitmapFromMemory(width, height, GUID_WICPixelFormat32bppBGRA, stride, stride * height, const_cast<BYTE*>(pixels), &source); }
+    if (SUCCEEDED(hr)) { hr = factory->CreateFormatConverter(&converter); }
+    if (SUCCEEDED(hr)) { hr = converter->Initialize(source, targetFormat, WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeCustom); }
+    if (SUCCEEDED(hr)) { hr = frame->WriteSource(converter, nullptr); }
+    if (SUCCEEDED(hr)) { hr = frame->Commit(); }
+    if (SUCCEEDED(hr)) { hr = encoder->Commit(); }
+
+    Release(converter);
+    Release(source);
+    Release(metaWriter);
+    Release(props);
+    Release(frame);
+    Release(encoder);
+    Release(factory);
+
+    return hr;
+}
+
+HRESULT PhotoEncoder::Encode(const BYTE* pixels, UINT width, UINT height, const Settings& settings, const wchar_t* path)
+{
+    IWICImagingFactory* factory = nullptr;
+    IWICStream* stream = nullptr;
+
+    HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+    if (SUCCEEDED(hr)) { hr = factory->CreateStream(&stream); }
+    if (SUCCEEDED(hr)) { hr = stream->InitializeFromFilename(path, GENERIC_WRITE); }
+    if (SUCCEEDED(hr)) { hr = Encode(pixels, width, height, settings, stream); }
+
+    Release(stream);
+    Release(factory);
+
+    return hr;
+}
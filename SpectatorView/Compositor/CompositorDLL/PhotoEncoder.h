@@ -0,0 +1,34 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Encodes photos to PNG or JPEG with WIC.
+// Pixels are 32 bit BGRA without padding, alpha is dropped. The calling thread has to have COM initialized.
+// Only Windows and WIC are used here, so the encoder can be measured outside of the DLL, see PhotoEncoderBenchmark.
+
+#pragma once
+
+#include <Windows.h>
+#include <wincodec.h>
+
+class PhotoEncoder
+{
+public:
+    enum class Format
+    {
+        PNG,
+        JPEG
+    };
+
+    struct Settings
+    {
+        Format PhotoFormat = Format::PNG;
+        // 0 to 1, JPEG only.
+        float JpegQuality = 0.9f;
+        // PNG only. WIC does not expose the zlib level. Picking a filter for every row is most of the
+        // PNG encoding time at 1080p, files without filters are somewhat larger and still lossless.
+        WICPngFilterOption PngFilter = WICPngFilterNone;
+    };
+
+    static HRESULT Encode(const BYTE* pixels, UINT width, UINT height, const Settings& settings, IStream* stream);
+    static HRESULT Encode(const BYTE* pixels, UINT width, UINT height, const Settings& settings, const wchar_t* path);
+};
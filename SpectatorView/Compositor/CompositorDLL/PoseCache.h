@@ -2,8 +2,12 @@
 // Licensed under the MIT License. See LICENSE in the project root for license information.
 
 #pragma once
+#include "CompositorConstants.h"
+#include "PosePredictor.h"
+
 #include <DirectXMath.h>
-#include <vector>
+#include <atomic>
+#include <cstdint>
 
 using namespace DirectX;
 
@@ -17,6 +21,14 @@ public:
     float TimeStamp;
     int Index;
 
+    PoseData() :
+        Position(0, 0, 0),
+        Rotation(0, 0, 0, 1),
+        TimeStamp(0),
+        Index(0)
+    {
+    }
+
     PoseData(XMFLOAT3 Position, XMFLOAT4 Rotation, float TimeStamp, int Index) :
         Position(Position),
         Rotation(Rotation),
@@ -26,112 +38,313 @@ public:
     }
 };
 
+// How a GetPose call got to its pose, for telemetry.
+struct PoseLookup
+{
+    // Index of the selected pose counting from the newest.
+    int SelectedIndex = 0;
+    // Time between the two poses the lookup blended, 0 if it used a single pose.
+    float InterpolationSpan = 0;
+    // How far the lookup extrapolated past the newest pose, 0 if it did not.
+    float PredictionTime = 0;
+};
+
+// Ring of the latest poses in time order.
+// One thread at a time adds poses, any thread can reset the cache, and any number of threads can
+// look poses up without locking.
+// The writer marks a slot with an odd sequence while it fills it, readers copy a slot and
+// retry when the sequence changed underneath them.
+// Lookups bracket the requested time with a binary search, a time past the newest pose is predicted.
+// PoseCacheBenchmark checks lookups against the sorted vector this replaced and measures both.
 class PoseCache
 {
 public:
-    PoseCache()
+    PoseCache() :
+        lastPoseIndex(0),
+        lastSelectedIndex(0),
+        predictor((PosePredictor::Mode)POSE_PREDICTION, POSE_PREDICTION_HORIZON, POSE_PREDICTION_DECAY),
+        range(0)
     {
-        poses.reserve(MAX_NUM_POSES + 1);
+        for (int i = 0; i < RING_SIZE; i++)
+        {
+            slots[i].Sequence.store(0, std::memory_order_relaxed);
+        }
     }
 
-    ~PoseCache()
+    // Index of the pose the latest lookup selected counting from the newest, for debugging.
+    int GetLastSelectedIndex() const
     {
-        poses.clear();
+        return lastSelectedIndex.load(std::memory_order_relaxed);
     }
 
-    int LastSelectedIndex;
-
+    // Poses are expected in time order. A pose that is not newer than the latest one is dropped.
+    // Callers that add poses from several threads have to serialize the calls.
     bool AddPose(XMFLOAT3 position, XMFLOAT4 rotation, float timeStamp)
     {
+        uint64_t currentRange = range.load(std::memory_order_acquire);
+        uint32_t first = First(currentRange);
+        uint32_t end = End(currentRange);
+
         // Already have this pose.
-        if (poses.size() > 0 && poses[0].TimeStamp == timeStamp)
+        if (first != end && slots[(end - 1) & RING_MASK].Pose.TimeStamp >= timeStamp)
         {
             return false;
         }
 
-        // Find index to insert at.
-        int i = 0;
-        while (i < poses.size() && poses[i].TimeStamp > timeStamp)
-        {
-            i++;
-        }
+        Slot& slot = slots[end & RING_MASK];
+        slot.Sequence.store(end * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
 
-        poses.insert(poses.begin() + i, PoseData(position, rotation, timeStamp, lastPoseIndex++));
+        slot.Pose = PoseData(position, rotation, timeStamp, lastPoseIndex.fetch_add(1, std::memory_order_relaxed));
+        slot.Sequence.store(end * 2 + 2, std::memory_order_release);
 
-        // Remove oldest.
-        if (poses.size() >= MAX_NUM_POSES)
+        // Reset only moves the oldest position up to the end, so when it got in first the new pose is the only one.
+        while (true)
         {
-            poses.erase(poses.begin() + MAX_NUM_POSES - 1);
+            // Keep fewer poses than slots, so readers that are a little behind do not have to retry.
+            uint32_t newFirst = First(currentRange);
+            if (end + 1 - newFirst > MAX_NUM_POSES - 1)
+            {
+                newFirst = end + 1 - (MAX_NUM_POSES - 1);
+            }
+
+            if (range.compare_exchange_weak(currentRange, Pack(newFirst, end + 1), std::memory_order_release, std::memory_order_acquire))
+            {
+                return true;
+            }
         }
-        return true;
     }
 
-    bool GetPose(XMFLOAT3& position, XMFLOAT4& rotation, float poseTime)
+    bool GetPose(XMFLOAT3& position, XMFLOAT4& rotation, float poseTime, PoseLookup* lookup = nullptr)
     {
-        if (poses.size() == 0)
+        for (;;)
         {
-            position = XMFLOAT3(0, 0, 0);
-            rotation = XMFLOAT4(0, 0, 0, 1);
-            return false;
+            uint64_t currentRange = range.load(std::memory_order_acquire);
+            uint32_t first = First(currentRange);
+            uint32_t count = End(currentRange) - first;
+
+            PoseLookup result;
+            if (count == 0)
+            {
+                position = XMFLOAT3(0, 0, 0);
+                rotation = XMFLOAT4(0, 0, 0, 1);
+                if (lookup != nullptr)
+                {
+                    *lookup = result;
+                }
+                return false;
+            }
+
+            // Find the oldest pose at or after poseTime.
+            uint32_t low = 0;
+            uint32_t high = count;
+            bool overwritten = false;
+            while (low < high)
+            {
+                uint32_t mid = low + (high - low) / 2;
+
+                PoseData pose;
+                if (!ReadPose(first + mid, pose))
+                {
+                    overwritten = true;
+                    break;
+                }
+
+                if (pose.TimeStamp < poseTime)
+                {
+                    low = mid + 1;
+                }
+                else
+                {
+                    high = mid;
+                }
+            }
+
+            if (overwritten)
+            {
+                continue;
+            }
+
+            result.SelectedIndex = (int)(count - low);
+
+            PoseData prev;
+            if (low == count)
+            {
+                // All poses are older, predict from the latest ones.
+                if (!Predict(first, count, poseTime, position, rotation, result.PredictionTime))
+                {
+                    continue;
+                }
+            }
+            else if (low == 0)
+            {
+                // All poses are newer, use the oldest.
+                if (!ReadPose(first, prev))
+                {
+                    continue;
+                }
+
+                position = prev.Position;
+                rotation = prev.Rotation;
+            }
+            else
+            {
+                //Lerp between 2 poses
+                PoseData next;
+                if (!ReadPose(first + low, prev) || !ReadPose(first + low - 1, next))
+                {
+                    continue;
+                }
+
+                result.InterpolationSpan = next.TimeStamp - prev.TimeStamp;
+
+                float lerpVal = (poseTime - prev.TimeStamp) / (next.TimeStamp - prev.TimeStamp);
+                if (lerpVal > 1) { lerpVal = 1; }
+                if (lerpVal < 0) { lerpVal = 0; }
+
+                XMStoreFloat3(&position, 
+                    XMVectorLerp(XMLoadFloat3(&prev.Position), XMLoadFloat3(&next.Position), lerpVal)
+                );
+
+                XMStoreFloat4(&rotation,
+                    XMQuaternionSlerp(XMLoadFloat4(&prev.Rotation), XMLoadFloat4(&next.Rotation), lerpVal)
+                );
+            }
+
+            lastSelectedIndex.store(result.SelectedIndex, std::memory_order_relaxed);
+            if (lookup != nullptr)
+            {
+                *lookup = result;
+            }
+
+            return true;
         }
+    }
 
-        //Find index for time
-        LastSelectedIndex = 0;
-        while (LastSelectedIndex < poses.size())
+    bool GetLatestPose(PoseData& pose)
+    {
+        for (;;)
         {
-            if (poses[LastSelectedIndex].TimeStamp < poseTime)
+            uint64_t currentRange = range.load(std::memory_order_acquire);
+            uint32_t first = First(currentRange);
+            uint32_t end = End(currentRange);
+
+            if (first == end)
             {
-                break;
+                return false;
             }
 
-            LastSelectedIndex++;
+            if (ReadPose(end - 1, pose))
+            {
+                return true;
+            }
         }
+    }
 
-        if (LastSelectedIndex == 0)
+    // Has to be called from the thread that looks poses up.
+    void SetPrediction(PosePredictor::Mode mode, float horizon, float decayTime)
+    {
+        predictor.Configure(mode, horizon, decayTime);
+    }
+
+    // Can be called from any thread, also while a pose is being added.
+    void Reset()
+    {
+        lastPoseIndex.store(0, std::memory_order_relaxed);
+
+        // Only the writer moves the end, so this drops every pose up to where the writer is.
+        // Slots keep their sequence, so stale poses can never match a new position in the ring.
+        uint64_t currentRange = range.load(std::memory_order_acquire);
+        while (!range.compare_exchange_weak(currentRange, Pack(End(currentRange), End(currentRange)),
+            std::memory_order_release, std::memory_order_acquire))
         {
-            position = poses[0].Position;
-            rotation = poses[0].Rotation;
         }
-        else if (LastSelectedIndex == poses.size())
+    }
+
+private:
+    // Power of two, so positions map to the same slot when they wrap around.
+    static const int RING_SIZE = 64;
+    static const uint32_t RING_MASK = RING_SIZE - 1;
+    static_assert(RING_SIZE > MAX_NUM_POSES, "Ring needs room for the writer beyond MAX_NUM_POSES");
+    static_assert(POSE_PREDICTION_SAMPLES < MAX_NUM_POSES, "Prediction can only use poses the cache keeps");
+
+    struct Slot
+    {
+        std::atomic<uint32_t> Sequence;
+        PoseData Pose;
+    };
+
+    // Copies the pose at a ring position, fails if the writer has moved past it.
+    bool ReadPose(uint32_t position, PoseData& pose) const
+    {
+        const Slot& slot = slots[position & RING_MASK];
+        uint32_t expected = position * 2 + 2;
+
+        if (slot.Sequence.load(std::memory_order_acquire) != expected)
         {
-            position = poses[poses.size() - 1].Position;
-            rotation = poses[poses.size() - 1].Rotation;
+            return false;
         }
-        else
-        {
-            //Lerp between 2 poses
-            PoseData next = poses[LastSelectedIndex];
-            PoseData prev = poses[LastSelectedIndex - 1];
 
-            float lerpVal = (poseTime - prev.TimeStamp) / (next.TimeStamp - prev.TimeStamp);
-            if (lerpVal > 1) { lerpVal = 1; }
-            if (lerpVal < 0) { lerpVal = 0; }
+        pose = slot.Pose;
+        std::atomic_thread_fence(std::memory_order_acquire);
 
-            XMStoreFloat3(&position, 
-                XMVectorLerp(XMLoadFloat3(&prev.Position), XMLoadFloat3(&next.Position), lerpVal)
-            );
+        return slot.Sequence.load(std::memory_order_relaxed) == expected;
+    }
+
+    // Pose at poseTime from the newest of the count poses starting at first, fails if the writer moved past one.
+    bool Predict(uint32_t first, uint32_t count, float poseTime, XMFLOAT3& position, XMFLOAT4& rotation, float& predictionTime)
+    {
+        uint32_t numSamples = (predictor.GetMode() == PosePredictor::Mode::None) ? 1 :
+            (count < POSE_PREDICTION_SAMPLES) ? count : POSE_PREDICTION_SAMPLES;
 
-            XMStoreFloat4(&rotation,
-                XMQuaternionSlerp(XMLoadFloat4(&prev.Rotation), XMLoadFloat4(&next.Rotation), lerpVal)
-            );
+        PoseSample samples[POSE_PREDICTION_SAMPLES];
+        for (uint32_t i = 0; i < numSamples; i++)
+        {
+            PoseData pose;
+            if (!ReadPose(first + count - numSamples + i, pose))
+            {
+                return false;
+            }
+
+            PoseSample& sample = samples[i];
+            sample.Position[0] = pose.Position.x;
+            sample.Position[1] = pose.Position.y;
+            sample.Position[2] = pose.Position.z;
+            sample.Rotation[0] = pose.Rotation.x;
+            sample.Rotation[1] = pose.Rotation.y;
+            sample.Rotation[2] = pose.Rotation.z;
+            sample.Rotation[3] = pose.Rotation.w;
+            sample.Time = pose.TimeStamp;
         }
 
+        PoseSample predicted;
+        predictionTime = predictor.Predict(samples, (int)numSamples, poseTime, predicted);
+
+        position = XMFLOAT3(predicted.Position);
+        rotation = XMFLOAT4(predicted.Rotation);
         return true;
     }
 
-    PoseData* GetLatestPose()
+    static uint64_t Pack(uint32_t first, uint32_t end)
     {
-        return (poses.size() > 0) ? &poses.at(0) : nullptr;
+        return ((uint64_t)first << 32) | end;
     }
 
-    void Reset()
+    static uint32_t First(uint64_t value)
     {
-        lastPoseIndex = 0;
-        poses.clear();
+        return (uint32_t)(value >> 32);
     }
 
-private:
-    int lastPoseIndex = 0;
-    std::vector<PoseData> poses;
-};
+    static uint32_t End(uint64_t value)
+    {
+        return (uint32_t)value;
+    }
 
+    std::atomic<int> lastPoseIndex;
+    std::atomic<int> lastSelectedIndex;
+    Slot slots[RING_SIZE];
+    PosePredictor predictor;
+
+    // Oldest and one past the newest ring position, packed so readers load both at once.
+    std::atomic<uint64_t> range;
+};
@@ -0,0 +1,290 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cmath>
+
+/*
+Extrapolates the pose of the camera past the newest pose received, so a
+composite frame that is newer than the network has delivered does not
+simply reuse an old pose.
+
+The prediction starts at the newest pose and moves it along the estimated
+linear and angular velocity. The velocity either comes straight from the
+newest poses, or from a Kalman filter over all of the poses given, which
+follows the motion with less of the tracking noise. Prediction never goes
+past the horizon, and the further ahead it goes the less it trusts the
+velocity: it decays with decayTime, so the camera eases to a stop instead
+of overshooting when the motion changes.
+
+Only standard C++ is used here, so the prediction can be evaluated on pose
+traces outside of the Windows build, see PosePredictionBenchmark.
+*/
+
+struct PoseSample
+{
+    float Position[3];
+    float Rotation[4];      // quaternion x, y, z, w
+    float Time;             // seconds
+};
+
+class PosePredictor
+{
+public:
+    // Matches the POSE_PREDICTION_* values in CompositorConstants.h.
+    enum class Mode
+    {
+        None,
+        ConstantVelocity,
+        Kalman,
+    };
+
+    // horizon and decayTime in seconds, a decayTime of 0 keeps the velocity constant.
+    PosePredictor(Mode mode = Mode::None, float horizon = 0, float decayTime = 0)
+    {
+        Configure(mode, horizon, decayTime);
+    }
+
+    void Configure(Mode mode, float horizon, float decayTime)
+    {
+        this->mode = mode;
+        this->horizon = horizon > 0 ? horizon : 0;
+        this->decayTime = decayTime > 0 ? decayTime : 0;
+    }
+
+    Mode GetMode() const
+    {
+        return mode;
+    }
+
+    // samples are in time order, oldest first. Predicts the pose at time from them and returns how far
+    // past the newest sample it went in seconds, 0 if it did not predict and predicted is the newest sample.
+    float Predict(const PoseSample* samples, int count, float time, PoseSample& predicted) const
+    {
+        const PoseSample& newest = samples[count - 1];
+        predicted = newest;
+
+        float ahead = time - newest.Time;
+        if (mode == Mode::None || count < 2 || horizon <= 0 || !(ahead > 0))
+        {
+            return 0;
+        }
+
+        if (ahead > horizon)
+        {
+            ahead = horizon;
+        }
+
+        float velocity[3];
+        float angularVelocity[3];
+        bool estimated = (mode == Mode::Kalman) ?
+            FilterVelocity(samples, count, velocity, angularVelocity) :
+            DifferenceVelocity(samples, count, velocity, angularVelocity);
+        if (!estimated)
+        {
+            return 0;
+        }
+
+        // Integral of the velocity decaying over time.
+        float travel = (decayTime > 0) ? decayTime * (1 - std::exp(-ahead / decayTime)) : ahead;
+
+        float rotationVector[3];
+        for (int i = 0; i < 3; i++)
+        {
+            predicted.Position[i] = newest.Position[i] + velocity[i] * travel;
+            rotationVector[i] = angularVelocity[i] * travel;
+        }
+
+        // Angular velocity is in world space, so the change applies before the newest rotation.
+        float change[4];
+        Exp(rotationVector, change);
+        Multiply(change, newest.Rotation, predicted.Rotation);
+        Normalize(predicted.Rotation);
+
+        predicted.Time = newest.Time + ahead;
+        return ahead;
+    }
+
+private:
+    // Span of the newest samples the constant velocity comes from, longer is smoother but lags more.
+    static constexpr float VelocityWindow = 0.05f;
+
+    // Kalman filter noise, tuned with PosePredictionBenchmark.
+    static constexpr float PositionNoise = 0.001f;              // m, tracking jitter of a position
+    static constexpr float AccelerationNoise = 0.3f;            // m^2/s^3, how quickly the velocity can change
+    static constexpr float RotationNoise = 0.002f;              // rad, tracking jitter of a rotation
+    static constexpr float AngularAccelerationNoise = 2.0f;     // rad^2/s^3
+    static constexpr float InitialVelocityVariance = 1.0f;      // (m/s)^2
+
+    // Samples closer than this are treated as duplicates.
+    static constexpr float MinInterval = 0.0001f;
+
+    Mode mode = Mode::None;
+    float horizon = 0;
+    float decayTime = 0;
+
+    static bool DifferenceVelocity(const PoseSample* samples, int count, float velocity[3], float angularVelocity[3])
+    {
+        const PoseSample& newest = samples[count - 1];
+
+        // The newest sample at least VelocityWindow older, or the oldest one.
+        int reference = count - 2;
+        while (reference > 0 && newest.Time - samples[reference].Time < VelocityWindow)
+        {
+            reference--;
+        }
+
+        float dt = newest.Time - samples[reference].Time;
+        if (dt < MinInterval)
+        {
+            return false;
+        }
+
+        AngularVelocity(samples[reference], newest, dt, angularVelocity);
+        for (int i = 0; i < 3; i++)
+        {
+            velocity[i] = (newest.Position[i] - samples[reference].Position[i]) / dt;
+        }
+
+        return true;
+    }
+
+    // Constant velocity model per axis, the position and its velocity are filtered together.
+    // The angular velocity between two samples is measured directly and filtered as a random walk.
+    static bool FilterVelocity(const PoseSample* samples, int count, float velocity[3], float angularVelocity[3])
+    {
+        const float r = PositionNoise * PositionNoise;
+
+        float position[3];
+        float covariance[3][3]; // p00, p01, p11 per axis
+        float angularVariance[3];
+        bool hasAngularVelocity = false;
+        for (int i = 0; i < 3; i++)
+        {
+            position[i] = samples[0].Position[i];
+            velocity[i] = 0;
+            covariance[i][0] = r;
+            covariance[i][1] = 0;
+            covariance[i][2] = InitialVelocityVariance;
+            angularVelocity[i] = 0;
+            angularVariance[i] = 0;
+        }
+
+        int previous = 0;
+        for (int s = 1; s < count; s++)
+        {
+            float dt = samples[s].Time - samples[previous].Time;
+            if (dt < MinInterval)
+            {
+                continue;
+            }
+
+            float q = AccelerationNoise;
+            for (int i = 0; i < 3; i++)
+            {
+                float* p = covariance[i];
+
+                // Predict.
+                position[i] += velocity[i] * dt;
+                float p00 = p[0] + dt * (2 * p[1] + dt * p[2]) + q * dt * dt * dt / 3;
+                float p01 = p[1] + dt * p[2] + q * dt * dt / 2;
+                float p11 = p[2] + q * dt;
+
+                // Update with the measured position.
+                float innovation = samples[s].Position[i] - position[i];
+                float k0 = p00 / (p00 + r);
+                float k1 = p01 / (p00 + r);
+                position[i] += k0 * innovation;
+                velocity[i] += k1 * innovation;
+                p[0] = (1 - k0) * p00;
+                p[1] = (1 - k0) * p01;
+                p[2] = p11 - k1 * p01;
+            }
+
+            float measured[3];
+            AngularVelocity(samples[previous], samples[s], dt, measured);
+            float measurementVariance = 2 * RotationNoise * RotationNoise / (dt * dt);
+            for (int i = 0; i < 3; i++)
+            {
+                if (!hasAngularVelocity)
+                {
+                    angularVelocity[i] = measured[i];
+                    angularVariance[i] = measurementVariance;
+                    continue;
+                }
+
+                float variance = angularVariance[i] + AngularAccelerationNoise * dt;
+                float k = variance / (variance + measurementVariance);
+                angularVelocity[i] += k * (measured[i] - angularVelocity[i]);
+                angularVariance[i] = (1 - k) * variance;
+            }
+
+            hasAngularVelocity = true;
+            previous = s;
+        }
+
+        return hasAngularVelocity;
+    }
+
+    // World space angular velocity that turns from into to in dt.
+    static void AngularVelocity(const PoseSample& from, const PoseSample& to, float dt, float angularVelocity[3])
+    {
+        float inverse[4] = { -from.Rotation[0], -from.Rotation[1], -from.Rotation[2], from.Rotation[3] };
+        float change[4];
+        Multiply(to.Rotation, inverse, change);
+
+        float rotationVector[3];
+        Log(change, rotationVector);
+        for (int i = 0; i < 3; i++)
+        {
+            angularVelocity[i] = rotationVector[i] / dt;
+        }
+    }
+
+    // a * b, which rotates by b and then by a.
+    static void Multiply(const float a[4], const float b[4], float result[4])
+    {
+        result[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+        result[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+        result[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+        result[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+    }
+
+    static void Normalize(float q[4])
+    {
+        float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        if (length > 0)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                q[i] /= length;
+            }
+        }
+    }
+
+    // Rotation vector, axis times angle, of the shorter way around.
+    static void Log(const float q[4], float rotationVector[3])
+    {
+        float sign = (q[3] < 0) ? -1.0f : 1.0f;
+        float sinHalf = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+        float angle = 2 * std::atan2(sinHalf, sign * q[3]);
+        float scale = (sinHalf > 1e-6f) ? sign * angle / sinHalf : 2 * sign;
+        for (int i = 0; i < 3; i++)
+        {
+            rotationVector[i] = q[i] * scale;
+        }
+    }
+
+    static void Exp(const float rotationVector[3], float q[4])
+    {
+        float angle = std::sqrt(rotationVector[0] * rotationVector[0] +
+            rotationVector[1] * rotationVector[1] + rotationVector[2] * rotationVector[2]);
+        float scale = (angle > 1e-6f) ? std::sin(angle / 2) / angle : 0.5f;
+        for (int i = 0; i < 3; i++)
+        {
+            q[i] = rotationVector[i] * scale;
+        }
+        q[3] = std::cos(angle / 2);
+    }
+};
@@ -0,0 +1,242 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "stdafx.h"
+#include "SyntheticFrameProvider.h"
+
+#if USE_SYNTHETIC_FRAMES
+#include "ColorConversion.h"
+
+#include <chrono>
+
+namespace
+{
+    typedef std::chrono::duration<LONGLONG, std::ratio<1, S2HNS>> hns;
+
+    // 75% color bars.
+    const BYTE colorBars[8][3] =
+    {
+        { 191, 191, 191 },
+        { 191, 191, 0 },
+        { 0, 191, 191 },
+        { 0, 191, 0 },
+        { 191, 0, 191 },
+        { 191, 0, 0 },
+        { 0, 0, 191 },
+        { 0, 0, 0 },
+    };
+
+    // Pixels the pattern moves each frame, even so UYVY pairs stay intact.
+    const int patternScrollSpeed = 8;
+}
+
+SyntheticFrameProvider::SyntheticFrameProvider(const CaptureConfig& config) :
+    config(config),
+    frameRing(config.GetFrameBufferSize(), config.CachedFrames),
+    frameSize(OutputYUV() ? config.GetRawFrameBufferSize() : config.GetFrameBufferSize())
+{
+    QueryPerformanceFrequency(&freq);
+}
+
+SyntheticFrameProvider::~SyntheticFrameProvider()
+{
+    Dispose();
+
+    delete[] pattern;
+}
+
+HRESULT SyntheticFrameProvider::Initialize(ID3D11ShaderResourceView* srv)
+{
+    if (IsEnabled())
+    {
+        return S_OK;
+    }
+
+    _colorSRV = srv;
+    if (_colorSRV != nullptr)
+    {
+        _colorSRV->GetDevice(&_device);
+    }
+
+    if (wcslen(SYNTHETIC_FRAME_FILE) > 0)
+    {
+        frameFile.open(SYNTHETIC_FRAME_FILE, std::ios::binary);
+        if (!frameFile.is_open())
+        {
+            OutputDebugString(L"ERROR: could not open SYNTHETIC_FRAME_FILE.\n");
+            return E_FAIL;
+        }
+    }
+    else if (pattern == nullptr)
+    {
+        CreatePattern();
+    }
+
+    frameRing.Reset();
+
+    stopCapture = false;
+    captureThread = std::thread(&SyntheticFrameProvider::CaptureThreadProc, this);
+    isEnabled = true;
+
+    return S_OK;
+}
+
+bool SyntheticFrameProvider::IsEnabled()
+{
+    return isEnabled;
+}
+
+void SyntheticFrameProvider::Update(int compositeFrameIndex)
+{
+    if (!IsEnabled() ||
+        _colorSRV == nullptr ||
+        _device == nullptr)
+    {
+        return;
+    }
+
+    const BYTE* buffer = frameRing.AcquireFrame(compositeFrameIndex);
+    if (buffer != nullptr)
+    {
+        DirectXHelper::UpdateSRV(_device, _colorSRV, buffer, config.GetFrameStride());
+        frameRing.ReleaseFrame();
+    }
+}
+
+void SyntheticFrameProvider::Dispose()
+{
+    stopCapture = true;
+    if (captureThread.joinable())
+    {
+        captureThread.join();
+    }
+
+    if (frameFile.is_open())
+    {
+        frameFile.close();
+    }
+
+    isEnabled = false;
+}
+
+void SyntheticFrameProvider::CaptureThreadProc()
+{
+    const hns frameDuration(GetDurationHNS());
+    // Sleeps are only as accurate as the scheduler tick, yield for the last part of the wait.
+    const hns yieldTime = std::chrono::milliseconds(2);
+
+    LARGE_INTEGER startTime;
+    QueryPerformanceCounter(&startTime);
+    LONGLONG startTimeHNS = (startTime.QuadPart / freq.QuadPart) * S2HNS + ((startTime.QuadPart % freq.QuadPart) * S2HNS) / freq.QuadPart;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (LONGLONG frame = 0; !stopCapture; frame++)
+    {
+        auto due = start + frame * frameDuration;
+        auto now = std::chrono::steady_clock::now();
+
+        if (now - due > frameDuration)
+        {
+            // Fell behind, skip the frames a capture card would have dropped.
+            frame = std::chrono::duration_cast<hns>(now - start) / frameDuration;
+            due = start + frame * frameDuration;
+        }
+        else if (due - now > yieldTime)
+        {
+            std::this_thread::sleep_for(due - now - yieldTime);
+        }
+
+        while (std::chrono::steady_clock::now() < due)
+        {
+            std::this_thread::yield();
+        }
+
+        // Null if the render thread is still reading the oldest frame, this frame is dropped then.
+        BYTE* buffer = frameRing.BeginWrite();
+        if (buffer == nullptr)
+        {
+            continue;
+        }
+
+        if (frameFile.is_open())
+        {
+            if (!ReadFileFrame(buffer))
+            {
+                OutputDebugString(L"ERROR: SYNTHETIC_FRAME_FILE does not contain a full frame.\n");
+                break;
+            }
+        }
+        else
+        {
+            WritePatternFrame(buffer, (int)frame);
+        }
+
+        frameRing.Publish(startTimeHNS + frame * frameDuration.count());
+    }
+}
+
+bool SyntheticFrameProvider::ReadFileFrame(BYTE* buffer)
+{
+    frameFile.read((char*)buffer, frameSize);
+    if (frameFile.gcount() == frameSize)
+    {
+        return true;
+    }
+
+    // Loop back to the first frame.
+    frameFile.clear();
+    frameFile.seekg(0);
+    frameFile.read((char*)buffer, frameSize);
+
+    return frameFile.gcount() == frameSize;
+}
+
+void SyntheticFrameProvider::WritePatternFrame(BYTE* buffer, int frame)
+{
+    int bytesPerPixel = frameSize / (config.FrameWidth * config.FrameHeight);
+    int rowBytes = config.FrameWidth * bytesPerPixel;
+    int offset = ((frame * patternScrollSpeed) % config.FrameWidth) * bytesPerPixel;
+
+    for (int y = 0; y < config.FrameHeight; y++)
+    {
+        const BYTE* src = pattern + y * rowBytes;
+        BYTE* dst = buffer + y * rowBytes;
+
+        memcpy(dst, src + offset, rowBytes - offset);
+        memcpy(dst + rowBytes - offset, src, offset);
+    }
+}
+
+void SyntheticFrameProvider::CreatePattern()
+{
+    int width = config.FrameWidth;
+    int height = config.FrameHeight;
+    BYTE* rgba = new BYTE[config.GetFrameBufferSize()];
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const BYTE* color = colorBars[(x * 8) / width];
+            BYTE* pixel = rgba + (y * width + x) * FRAME_BPP;
+
+            pixel[0] = color[0];
+            pixel[1] = color[1];
+            pixel[2] = color[2];
+            pixel[3] = 255;
+        }
+    }
+
+    if (OutputYUV())
+    {
+        pattern = new BYTE[config.GetRawFrameBufferSize()];
+        ColorConversion::RGBAToUYVY(rgba, width * FRAME_BPP, pattern, width * FRAME_BPP_RAW, width, height);
+        delete[] rgba;
+    }
+    else
+    {
+        pattern = rgba;
+    }
+}
+#endif
@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+#if USE_SYNTHETIC_FRAMES
+#include "IFrameProvider.h"
+#include "FrameRing.h"
+#include "DirectXHelper.h"
+
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+// Provides frames without capture hardware, to measure the compositor on any machine.
+// Plays raw frames from SYNTHETIC_FRAME_FILE in a loop, or scrolls color bars if no file is set.
+// Frames are produced on their own thread at the capture frame rate, like a capture card callback,
+// and are timestamped with the time they were scheduled for.
+class SyntheticFrameProvider : public IFrameProvider
+{
+private:
+    ID3D11ShaderResourceView* _colorSRV = nullptr;
+    ID3D11Device* _device = nullptr;
+
+    CaptureConfig config;
+    FrameRing frameRing;
+
+    // Bytes of one frame in the file or pattern.
+    int frameSize;
+    BYTE* pattern = nullptr;
+    std::ifstream frameFile;
+
+    std::thread captureThread;
+    std::atomic<bool> isEnabled{ false };
+    std::atomic<bool> stopCapture{ false };
+
+    LARGE_INTEGER freq;
+
+    void CaptureThreadProc();
+    bool ReadFileFrame(BYTE* buffer);
+    void WritePatternFrame(BYTE* buffer, int frame);
+    void CreatePattern();
+
+public:
+    SyntheticFrameProvider(const CaptureConfig& config);
+    ~SyntheticFrameProvider();
+
+    // Inherited via IFrameProvider
+    virtual HRESULT Initialize(ID3D11ShaderResourceView* srv) override;
+    virtual bool IsEnabled() override;
+    virtual void Update(int compositeFrameIndex) override;
+    virtual void Dispose() override;
+
+    virtual bool OutputYUV() override
+    {
+        return config.PixelFormat == CapturePixelFormat::YUV;
+    }
+
+    virtual LONGLONG GetTimestamp(int frame) override
+    {
+        return frameRing.GetTimestamp(frame);
+    }
+
+    virtual LONGLONG GetDurationHNS() override
+    {
+        return config.GetCaptureDurationHNS(SYNTHETIC_FRAME_FPS);
+    }
+
+    virtual int GetCaptureFrameIndex() override
+    {
+        return frameRing.GetLatestFrame();
+    }
+
+    virtual bool GetFrameStats(FrameStats& stats) override
+    {
+        frameRing.GetStats(stats);
+        return true;
+    }
+};
+#endif
@@ -0,0 +1,90 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+Per frame timing records of the compositor, kept in a ring so a long
+session only keeps its latest minutes.
+
+The ring lives in a block of memory that starts with a TelemetryHeader,
+the recorder maps it to a file so the records survive a crash. Writing a
+record is a copy into the mapped view and never blocks.
+
+Only standard C++ is used here, so the format can be read outside of the
+Windows build, see TelemetryAnalyzer.
+*/
+
+#define TELEMETRY_MAGIC   0x4C545653 // "SVTL"
+#define TELEMETRY_VERSION 2
+
+// One record per call to CompositorInterface::GetPose.
+// Times are in seconds on the clocks GetPose works with.
+struct TelemetryRecord
+{
+    int64_t Time;                   // when the pose was chosen, in ticks of TelemetryHeader::TimeFrequency
+    int32_t CompositeFrame;         // capture frame being composited
+    int32_t CaptureFrame;           // latest captured frame
+    int32_t FrameStep;              // frames the composite frame moved forward
+    int32_t CapturedFrames;         // provider totals, -1 if the provider does not count them
+    int32_t DroppedFrames;
+    int32_t EncoderQueueDepth;      // video frames waiting for the encoder, -1 while not recording
+    int32_t LatestPoseIndex;        // index of the newest pose, -1 if there is none
+    int32_t SelectedPose;           // poses back from the newest the lookup landed on
+    float CameraTime;               // time of the composite frame on the camera clock
+    float PoseTime;                 // requested time on the pose clock, after latency compensation
+    float LatestPoseTime;
+    float InterpolationSpan;        // time between the two poses blended, 0 if a single pose was used
+    float PoseTimeUncertainty;      // estimated error of the camera to pose clock mapping
+    float PredictionTime;           // how far the pose was extrapolated past the newest one, 0 if it was not
+    float LatestPosition[3];        // the newest pose, so a recording is also a trace of the camera's poses
+    float LatestRotation[4];
+    float Reserved;
+};
+
+struct TelemetryHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t RecordSize;
+    uint32_t Capacity;              // records in the ring
+    int64_t TimeFrequency;          // ticks per second of TelemetryRecord::Time
+    uint64_t RecordsWritten;        // the newest record is at (RecordsWritten - 1) % Capacity
+};
+
+class TelemetryRing
+{
+public:
+    static size_t GetMemorySize(uint32_t capacity)
+    {
+        return sizeof(TelemetryHeader) + (size_t)capacity * sizeof(TelemetryRecord);
+    }
+
+    // memory needs GetMemorySize(capacity) bytes and has to outlive the ring.
+    TelemetryRing(void* memory, uint32_t capacity, int64_t timeFrequency)
+        : header((TelemetryHeader*)memory)
+        , records((TelemetryRecord*)(header + 1))
+    {
+        header->Magic = TELEMETRY_MAGIC;
+        header->Version = TELEMETRY_VERSION;
+        header->RecordSize = sizeof(TelemetryRecord);
+        header->Capacity = capacity;
+        header->TimeFrequency = timeFrequency;
+        header->RecordsWritten = 0;
+    }
+
+    void Write(const TelemetryRecord& record)
+    {
+        uint64_t index = header->RecordsWritten;
+        memcpy(&records[index % header->Capacity], &record, sizeof(TelemetryRecord));
+        header->RecordsWritten = index + 1;
+    }
+
+private:
+    TelemetryHeader* header;
+    TelemetryRecord* records;
+};
@@ -0,0 +1,66 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "stdafx.h"
+#include "TelemetryRecorder.h"
+
+TelemetryRecorder::~TelemetryRecorder()
+{
+    Stop();
+}
+
+bool TelemetryRecorder::Start(const std::wstring& path)
+{
+    Stop();
+
+    ULONGLONG size = TelemetryRing::GetMemorySize(TELEMETRY_RING_RECORDS);
+
+    // Other processes can read the file while the session is running.
+    file = CreateFile(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        mapping = CreateFileMapping(file, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, NULL);
+    }
+
+    if (mapping != NULL)
+    {
+        view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+    }
+
+    if (view == nullptr)
+    {
+        OutputDebugString(L"Error creating telemetry file.\n");
+        Stop();
+        return false;
+    }
+
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+
+    ring = new TelemetryRing(view, TELEMETRY_RING_RECORDS, freq.QuadPart);
+    return true;
+}
+
+void TelemetryRecorder::Stop()
+{
+    delete ring;
+    ring = nullptr;
+
+    if (view != nullptr)
+    {
+        UnmapViewOfFile(view);
+        view = nullptr;
+    }
+
+    if (mapping != NULL)
+    {
+        CloseHandle(mapping);
+        mapping = NULL;
+    }
+
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+}
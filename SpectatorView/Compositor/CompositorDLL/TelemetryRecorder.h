@@ -0,0 +1,41 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+#include "stdafx.h"
+#include "Telemetry.h"
+
+#include <string>
+
+// Writes TelemetryRecords to a ring in a memory mapped file.
+// Records are copied into the mapped view, the OS writes them to disk in the background,
+// even if the process crashes. Start, Stop and Write have to be called from the same thread.
+class TelemetryRecorder
+{
+// 10 minutes at 60 frames per second, 3.3MB.
+#define TELEMETRY_RING_RECORDS (60 * 60 * 10)
+public:
+    ~TelemetryRecorder();
+
+    bool Start(const std::wstring& path);
+    void Stop();
+
+    bool IsRecording()
+    {
+        return ring != nullptr;
+    }
+
+    void Write(const TelemetryRecord& record)
+    {
+        if (ring != nullptr)
+        {
+            ring->Write(record);
+        }
+    }
+
+private:
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+    void* view = nullptr;
+    TelemetryRing* ring = nullptr;
+};
@@ -4,6 +4,191 @@
 #pragma once
 #include "CompositorConstants.h"
 
+#include <algorithm>
+#include <cmath>
+
+// Maps a remote clock onto the local clock with a least squares line over the latest samples.
+// The slope of the line follows drift between the two clocks.
+// Samples far from the line, like delivery spikes on the network, are left out of the fit.
+class ClockModel
+{
+public:
+    ClockModel()
+    {
+        Reset();
+    }
+
+    void AddSample(double remoteTime, double localTime)
+    {
+        remoteTimes[nextSample] = remoteTime;
+        localTimes[nextSample] = localTime;
+        nextSample = (nextSample + 1) % WINDOW_SIZE;
+        if (numSamples < WINDOW_SIZE)
+        {
+            numSamples++;
+        }
+
+        Fit();
+    }
+
+    void Reset()
+    {
+        nextSample = 0;
+        numSamples = 0;
+        offset = 0;
+        slope = 1;
+        uncertainty = 0;
+    }
+
+    bool HasSamples()
+    {
+        return numSamples > 0;
+    }
+
+    double ToLocal(double remoteTime)
+    {
+        return offset + slope * remoteTime;
+    }
+
+    double ToRemote(double localTime)
+    {
+        return (localTime - offset) / slope;
+    }
+
+    // Standard deviation in seconds of the samples that were fit around the line.
+    double GetUncertainty()
+    {
+        return uncertainty;
+    }
+
+private:
+    // About 10 seconds of camera frames or poses.
+    static const int WINDOW_SIZE = 600;
+
+    // Samples need to cover this many seconds before drift is estimated,
+    // over shorter spans jitter dominates the slope.
+    const double MIN_DRIFT_SPAN = 5.0;
+    // Real clocks drift far less than 1000 ppm, anything steeper is noise.
+    const double MAX_DRIFT = 0.001;
+    // Residuals below this are never treated as outliers.
+    const double MIN_OUTLIER_THRESHOLD = 0.001;
+
+    double remoteTimes[WINDOW_SIZE];
+    double localTimes[WINDOW_SIZE];
+    bool inliers[WINDOW_SIZE];
+    double residuals[WINDOW_SIZE];
+    double sortedResiduals[WINDOW_SIZE];
+    int nextSample;
+    int numSamples;
+
+    double offset;
+    double slope;
+    double uncertainty;
+
+    void Fit()
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            inliers[i] = true;
+        }
+
+        FitInliers();
+
+        if (numSamples < 3)
+        {
+            return;
+        }
+
+        // Reject samples further from the line than 3 standard deviations,
+        // estimated from the median absolute residual so the outliers do not widen it.
+        for (int i = 0; i < numSamples; i++)
+        {
+            residuals[i] = std::abs(localTimes[i] - ToLocal(remoteTimes[i]));
+        }
+
+        std::copy(residuals, residuals + numSamples, sortedResiduals);
+        std::nth_element(sortedResiduals, sortedResiduals + numSamples / 2, sortedResiduals + numSamples);
+        double threshold = std::max(3.0 * 1.4826 * sortedResiduals[numSamples / 2], MIN_OUTLIER_THRESHOLD);
+
+        int numInliers = 0;
+        for (int i = 0; i < numSamples; i++)
+        {
+            inliers[i] = residuals[i] <= threshold;
+            numInliers += inliers[i] ? 1 : 0;
+        }
+
+        if (numInliers < numSamples)
+        {
+            FitInliers();
+        }
+    }
+
+    void FitInliers()
+    {
+        // Center on the means, seconds since boot lose precision when squared.
+        int n = 0;
+        double meanRemote = 0;
+        double meanLocal = 0;
+        double minRemote = 0;
+        double maxRemote = 0;
+        for (int i = 0; i < numSamples; i++)
+        {
+            if (!inliers[i])
+            {
+                continue;
+            }
+
+            if (n == 0 || remoteTimes[i] < minRemote) { minRemote = remoteTimes[i]; }
+            if (n == 0 || remoteTimes[i] > maxRemote) { maxRemote = remoteTimes[i]; }
+
+            meanRemote += remoteTimes[i];
+            meanLocal += localTimes[i];
+            n++;
+        }
+
+        if (n == 0)
+        {
+            return;
+        }
+
+        meanRemote /= n;
+        meanLocal /= n;
+
+        slope = 1;
+        if (maxRemote - minRemote >= MIN_DRIFT_SPAN)
+        {
+            double covariance = 0;
+            double variance = 0;
+            for (int i = 0; i < numSamples; i++)
+            {
+                if (inliers[i])
+                {
+                    double dr = remoteTimes[i] - meanRemote;
+                    covariance += dr * (localTimes[i] - meanLocal);
+                    variance += dr * dr;
+                }
+            }
+
+            slope = std::min(std::max(covariance / variance, 1.0 - MAX_DRIFT), 1.0 + MAX_DRIFT);
+        }
+
+        offset = meanLocal - slope * meanRemote;
+
+        double sumSquares = 0;
+        for (int i = 0; i < numSamples; i++)
+        {
+            if (inliers[i])
+            {
+                double residual = localTimes[i] - ToLocal(remoteTimes[i]);
+                sumSquares += residual * residual;
+            }
+        }
+
+        // Two degrees of freedom go to the line.
+        uncertainty = (n > 2) ? std::sqrt(sumSquares / (n - 2)) : 0;
+    }
+};
+
 class TimeSynchronizer
 {
 public:
@@ -19,60 +204,54 @@ public:
     void Update(int camFrame, float camTime, int poseIndex, float poseTime)
     {
         QueryPerformanceCounter(&time);
-        LONGLONG currentTimeHNS = time.QuadPart * S2HNS / freq.QuadPart;
-
-        float currentTimeS = (float)(0.0001f * currentTimeHNS / 1000.0f);
+        double currentTimeS = (double)time.QuadPart / (double)freq.QuadPart;
 
         if (camFrame != prevCamFrame)
         {
             prevCamFrame = camFrame;
-            float newDelta = currentTimeS - camTime;
-            numCamFrameSamples++;
-
-            deltaCameraToUnity = Lerp(deltaCameraToUnity, newDelta, 1.0f / Min((float)numCamFrameSamples, 60.0f));
+            cameraToUnity.AddSample(camTime, currentTimeS);
         }
         if (poseIndex != prevPoseIndex)
         {
             prevPoseIndex = poseIndex;
-            float newDelta = currentTimeS - poseTime;
-            numPoseIndexSamples++;
-            deltaPoseToUnity = Lerp(deltaPoseToUnity, newDelta, 1.0f / Min((float)numPoseIndexSamples, 60.0f));
+            poseToUnity.AddSample(poseTime, currentTimeS);
         }
     }
 
     float GetPoseTimeFromCameraTime(float cameraTime)
     {
-        return (cameraTime + deltaCameraToUnity) - deltaPoseToUnity;
+        if (!cameraToUnity.HasSamples() || !poseToUnity.HasSamples())
+        {
+            return cameraTime;
+        }
+
+        return (float)poseToUnity.ToRemote(cameraToUnity.ToLocal(cameraTime));
+    }
+
+    // Estimated standard deviation in seconds of GetPoseTimeFromCameraTime.
+    float GetPoseTimeUncertainty()
+    {
+        double camera = cameraToUnity.GetUncertainty();
+        double pose = poseToUnity.GetUncertainty();
+
+        return (float)std::sqrt(camera * camera + pose * pose);
     }
 
     void Reset()
     {
         prevCamFrame = -1;
-        numCamFrameSamples = 0;
         prevPoseIndex = -1;
-        numPoseIndexSamples = 0;
+        cameraToUnity.Reset();
+        poseToUnity.Reset();
     }
 
 private:
-    float deltaCameraToUnity;
-    float deltaPoseToUnity;
+    ClockModel cameraToUnity;
+    ClockModel poseToUnity;
 
     int prevCamFrame = -1;
-    int numCamFrameSamples = 0;
     int prevPoseIndex = -1;
-    int numPoseIndexSamples = 0;
 
     LARGE_INTEGER freq;
     LARGE_INTEGER time;
-
-    float Lerp(float a, float b, float t)
-    {
-        return (1 - t) * a + t * b;
-    }
-
-    float Min(float a, float b)
-    {
-        return (a < b) ? a : b;
-    }
 };
-
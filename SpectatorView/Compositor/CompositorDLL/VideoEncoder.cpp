@@ -6,6 +6,8 @@
 
 #include "codecapi.h"
 
+#include <algorithm>
+
 
 VideoEncoder::VideoEncoder(UINT frameWidth, UINT frameHeight, UINT frameStride, UINT fps,
     UINT32 audioBufferSize, UINT32 audioSampleRate, UINT32 audioChannels, UINT32 audioBPS) :
@@ -19,13 +21,26 @@ VideoEncoder::VideoEncoder(UINT frameWidth, UINT frameHeight, UINT frameStride,
     fps(fps),
     bitRate(62 * 1000 * 1000 + 500 * 1000), // 62,5 MBit/s
     videoEncodingFormat(MFVideoFormat_H264),
-    isRecording(false)
+    isRecording(false),
+    audioRing(audioBufferSize, AudioRingSize),
+    audioTimeline(audioSampleRate, MaxAudioDriftHNS, MaxAudioGapHNS)
 {
     inputFormat = MFVideoFormat_NV12;
 }
 
 VideoEncoder::~VideoEncoder()
 {
+    if (isRecording)
+    {
+        StopRecording();
+    }
+
+    // Samples the sink writer still holds keep their pool alive until they come back.
+    videoSamplePool->Clear();
+    videoSamplePool->Release();
+    audioSamplePool->Clear();
+    audioSamplePool->Release();
+
     MFShutdown();
 }
 
@@ -45,7 +60,10 @@ bool VideoEncoder::Initialize(ID3D11Device* device)
     }
 
     numFramesRecorded = 0;
-    numAudioFramesRecorded = 0;
+
+    // Preallocate every buffer the encoder will use while recording.
+    if (SUCCEEDED(hr)) { hr = videoSamplePool->Initialize(VideoSamplePoolSize, (DWORD)(1.5f * frameWidth * frameHeight)); }
+    if (SUCCEEDED(hr)) { hr = audioSamplePool->Initialize(AudioSamplePoolSize, audioBufferSize); }
 
     return SUCCEEDED(hr);
 }
@@ -66,7 +84,6 @@ void VideoEncoder::StartRecording(LPCWSTR videoPath, bool encodeAudio)
 
     // Reset previous times to get valid data for this recording.
     numFramesRecorded = 0;
-    numAudioFramesRecorded = 0;
 
     HRESULT hr = E_PENDING;
 
@@ -161,8 +178,35 @@ void VideoEncoder::StartRecording(LPCWSTR videoPath, bool encodeAudio)
         OutputDebugString(L"Error starting recording.\n");
     }
 
+    {
+        std::lock_guard<std::mutex> queueGuard(queueLock);
+        stats = {};
+        totalQueueWait = 0;
+        stopEncoder = false;
+    }
+
+    // Blocks left over from the last recording are dropped once the audio thread is out of the ring.
+    while (audioWriters > 0)
+    {
+        std::this_thread::yield();
+    }
+    audioRing.Reset();
+    audioTimeline.Reset();
+    audioBlocksQueued = 0;
+    audioBlocksDropped = 0;
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    recordingStartTime = QPCToHNS(now.QuadPart);
+    videoClockOffset = 0;
+
+    encoderThread = std::thread(&VideoEncoder::EncoderThreadProc, this);
+
     isRecording = true;
     acceptQueuedFrames = true;
+#if ENCODE_AUDIO
+    acceptAudio = encodeAudio;
+#endif
 
     SafeRelease(pVideoTypeOut);
     SafeRelease(pVideoTypeIn);
@@ -173,273 +217,491 @@ void VideoEncoder::StartRecording(LPCWSTR videoPath, bool encodeAudio)
 #endif
 }
 
-void VideoEncoder::WriteAudio(byte* buffer)
+void VideoEncoder::StopRecording()
+{
+    std::unique_lock<std::shared_mutex> lock(videoStateLock);
+
+    numFramesRecorded = 0;
+
+    // Clear any async frames.
+    acceptQueuedFrames = false;
+    acceptAudio = false;
+    StopEncoderThread();
+
+    if (sinkWriter == NULL || !isRecording)
+    {
+        OutputDebugString(L"Must start recording before it can be stopped.\n");
+        return;
+    }
+
+    if (videoStreamIndex != NULL)
+    {
+        sinkWriter->Flush(videoStreamIndex);
+    }
+    if (audioStreamIndex != NULL)
+    {
+        sinkWriter->Flush(audioStreamIndex);
+    }
+
+    sinkWriter->Finalize();
+    SafeRelease(sinkWriter);
+
+    isRecording = false;
+
+    EncoderStats stats;
+    GetStats(stats);
+
+    wchar_t statsMessage[256];
+    swprintf_s(statsMessage, L"Recording stopped. Video frames: %llu queued, %llu dropped. Audio frames: %llu queued, %llu dropped. Queue wait: %lld avg, %lld max (hns).\n",
+        stats.videoFramesQueued, stats.videoFramesDropped, stats.audioFramesQueued, stats.audioFramesDropped,
+        stats.averageQueueWaitHNS, stats.maxQueueWaitHNS);
+    OutputDebugString(statsMessage);
+}
+
+void VideoEncoder::QueueVideoFrame(byte* buffer, LONGLONG timestamp, LONGLONG duration)
 {
     std::shared_lock<std::shared_mutex> lock(videoStateLock);
 
-#if ENCODE_AUDIO
-    if (!isRecording)
+    if (!acceptQueuedFrames)
     {
         return;
     }
 
-    LONGLONG sampleTime = numAudioFramesRecorded * AUDIO_POLLING_RATE_HNS;
-    LONGLONG duration = AUDIO_POLLING_RATE_HNS;
+    IMFSample* pVideoSample = videoSamplePool->Acquire();
+    if (pVideoSample == NULL)
+    {
+        std::lock_guard<std::mutex> queueGuard(queueLock);
+        stats.videoFramesDropped++;
+        return;
+    }
 
-    // Copy frame to a temporary buffer and process on a background thread.
-    byte* tmpAudioBuffer = new byte[audioBufferSize];
-    memcpy(tmpAudioBuffer, buffer, audioBufferSize);
+    LONGLONG sampleTime = numFramesRecorded * duration;
 
-    concurrency::create_task([=]()
+    // Track how far the video timeline is from the wall clock, smoothed over a few frames.
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    LONGLONG clockOffset = sampleTime - (QPCToHNS(now.QuadPart) - recordingStartTime);
+    if (numFramesRecorded > 0)
     {
-        std::shared_lock<std::shared_mutex> lock(videoStateLock);
+        clockOffset = videoClockOffset + (clockOffset - videoClockOffset) / 8;
+    }
+    videoClockOffset = clockOffset;
 
-        HRESULT hr = E_PENDING;
-        if (sinkWriter == NULL || !isRecording)
-        {
-            OutputDebugString(L"Must start recording before writing audio frames.\n");
-            delete[] tmpAudioBuffer;
-            return;
-        }
+    LONG cbWidth = frameWidth;
+    DWORD cbBuffer = videoSamplePool->GetBufferSize();
+    DWORD imageHeight = (int)(1.5f * frameHeight);
 
-        IMFSample* pAudioSample = NULL;
-        IMFMediaBuffer* pAudioBuffer = NULL;
+    IMFMediaBuffer* pVideoBuffer = NULL;
+    BYTE* pData = NULL;
 
-        const DWORD cbAudioBuffer = audioBufferSize;
+    HRESULT hr = pVideoSample->GetBufferByIndex(0, &pVideoBuffer);
 
-        BYTE* pData = NULL;
+    // Lock the buffer and copy the video frame to the buffer.
+    if (SUCCEEDED(hr)) { hr = pVideoBuffer->Lock(&pData, NULL, NULL); }
 
-        hr = MFCreateMemoryBuffer(cbAudioBuffer, &pAudioBuffer);
-        if (SUCCEEDED(hr)) { hr = pAudioBuffer->Lock(&pData, NULL, NULL); }
-        memcpy(pData, tmpAudioBuffer, cbAudioBuffer);
-        if (pAudioBuffer)
-        {
-            pAudioBuffer->Unlock();
-        }
+    if (SUCCEEDED(hr))
+    {
+        hr = MFCopyImage(
+            pData,                      // Destination buffer.
+            cbWidth,                    // Destination stride.
+            buffer,
+            cbWidth,                    // Source stride.
+            cbWidth,                    // Image width in bytes.
+            imageHeight                 // Image height in pixels.
+        );
+
+        pVideoBuffer->Unlock();
+    }
 
-        if (SUCCEEDED(hr)) { hr = MFCreateSample(&pAudioSample); }
-        if (SUCCEEDED(hr)) { hr = pAudioSample->SetSampleTime(sampleTime); }
-        if (SUCCEEDED(hr)) { hr = pAudioSample->SetSampleDuration(duration); }
-        if (SUCCEEDED(hr)) { hr = pAudioBuffer->SetCurrentLength(cbAudioBuffer); }
-        if (SUCCEEDED(hr)) { hr = pAudioSample->AddBuffer(pAudioBuffer); }
+    // Set the data length of the buffer.
+    if (SUCCEEDED(hr)) { hr = pVideoBuffer->SetCurrentLength(cbBuffer); }
 
-        if (SUCCEEDED(hr)) { hr = sinkWriter->WriteSample(audioStreamIndex, pAudioSample); }
+    if (SUCCEEDED(hr)) { hr = pVideoSample->SetSampleTime(sampleTime); } //100-nanosecond units
+    if (SUCCEEDED(hr)) { hr = pVideoSample->SetSampleDuration(duration); } //100-nanosecond units
 
-        SafeRelease(pAudioSample);
-        SafeRelease(pAudioBuffer);
+    SafeRelease(pVideoBuffer);
 
-        if (FAILED(hr))
+    if (FAILED(hr) || !QueueSample(pVideoSample, videoStreamIndex))
+    {
+        OutputDebugString(L"Error queueing video frame.\n");
+        SafeRelease(pVideoSample);
+        return;
+    }
+
+    numFramesRecorded++;
+}
+
+void VideoEncoder::QueueAudioFrame(byte* buffer, LONGLONG timestamp)
+{
+#if ENCODE_AUDIO
+    // StartRecording waits for audioWriters to reach zero before it resets the ring.
+    audioWriters++;
+
+    bool queued = false;
+    if (acceptAudio)
+    {
+        queued = audioRing.Push(buffer, QPCToHNS(timestamp));
+        if (queued)
+        {
+            audioBlocksQueued++;
+        }
+        else
         {
-            OutputDebugString(L"Error writing audio frame.\n");
+            audioBlocksDropped++;
         }
+    }
 
-        delete[] tmpAudioBuffer;
-    });
+    audioWriters--;
 
-    numAudioFramesRecorded++;
+    if (queued)
+    {
+        queueCondition.notify_one();
+    }
 #endif
 }
 
-void VideoEncoder::WriteVideo(byte* buffer, LONGLONG duration)
+void VideoEncoder::GetStats(EncoderStats& encoderStats)
 {
-    std::shared_lock<std::shared_mutex> lock(videoStateLock);
+    std::lock_guard<std::mutex> queueGuard(queueLock);
 
-    if (!isRecording)
-    {
-        return;
-    }
+    encoderStats = stats;
+    encoderStats.audioFramesQueued = audioBlocksQueued;
+    encoderStats.audioFramesDropped = audioBlocksDropped;
+}
 
-    LONGLONG sampleTime = numFramesRecorded * duration;
+int VideoEncoder::GetQueueDepth()
+{
+    std::lock_guard<std::mutex> queueGuard(queueLock);
+
+    return (int)encoderQueue.size();
+}
 
-    // Copy frame to a temporary buffer and process on a background thread.
-    BYTE* tmpVideoBuffer = new BYTE[(int)(1.5f * frameHeight * frameWidth)];
-    memcpy(tmpVideoBuffer, buffer, (int)(1.5f * frameHeight * frameWidth));
+// Takes ownership of the sample reference when it returns true.
+bool VideoEncoder::QueueSample(IMFSample* sample, DWORD streamIndex)
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
 
-    concurrency::create_task([=]()
     {
-        std::shared_lock<std::shared_mutex> lock(videoStateLock);
+        std::lock_guard<std::mutex> queueGuard(queueLock);
 
-        HRESULT hr = E_PENDING;
-        if (sinkWriter == NULL || !isRecording)
+        if (stopEncoder)
         {
-            OutputDebugString(L"Must start recording before writing video frames.\n");
-            delete[] tmpVideoBuffer;
-            return;
+            return false;
         }
 
-        LONG cbWidth = frameWidth;
-        DWORD cbBuffer = (int)(1.5f * frameWidth * frameHeight);
-        DWORD imageHeight = (int)(1.5f * frameHeight);
-
-        IMFSample* pVideoSample = NULL;
-        IMFMediaBuffer* pVideoBuffer = NULL;
-        BYTE* pData = NULL;
-
-        // Create a new memory buffer.
-        hr = MFCreateMemoryBuffer(cbBuffer, &pVideoBuffer);
+        encoderQueue.push_back({ sample, streamIndex, now.QuadPart });
 
-        // Lock the buffer and copy the video frame to the buffer.
-        if (SUCCEEDED(hr)) { hr = pVideoBuffer->Lock(&pData, NULL, NULL); }
-
-        if (SUCCEEDED(hr))
+        if (streamIndex == videoStreamIndex)
         {
-            //TODO: Can pVideoBuffer be created from an ID3D11Texture2D*?
-            hr = MFCopyImage(
-                pData,                      // Destination buffer.
-                cbWidth,                    // Destination stride.
-                tmpVideoBuffer,
-                cbWidth,                    // Source stride.
-                cbWidth,                    // Image width in bytes.
-                imageHeight                 // Image height in pixels.
-            );
+            stats.videoFramesQueued++;
         }
-
-        if (pVideoBuffer)
+        else
         {
-            pVideoBuffer->Unlock();
+            stats.audioFramesQueued++;
         }
+    }
 
-        // Set the data length of the buffer.
-        if (SUCCEEDED(hr)) { hr = pVideoBuffer->SetCurrentLength(cbBuffer); }
-
-        // Create a media sample and add the buffer to the sample.
-        if (SUCCEEDED(hr)) { hr = MFCreateSample(&pVideoSample); }
-        if (SUCCEEDED(hr)) { hr = pVideoSample->AddBuffer(pVideoBuffer); }
+    queueCondition.notify_one();
 
-        if (SUCCEEDED(hr)) { hr = pVideoSample->SetSampleTime(sampleTime); } //100-nanosecond units
-        if (SUCCEEDED(hr)) { hr = pVideoSample->SetSampleDuration(duration); } //100-nanosecond units
+    return true;
+}
 
-        // Send the sample to the Sink Writer.
-        if (SUCCEEDED(hr)) { hr = sinkWriter->WriteSample(videoStreamIndex, pVideoSample); }
+// QueryPerformanceCounter time in 100ns units, split up so the multiplication cannot overflow.
+LONGLONG VideoEncoder::QPCToHNS(LONGLONG qpcTime)
+{
+    return (qpcTime / freq.QuadPart) * S2HNS + ((qpcTime % freq.QuadPart) * S2HNS) / freq.QuadPart;
+}
 
-        SafeRelease(pVideoSample);
-        SafeRelease(pVideoBuffer);
-        delete[] tmpVideoBuffer;
+// Encoder thread: writes every block in the audio ring at its place on the video timeline.
+void VideoEncoder::DrainAudio()
+{
+    const LONGLONG blockAlign = audioChannels * sizeof(short);
+    const LONGLONG blockSamples = audioRing.GetBlockSize() / blockAlign;
 
-        if (FAILED(hr))
+    LONGLONG timestamp;
+    const BYTE* block;
+    while ((block = audioRing.Front(timestamp)) != nullptr)
+    {
+        if (sinkWriter != NULL)
         {
-            OutputDebugString(L"Error writing video frame.\n");
+            LONGLONG blockTime = timestamp - recordingStartTime + videoClockOffset;
+            LONGLONG correction = audioTimeline.Place(blockTime);
+
+            // Audio that is late gets silence in front of it, audio that is early loses its first samples.
+            if (correction > 0)
+            {
+                WriteAudio(nullptr, correction);
+            }
+
+            LONGLONG skipped = std::min(std::max(-correction, 0LL), blockSamples);
+            WriteAudio(block + skipped * blockAlign, blockSamples - skipped);
         }
-    });
 
-    numFramesRecorded++;
+        audioRing.Pop();
+    }
 }
 
-void VideoEncoder::StopRecording()
+// Writes samples, or silence when data is null, in chunks that fit the pooled buffers.
+void VideoEncoder::WriteAudio(const BYTE* data, LONGLONG numSamples)
 {
-    std::unique_lock<std::shared_mutex> lock(videoStateLock);
+    const LONGLONG blockAlign = audioChannels * sizeof(short);
+    const LONGLONG maxSamples = audioSamplePool->GetBufferSize() / blockAlign;
 
-    numFramesRecorded = 0;
-    numAudioFramesRecorded = 0;
-
-    if (sinkWriter == NULL || !isRecording)
+    while (numSamples > 0)
     {
-        OutputDebugString(L"Must start recording before it can be stopped.\n");
-        return;
-    }
+        LONGLONG chunkSamples = std::min(numSamples, maxSamples);
+        DWORD cbChunk = (DWORD)(chunkSamples * blockAlign);
 
-    // Clear any async frames.
-    acceptQueuedFrames = false;
+        // Sample times come from the samples written so far, the timeline moves on even if the chunk is dropped.
+        LONGLONG sampleTime = audioTimeline.GetTime();
+        audioTimeline.Advance(chunkSamples);
+        LONGLONG duration = audioTimeline.GetTime() - sampleTime;
 
-    std::mutex completion_mutex;
+        IMFSample* pAudioSample = audioSamplePool->Acquire();
+        HRESULT hr = (pAudioSample != NULL) ? S_OK : E_OUTOFMEMORY;
 
-    bool doneCleaningVideoTasks = false;
-    bool doneCleaningAudioTasks = false;
+        IMFMediaBuffer* pAudioBuffer = NULL;
+        BYTE* pData = NULL;
 
-    std::unique_lock<std::mutex> completion_lock(completion_mutex);
-    std::condition_variable completion_lock_check;
+        if (SUCCEEDED(hr)) { hr = pAudioSample->GetBufferByIndex(0, &pAudioBuffer); }
+        if (SUCCEEDED(hr)) { hr = pAudioBuffer->Lock(&pData, NULL, NULL); }
+        if (SUCCEEDED(hr))
+        {
+            if (data != nullptr)
+            {
+                memcpy(pData, data, cbChunk);
+            }
+            else
+            {
+                memset(pData, 0, cbChunk);
+            }
+            pAudioBuffer->Unlock();
+        }
 
-    concurrency::create_task([&]
-    {
-        while (!videoQueue.empty())
+        if (SUCCEEDED(hr)) { hr = pAudioBuffer->SetCurrentLength(cbChunk); }
+        if (SUCCEEDED(hr)) { hr = pAudioSample->SetSampleTime(sampleTime); }
+        if (SUCCEEDED(hr)) { hr = pAudioSample->SetSampleDuration(duration); }
+        if (SUCCEEDED(hr)) { hr = sinkWriter->WriteSample(audioStreamIndex, pAudioSample); }
+
+        SafeRelease(pAudioBuffer);
+        SafeRelease(pAudioSample);
+
+        if (FAILED(hr))
         {
-            videoQueue.pop();
+            audioBlocksDropped++;
+            OutputDebugString(L"Error writing audio sample.\n");
         }
 
+        if (data != nullptr)
         {
-            std::lock_guard<std::mutex> lk(completion_mutex);
-            doneCleaningVideoTasks = true;
+            data += cbChunk;
         }
-        completion_lock_check.notify_one();
-    });
+        numSamples -= chunkSamples;
+    }
+}
+
+void VideoEncoder::EncoderThreadProc()
+{
+    // Audio is pushed without taking the queue lock, so also wake up about once per audio block.
+    const std::chrono::milliseconds audioPollInterval(AUDIO_POLLING_RATE_HNS / MS2HNS);
 
-    concurrency::create_task([&]
+    while (true)
     {
-        while (!audioQueue.empty())
+        EncoderInput input = {};
+        bool hasInput = false;
+
+        {
+            std::unique_lock<std::mutex> queueGuard(queueLock);
+            queueCondition.wait_for(queueGuard, audioPollInterval,
+                [this] { return stopEncoder || !encoderQueue.empty() || !audioRing.IsEmpty(); });
+
+            if (stopEncoder)
+            {
+                return;
+            }
+
+            if (!encoderQueue.empty())
+            {
+                input = encoderQueue.front();
+                encoderQueue.pop_front();
+                hasInput = true;
+
+                LARGE_INTEGER now;
+                QueryPerformanceCounter(&now);
+
+                LONGLONG queueWait = (now.QuadPart - input.queueTime) * S2HNS / freq.QuadPart;
+                UINT64 samplesWritten = stats.videoFramesQueued + stats.audioFramesQueued - encoderQueue.size();
+
+                totalQueueWait += queueWait;
+                stats.averageQueueWaitHNS = totalQueueWait / (LONGLONG)samplesWritten;
+                stats.maxQueueWaitHNS = std::max(stats.maxQueueWaitHNS, queueWait);
+            }
+        }
+
+        DrainAudio();
+
+        if (!hasInput)
         {
-            audioQueue.pop();
+            continue;
         }
 
+        HRESULT hr = E_PENDING;
+        if (sinkWriter != NULL)
         {
-            std::lock_guard<std::mutex> lk(completion_mutex);
-            doneCleaningAudioTasks = true;
+            hr = sinkWriter->WriteSample(input.streamIndex, input.sample);
         }
-        completion_lock_check.notify_one();
-    });
 
-    completion_lock_check.wait(completion_lock, [&] {return doneCleaningVideoTasks && doneCleaningAudioTasks; });
+        // The sample goes back to its pool once the sink writer is done with it.
+        SafeRelease(input.sample);
 
-    if (videoStreamIndex != NULL)
+        if (FAILED(hr))
+        {
+            OutputDebugString(L"Error writing sample.\n");
+        }
+    }
+}
+
+void VideoEncoder::StopEncoderThread()
+{
     {
-        sinkWriter->Flush(videoStreamIndex);
+        std::lock_guard<std::mutex> queueGuard(queueLock);
+        stopEncoder = true;
     }
-    if (audioStreamIndex != NULL)
+    queueCondition.notify_one();
+
+    if (encoderThread.joinable())
     {
-        sinkWriter->Flush(audioStreamIndex);
+        encoderThread.join();
     }
 
-    sinkWriter->Finalize();
-    SafeRelease(sinkWriter);
+    // Frames that did not make it to the sink writer are dropped.
+    std::lock_guard<std::mutex> queueGuard(queueLock);
+    while (!encoderQueue.empty())
+    {
+        SafeRelease(encoderQueue.front().sample);
+        encoderQueue.pop_front();
+    }
+}
 
-    isRecording = false;
+#pragma region SamplePool
+VideoEncoder::SamplePool::~SamplePool()
+{
+    Clear();
 }
 
-void VideoEncoder::QueueVideoFrame(byte* buffer, LONGLONG timestamp, LONGLONG duration)
+HRESULT VideoEncoder::SamplePool::Initialize(UINT sampleCount, DWORD size)
 {
-    std::shared_lock<std::shared_mutex> lock(videoStateLock);
+    Clear();
+
+    std::lock_guard<std::mutex> lock(poolLock);
+
+    bufferSize = size;
 
-    if (acceptQueuedFrames)
+    HRESULT hr = S_OK;
+    for (UINT i = 0; i < sampleCount && SUCCEEDED(hr); i++)
     {
-        videoQueue.push(VideoInput(buffer, duration));
+        IMFTrackedSample* pTrackedSample = NULL;
+        IMFSample* pSample = NULL;
+        IMFMediaBuffer* pBuffer = NULL;
+
+        hr = MFCreateTrackedSample(&pTrackedSample);
+        if (SUCCEEDED(hr)) { hr = pTrackedSample->QueryInterface(IID_PPV_ARGS(&pSample)); }
+        if (SUCCEEDED(hr)) { hr = MFCreateMemoryBuffer(bufferSize, &pBuffer); }
+        if (SUCCEEDED(hr)) { hr = pSample->AddBuffer(pBuffer); }
+        if (SUCCEEDED(hr))
+        {
+            freeSamples.push_back(pSample);
+            pSample = NULL;
+        }
+
+        SafeRelease(pBuffer);
+        SafeRelease(pSample);
+        SafeRelease(pTrackedSample);
     }
+
+    return hr;
 }
 
-void VideoEncoder::QueueAudioFrame(byte* buffer)
+void VideoEncoder::SamplePool::Clear()
 {
-    std::shared_lock<std::shared_mutex> lock(videoStateLock);
+    std::lock_guard<std::mutex> lock(poolLock);
 
-    if (acceptQueuedFrames)
+    for (IMFSample* pSample : freeSamples)
     {
-        audioQueue.push(AudioInput(buffer));
+        pSample->Release();
     }
+    freeSamples.clear();
+    usedSamples.clear();
 }
 
-void VideoEncoder::Update()
+IMFSample* VideoEncoder::SamplePool::Acquire()
 {
-    std::shared_lock<std::shared_mutex> lock(videoStateLock);
-    if (!isRecording)
+    IMFSample* pSample = NULL;
+
     {
-        return;
+        std::lock_guard<std::mutex> lock(poolLock);
+
+        if (freeSamples.empty())
+        {
+            return NULL;
+        }
+
+        pSample = freeSamples.back();
+        freeSamples.pop_back();
+        usedSamples.insert(pSample);
     }
 
-    while (!videoQueue.empty())
+    // Released in Invoke, when the sample comes back.
+    AddRef();
+
+    // The allocator is cleared every time the sample is returned, so set it again.
+    IMFTrackedSample* pTrackedSample = NULL;
+    HRESULT hr = pSample->QueryInterface(IID_PPV_ARGS(&pTrackedSample));
+    if (SUCCEEDED(hr)) { hr = pTrackedSample->SetAllocator(this, NULL); }
+    SafeRelease(pTrackedSample);
+
+    if (FAILED(hr))
     {
-        if (isRecording)
+        // Without an allocator the sample would not come back, keep it in the pool.
         {
-            VideoInput input = videoQueue.front();
-            WriteVideo(input.sharedBuffer, input.duration);
-            videoQueue.pop();
+            std::lock_guard<std::mutex> lock(poolLock);
+            usedSamples.erase(pSample);
+            freeSamples.push_back(pSample);
         }
+        Release();
+        return NULL;
     }
 
-    while (!audioQueue.empty())
+    return pSample;
+}
+
+STDMETHODIMP VideoEncoder::SamplePool::Invoke(IMFAsyncResult* pResult)
+{
+    IUnknown* pObject = NULL;
+    IMFSample* pSample = NULL;
+
+    HRESULT hr = pResult->GetObject(&pObject);
+    if (SUCCEEDED(hr)) { hr = pObject->QueryInterface(IID_PPV_ARGS(&pSample)); }
+    SafeRelease(pObject);
+
+    if (SUCCEEDED(hr))
     {
-        if (isRecording)
+        std::lock_guard<std::mutex> lock(poolLock);
+        if (usedSamples.erase(pSample) > 0)
+        {
+            freeSamples.push_back(pSample);
+        }
+        else
         {
-            AudioInput input = audioQueue.front();
-            WriteAudio(input.buffer);
-            delete[] input.buffer;
-            audioQueue.pop();
+            // Handed out before the pool was cleared.
+            pSample->Release();
         }
     }
+
+    // Last, this can be the reference that keeps the pool alive.
+    Release();
+
+    return hr;
 }
+#pragma endregion SamplePool
@@ -14,8 +14,15 @@
 #include <shared_mutex>
 
 #include "DirectXHelper.h"
+#include "AudioRing.h"
 
-#include <queue>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 
 #pragma comment(lib, "mf")
 #pragma comment(lib, "mfreadwrite")
@@ -27,6 +34,16 @@
 class VideoEncoder
 {
 public:
+    struct EncoderStats
+    {
+        UINT64 videoFramesQueued;
+        UINT64 videoFramesDropped;
+        UINT64 audioFramesQueued;
+        UINT64 audioFramesDropped;
+        LONGLONG averageQueueWaitHNS;
+        LONGLONG maxQueueWaitHNS;
+    };
+
     VideoEncoder(UINT frameWidth, UINT frameHeight, UINT frameStride, UINT fps,
         UINT32 audioBufferSize, UINT32 audioSampleRate, UINT32 audioChannels, UINT32 audioBPS);
     ~VideoEncoder();
@@ -38,51 +55,119 @@ public:
     void StopRecording();
 
     // Used for recording video from a background thread.
+    // The frame is copied before returning, so the buffer can be reused right away.
     void QueueVideoFrame(byte* buffer, LONGLONG timestamp, LONGLONG duration);
-    void QueueAudioFrame(byte* buffer);
-
-    // Do not call this from a background thread.
-    void Update();
+    // Safe to call from the engine's audio thread, no locks are taken.
+    // timestamp is the QueryPerformanceCounter time the block was captured.
+    void QueueAudioFrame(byte* buffer, LONGLONG timestamp);
 
-private:
-    void WriteVideo(byte* buffer, LONGLONG duration);
-    void WriteAudio(byte* buffer);
-
-    LARGE_INTEGER freq;
+    // Counters for the current recording, reset by StartRecording.
+    void GetStats(EncoderStats& stats);
 
-    LONGLONG numFramesRecorded = 0;
-    LONGLONG numAudioFramesRecorded = 0;
+    // Samples waiting for the encoder thread.
+    int GetQueueDepth();
 
-    class VideoInput
+private:
+    // Number of preallocated samples. When all of them are queued or still held by
+    // the sink writer, new frames are dropped instead of allocating more.
+    static const UINT VideoSamplePoolSize = 8;
+    static const UINT AudioSamplePoolSize = 32;
+
+    // Audio blocks that can wait for the encoder thread before new ones are dropped.
+    static const int AudioRingSize = 64;
+    // Audio that drifts further than this from the video timeline is corrected.
+    static const LONGLONG MaxAudioDriftHNS = 20 * MS2HNS;
+    // Gaps in the audio longer than this are filled with silence right away.
+    static const LONGLONG MaxAudioGapHNS = 200 * MS2HNS;
+
+    // Fixed set of tracked samples, each with its own preallocated buffer.
+    // A sample goes back to the free list when the sink writer releases it.
+    // The sink writer can let go of a sample after the encoder is gone, so the
+    // pool is reference counted and every sample that is out holds a reference.
+    class SamplePool : public IMFAsyncCallback
     {
     public:
-        byte* sharedBuffer;
-        LONGLONG duration;
+        // Samples of an earlier Initialize are dropped, the ones still out when they come back.
+        HRESULT Initialize(UINT sampleCount, DWORD bufferSize);
+        // Releases the free samples, the ones still out are released when they come back.
+        void Clear();
+
+        // Returns nullptr when every sample is in use.
+        IMFSample* Acquire();
 
-        VideoInput(byte* buffer, LONGLONG duration)
+        DWORD GetBufferSize()
         {
-            this->sharedBuffer = buffer;
-            this->duration = duration;
+            return bufferSize;
         }
-    };
 
-    class AudioInput
-    {
-    public:
-        byte* buffer = new byte[AUDIO_BUFSIZE];
+        STDMETHODIMP_(ULONG) AddRef()
+        {
+            return InterlockedIncrement(&m_cRef);
+        }
+        STDMETHODIMP_(ULONG) Release()
+        {
+            ULONG cRef = InterlockedDecrement(&m_cRef);
+            if (cRef == 0)
+            {
+                delete this;
+            }
+            return cRef;
+        }
+
+        STDMETHODIMP QueryInterface(REFIID riid, void **ppvObject)
+        {
+            if (NULL == ppvObject) return E_POINTER;
+            if (riid == __uuidof(IUnknown) || riid == __uuidof(IMFAsyncCallback))
+            {
+                *ppvObject = static_cast<IMFAsyncCallback*>(this);
+                AddRef();
+                return S_OK;
+            }
+            *ppvObject = NULL;
+            return E_NOINTERFACE;
+        }
 
-        AudioInput(byte* buffer)
+        // IMFAsyncCallback
+        STDMETHODIMP GetParameters(DWORD*, DWORD*)
         {
-            memcpy(this->buffer, buffer, AUDIO_BUFSIZE);
+            return E_NOTIMPL;
         }
+        STDMETHODIMP Invoke(IMFAsyncResult* pResult);
+
+    private:
+        ~SamplePool();
+
+        std::mutex poolLock;
+        std::vector<IMFSample*> freeSamples;
+        // Samples handed out since the last Clear, the ones that go back to the free list.
+        std::set<IMFSample*> usedSamples;
+        DWORD bufferSize = 0;
+        ULONG m_cRef = 1;
     };
 
+    // Sample waiting for the encoder thread.
+    struct EncoderInput
+    {
+        IMFSample* sample;
+        DWORD streamIndex;
+        LONGLONG queueTime;
+    };
+
+    bool QueueSample(IMFSample* sample, DWORD streamIndex);
+    void DrainAudio();
+    void WriteAudio(const BYTE* data, LONGLONG numSamples);
+    LONGLONG QPCToHNS(LONGLONG qpcTime);
+    void EncoderThreadProc();
+    void StopEncoderThread();
+
+    LARGE_INTEGER freq;
+
+    LONGLONG numFramesRecorded = 0;
+
     IMFSinkWriter* sinkWriter;
     DWORD videoStreamIndex;
     DWORD audioStreamIndex;
 
-    byte* nullAudioBuffer = new byte[AUDIO_BUFSIZE];
-
     bool isRecording = false;
     bool acceptQueuedFrames = false;
 
@@ -101,8 +186,29 @@ private:
     UINT32 audioChannels;
     UINT32 audioBPS;
 
-    std::queue<VideoInput> videoQueue;
-    std::queue<AudioInput> audioQueue;
+    SamplePool* videoSamplePool = new SamplePool();
+    SamplePool* audioSamplePool = new SamplePool();
+
+    // Samples are written by a single encoder thread in the order they were queued.
+    std::thread encoderThread;
+    std::mutex queueLock;
+    std::condition_variable queueCondition;
+    std::deque<EncoderInput> encoderQueue;
+    bool stopEncoder = false;
+    EncoderStats stats = {};
+    LONGLONG totalQueueWait = 0;
+
+    // Audio goes through a lock free ring and is written by the encoder thread.
+    AudioRing audioRing;
+    AudioTimeline audioTimeline;
+    std::atomic<bool> acceptAudio{ false };
+    std::atomic<int> audioWriters{ 0 };
+    std::atomic<UINT64> audioBlocksQueued{ 0 };
+    std::atomic<UINT64> audioBlocksDropped{ 0 };
+
+    // Audio is placed on the video timeline, which can run ahead of or behind the wall clock.
+    LONGLONG recordingStartTime = 0;
+    std::atomic<LONGLONG> videoClockOffset{ 0 };
 
     std::shared_mutex videoStateLock;
 
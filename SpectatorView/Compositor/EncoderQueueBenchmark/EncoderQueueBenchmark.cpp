@@ -0,0 +1,350 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Compares the two ways VideoEncoder has handed NV12 frames to the sink writer, with a null sink
+// writer that only holds each frame for a while, the way the encoder does.
+// The per frame way allocates a copy of the frame and starts a task for it, which allocates the
+// media buffer, copies again and writes. The pooled way copies into one of a fixed set of buffers
+// and queues it for a single encoder thread, and drops the frame when every buffer is in use.
+// Reports the time the capture thread spends per frame, the queue wait, drops, and the most frame
+// memory held at once.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 EncoderQueueBenchmark.cpp
+//
+// Usage: EncoderQueueBenchmark [frames]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // VideoSamplePoolSize in VideoEncoder.h.
+    const size_t PoolSize = 8;
+
+    struct Scenario
+    {
+        const char* Name;
+        int Width;
+        int Height;
+        // 0 to queue frames as fast as the capture thread can.
+        double FPS;
+        // How long the sink writer takes per frame.
+        double SinkMS;
+    };
+
+    struct Result
+    {
+        std::vector<double> CaptureUS;
+        std::vector<double> WaitMS;
+        size_t Written = 0;
+        size_t Dropped = 0;
+        size_t PeakBytes = 0;
+        double Seconds = 0;
+    };
+
+    double Milliseconds(Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    // Stands in for IMFSinkWriter::WriteSample, which serializes writes and holds the sample while it encodes.
+    class NullSinkWriter
+    {
+    public:
+        explicit NullSinkWriter(double sinkMS) :
+            sinkMS(sinkMS)
+        {
+        }
+
+        // Returns how long the frame waited from queueTime until the sink writer got to it.
+        double WriteSample(const uint8_t* data, size_t size, Clock::time_point queueTime)
+        {
+            std::lock_guard<std::mutex> lock(writeLock);
+            double waitMS = Milliseconds(Clock::now() - queueTime);
+
+            // Read the frame like an encoder would, so the copy can not be optimized away.
+            checksum += data[0] + data[size / 2] + data[size - 1];
+            if (sinkMS > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(sinkMS));
+            }
+
+            return waitMS;
+        }
+
+        uint64_t checksum = 0;
+
+    private:
+        std::mutex writeLock;
+        double sinkMS;
+    };
+
+    // Frame memory held by the encoder.
+    class ByteCounter
+    {
+    public:
+        void Add(size_t bytes)
+        {
+            size_t now = (current += bytes);
+            size_t peak = this->peak.load();
+            while (now > peak && !this->peak.compare_exchange_weak(peak, now))
+            {
+            }
+        }
+
+        void Remove(size_t bytes)
+        {
+            current -= bytes;
+        }
+
+        size_t Peak() const { return peak; }
+
+    private:
+        std::atomic<size_t> current{ 0 };
+        std::atomic<size_t> peak{ 0 };
+    };
+
+    // WriteVideo before the pool: a copy of the frame and a task for every frame.
+    Result RunPerFrame(const Scenario& scenario, const std::vector<uint8_t>& frame, int frames)
+    {
+        const size_t size = frame.size();
+
+        Result result;
+        NullSinkWriter sinkWriter(scenario.SinkMS);
+        ByteCounter bytes;
+        std::mutex stateLock;
+        std::vector<std::thread> tasks;
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < frames; i++)
+        {
+            if (scenario.FPS > 0)
+            {
+                std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(i / scenario.FPS)));
+            }
+
+            Clock::time_point captured = Clock::now();
+
+            uint8_t* copy = new uint8_t[size];
+            bytes.Add(size);
+            memcpy(copy, frame.data(), size);
+
+            tasks.emplace_back([&, copy, captured]()
+            {
+                uint8_t* buffer = new uint8_t[size];
+                bytes.Add(size);
+                memcpy(buffer, copy, size);
+                delete[] copy;
+                bytes.Remove(size);
+
+                double waitMS = sinkWriter.WriteSample(buffer, size, captured);
+
+                delete[] buffer;
+                bytes.Remove(size);
+
+                std::lock_guard<std::mutex> lock(stateLock);
+                result.WaitMS.push_back(waitMS);
+                result.Written++;
+            });
+
+            result.CaptureUS.push_back(Milliseconds(Clock::now() - captured) * 1000);
+        }
+
+        for (std::thread& task : tasks)
+        {
+            task.join();
+        }
+
+        result.Seconds = Milliseconds(Clock::now() - start) / 1000;
+        result.PeakBytes = bytes.Peak();
+        return result;
+    }
+
+    // QueueVideoFrame with the pool: one of a fixed set of buffers, queued for the encoder thread.
+    Result RunPooled(const Scenario& scenario, const std::vector<uint8_t>& frame, int frames)
+    {
+        const size_t size = frame.size();
+
+        struct Input
+        {
+            uint8_t* Buffer;
+            Clock::time_point QueueTime;
+        };
+
+        Result result;
+        NullSinkWriter sinkWriter(scenario.SinkMS);
+
+        std::vector<std::unique_ptr<uint8_t[]>> buffers;
+        std::vector<uint8_t*> freeBuffers;
+        for (size_t i = 0; i < PoolSize; i++)
+        {
+            buffers.emplace_back(new uint8_t[size]);
+            freeBuffers.push_back(buffers.back().get());
+        }
+        std::mutex poolLock;
+
+        std::mutex queueLock;
+        std::condition_variable queueCondition;
+        std::deque<Input> queue;
+        bool stop = false;
+
+        std::thread encoderThread([&]()
+        {
+            while (true)
+            {
+                Input input;
+                {
+                    std::unique_lock<std::mutex> lock(queueLock);
+                    queueCondition.wait(lock, [&] { return stop || !queue.empty(); });
+                    if (queue.empty())
+                    {
+                        return;
+                    }
+
+                    input = queue.front();
+                    queue.pop_front();
+                }
+
+                result.WaitMS.push_back(sinkWriter.WriteSample(input.Buffer, size, input.QueueTime));
+                result.Written++;
+
+                std::lock_guard<std::mutex> lock(poolLock);
+                freeBuffers.push_back(input.Buffer);
+            }
+        });
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < frames; i++)
+        {
+            if (scenario.FPS > 0)
+            {
+                std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(i / scenario.FPS)));
+            }
+
+            Clock::time_point captured = Clock::now();
+
+            uint8_t* buffer = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(poolLock);
+                if (!freeBuffers.empty())
+                {
+                    buffer = freeBuffers.back();
+                    freeBuffers.pop_back();
+                }
+            }
+
+            if (buffer == nullptr)
+            {
+                result.Dropped++;
+            }
+            else
+            {
+                memcpy(buffer, frame.data(), size);
+                {
+                    std::lock_guard<std::mutex> lock(queueLock);
+                    queue.push_back({ buffer, captured });
+                }
+                queueCondition.notify_one();
+            }
+
+            result.CaptureUS.push_back(Milliseconds(Clock::now() - captured) * 1000);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queueLock);
+            stop = true;
+        }
+        queueCondition.notify_one();
+        encoderThread.join();
+
+        result.Seconds = Milliseconds(Clock::now() - start) / 1000;
+        result.PeakBytes = PoolSize * size;
+        return result;
+    }
+
+    double Mean(const std::vector<double>& values)
+    {
+        double sum = 0;
+        for (double value : values)
+        {
+            sum += value;
+        }
+        return values.empty() ? 0 : sum / values.size();
+    }
+
+    double Percentile(std::vector<double> values, double p)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(p * (values.size() - 1))];
+    }
+
+    void Print(const char* name, const Result& result)
+    {
+        printf("    %-10s %9.0f %9.0f %9.1f %9.1f %8zu %8zu %9.0f %8.1f\n",
+            name,
+            Mean(result.CaptureUS),
+            Percentile(result.CaptureUS, 0.99),
+            Mean(result.WaitMS),
+            Percentile(result.WaitMS, 1.0),
+            result.Written,
+            result.Dropped,
+            result.PeakBytes / (1024.0 * 1024.0),
+            result.Written / result.Seconds);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 300;
+    if (frames <= 0)
+    {
+        fprintf(stderr, "Usage: EncoderQueueBenchmark [frames]\n");
+        return 1;
+    }
+
+    const Scenario scenarios[] =
+    {
+        { "1080p, as fast as possible", 1920, 1080, 0, 0 },
+        { "1080p at 30 fps", 1920, 1080, 30, 5 },
+        { "1080p at 30 fps, encoder slower than the frame rate", 1920, 1080, 30, 40 },
+    };
+
+    printf("%d frames per run, null sink writer, %zu pooled buffers.\n\n", frames, PoolSize);
+
+    for (const Scenario& scenario : scenarios)
+    {
+        // NV12, like the frames the compositor queues.
+        std::vector<uint8_t> frame((size_t)(1.5 * scenario.Width * scenario.Height));
+        for (size_t i = 0; i < frame.size(); i++)
+        {
+            frame[i] = (uint8_t)(i * 31);
+        }
+
+        printf("%s, sink writer %.0f ms per frame:\n", scenario.Name, scenario.SinkMS);
+        printf("    %-10s %9s %9s %9s %9s %8s %8s %9s %8s\n",
+            "", "queue us", "p99 us", "wait ms", "max ms", "written", "dropped", "peak MB", "fps");
+
+        Print("per frame", RunPerFrame(scenario, frame, frames));
+        Print("pooled", RunPooled(scenario, frame, frames));
+        printf("\n");
+    }
+
+    return 0;
+}
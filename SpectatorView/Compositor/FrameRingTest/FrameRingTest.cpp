@@ -0,0 +1,273 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Tests for FrameRing, the ring the capture providers hand frames to the render thread through.
+// The single threaded tests check which frames the renderer can get and what counts as dropped.
+// The threaded test has a capture thread write and publish frames as fast as it can while a render
+// thread acquires the latest one, and checks that every acquired frame is complete, has the
+// timestamp it was published with, and is not older than the one before.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 FrameRingTest.cpp
+// or:
+//     g++ -std=c++14 -O2 -pthread FrameRingTest.cpp
+//
+// Usage: FrameRingTest [seconds]
+
+#include "../CompositorDLL/FrameRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace
+{
+    // Large enough that a torn copy would show up as words from different frames.
+    const int FrameWords = 4096;
+    const int FrameSize = FrameWords * sizeof(uint32_t);
+
+    // Fewer slots than the providers keep, MAX_NUM_CACHED_BUFFERS in CompositorConstants.h,
+    // so the capture thread laps the renderer often.
+    const int NumSlots = 4;
+
+    std::atomic<int> failures{ 0 };
+
+    void Expect(bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            printf("FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    void WriteFrame(uint8_t* buffer, uint32_t value)
+    {
+        uint32_t* words = (uint32_t*)buffer;
+        for (int i = 0; i < FrameWords; i++)
+        {
+            words[i] = value;
+        }
+    }
+
+    // True if every word of the frame is value.
+    bool FrameIs(const uint8_t* buffer, uint32_t value)
+    {
+        const uint32_t* words = (const uint32_t*)buffer;
+        for (int i = 0; i < FrameWords; i++)
+        {
+            if (words[i] != value)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Writes and publishes the next frame, false if the ring dropped it.
+    bool Capture(FrameRing& ring, int64_t timeStamp)
+    {
+        uint8_t* buffer = ring.BeginWrite();
+        if (buffer == nullptr)
+        {
+            return false;
+        }
+
+        WriteFrame(buffer, (uint32_t)ring.GetLatestFrame() + 1);
+        ring.Publish(timeStamp);
+        return true;
+    }
+
+    void TestNothingCaptured()
+    {
+        FrameRing ring(FrameSize, NumSlots);
+
+        Expect(ring.GetLatestFrame() == 0, "no latest frame before the first capture");
+        Expect(ring.AcquireFrame(0) == nullptr, "frame 0 is never available");
+        Expect(ring.AcquireFrame(1) == nullptr, "frame 1 is not available before it is captured");
+        ring.ReleaseFrame();
+    }
+
+    void TestCaptureAcquire()
+    {
+        FrameRing ring(FrameSize, NumSlots);
+
+        Expect(Capture(ring, 100), "capture into an empty ring");
+        Expect(ring.GetLatestFrame() == 1, "first frame is frame 1");
+        Expect(ring.GetTimestamp(1) == 100, "timestamp of the first frame");
+
+        const uint8_t* frame = ring.AcquireFrame(1);
+        Expect(frame != nullptr && FrameIs(frame, 1), "acquire returns the captured frame");
+        ring.ReleaseFrame();
+
+        FrameStats stats;
+        ring.GetStats(stats);
+        Expect(stats.CapturedFrames == 1, "one frame captured");
+        Expect(stats.DroppedFrames == 0, "no frame dropped");
+    }
+
+    void TestOverwritten()
+    {
+        FrameRing ring(FrameSize, NumSlots);
+
+        for (int i = 1; i <= NumSlots + 2; i++)
+        {
+            Expect(Capture(ring, i * 100), "capture while the renderer holds nothing");
+        }
+
+        // Frames 1 and 2 were overwritten by NumSlots + 1 and NumSlots + 2, unused.
+        Expect(ring.AcquireFrame(1) == nullptr, "overwritten frame is gone");
+        ring.ReleaseFrame();
+        Expect(ring.AcquireFrame(2) == nullptr, "second overwritten frame is gone");
+        ring.ReleaseFrame();
+
+        for (int i = 3; i <= NumSlots + 2; i++)
+        {
+            const uint8_t* frame = ring.AcquireFrame(i);
+            Expect(frame != nullptr && FrameIs(frame, i), "frames still in the ring are available");
+            Expect(ring.GetTimestamp(i) == i * 100, "frames keep their timestamp");
+            ring.ReleaseFrame();
+        }
+
+        FrameStats stats;
+        ring.GetStats(stats);
+        Expect(stats.CapturedFrames == NumSlots + 2, "every frame captured");
+        Expect(stats.DroppedFrames == 2, "overwritten unused frames count as dropped");
+    }
+
+    void TestHeldSlot()
+    {
+        FrameRing ring(FrameSize, NumSlots);
+
+        Capture(ring, 100);
+        const uint8_t* held = ring.AcquireFrame(1);
+        Expect(held != nullptr, "acquire frame 1");
+
+        // Fill the ring up to the slot the renderer holds.
+        for (int i = 2; i <= NumSlots; i++)
+        {
+            Expect(Capture(ring, i * 100), "capture into slots the renderer does not hold");
+        }
+
+        Expect(!Capture(ring, 1000), "capture into the held slot is dropped");
+        Expect(ring.GetLatestFrame() == NumSlots, "dropped capture does not become the latest frame");
+        Expect(FrameIs(held, 1), "held frame is untouched");
+
+        ring.ReleaseFrame();
+        Expect(Capture(ring, 1000), "capture after release");
+        Expect(ring.AcquireFrame(1) == nullptr, "released frame can be overwritten");
+        ring.ReleaseFrame();
+
+        FrameStats stats;
+        ring.GetStats(stats);
+        Expect(stats.CapturedFrames == NumSlots + 1, "dropped capture is not counted as captured");
+        Expect(stats.DroppedFrames == 1, "capture into the held slot counts as dropped");
+    }
+
+    void TestConcurrent(double seconds)
+    {
+        FrameRing ring(FrameSize, NumSlots);
+
+        std::atomic<bool> done{ false };
+        uint64_t attempts = 0;
+        uint64_t captured = 0;
+
+        std::thread captureThread([&]()
+        {
+            while (!done.load(std::memory_order_relaxed))
+            {
+                attempts++;
+
+                // The timestamp is derived from the frame, so the renderer can check it.
+                int64_t next = ring.GetLatestFrame() + 1;
+                if (Capture(ring, next * 10))
+                {
+                    captured++;
+                }
+                else
+                {
+                    // A camera would not deliver the next frame right away either.
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        uint64_t acquired = 0;
+        uint64_t missed = 0;
+        uint64_t torn = 0;
+        uint64_t wrongTime = 0;
+        uint64_t reordered = 0;
+        int last = 0;
+
+        auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+        while (std::chrono::steady_clock::now() < end)
+        {
+            int latest = ring.GetLatestFrame();
+            const uint8_t* frame = ring.AcquireFrame(latest);
+            if (frame == nullptr)
+            {
+                ring.ReleaseFrame();
+                if (latest > 0)
+                {
+                    missed++;
+                }
+                continue;
+            }
+
+            if (!FrameIs(frame, (uint32_t)latest))
+            {
+                torn++;
+            }
+            if (ring.GetTimestamp(latest) != latest * 10)
+            {
+                wrongTime++;
+            }
+            if (latest < last)
+            {
+                reordered++;
+            }
+            last = latest;
+            acquired++;
+
+            ring.ReleaseFrame();
+        }
+
+        done = true;
+        captureThread.join();
+
+        FrameStats stats;
+        ring.GetStats(stats);
+
+        printf("concurrent: %llu frames captured, %llu acquired, %llu overwritten before they were acquired, %d dropped in %.1f s\n",
+            (unsigned long long)captured, (unsigned long long)acquired, (unsigned long long)missed, stats.DroppedFrames, seconds);
+
+        Expect(acquired > 0, "renderer acquired frames");
+        Expect(torn == 0, "no torn frames");
+        Expect(wrongTime == 0, "acquired frames have the timestamp they were published with");
+        Expect(reordered == 0, "acquired frames are not older than the one before");
+        Expect((uint64_t)stats.CapturedFrames == captured, "captured count matches the published frames");
+        Expect(captured <= attempts, "no more frames published than written");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+
+    TestNothingCaptured();
+    TestCaptureAcquire();
+    TestOverwritten();
+    TestHeldSlot();
+    TestConcurrent(seconds);
+
+    if (failures > 0)
+    {
+        printf("%d checks failed\n", failures.load());
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,435 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Reports size, speed and geometric error of the compact spatial mapping format (MeshCodec.h)
+// against the legacy one, on generated surfaces that look like what a HoloLens sends.
+// Then simulates a session of spatial mapping refreshes, to compare resending every surface
+// with the updates of protocol version 4 that only send the surfaces that changed.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 MeshCodecBenchmark.cpp
+//
+// Usage: MeshCodecBenchmark
+
+#include "../SharedHeaders/MeshCodec.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // HoloLens surfaces store positions as 16 bit integers, scaled by VertexPositionScale.
+    const double MetersPerUnit = 4.0 / 32767;
+    const double MinimumSeconds = 0.5;
+    // Cell size of the grid that finds the original of a decoded vertex, larger than any error measured.
+    const int CellUnits = 64;
+
+    // Sizes of SpatialMappingUpdateHeader and SpatialMappingSurfaceEntry in NetworkPacketStructure.h,
+    // which needs the Windows headers.
+    const size_t UpdateHeaderBytes = 2 * sizeof(int);
+    const size_t SurfaceEntryBytes = 16 + sizeof(int) + 10 * sizeof(float);
+    // Refreshes in the simulated session, and how the surfaces change between two of them.
+    const int Refreshes = 60;
+    const int ChangedPerRefresh = 2;
+    const int RefreshesPerNewSurface = 10;
+    // Bandwidth the transfer time is estimated for, a busy WiFi network.
+    const double BitsPerSecond = 20e6;
+
+    struct Sample
+    {
+        const char* Name;
+        std::vector<CodecMesh> Meshes;
+    };
+
+    int ToUnits(double meters)
+    {
+        double units = std::floor(meters / MetersPerUnit + 0.5);
+        return (int)std::max(-32767.0, std::min(32767.0, units));
+    }
+
+    void AddVertex(CodecMesh& mesh, double x, double y, double z)
+    {
+        mesh.Positions.push_back((float)ToUnits(x));
+        mesh.Positions.push_back((float)ToUnits(y));
+        mesh.Positions.push_back((float)ToUnits(z));
+    }
+
+    // A width x height grid, triangulated row by row like the surface observer does.
+    void AddGridIndices(CodecMesh& mesh, int width, int height)
+    {
+        for (int y = 0; y + 1 < height; y++)
+        {
+            for (int x = 0; x + 1 < width; x++)
+            {
+                uint16_t a = (uint16_t)(y * width + x);
+                uint16_t b = (uint16_t)(a + 1);
+                uint16_t c = (uint16_t)(a + width);
+                uint16_t d = (uint16_t)(c + 1);
+
+                uint16_t triangles[] = { a, c, b, b, c, d };
+                mesh.Indices.insert(mesh.Indices.end(), triangles, triangles + 6);
+            }
+        }
+    }
+
+    // A wall with sensor noise and a few bumps, at spacing meters between vertices.
+    CodecMesh Wall(std::mt19937& random, double width, double height, double spacing)
+    {
+        std::normal_distribution<double> noise(0, 0.003);
+        CodecMesh mesh;
+
+        int columns = (int)(width / spacing) + 1;
+        int rows = (int)(height / spacing) + 1;
+        for (int y = 0; y < rows; y++)
+        {
+            for (int x = 0; x < columns; x++)
+            {
+                double u = x * spacing - width / 2;
+                double v = y * spacing - height / 2;
+                double bump = 0.05 * std::sin(u * 3) * std::cos(v * 2);
+                AddVertex(mesh, u, v, bump + noise(random));
+            }
+        }
+
+        AddGridIndices(mesh, columns, rows);
+        return mesh;
+    }
+
+    // A lumpy closed object, with its triangles in no particular order.
+    CodecMesh Object(std::mt19937& random, double radius, int rings, int segments)
+    {
+        const double pi = 3.14159265358979;
+        std::normal_distribution<double> noise(0, 0.003);
+        CodecMesh mesh;
+
+        for (int ring = 0; ring <= rings; ring++)
+        {
+            double theta = pi * ring / rings;
+            for (int segment = 0; segment <= segments; segment++)
+            {
+                double phi = 2 * pi * segment / segments;
+                double r = radius * (1 + 0.1 * std::sin(theta * 5) * std::sin(phi * 3)) + noise(random);
+                AddVertex(mesh, r * std::sin(theta) * std::cos(phi), r * std::cos(theta), r * std::sin(theta) * std::sin(phi));
+            }
+        }
+
+        AddGridIndices(mesh, segments + 1, rings + 1);
+
+        std::vector<size_t> triangles(mesh.Indices.size() / 3);
+        for (size_t i = 0; i < triangles.size(); i++)
+        {
+            triangles[i] = i;
+        }
+        std::shuffle(triangles.begin(), triangles.end(), random);
+
+        std::vector<uint16_t> shuffled;
+        shuffled.reserve(mesh.Indices.size());
+        for (size_t triangle : triangles)
+        {
+            shuffled.insert(shuffled.end(), &mesh.Indices[triangle * 3], &mesh.Indices[triangle * 3 + 3]);
+        }
+        mesh.Indices.swap(shuffled);
+        return mesh;
+    }
+
+    // Bytes SurfaceMesh::Serialize sends for the mesh: lengths, transform, float3 positions and the indices.
+    size_t LegacySize(const CodecMesh& mesh)
+    {
+        return 2 * sizeof(int) + 10 * sizeof(float) + mesh.Positions.size() * sizeof(float) + mesh.Indices.size() * sizeof(uint16_t);
+    }
+
+    // The codec renumbers vertices and reorders triangles, so every decoded vertex is matched
+    // with the closest original vertex. Vertices are centimeters apart, much more than the error.
+    class VertexMatcher
+    {
+    public:
+        VertexMatcher(const CodecMesh& mesh)
+            : positions(mesh.Positions)
+        {
+            for (uint32_t vertex = 0; vertex < positions.size() / 3; vertex++)
+            {
+                cells[Key(Cell(positions[vertex * 3]), Cell(positions[vertex * 3 + 1]), Cell(positions[vertex * 3 + 2]))].push_back(vertex);
+            }
+        }
+
+        // Distance from position to the closest original vertex.
+        double Distance(const float* position)
+        {
+            double closest = 1e30;
+            int x = Cell(position[0]);
+            int y = Cell(position[1]);
+            int z = Cell(position[2]);
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                for (int dy = -1; dy <= 1; dy++)
+                {
+                    for (int dz = -1; dz <= 1; dz++)
+                    {
+                        auto cell = cells.find(Key(x + dx, y + dy, z + dz));
+                        if (cell == cells.end())
+                        {
+                            continue;
+                        }
+
+                        for (uint32_t vertex : cell->second)
+                        {
+                            double squared = 0;
+                            for (int c = 0; c < 3; c++)
+                            {
+                                double difference = position[c] - positions[vertex * 3 + c];
+                                squared += difference * difference;
+                            }
+                            closest = std::min(closest, squared);
+                        }
+                    }
+                }
+            }
+
+            return std::sqrt(closest);
+        }
+
+    private:
+        const std::vector<float>& positions;
+        std::unordered_map<int64_t, std::vector<uint32_t>> cells;
+
+        static int Cell(float units)
+        {
+            return (int)std::floor(units / CellUnits);
+        }
+
+        static int64_t Key(int x, int y, int z)
+        {
+            return ((int64_t)(x & 0xFFFFF) << 40) | ((int64_t)(y & 0xFFFFF) << 20) | (int64_t)(z & 0xFFFFF);
+        }
+    };
+
+    struct RefreshTotals
+    {
+        size_t Bytes = 0;
+        double EncodeSeconds = 0;
+        double DecodeSeconds = 0;
+    };
+
+    double Seconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Encodes the surfaces the client needs and decodes them the way the compositor does.
+    void Refresh(const std::map<int, CodecMesh>& surfaces, const std::vector<int>& send, const MeshCodecOptions& options, RefreshTotals& totals)
+    {
+        std::vector<uint8_t> encoded;
+        auto start = std::chrono::steady_clock::now();
+        for (int id : send)
+        {
+            MeshCodec::Encode(surfaces.at(id), options, encoded);
+        }
+        totals.EncodeSeconds += Seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        size_t offset = 0;
+        for (size_t i = 0; i < send.size(); i++)
+        {
+            CodecMesh mesh;
+            MeshCodec::Decode(encoded.data(), encoded.size(), offset, mesh);
+        }
+        totals.DecodeSeconds += Seconds(start);
+
+        totals.Bytes += encoded.size();
+    }
+
+    void PrintRefreshes(const char* name, const RefreshTotals& totals)
+    {
+        double bytes = (double)totals.Bytes / Refreshes;
+        double encodeMs = totals.EncodeSeconds * 1000 / Refreshes;
+        double decodeMs = totals.DecodeSeconds * 1000 / Refreshes;
+        double transferMs = bytes * 8 / BitsPerSecond * 1000;
+        printf("    %-14s  %9.0f  %9.2f  %9.2f  %11.1f  %8.1f\n",
+            name, bytes, encodeMs, decodeMs, transferMs, encodeMs + transferMs + decodeMs);
+    }
+
+    // A room whose surfaces the observer keeps refining, a few at a time, while the user walks
+    // around and new surfaces come and old ones go. Every surface is sent once at the start.
+    void RunRefreshes(std::mt19937& random)
+    {
+        MeshCodecOptions options;
+        options.PositionBits = 12;
+
+        std::map<int, CodecMesh> surfaces;
+        int nextID = 0;
+        for (int i = 0; i < 24; i++)
+        {
+            surfaces[nextID++] = Wall(random, 1.0 + 0.1 * (i % 5), 1.0, 0.03);
+        }
+
+        RefreshTotals full;
+        RefreshTotals incremental;
+        size_t surfaceCount = 0;
+        for (int refresh = 0; refresh < Refreshes; refresh++)
+        {
+            std::vector<int> changed;
+            if (refresh == 0)
+            {
+                for (auto& surface : surfaces)
+                {
+                    changed.push_back(surface.first);
+                }
+            }
+            else
+            {
+                if (refresh % RefreshesPerNewSurface == 0)
+                {
+                    surfaces.erase(surfaces.begin());
+                    surfaces[nextID] = Wall(random, 1.2, 1.0, 0.03);
+                    changed.push_back(nextID++);
+                }
+
+                for (int i = 0; i < ChangedPerRefresh; i++)
+                {
+                    auto surface = surfaces.begin();
+                    std::advance(surface, random() % surfaces.size());
+                    surface->second = Wall(random, 1.0 + 0.1 * (surface->first % 5), 1.0, 0.03);
+                    changed.push_back(surface->first);
+                }
+
+                std::sort(changed.begin(), changed.end());
+                changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+            }
+
+            std::vector<int> all;
+            for (auto& surface : surfaces)
+            {
+                all.push_back(surface.first);
+            }
+
+            Refresh(surfaces, all, options, full);
+            Refresh(surfaces, changed, options, incremental);
+            incremental.Bytes += UpdateHeaderBytes + surfaces.size() * SurfaceEntryBytes;
+            surfaceCount += surfaces.size();
+        }
+
+        printf("Refreshes: %d, %zu surfaces on average, %d changed per refresh, a new one every %d, 12 bits\n",
+            Refreshes, surfaceCount / Refreshes, ChangedPerRefresh, RefreshesPerNewSurface);
+        printf("    per refresh         bytes  encode ms  decode ms  transfer ms  total ms   (transfer at %.0f Mbit/s)\n",
+            BitsPerSecond / 1e6);
+        PrintRefreshes("all surfaces", full);
+        PrintRefreshes("changed only", incremental);
+    }
+
+    template <typename Function>
+    double SecondsPerRun(Function function)
+    {
+        int runs = 0;
+        auto start = std::chrono::steady_clock::now();
+        double seconds = 0;
+        do
+        {
+            function();
+            runs++;
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (seconds < MinimumSeconds);
+
+        return seconds / runs;
+    }
+
+    void Run(const Sample& sample)
+    {
+        size_t legacyBytes = 0;
+        size_t vertices = 0;
+        size_t triangles = 0;
+        for (const CodecMesh& mesh : sample.Meshes)
+        {
+            legacyBytes += LegacySize(mesh);
+            vertices += mesh.Positions.size() / 3;
+            triangles += mesh.Indices.size() / 3;
+        }
+
+        printf("%s: %zu surfaces, %zu vertices, %zu triangles, %zu bytes in the legacy format\n",
+            sample.Name, sample.Meshes.size(), vertices, triangles, legacyBytes);
+        printf("    bits  entropy     bytes   ratio  encode MB/s  decode MB/s  max error mm  rms error mm\n");
+
+        for (int bits : { 16, 14, 12, 10 })
+        {
+            for (bool entropy : { false, true })
+            {
+                MeshCodecOptions options;
+                options.PositionBits = bits;
+                options.EntropyCoding = entropy;
+
+                std::vector<uint8_t> encoded;
+                double encodeSeconds = SecondsPerRun([&]()
+                {
+                    encoded.clear();
+                    for (const CodecMesh& mesh : sample.Meshes)
+                    {
+                        MeshCodec::Encode(mesh, options, encoded);
+                    }
+                });
+
+                std::vector<CodecMesh> decoded(sample.Meshes.size());
+                double decodeSeconds = SecondsPerRun([&]()
+                {
+                    size_t offset = 0;
+                    for (CodecMesh& mesh : decoded)
+                    {
+                        MeshCodec::Decode(encoded.data(), encoded.size(), offset, mesh);
+                    }
+                });
+
+                double maxError = 0;
+                double sumSquares = 0;
+                size_t decodedVertices = 0;
+                for (size_t m = 0; m < sample.Meshes.size(); m++)
+                {
+                    VertexMatcher matcher(sample.Meshes[m]);
+                    for (size_t vertex = 0; vertex < decoded[m].Positions.size() / 3; vertex++)
+                    {
+                        double error = matcher.Distance(&decoded[m].Positions[vertex * 3]);
+                        maxError = std::max(maxError, error);
+                        sumSquares += error * error;
+                        decodedVertices++;
+                    }
+                }
+
+                double toMillimeters = MetersPerUnit * 1000;
+                printf("    %4d  %7s  %8zu  %5.1fx  %11.0f  %11.0f  %12.4f  %12.4f\n",
+                    bits, entropy ? "yes" : "no", encoded.size(), (double)legacyBytes / encoded.size(),
+                    legacyBytes / encodeSeconds / 1e6, legacyBytes / decodeSeconds / 1e6,
+                    maxError * toMillimeters, std::sqrt(sumSquares / decodedVertices) * toMillimeters);
+            }
+        }
+
+        printf("\n");
+    }
+}
+
+int main()
+{
+    std::mt19937 random(42);
+
+    Sample wall = { "Wall, 2.5cm spacing", {} };
+    wall.Meshes.push_back(Wall(random, 3.0, 2.5, 0.025));
+
+    Sample object = { "Object, shuffled triangles", {} };
+    object.Meshes.push_back(Object(random, 0.5, 60, 80));
+
+    // The surface observer splits a room into many small surfaces, each sent with its own header.
+    Sample room = { "Room, 24 surfaces", {} };
+    for (int i = 0; i < 24; i++)
+    {
+        room.Meshes.push_back(Wall(random, 1.0 + 0.1 * (i % 5), 1.0, 0.03));
+    }
+
+    Run(wall);
+    Run(object);
+    Run(room);
+
+    RunRefreshes(random);
+    return 0;
+}
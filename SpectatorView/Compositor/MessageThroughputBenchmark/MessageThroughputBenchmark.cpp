@@ -0,0 +1,387 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Measures how fast poses and spatial mapping go through TCPSocket over loopback, with the fixed
+// size packets of protocol version 0 and with the framed messages of the later versions.
+// Poses are sent as SVPose packets and as framed messages. A mesh is sent as 60 byte
+// SpatialMappingPackets, as one framed message like version 1, and as SpatialMappingChunks like
+// version 2 and up, without waiting for acks. The receiver checks every pose and the mesh bytes.
+//
+// Only depends on standard C++ and the sockets, build it with:
+//     cl /EHsc /O2 /I..\SharedHeaders MessageThroughputBenchmark.cpp
+// or:
+//     g++ -std=c++14 -O2 -pthread -I../SharedHeaders MessageThroughputBenchmark.cpp
+//
+// Usage: MessageThroughputBenchmark [mesh MB]
+// Port DEFAULT_PORT on this machine has to be free.
+
+#include "../SharedHeaders/NetworkPacketStructure.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const char* ServerAddress = "127.0.0.1";
+    const int NumPoses = 200000;
+    // Legacy packets are slow, so they carry fewer poses and meshes.
+    const int NumLegacyPoses = 50000;
+    const int NumMeshes = 5;
+
+    // The pose provider listens and sends, the compositor connects and receives.
+    struct Connection
+    {
+        TCPSocket sender;
+        TCPSocket receiver;
+    };
+
+    bool Connect(Connection& connection)
+    {
+        std::thread accepting([&]()
+        {
+            connection.sender.CreateServerListener();
+            connection.sender.ServerEstablishConnection();
+        });
+
+        // Give the listener a moment, so the first connect does not fail.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        bool connected = false;
+        for (int attempt = 0; attempt < 50 && !connected; attempt++)
+        {
+            connected = connection.receiver.CreateClientListener(ServerAddress);
+            if (!connected)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
+        accepting.join();
+
+        if (!connected)
+        {
+            printf("Could not connect over TCP on port %d.\n", DEFAULT_PORT);
+        }
+        return connected;
+    }
+
+    // Runs send and receive on their own threads, seconds until the receiver is done, 0 on failure.
+    double Measure(std::function<bool(TCPSocket&)> send, std::function<bool(TCPSocket&)> receive)
+    {
+        Connection connection;
+        if (!Connect(connection))
+        {
+            return 0;
+        }
+
+        Clock::time_point start = Clock::now();
+        bool sent = false;
+        std::thread sending([&]() { sent = send(connection.sender); });
+        bool received = receive(connection.receiver);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        sending.join();
+
+        return (sent && received) ? seconds : 0;
+    }
+
+    SVPose MakePose(int i)
+    {
+        SVPose pose;
+        pose.sentTime = i;
+        pose.posX = (float)i;
+        return pose;
+    }
+
+    bool IsPose(const SVPose& pose, int i)
+    {
+        return pose.header == PacketType::Pose && pose.sentTime == i && pose.posX == (float)i;
+    }
+
+    bool SendPosePackets(TCPSocket& tcp)
+    {
+        for (int i = 0; i < NumLegacyPoses; i++)
+        {
+            SVPose pose = MakePose(i);
+            if (!tcp.SendData((byte*)&pose, sizeof(pose)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ReceivePosePackets(TCPSocket& tcp)
+    {
+        SVPose pose;
+        byte* bytes = (byte*)&pose;
+        for (int i = 0; i < NumLegacyPoses; i++)
+        {
+            if (!tcp.ReceiveData(bytes, sizeof(pose)) || !IsPose(pose, i))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SendPoseMessages(TCPSocket& tcp)
+    {
+        for (int i = 0; i < NumPoses; i++)
+        {
+            SVPose pose = MakePose(i);
+            if (!tcp.SendMessageBytes(PacketType::Pose, &pose, sizeof(pose)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ReceivePoseMessages(TCPSocket& tcp)
+    {
+        for (int i = 0; i < NumPoses; i++)
+        {
+            int type;
+            byte* payload;
+            int length;
+            SVPose pose;
+            if (!tcp.ReceiveMessage(type, payload, length) || type != PacketType::Pose || length != sizeof(pose))
+            {
+                return false;
+            }
+
+            memcpy(&pose, payload, sizeof(pose));
+            if (!IsPose(pose, i))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Version 0: SPATIAL_MAPPING_BUFSIZE bytes per packet, one send each.
+    bool SendMeshPackets(TCPSocket& tcp, const std::vector<byte>& mesh, int numMeshes)
+    {
+        int length = (int)mesh.size();
+        int numPackets = (length + SPATIAL_MAPPING_BUFSIZE - 1) / SPATIAL_MAPPING_BUFSIZE;
+        for (int m = 0; m < numMeshes; m++)
+        {
+            SpatialMappingPacket packet;
+            for (int i = 0; i < numPackets; i++)
+            {
+                packet.packetStartIndex = i * SPATIAL_MAPPING_BUFSIZE;
+                packet.bytesWrittenThisPacket = (length - packet.packetStartIndex < SPATIAL_MAPPING_BUFSIZE) ?
+                    length - packet.packetStartIndex : SPATIAL_MAPPING_BUFSIZE;
+                packet.totalSpatialMappingBytes = length;
+                packet.numSpatialMappingPackets = numPackets;
+                memcpy(packet.payload, &mesh[packet.packetStartIndex], packet.bytesWrittenThisPacket);
+
+                if (!tcp.SendData((byte*)&packet, sizeof(packet)))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool ReceiveMeshPackets(TCPSocket& tcp, const std::vector<byte>& mesh, int numMeshes)
+    {
+        std::vector<byte> received(mesh.size());
+        for (int m = 0; m < numMeshes; m++)
+        {
+            int receivedBytes = 0;
+            while (receivedBytes < (int)mesh.size())
+            {
+                SpatialMappingPacket packet;
+                byte* bytes = (byte*)&packet;
+                if (!tcp.ReceiveData(bytes, sizeof(packet)) ||
+                    packet.packetStartIndex < 0 ||
+                    packet.bytesWrittenThisPacket > SPATIAL_MAPPING_BUFSIZE ||
+                    packet.packetStartIndex + packet.bytesWrittenThisPacket > (int)received.size())
+                {
+                    return false;
+                }
+
+                memcpy(&received[packet.packetStartIndex], packet.payload, packet.bytesWrittenThisPacket);
+                receivedBytes += packet.bytesWrittenThisPacket;
+            }
+
+            if (received != mesh)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Version 1: the whole mesh in one message.
+    bool SendMeshMessages(TCPSocket& tcp, const std::vector<byte>& mesh)
+    {
+        for (int m = 0; m < NumMeshes; m++)
+        {
+            if (!tcp.SendMessageBytes(PacketType::SpatialMapping, mesh.data(), (int)mesh.size()))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ReceiveMeshMessages(TCPSocket& tcp, const std::vector<byte>& mesh)
+    {
+        for (int m = 0; m < NumMeshes; m++)
+        {
+            int type;
+            byte* payload;
+            int length;
+            if (!tcp.ReceiveMessage(type, payload, length) ||
+                type != PacketType::SpatialMapping ||
+                length != (int)mesh.size() ||
+                memcmp(payload, mesh.data(), mesh.size()) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Version 2 and up: SPATIAL_MAPPING_CHUNK_SIZE chunks gathered with their header.
+    bool SendMeshChunks(TCPSocket& tcp, const std::vector<byte>& mesh)
+    {
+        SpatialMappingChunkHeader header;
+        header.totalBytes = (int)mesh.size();
+        for (int m = 0; m < NumMeshes; m++)
+        {
+            header.transferID = m + 1;
+            for (int offset = 0; offset < header.totalBytes; offset += SPATIAL_MAPPING_CHUNK_SIZE)
+            {
+                int chunkLength = (header.totalBytes - offset < SPATIAL_MAPPING_CHUNK_SIZE) ?
+                    header.totalBytes - offset : SPATIAL_MAPPING_CHUNK_SIZE;
+                header.offset = offset;
+
+                TCPSocket::MessagePart parts[] =
+                {
+                    { &header, sizeof(header) },
+                    { &mesh[offset], chunkLength },
+                };
+
+                if (!tcp.SendMessageParts(PacketType::SpatialMappingChunk, parts, 2))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool ReceiveMeshChunks(TCPSocket& tcp, const std::vector<byte>& mesh)
+    {
+        std::vector<byte> received(mesh.size());
+        for (int m = 0; m < NumMeshes; m++)
+        {
+            int receivedBytes = 0;
+            while (receivedBytes < (int)mesh.size())
+            {
+                int type;
+                byte* payload;
+                int length;
+                SpatialMappingChunkHeader header;
+                if (!tcp.ReceiveMessage(type, payload, length) ||
+                    type != PacketType::SpatialMappingChunk ||
+                    length < (int)sizeof(header))
+                {
+                    return false;
+                }
+
+                memcpy(&header, payload, sizeof(header));
+                int chunkLength = length - (int)sizeof(header);
+                if (header.transferID != m + 1 || header.offset < 0 || header.offset + chunkLength > (int)received.size())
+                {
+                    return false;
+                }
+
+                memcpy(&received[header.offset], payload + sizeof(header), chunkLength);
+                receivedBytes += chunkLength;
+            }
+
+            if (received != mesh)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void PrintRate(const char* name, double seconds, double items, const char* unit, double bytes)
+    {
+        if (seconds == 0)
+        {
+            printf("    %-40s FAILED\n", name);
+            return;
+        }
+
+        printf("    %-40s %12.0f %-9s %10.1f MB/s\n", name, items / seconds, unit, bytes / seconds / (1024 * 1024));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int meshMB = argc > 1 ? atoi(argv[1]) : 4;
+    if (meshMB <= 0 || meshMB > MAX_MESSAGE_LENGTH / (1024 * 1024))
+    {
+        fprintf(stderr, "Usage: MessageThroughputBenchmark [mesh MB, at most %d]\n", MAX_MESSAGE_LENGTH / (1024 * 1024));
+        return 1;
+    }
+
+    WSASession session;
+    (void)session;
+
+    // Bytes that do not repeat on the packet or chunk size, so a misplaced piece shows up.
+    std::vector<byte> mesh((size_t)meshMB * 1024 * 1024);
+    for (size_t i = 0; i < mesh.size(); i++)
+    {
+        mesh[i] = (byte)(i * 7 + i / 251);
+    }
+
+    // Legacy packets move a fraction of a mesh in the time the others move several.
+    std::vector<byte> legacyMesh(mesh.begin(), mesh.begin() + mesh.size() / 4);
+    const int numLegacyMeshes = 1;
+
+    printf("Loopback, %d MB meshes:\n", meshMB);
+
+    double posePackets = Measure(SendPosePackets, ReceivePosePackets);
+    PrintRate("poses, SVPose packets", posePackets, NumLegacyPoses, "poses/s", (double)NumLegacyPoses * sizeof(SVPose));
+
+    double poseMessages = Measure(SendPoseMessages, ReceivePoseMessages);
+    PrintRate("poses, framed messages", poseMessages, NumPoses, "poses/s", (double)NumPoses * sizeof(SVPose));
+
+    double meshPackets = Measure(
+        [&](TCPSocket& tcp) { return SendMeshPackets(tcp, legacyMesh, numLegacyMeshes); },
+        [&](TCPSocket& tcp) { return ReceiveMeshPackets(tcp, legacyMesh, numLegacyMeshes); });
+    PrintRate("spatial mapping, 60 byte packets", meshPackets, numLegacyMeshes, "meshes/s", (double)numLegacyMeshes * legacyMesh.size());
+
+    double meshMessages = Measure(
+        [&](TCPSocket& tcp) { return SendMeshMessages(tcp, mesh); },
+        [&](TCPSocket& tcp) { return ReceiveMeshMessages(tcp, mesh); });
+    PrintRate("spatial mapping, one message", meshMessages, NumMeshes, "meshes/s", (double)NumMeshes * mesh.size());
+
+    double meshChunks = Measure(
+        [&](TCPSocket& tcp) { return SendMeshChunks(tcp, mesh); },
+        [&](TCPSocket& tcp) { return ReceiveMeshChunks(tcp, mesh); });
+    PrintRate("spatial mapping, 16KB chunks", meshChunks, NumMeshes, "meshes/s", (double)NumMeshes * mesh.size());
+
+    if (posePackets == 0 || poseMessages == 0 || meshPackets == 0 || meshMessages == 0 || meshChunks == 0)
+    {
+        printf("\nA transfer failed or arrived with the wrong bytes.\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,271 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Measures the photo encodings PhotoCapture can pick from, on a generated frame of camera noise
+// with holograms on top.
+// Each setting encodes the frame to memory a number of times on one thread, then a burst of photos
+// on as many threads as the CPU has, the way PhotoCapture hands them to its task group. PNG photos
+// are decoded again and have to match the frame exactly.
+//
+// Only depends on Windows and WIC, build it with:
+//     cl /EHsc /O2 PhotoEncoderBenchmark.cpp ..\CompositorDLL\PhotoEncoder.cpp ole32.lib windowscodecs.lib
+//
+// Usage: PhotoEncoderBenchmark [width height]
+
+#define NOMINMAX
+#include "../CompositorDLL/PhotoEncoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Encodes per setting on one thread, and photos in a burst.
+    const int Runs = 5;
+    const int BurstPhotos = 8;
+
+    struct Setting
+    {
+        const char* Name;
+        PhotoEncoder::Settings Encoder;
+        bool Lossless;
+    };
+
+    std::vector<Setting> Settings()
+    {
+        std::vector<Setting> settings;
+
+        Setting png = { "PNG, adaptive filters", PhotoEncoder::Settings(), true };
+        png.Encoder.PngFilter = WICPngFilterAdaptive;
+        settings.push_back(png);
+
+        png.Name = "PNG, no filters";
+        png.Encoder.PngFilter = WICPngFilterNone;
+        settings.push_back(png);
+
+        Setting jpeg = { "JPEG, quality 0.9", PhotoEncoder::Settings(), false };
+        jpeg.Encoder.PhotoFormat = PhotoEncoder::Format::JPEG;
+        jpeg.Encoder.JpegQuality = 0.9f;
+        settings.push_back(jpeg);
+
+        jpeg.Name = "JPEG, quality 0.75";
+        jpeg.Encoder.JpegQuality = 0.75f;
+        settings.push_back(jpeg);
+
+        return settings;
+    }
+
+    // BGRA frame: a noisy gradient like a camera image, with flat colored boxes like holograms.
+    std::vector<BYTE> GenerateFrame(int width, int height)
+    {
+        std::mt19937 random(12345);
+        std::uniform_int_distribution<int> noise(-6, 6);
+
+        std::vector<BYTE> pixels(width * height * 4);
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                BYTE* pixel = &pixels[(y * width + x) * 4];
+                int base = 40 + 140 * x / width;
+                pixel[0] = (BYTE)std::min(std::max(base + 30 * y / height + noise(random), 0), 255);
+                pixel[1] = (BYTE)std::min(std::max(base + noise(random), 0), 255);
+                pixel[2] = (BYTE)std::min(std::max(base + 20 + noise(random), 0), 255);
+                pixel[3] = 255;
+
+                bool hologram = ((x / (width / 8)) + (y / (height / 6))) % 5 == 0;
+                if (hologram)
+                {
+                    pixel[0] = 230;
+                    pixel[1] = (BYTE)(120 + 100 * y / height);
+                    pixel[2] = 40;
+                }
+            }
+        }
+        return pixels;
+    }
+
+    IStream* CreateMemoryStream()
+    {
+        IStream* stream = nullptr;
+        return SUCCEEDED(CreateStreamOnHGlobal(nullptr, TRUE, &stream)) ? stream : nullptr;
+    }
+
+    ULONGLONG StreamSize(IStream* stream)
+    {
+        STATSTG stat = {};
+        return SUCCEEDED(stream->Stat(&stat, STATFLAG_NONAME)) ? stat.cbSize.QuadPart : 0;
+    }
+
+    // True if the photo in the stream decodes to the frame, without alpha.
+    bool DecodesTo(IStream* stream, const std::vector<BYTE>& pixels, UINT width, UINT height)
+    {
+        IWICImagingFactory* factory = nullptr;
+        IWICBitmapDecoder* decoder = nullptr;
+        IWICBitmapFrameDecode* frame = nullptr;
+        IWICFormatConverter* converter = nullptr;
+
+        std::vector<BYTE> decoded(width * height * 4);
+        LARGE_INTEGER start = {};
+
+        HRESULT hr = stream->Seek(start, STREAM_SEEK_SET, nullptr);
+        if (SUCCEEDED(hr)) { hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory)); }
+        if (SUCCEEDED(hr)) { hr = factory->CreateDecoderFromStream(stream, nullptr, WICDecodeMetadataCacheOnDemand, &decoder); }
+        if (SUCCEEDED(hr)) { hr = decoder->GetFrame(0, &frame); }
+        if (SUCCEEDED(hr)) { hr = factory->CreateFormatConverter(&converter); }
+        if (SUCCEEDED(hr)) { hr = converter->Initialize(frame, GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeCustom); }
+        if (SUCCEEDED(hr)) { hr = converter->CopyPixels(nullptr, width * 4, (UINT)decoded.size(), decoded.data()); }
+
+        if (converter != nullptr) { converter->Release(); }
+        if (frame != nullptr) { frame->Release(); }
+        if (decoder != nullptr) { decoder->Release(); }
+        if (factory != nullptr) { factory->Release(); }
+
+        if (FAILED(hr))
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < pixels.size(); i += 4)
+        {
+            if (decoded[i] != pixels[i] || decoded[i + 1] != pixels[i + 1] || decoded[i + 2] != pixels[i + 2])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Milliseconds per photo on one thread, 0 if encoding failed.
+    double EncodeSerial(const Setting& setting, const std::vector<BYTE>& pixels, UINT width, UINT height, ULONGLONG& bytes, bool& exact)
+    {
+        double totalMS = 0;
+        for (int i = 0; i < Runs; i++)
+        {
+            IStream* stream = CreateMemoryStream();
+            if (stream == nullptr)
+            {
+                return 0;
+            }
+
+            Clock::time_point start = Clock::now();
+            HRESULT hr = PhotoEncoder::Encode(pixels.data(), width, height, setting.Encoder, stream);
+            totalMS += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            bytes = StreamSize(stream);
+            if (i == 0)
+            {
+                exact = SUCCEEDED(hr) && (!setting.Lossless || DecodesTo(stream, pixels, width, height));
+            }
+
+            stream->Release();
+            if (FAILED(hr))
+            {
+                return 0;
+            }
+        }
+        return totalMS / Runs;
+    }
+
+    // Photos per second for a burst spread over the threads.
+    double EncodeBurst(const Setting& setting, const std::vector<BYTE>& pixels, UINT width, UINT height, unsigned threads)
+    {
+        std::atomic<int> next{ 0 };
+        std::atomic<int> failed{ 0 };
+
+        Clock::time_point start = Clock::now();
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads; i++)
+        {
+            workers.emplace_back([&]()
+            {
+                // WIC needs COM on the worker thread.
+                HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+                while (next++ < BurstPhotos)
+                {
+                    IStream* stream = CreateMemoryStream();
+                    if (stream == nullptr || FAILED(PhotoEncoder::Encode(pixels.data(), width, height, setting.Encoder, stream)))
+                    {
+                        failed++;
+                    }
+
+                    if (stream != nullptr)
+                    {
+                        stream->Release();
+                    }
+                }
+
+                if (SUCCEEDED(hrCom))
+                {
+                    CoUninitialize();
+                }
+            });
+        }
+
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return (failed > 0) ? 0 : BurstPhotos / seconds;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UINT width = argc > 2 ? (UINT)atoi(argv[1]) : 1920;
+    UINT height = argc > 2 ? (UINT)atoi(argv[2]) : 1080;
+    if (width < 8 || height < 6)
+    {
+        fprintf(stderr, "Usage: PhotoEncoderBenchmark [width height]\n");
+        return 1;
+    }
+
+    HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    if (FAILED(hrCom))
+    {
+        fprintf(stderr, "Could not initialize COM.\n");
+        return 1;
+    }
+
+    std::vector<BYTE> pixels = GenerateFrame((int)width, (int)height);
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    printf("%ux%u frame, %d encodes on one thread, bursts of %d photos on %u threads:\n", width, height, Runs, BurstPhotos, threads);
+    printf("    %-24s %9s %9s %12s %12s %10s\n", "", "ms", "KB", "photos/s", "burst /s", "lossless");
+
+    bool passed = true;
+    for (const Setting& setting : Settings())
+    {
+        ULONGLONG bytes = 0;
+        bool exact = false;
+        double ms = EncodeSerial(setting, pixels, width, height, bytes, exact);
+        double burst = (ms > 0) ? EncodeBurst(setting, pixels, width, height, threads) : 0;
+
+        if (ms == 0 || burst == 0)
+        {
+            printf("    %-24s FAILED to encode\n", setting.Name);
+            passed = false;
+            continue;
+        }
+
+        printf("    %-24s %9.1f %9.0f %12.1f %12.1f %10s\n",
+            setting.Name, ms, bytes / 1024.0, 1000 / ms, burst,
+            setting.Lossless ? (exact ? "exact" : "DIFFERENT") : "-");
+        passed &= exact;
+    }
+
+    CoUninitialize();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,366 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Checks PoseCache against the sorted vector it replaced and measures both, at pose rates from 60 to 1000 Hz.
+// Poses of generated camera motion are added one at a time, and after every pose both caches are
+// asked for times between the poses, on them, before the oldest and past the newest. The position,
+// rotation and selected index have to be the same bit for bit; prediction is off, which is what the
+// vector did past the newest pose.
+// Then a writer thread adds poses while a reader thread looks them up and resets the cache now and
+// then, and the reader checks every pose it gets against the motion.
+//
+// Only depends on standard C++ and DirectXMath, build it with:
+//     cl /EHsc /O2 /I..\SharedHeaders PoseCacheBenchmark.cpp
+//
+// Usage: PoseCacheBenchmark [seconds of concurrent test]
+
+#include <Windows.h>
+
+#include "../CompositorDLL/PoseCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const float PoseRates[] = { 60, 120, 250, 500, 1000 };
+
+    // Poses added per rate for the exactness check and the benchmark.
+    const int CheckPoses = 2000;
+    const int BenchmarkPoses = 200000;
+
+    // The render thread looks a pose up about this far behind the newest one.
+    const float LookupDelay = 0.05f;
+
+    // PoseCache before the ring: a vector sorted from newest to oldest.
+    class VectorPoseCache
+    {
+    public:
+        VectorPoseCache()
+        {
+            poses.reserve(MAX_NUM_POSES + 1);
+        }
+
+        int LastSelectedIndex = 0;
+
+        bool AddPose(XMFLOAT3 position, XMFLOAT4 rotation, float timeStamp)
+        {
+            // Already have this pose.
+            if (poses.size() > 0 && poses[0].TimeStamp == timeStamp)
+            {
+                return false;
+            }
+
+            // Find index to insert at.
+            size_t i = 0;
+            while (i < poses.size() && poses[i].TimeStamp > timeStamp)
+            {
+                i++;
+            }
+
+            poses.insert(poses.begin() + i, PoseData(position, rotation, timeStamp, lastPoseIndex++));
+
+            // Remove oldest.
+            if (poses.size() >= MAX_NUM_POSES)
+            {
+                poses.erase(poses.begin() + MAX_NUM_POSES - 1);
+            }
+            return true;
+        }
+
+        bool GetPose(XMFLOAT3& position, XMFLOAT4& rotation, float poseTime)
+        {
+            if (poses.size() == 0)
+            {
+                position = XMFLOAT3(0, 0, 0);
+                rotation = XMFLOAT4(0, 0, 0, 1);
+                return false;
+            }
+
+            //Find index for time
+            LastSelectedIndex = 0;
+            while (LastSelectedIndex < (int)poses.size())
+            {
+                if (poses[LastSelectedIndex].TimeStamp < poseTime)
+                {
+                    break;
+                }
+
+                LastSelectedIndex++;
+            }
+
+            if (LastSelectedIndex == 0)
+            {
+                position = poses[0].Position;
+                rotation = poses[0].Rotation;
+            }
+            else if (LastSelectedIndex == (int)poses.size())
+            {
+                position = poses[poses.size() - 1].Position;
+                rotation = poses[poses.size() - 1].Rotation;
+            }
+            else
+            {
+                //Lerp between 2 poses
+                PoseData next = poses[LastSelectedIndex];
+                PoseData prev = poses[LastSelectedIndex - 1];
+
+                float lerpVal = (poseTime - prev.TimeStamp) / (next.TimeStamp - prev.TimeStamp);
+                if (lerpVal > 1) { lerpVal = 1; }
+                if (lerpVal < 0) { lerpVal = 0; }
+
+                XMStoreFloat3(&position,
+                    XMVectorLerp(XMLoadFloat3(&prev.Position), XMLoadFloat3(&next.Position), lerpVal)
+                );
+
+                XMStoreFloat4(&rotation,
+                    XMQuaternionSlerp(XMLoadFloat4(&prev.Rotation), XMLoadFloat4(&next.Rotation), lerpVal)
+                );
+            }
+
+            return true;
+        }
+
+    private:
+        int lastPoseIndex = 0;
+        std::vector<PoseData> poses;
+    };
+
+    struct Pose
+    {
+        XMFLOAT3 Position;
+        XMFLOAT4 Rotation;
+        float Time;
+    };
+
+    // Camera walking around and turning its head, with a little jitter on the pose times.
+    std::vector<Pose> GenerateMotion(float rate, int count, std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+
+        std::vector<Pose> poses;
+        for (int i = 0; i < count; i++)
+        {
+            float t = (i + jitter(random)) / rate;
+            float yaw = 0.8f * std::sin(0.7f * t);
+            float pitch = 0.2f * std::sin(1.3f * t);
+
+            Pose pose;
+            pose.Time = t;
+            pose.Position = XMFLOAT3(std::sin(0.3f * t), 1.6f + 0.02f * std::sin(9 * t), std::cos(0.4f * t));
+            pose.Rotation = XMFLOAT4(std::sin(pitch / 2) * std::cos(yaw / 2), std::cos(pitch / 2) * std::sin(yaw / 2),
+                -std::sin(pitch / 2) * std::sin(yaw / 2), std::cos(pitch / 2) * std::cos(yaw / 2));
+            poses.push_back(pose);
+        }
+        return poses;
+    }
+
+    bool Same(const XMFLOAT3& a, const XMFLOAT3& b) { return memcmp(&a, &b, sizeof(a)) == 0; }
+    bool Same(const XMFLOAT4& a, const XMFLOAT4& b) { return memcmp(&a, &b, sizeof(a)) == 0; }
+
+    // Number of lookups that differ from the vector.
+    int CheckExact(float rate, std::mt19937& random)
+    {
+        std::vector<Pose> motion = GenerateMotion(rate, CheckPoses, random);
+
+        VectorPoseCache reference;
+        PoseCache ring;
+        ring.SetPrediction(PosePredictor::Mode::None, 0, 0);
+
+        std::uniform_real_distribution<float> unit(0, 1);
+
+        int lookups = 0;
+        int mismatches = 0;
+        for (size_t i = 0; i < motion.size(); i++)
+        {
+            const Pose& pose = motion[i];
+            bool addedReference = reference.AddPose(pose.Position, pose.Rotation, pose.Time);
+            bool addedRing = ring.AddPose(pose.Position, pose.Rotation, pose.Time);
+            if (addedReference != addedRing)
+            {
+                mismatches++;
+            }
+
+            // Both keep MAX_NUM_POSES - 1 poses.
+            size_t oldest = i >= MAX_NUM_POSES - 2 ? i - (MAX_NUM_POSES - 2) : 0;
+            float span = pose.Time - motion[oldest].Time;
+
+            std::vector<float> times =
+            {
+                pose.Time,
+                motion[oldest].Time,
+                motion[oldest].Time - 0.01f,
+                pose.Time + 0.01f,
+                pose.Time - LookupDelay,
+                motion[oldest + (i - oldest) / 2].Time,
+            };
+            for (int j = 0; j < 8; j++)
+            {
+                times.push_back(motion[oldest].Time + unit(random) * span);
+            }
+
+            for (float time : times)
+            {
+                XMFLOAT3 referencePosition, ringPosition;
+                XMFLOAT4 referenceRotation, ringRotation;
+                PoseLookup lookup;
+
+                reference.GetPose(referencePosition, referenceRotation, time);
+                ring.GetPose(ringPosition, ringRotation, time, &lookup);
+                lookups++;
+
+                if (!Same(referencePosition, ringPosition) || !Same(referenceRotation, ringRotation) ||
+                    reference.LastSelectedIndex != lookup.SelectedIndex)
+                {
+                    mismatches++;
+                }
+            }
+        }
+
+        printf("    %6.0f Hz: %d lookups, %d different\n", rate, lookups, mismatches);
+        return mismatches;
+    }
+
+    template <typename Cache>
+    void Measure(const std::vector<Pose>& motion, double& addNS, double& lookupNS)
+    {
+        Cache cache;
+
+        XMFLOAT3 position;
+        XMFLOAT4 rotation;
+        float sink = 0;
+
+        Clock::duration addTime(0);
+        Clock::duration lookupTime(0);
+        for (size_t i = 0; i < motion.size(); i += 64)
+        {
+            size_t end = std::min(i + 64, motion.size());
+
+            Clock::time_point start = Clock::now();
+            for (size_t j = i; j < end; j++)
+            {
+                cache.AddPose(motion[j].Position, motion[j].Rotation, motion[j].Time);
+            }
+            Clock::time_point middle = Clock::now();
+            for (size_t j = i; j < end; j++)
+            {
+                cache.GetPose(position, rotation, motion[j].Time - LookupDelay);
+                sink += position.x;
+            }
+            Clock::time_point stop = Clock::now();
+
+            addTime += middle - start;
+            lookupTime += stop - middle;
+        }
+
+        addNS = std::chrono::duration<double, std::nano>(addTime).count() / motion.size();
+        lookupNS = std::chrono::duration<double, std::nano>(lookupTime).count() / motion.size() + (sink == 12345 ? 1 : 0);
+    }
+
+    // Writer adds poses of straight line motion, x equal to the time, while the reader looks them up and resets.
+    bool CheckConcurrent(double seconds)
+    {
+        PoseCache cache;
+        cache.SetPrediction(PosePredictor::Mode::None, 0, 0);
+
+        std::atomic<bool> done{ false };
+        std::atomic<float> newest{ 0 };
+
+        std::thread writer([&]()
+        {
+            float time = 0;
+            while (!done.load(std::memory_order_relaxed))
+            {
+                time += 0.001f;
+                cache.AddPose(XMFLOAT3(time, 2 * time, 0), XMFLOAT4(0, 0, 0, 1), time);
+                newest.store(time, std::memory_order_relaxed);
+            }
+        });
+
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> behind(0, 0.08f);
+
+        long long lookups = 0;
+        long long resets = 0;
+        long long wrong = 0;
+
+        Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+        while (Clock::now() < end)
+        {
+            float time = newest.load(std::memory_order_relaxed) - behind(random);
+
+            XMFLOAT3 position;
+            XMFLOAT4 rotation;
+            PoseLookup lookup;
+            if (cache.GetPose(position, rotation, time, &lookup))
+            {
+                // Any pose the reader can get lies on the line, blended or not.
+                if (std::fabs(position.y - 2 * position.x) > 1e-3f || std::fabs(rotation.w - 1) > 1e-5f ||
+                    lookup.SelectedIndex < 0 || lookup.SelectedIndex > MAX_NUM_POSES)
+                {
+                    wrong++;
+                }
+            }
+            lookups++;
+
+            PoseData latest;
+            if (cache.GetLatestPose(latest) && (latest.Position.x != latest.TimeStamp || latest.Position.y != 2 * latest.TimeStamp))
+            {
+                wrong++;
+            }
+
+            if (lookups % 1000 == 0)
+            {
+                cache.Reset();
+                resets++;
+            }
+        }
+
+        done = true;
+        writer.join();
+
+        printf("    %lld lookups and %lld resets during %.1f s of adding poses, %lld wrong\n", lookups, resets, seconds, wrong);
+        return wrong == 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+
+    std::mt19937 random(12345);
+    bool passed = true;
+
+    printf("Lookups compared with the sorted vector, bit for bit:\n");
+    for (float rate : PoseRates)
+    {
+        passed &= CheckExact(rate, random) == 0;
+    }
+
+    printf("\nTime per pose added and per lookup %.0f ms behind the newest pose:\n", LookupDelay * 1000);
+    printf("    %9s %12s %12s %12s %12s\n", "", "vector add", "ring add", "vector get", "ring get");
+    for (float rate : PoseRates)
+    {
+        std::vector<Pose> motion = GenerateMotion(rate, BenchmarkPoses, random);
+
+        double vectorAdd, vectorGet, ringAdd, ringGet;
+        Measure<VectorPoseCache>(motion, vectorAdd, vectorGet);
+        Measure<PoseCache>(motion, ringAdd, ringGet);
+
+        printf("    %6.0f Hz %9.0f ns %9.0f ns %9.0f ns %9.0f ns\n", rate, vectorAdd, ringAdd, vectorGet, ringGet);
+    }
+
+    printf("\nConcurrent writer, reader and resets:\n");
+    passed &= CheckConcurrent(seconds);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,527 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Compares poses over TCP with the UDP pose channel on a link that loses and reorders packets.
+// The poses go over loopback through a relay that drops and holds them back like the link would.
+// Over UDP the relay forwards every datagram on its own to a PoseChannelReceiver. Over TCP it
+// delivers them in order, so a lost segment holds back every pose after it until its retransmit.
+//
+// Reports the latency of the poses that are used, how old the newest pose is when a 60Hz
+// compositor frame looks for it, and how many poses were lost or dropped for being stale.
+//
+// Only depends on standard C++ and the sockets, build it with:
+//     cl /EHsc /O2 /I..\SharedHeaders PoseChannelBenchmark.cpp
+//
+// Usage: PoseChannelBenchmark
+// Port DEFAULT_PORT on this machine has to be free.
+
+#include "../SharedHeaders/PoseChannel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const char* ServerAddress = "127.0.0.1";
+    const int PoseRate = 60;
+    // Camera frames, on a clock of their own.
+    const double FrameRate = 59.94;
+    const int RunSeconds = 10;
+
+    // One way delay of the link, and jitter on top of it.
+    const double LinkDelayMS = 2;
+    const double LinkJitterMS = 2;
+    // How much later a reordered packet arrives.
+    const double ReorderMinMS = 5;
+    const double ReorderMaxMS = 20;
+    // Minimum retransmit timeout of Windows and Linux TCP.
+    const double RetransmitTimeoutMS = 200;
+    // Duplicate acks that make TCP retransmit before the timeout.
+    const int FastRetransmitAcks = 3;
+
+    // Same layout as SVPose in NetworkPacketStructure.h, which needs the Windows headers.
+    struct Pose
+    {
+        int header = 0;
+        int64_t sentTime;   // hns
+        float rotation[4];
+        float position[3];
+    };
+
+    Clock::time_point Start = Clock::now();
+
+    double NowMS()
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+    }
+
+    int64_t NowHNS()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - Start).count() / 100;
+    }
+
+    struct LinkConditions
+    {
+        const char* Name;
+        double Loss;
+        double Reorder;
+    };
+
+    // Decides when a packet sent now arrives.
+    class LossyLink
+    {
+    public:
+        LossyLink(const LinkConditions& conditions, unsigned int seed)
+            : conditions(conditions)
+            , random(seed)
+        {
+        }
+
+        // Delay of a datagram in ms, < 0 when it is lost.
+        double DatagramDelay()
+        {
+            if (Chance(conditions.Loss))
+            {
+                return -1;
+            }
+            return Delay();
+        }
+
+        // Delay of a TCP segment in ms until it arrives, retransmits included.
+        // The following poses make the receiver send the duplicate acks of a fast retransmit.
+        double SegmentDelay()
+        {
+            double delay = 0;
+            double retransmit = FastRetransmitAcks * 1000.0 / PoseRate + 2 * LinkDelayMS;
+            while (Chance(conditions.Loss))
+            {
+                delay += retransmit;
+                // A retransmit that is lost again waits for the timeout.
+                retransmit = RetransmitTimeoutMS;
+            }
+            return delay + Delay();
+        }
+
+    private:
+        LinkConditions conditions;
+        std::mt19937 random;
+
+        bool Chance(double probability)
+        {
+            return std::uniform_real_distribution<double>(0, 1)(random) < probability;
+        }
+
+        double Delay()
+        {
+            double delay = LinkDelayMS + std::uniform_real_distribution<double>(0, LinkJitterMS)(random);
+            if (Chance(conditions.Reorder))
+            {
+                delay += std::uniform_real_distribution<double>(ReorderMinMS, ReorderMaxMS)(random);
+            }
+            return delay;
+        }
+    };
+
+    // Runs actions at the time they are due, on its own thread.
+    class DelayQueue
+    {
+    public:
+        DelayQueue()
+            : thread(&DelayQueue::Run, this)
+        {
+        }
+
+        ~DelayQueue()
+        {
+            {
+                std::lock_guard<std::mutex> lock(queueLock);
+                stopping = true;
+            }
+            changed.notify_all();
+            thread.join();
+        }
+
+        void Push(double timeMS, std::function<void()> action)
+        {
+            {
+                std::lock_guard<std::mutex> lock(queueLock);
+                queue.push({ timeMS, order++, action });
+            }
+            changed.notify_all();
+        }
+
+    private:
+        struct Entry
+        {
+            double TimeMS;
+            int Order;
+            std::function<void()> Action;
+
+            bool operator<(const Entry& other) const
+            {
+                // Earliest first, and in the order pushed at the same time.
+                return (TimeMS != other.TimeMS) ? TimeMS > other.TimeMS : Order > other.Order;
+            }
+        };
+
+        std::mutex queueLock;
+        std::condition_variable changed;
+        std::priority_queue<Entry> queue;
+        int order = 0;
+        bool stopping = false;
+        std::thread thread;
+
+        void Run()
+        {
+            std::unique_lock<std::mutex> lock(queueLock);
+            while (!stopping || !queue.empty())
+            {
+                if (queue.empty())
+                {
+                    changed.wait(lock);
+                    continue;
+                }
+
+                double wait = queue.top().TimeMS - NowMS();
+                if (wait > 0)
+                {
+                    changed.wait_for(lock, std::chrono::duration<double, std::milli>(wait));
+                    continue;
+                }
+
+                Entry entry = queue.top();
+                queue.pop();
+                lock.unlock();
+                entry.Action();
+                lock.lock();
+            }
+        }
+    };
+
+    // What the compositor has of the poses, written by one thread at a time.
+    class PoseConsumer
+    {
+    public:
+        void Received(const Pose& pose)
+        {
+            latencyMS.push_back((NowHNS() - pose.sentTime) / 10000.0);
+            if (pose.sentTime > newestSent)
+            {
+                newestSent = pose.sentTime;
+            }
+        }
+
+        // Age of the newest pose at every compositor frame, until stopping is set.
+        void SampleFrames(const std::atomic<bool>& stopping)
+        {
+            Clock::time_point frame = Clock::now();
+            while (!stopping)
+            {
+                int64_t newest = newestSent;
+                if (newest >= 0)
+                {
+                    freshnessMS.push_back((NowHNS() - newest) / 10000.0);
+                }
+
+                frame += std::chrono::microseconds((int)(1000000 / FrameRate));
+                std::this_thread::sleep_until(frame);
+            }
+        }
+
+        std::vector<double> latencyMS;
+        std::vector<double> freshnessMS;
+
+    private:
+        std::atomic<int64_t> newestSent { -1 };
+    };
+
+    struct Result
+    {
+        std::vector<double> LatencyMS;
+        std::vector<double> FreshnessMS;
+        int Sent = 0;
+        int Used = 0;
+        int Stale = 0;
+        int Lost = 0;
+    };
+
+    // Sends a pose every 1 / PoseRate seconds for RunSeconds through send.
+    int SendPoses(std::function<bool(const Pose&)> send)
+    {
+        int sent = 0;
+        Clock::time_point next = Clock::now();
+        Clock::time_point end = next + std::chrono::seconds(RunSeconds);
+        while (next < end)
+        {
+            Pose pose;
+            pose.sentTime = NowHNS();
+            pose.position[0] = (float)sent;
+            send(pose);
+            sent++;
+
+            next += std::chrono::microseconds(1000000 / PoseRate);
+            std::this_thread::sleep_until(next);
+        }
+
+        return sent;
+    }
+
+    bool MeasureUDP(const LinkConditions& conditions, unsigned int seed, Result& result)
+    {
+        PoseChannelReceiver receiver;
+        int receiverPort = receiver.Open();
+
+        UDPSocket relay;
+        int relayPort = relay.Bind(0);
+        if (receiverPort == 0 || relayPort == 0)
+        {
+            printf("Could not bind UDP ports.\n");
+            return false;
+        }
+
+        sockaddr_in receiverAddress = {};
+        receiverAddress.sin_family = AF_INET;
+        receiverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        receiverAddress.sin_port = htons((uint16_t)receiverPort);
+
+        sockaddr_storage relayAddress = {};
+        ((sockaddr_in*)&relayAddress)->sin_family = AF_INET;
+        ((sockaddr_in*)&relayAddress)->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        PoseChannelSender sender;
+        if (!sender.Open(relayAddress, sizeof(sockaddr_in), relayPort, receiver.Listen()))
+        {
+            printf("Could not open the pose channel.\n");
+            return false;
+        }
+
+        PoseConsumer consumer;
+        std::atomic<bool> stopping { false };
+        std::atomic<bool> sent { false };
+
+        std::thread receiving([&]()
+        {
+            Pose pose;
+            while (!stopping)
+            {
+                if (receiver.Receive(&pose, sizeof(pose), 50))
+                {
+                    consumer.Received(pose);
+                }
+            }
+        });
+
+        std::thread sampling([&]() { consumer.SampleFrames(sent); });
+
+        {
+            DelayQueue queue;
+            std::thread relaying([&]()
+            {
+                LossyLink link(conditions, seed);
+                byte datagram[sizeof(PoseDatagramHeader) + MAX_POSE_DATAGRAM_PAYLOAD];
+                while (!stopping)
+                {
+                    int length = relay.Receive(datagram, sizeof(datagram), 50);
+                    if (length <= 0)
+                    {
+                        continue;
+                    }
+
+                    double delay = link.DatagramDelay();
+                    if (delay < 0)
+                    {
+                        continue;
+                    }
+
+                    std::vector<byte> bytes(datagram, datagram + length);
+                    queue.Push(NowMS() + delay, [&relay, bytes, receiverAddress]()
+                    {
+                        relay.SendTo(bytes.data(), (int)bytes.size(), (sockaddr*)&receiverAddress, sizeof(receiverAddress));
+                    });
+                }
+            });
+
+            result.Sent = SendPoses([&](const Pose& pose) { return sender.Send(&pose, sizeof(pose)); });
+            sent = true;
+
+            // Let the last poses arrive.
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            stopping = true;
+            relaying.join();
+        }
+
+        receiving.join();
+        sampling.join();
+
+        result.LatencyMS = consumer.latencyMS;
+        result.FreshnessMS = consumer.freshnessMS;
+        result.Used = receiver.Accepted;
+        result.Stale = receiver.Stale;
+        result.Lost = result.Sent - receiver.Accepted - receiver.Stale;
+        return true;
+    }
+
+    bool MeasureTCP(const LinkConditions& conditions, unsigned int seed, Result& result)
+    {
+        // The pose provider listens, the relay connects like the compositor does.
+        TCPSocket sender;
+        TCPSocket relay;
+        std::thread accepting([&]()
+        {
+            sender.CreateServerListener();
+            sender.ServerEstablishConnection();
+        });
+
+        // Give the listener a moment, so the first connect does not fail.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        bool connected = false;
+        for (int attempt = 0; attempt < 50 && !connected; attempt++)
+        {
+            connected = relay.CreateClientListener(ServerAddress);
+            if (!connected)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
+        accepting.join();
+
+        if (!connected)
+        {
+            printf("Could not connect over TCP on port %d.\n", DEFAULT_PORT);
+            return false;
+        }
+
+        PoseConsumer consumer;
+        std::atomic<bool> stopping { false };
+        std::atomic<bool> sent { false };
+        std::thread sampling([&]() { consumer.SampleFrames(sent); });
+
+        {
+            DelayQueue queue;
+            std::thread relaying([&]()
+            {
+                LossyLink link(conditions, seed);
+                double lastDelivery = 0;
+
+                int type;
+                byte* payload;
+                int length;
+                while (relay.ReceiveMessage(type, payload, length))
+                {
+                    if (length < (int)sizeof(Pose))
+                    {
+                        continue;
+                    }
+
+                    Pose pose;
+                    memcpy(&pose, payload, sizeof(pose));
+
+                    // In order, a pose never arrives before the one sent ahead of it.
+                    double delivery = NowMS() + link.SegmentDelay();
+                    delivery = (delivery > lastDelivery) ? delivery : lastDelivery;
+                    lastDelivery = delivery;
+
+                    queue.Push(delivery, [&consumer, pose]() { consumer.Received(pose); });
+                }
+            });
+
+            result.Sent = SendPoses([&](const Pose& pose) { return sender.SendMessageBytes(0, &pose, sizeof(pose)); });
+            sent = true;
+
+            // A pose can be held back for a retransmit timeout or more.
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            stopping = true;
+            // Closed from this end, so the port is not left in TIME_WAIT for the next run.
+            relay.Shutdown();
+            relaying.join();
+        }
+
+        sampling.join();
+
+        result.LatencyMS = consumer.latencyMS;
+        result.FreshnessMS = consumer.freshnessMS;
+        result.Used = (int)consumer.latencyMS.size();
+        result.Lost = result.Sent - result.Used;
+        return true;
+    }
+
+    double Mean(const std::vector<double>& values)
+    {
+        double sum = 0;
+        for (double value : values)
+        {
+            sum += value;
+        }
+        return values.empty() ? 0 : sum / values.size();
+    }
+
+    double Percentile(std::vector<double> values, int percent)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+
+        std::sort(values.begin(), values.end());
+        size_t index = values.size() * percent / 100;
+        return values[(index < values.size()) ? index : values.size() - 1];
+    }
+
+    void Print(const char* transport, const LinkConditions& conditions, const Result& result)
+    {
+        printf("    %-22s %-4s  %6.1f %6.1f %6.1f   %6.1f %6.1f %6.1f   %5d %5d %5d %5d\n",
+            conditions.Name, transport,
+            Mean(result.LatencyMS), Percentile(result.LatencyMS, 95), Percentile(result.LatencyMS, 100),
+            Mean(result.FreshnessMS), Percentile(result.FreshnessMS, 95), Percentile(result.FreshnessMS, 100),
+            result.Sent, result.Used, result.Stale, result.Lost);
+    }
+}
+
+int main()
+{
+    WSASession session;
+    (void)session;
+
+    printf("Poses at %dHz for %ds per run over loopback, %.0f-%.0fms one way delay,\n",
+        PoseRate, RunSeconds, LinkDelayMS, LinkDelayMS + LinkJitterMS);
+    printf("reordered packets are held back %.0f-%.0fms, freshness is sampled by %.2fHz frames\n",
+        ReorderMinMS, ReorderMaxMS, FrameRate);
+    printf("                                  latency (ms)           freshness (ms)\n");
+    printf("    link                         mean    p95    max     mean    p95    max    sent  used stale  lost\n");
+
+    const LinkConditions links[] =
+    {
+        { "no loss",            0.00, 0.00 },
+        { "1% loss",            0.01, 0.00 },
+        { "5% loss",            0.05, 0.00 },
+        { "5% reordered",       0.00, 0.05 },
+        { "5% loss, reordered", 0.05, 0.05 },
+    };
+
+    unsigned int seed = 1;
+    for (const LinkConditions& conditions : links)
+    {
+        Result tcp;
+        Result udp;
+        if (!MeasureTCP(conditions, seed, tcp) || !MeasureUDP(conditions, seed, udp))
+        {
+            return 1;
+        }
+
+        Print("TCP", conditions, tcp);
+        Print("UDP", conditions, udp);
+        seed++;
+    }
+
+    return 0;
+}
@@ -0,0 +1,200 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Measures how long each pose takes from the send call to the compositor's receive over loopback,
+// with the options of SocketProfile::LowLatency and with the operating system defaults.
+// The sender writes a burst of poses every few milliseconds, each pose its own framed message like
+// the pose provider sends them. With Nagle's algorithm on, a pose that follows one that has not been
+// acknowledged yet waits for that ACK, and the receiver can hold the ACK back.
+// Loopback acknowledges fast, so over Wi-Fi the difference is larger.
+//
+// Only depends on standard C++ and the sockets, build it with:
+//     cl /EHsc /O2 /I..\SharedHeaders PoseLatencyBenchmark.cpp
+// or:
+//     g++ -std=c++14 -O2 -pthread -I../SharedHeaders PoseLatencyBenchmark.cpp
+//
+// Usage: PoseLatencyBenchmark [poses per profile]
+// Port DEFAULT_PORT on this machine has to be free.
+
+#include "../SharedHeaders/NetworkPacketStructure.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const char* ServerAddress = "127.0.0.1";
+    const int PosesPerBurst = 3;
+    const int BurstIntervalMS = 5;
+
+    struct Result
+    {
+        int Received = 0;
+        bool InOrder = true;
+        // Microseconds from sending each pose to receiving it.
+        std::vector<double> Latencies;
+    };
+
+    double Percentile(std::vector<double> values, double p)
+    {
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(p * (values.size() - 1))];
+    }
+
+    LONGLONG Now(Clock::time_point start)
+    {
+        return (LONGLONG)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    bool Measure(SocketProfile profile, int numPoses, Result& result)
+    {
+        // The pose provider listens, the compositor connects.
+        TCPSocket sender(profile);
+        TCPSocket receiver(profile);
+        std::thread accepting([&]()
+        {
+            sender.CreateServerListener();
+            sender.ServerEstablishConnection();
+        });
+
+        // Give the listener a moment, so the first connect does not fail.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        bool connected = false;
+        for (int attempt = 0; attempt < 50 && !connected; attempt++)
+        {
+            connected = receiver.CreateClientListener(ServerAddress);
+            if (!connected)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
+        accepting.join();
+
+        if (!connected)
+        {
+            printf("Could not connect over TCP on port %d.\n", DEFAULT_PORT);
+            return false;
+        }
+
+        Clock::time_point start = Clock::now();
+
+        std::thread sending([&]()
+        {
+            SVPose pose;
+            for (int i = 0; i < numPoses; i++)
+            {
+                if (i > 0 && i % PosesPerBurst == 0)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(BurstIntervalMS));
+                }
+
+                // The sequence number rides in a position, exact as a float up to 2^24.
+                pose.posX = (float)i;
+                pose.sentTime = Now(start);
+                if (!sender.SendMessageBytes(PacketType::Pose, &pose, sizeof(pose)))
+                {
+                    return;
+                }
+            }
+        });
+
+        for (int i = 0; i < numPoses; i++)
+        {
+            int type;
+            byte* payload;
+            int length;
+            if (!receiver.ReceiveMessage(type, payload, length))
+            {
+                break;
+            }
+
+            LONGLONG receivedTime = Now(start);
+            if (type != PacketType::Pose || length != sizeof(SVPose))
+            {
+                result.InOrder = false;
+                break;
+            }
+
+            SVPose pose;
+            memcpy(&pose, payload, sizeof(pose));
+            result.InOrder &= pose.posX == (float)i;
+            result.Latencies.push_back((receivedTime - pose.sentTime) / 1000.0);
+            result.Received++;
+        }
+
+        sending.join();
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int numPoses = argc > 1 ? atoi(argv[1]) : 3000;
+    if (numPoses <= 0 || numPoses >= (1 << 24))
+    {
+        fprintf(stderr, "Usage: PoseLatencyBenchmark [poses per profile]\n");
+        return 1;
+    }
+
+    WSASession session;
+    (void)session;
+
+    struct Run
+    {
+        const char* Name;
+        SocketProfile Profile;
+    };
+
+    const Run runs[] =
+    {
+        { "LowLatency, Nagle off", SocketProfile::LowLatency },
+        { "Default, Nagle on", SocketProfile::Default },
+    };
+
+    printf("%d poses per profile over loopback, %d back to back every %d ms, latency in us:\n", numPoses, PosesPerBurst, BurstIntervalMS);
+    printf("    %-24s %9s %9s %9s %9s %9s\n", "", "received", "median", "p90", "p99", "max");
+
+    bool passed = true;
+    for (const Run& run : runs)
+    {
+        Result result;
+        if (!Measure(run.Profile, numPoses, result))
+        {
+            return 1;
+        }
+
+        bool ok = result.Received == numPoses && result.InOrder;
+        if (result.Latencies.empty())
+        {
+            printf("    %-24s %9d  FAILED\n", run.Name, result.Received);
+        }
+        else
+        {
+            printf("    %-24s %9d %9.1f %9.1f %9.1f %9.1f%s\n",
+                run.Name, result.Received,
+                Percentile(result.Latencies, 0.5),
+                Percentile(result.Latencies, 0.9),
+                Percentile(result.Latencies, 0.99),
+                Percentile(result.Latencies, 1.0),
+                ok ? "" : "  FAILED");
+        }
+
+        passed &= ok;
+    }
+
+    if (!passed)
+    {
+        printf("\nPoses were lost or arrived out of order.\n");
+        return 1;
+    }
+
+    return 0;
+}
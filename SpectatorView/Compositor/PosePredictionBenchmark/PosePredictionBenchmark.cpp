@@ -0,0 +1,398 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Reports how far the poses PosePredictor extrapolates are from the poses that arrive later,
+// for the prediction modes and a range of network latencies.
+// The pose traces come from telemetry files recorded by the compositor, which hold the newest
+// pose of every frame, or without files from generated camera motion.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 PosePredictionBenchmark.cpp
+//
+// Usage: PosePredictionBenchmark [<n>_Telemetry.svtl ...]
+
+#include "../CompositorDLL/PosePredictor.h"
+#include "../CompositorDLL/Telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const double Pi = 3.14159265358979323846;
+
+    // POSE_PREDICTION_* in CompositorConstants.h, which needs the Windows headers.
+    const float PredictionHorizon = 0.1f;
+    const float PredictionDecay = 0.3f;
+    const size_t PredictionSamples = 30;
+
+    // How much older than the pose the compositor wants the newest pose it has is.
+    const float LatenciesMS[] = { 10.0f, 25.0f, 50.0f, 75.0f, 100.0f, 150.0f };
+    const int NumLatencies = sizeof(LatenciesMS) / sizeof(LatenciesMS[0]);
+
+    // Generated traces, at the rate the HoloLens sends poses.
+    const double TraceSeconds = 60;
+    const double PoseRate = 60;
+    const double DroppedPoses = 0.02;
+    const double PositionJitter = 0.0005;        // m
+    const double RotationJitter = 0.05 * Pi / 180; // rad
+
+    struct Trace
+    {
+        std::string Name;
+        // Runs of poses in time order, a new run starts where the pose cache was reset.
+        std::vector<std::vector<PoseSample>> Runs;
+    };
+
+    struct Setting
+    {
+        const char* Name;
+        PosePredictor::Mode Mode;
+        float DecayTime;
+    };
+
+    struct Motion
+    {
+        // Sums of sines per axis, amplitude in m or rad and frequency in Hz.
+        struct Wave
+        {
+            double Amplitude;
+            double Frequency;
+        };
+
+        std::vector<Wave> Position[3];
+        std::vector<Wave> Angles[3];    // yaw, pitch, roll
+        double Velocity[3];             // constant drift, m/s
+    };
+
+    double Evaluate(const std::vector<Motion::Wave>& waves, const std::vector<double>& phases, double t)
+    {
+        double value = 0;
+        for (size_t i = 0; i < waves.size(); i++)
+        {
+            value += waves[i].Amplitude * std::sin(2 * Pi * waves[i].Frequency * t + phases[i]);
+        }
+        return value;
+    }
+
+    void FromAngles(double yaw, double pitch, double roll, float q[4])
+    {
+        double cy = std::cos(yaw / 2), sy = std::sin(yaw / 2);
+        double cp = std::cos(pitch / 2), sp = std::sin(pitch / 2);
+        double cr = std::cos(roll / 2), sr = std::sin(roll / 2);
+
+        // Yaw about y, then pitch about x, then roll about z.
+        q[0] = (float)(cy * sp * cr + sy * cp * sr);
+        q[1] = (float)(sy * cp * cr - cy * sp * sr);
+        q[2] = (float)(cy * cp * sr - sy * sp * cr);
+        q[3] = (float)(cy * cp * cr + sy * sp * sr);
+    }
+
+    Trace Generate(const char* name, const Motion& motion, unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<double> phase(0, 2 * Pi);
+        std::uniform_real_distribution<double> unit(0, 1);
+        std::normal_distribution<double> normal(0, 1);
+
+        std::vector<double> positionPhases[3];
+        std::vector<double> anglePhases[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            for (size_t i = 0; i < motion.Position[axis].size(); i++)
+            {
+                positionPhases[axis].push_back(phase(random));
+            }
+            for (size_t i = 0; i < motion.Angles[axis].size(); i++)
+            {
+                anglePhases[axis].push_back(phase(random));
+            }
+        }
+
+        Trace trace;
+        trace.Name = name;
+        trace.Runs.resize(1);
+        for (int i = 0; i < (int)(TraceSeconds * PoseRate); i++)
+        {
+            if (unit(random) < DroppedPoses)
+            {
+                continue;
+            }
+
+            double t = i / PoseRate;
+            PoseSample sample;
+            sample.Time = (float)t;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                sample.Position[axis] = (float)(motion.Velocity[axis] * t +
+                    Evaluate(motion.Position[axis], positionPhases[axis], t) + PositionJitter * normal(random));
+            }
+
+            double angles[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                angles[axis] = Evaluate(motion.Angles[axis], anglePhases[axis], t) + RotationJitter * normal(random);
+            }
+            FromAngles(angles[0], angles[1], angles[2], sample.Rotation);
+
+            trace.Runs[0].push_back(sample);
+        }
+
+        return trace;
+    }
+
+    std::vector<Trace> GenerateTraces()
+    {
+        const double Degrees = Pi / 180;
+        std::vector<Trace> traces;
+
+        // Camera on a tripod panning slowly across the scene.
+        Motion tripod = {};
+        tripod.Angles[0] = { { 30 * Degrees, 0.08 }, { 10 * Degrees, 0.23 } };
+        tripod.Angles[1] = { { 5 * Degrees, 0.11 } };
+        traces.push_back(Generate("tripod pan", tripod, 1));
+
+        // Camera held by someone standing, with a little hand tremor.
+        Motion handheld = {};
+        handheld.Position[0] = { { 0.10, 0.25 }, { 0.03, 0.9 }, { 0.001, 8.0 } };
+        handheld.Position[1] = { { 0.04, 0.35 }, { 0.01, 1.3 }, { 0.001, 9.0 } };
+        handheld.Position[2] = { { 0.06, 0.2 }, { 0.02, 0.7 }, { 0.001, 7.0 } };
+        handheld.Angles[0] = { { 25 * Degrees, 0.15 }, { 8 * Degrees, 0.6 }, { 0.2 * Degrees, 8.5 } };
+        handheld.Angles[1] = { { 8 * Degrees, 0.25 }, { 3 * Degrees, 0.8 }, { 0.2 * Degrees, 7.5 } };
+        handheld.Angles[2] = { { 3 * Degrees, 0.3 }, { 0.1 * Degrees, 9.5 } };
+        traces.push_back(Generate("handheld", handheld, 2));
+
+        // Camera carried by someone walking, bobbing with every step and turning.
+        Motion walking = {};
+        walking.Velocity[2] = 1.0;
+        walking.Position[0] = { { 0.03, 0.9 }, { 0.5, 0.05 } };
+        walking.Position[1] = { { 0.025, 1.8 }, { 0.005, 3.6 } };
+        walking.Angles[0] = { { 45 * Degrees, 0.05 }, { 15 * Degrees, 0.3 }, { 2 * Degrees, 0.9 } };
+        walking.Angles[1] = { { 2 * Degrees, 1.8 }, { 5 * Degrees, 0.2 } };
+        walking.Angles[2] = { { 2 * Degrees, 0.9 } };
+        traces.push_back(Generate("walking", walking, 3));
+
+        return traces;
+    }
+
+    bool ReadTrace(const char* path, Trace& trace)
+    {
+        FILE* file = nullptr;
+#if defined(_MSC_VER)
+        fopen_s(&file, path, "rb");
+#else
+        file = fopen(path, "rb");
+#endif
+        if (file == nullptr)
+        {
+            fprintf(stderr, "Can not open %s.\n", path);
+            return false;
+        }
+
+        TelemetryHeader header;
+        bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+            header.Magic == TELEMETRY_MAGIC &&
+            header.Version == TELEMETRY_VERSION &&
+            header.RecordSize == sizeof(TelemetryRecord) &&
+            header.Capacity > 0;
+
+        std::vector<TelemetryRecord> ring;
+        if (valid)
+        {
+            ring.resize(header.Capacity);
+            valid = fread(ring.data(), sizeof(TelemetryRecord), ring.size(), file) == ring.size();
+        }
+
+        fclose(file);
+
+        if (!valid)
+        {
+            fprintf(stderr, "%s is not a telemetry file of this version.\n", path);
+            return false;
+        }
+
+        trace.Name = path;
+        trace.Runs.clear();
+
+        // Every frame holds the newest pose, keep each pose once.
+        uint64_t count = std::min<uint64_t>(header.RecordsWritten, header.Capacity);
+        int lastIndex = -1;
+        for (uint64_t i = header.RecordsWritten - count; i < header.RecordsWritten; i++)
+        {
+            const TelemetryRecord& record = ring[i % header.Capacity];
+            if (record.LatestPoseIndex < 0 || record.LatestPoseIndex == lastIndex)
+            {
+                continue;
+            }
+
+            if (record.LatestPoseIndex < lastIndex || trace.Runs.empty() ||
+                record.LatestPoseTime <= trace.Runs.back().back().Time)
+            {
+                trace.Runs.emplace_back();
+            }
+            lastIndex = record.LatestPoseIndex;
+
+            PoseSample sample;
+            memcpy(sample.Position, record.LatestPosition, sizeof(sample.Position));
+            memcpy(sample.Rotation, record.LatestRotation, sizeof(sample.Rotation));
+            sample.Time = record.LatestPoseTime;
+            trace.Runs.back().push_back(sample);
+        }
+
+        return true;
+    }
+
+    struct Errors
+    {
+        std::vector<double> PositionMM;
+        std::vector<double> RotationDegrees;
+    };
+
+    double Mean(const std::vector<double>& values)
+    {
+        double sum = 0;
+        for (double value : values)
+        {
+            sum += value;
+        }
+        return values.empty() ? 0 : sum / values.size();
+    }
+
+    double Percentile95(std::vector<double> values)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, values.size() * 95 / 100)];
+    }
+
+    // Predicts every pose of the trace from the poses that were older than it by latency.
+    Errors Measure(const Trace& trace, const Setting& setting, float latency)
+    {
+        PosePredictor predictor(setting.Mode, PredictionHorizon, setting.DecayTime);
+
+        Errors errors;
+        for (const std::vector<PoseSample>& run : trace.Runs)
+        {
+            size_t known = 0;
+            for (const PoseSample& actual : run)
+            {
+                while (known < run.size() && run[known].Time <= actual.Time - latency)
+                {
+                    known++;
+                }
+
+                if (known == 0)
+                {
+                    continue;
+                }
+
+                // What PoseCache hands the predictor.
+                size_t first = (known > PredictionSamples) ? known - PredictionSamples : 0;
+                PoseSample predicted;
+                predictor.Predict(&run[first], (int)(known - first), actual.Time, predicted);
+
+                double squared = 0;
+                for (int i = 0; i < 3; i++)
+                {
+                    double difference = predicted.Position[i] - actual.Position[i];
+                    squared += difference * difference;
+                }
+                errors.PositionMM.push_back(std::sqrt(squared) * 1000);
+
+                double dot = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    dot += predicted.Rotation[i] * actual.Rotation[i];
+                }
+                dot = std::min(1.0, std::fabs(dot));
+                errors.RotationDegrees.push_back(2 * std::acos(dot) * 180 / Pi);
+            }
+        }
+
+        return errors;
+    }
+
+    void Report(const Trace& trace, const std::vector<Setting>& settings)
+    {
+        size_t poses = 0;
+        for (const std::vector<PoseSample>& run : trace.Runs)
+        {
+            poses += run.size();
+        }
+
+        printf("%s: %zu poses\n", trace.Name.c_str(), poses);
+        printf("    %-24s", "latency ms");
+        for (float latency : LatenciesMS)
+        {
+            printf("  %16.1f", latency);
+        }
+        printf("\n    %-24s", "");
+        for (int i = 0; i < NumLatencies; i++)
+        {
+            printf("  %16s", "mm / deg  (p95)");
+        }
+        printf("\n");
+
+        for (const Setting& setting : settings)
+        {
+            printf("    %-24s", setting.Name);
+            for (float latency : LatenciesMS)
+            {
+                Errors errors = Measure(trace, setting, latency / 1000.0f);
+                printf("  %5.1f/%4.2f (%4.1f)", Mean(errors.PositionMM), Mean(errors.RotationDegrees),
+                    Percentile95(errors.PositionMM));
+            }
+            printf("\n");
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<Trace> traces;
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            Trace trace;
+            if (!ReadTrace(argv[i], trace))
+            {
+                return 1;
+            }
+            traces.push_back(trace);
+        }
+    }
+    else
+    {
+        traces = GenerateTraces();
+    }
+
+    std::vector<Setting> settings =
+    {
+        { "none (newest pose)", PosePredictor::Mode::None, 0 },
+        { "constant velocity", PosePredictor::Mode::ConstantVelocity, 0 },
+        { "constant velocity decay", PosePredictor::Mode::ConstantVelocity, PredictionDecay },
+        { "kalman", PosePredictor::Mode::Kalman, 0 },
+        { "kalman decay", PosePredictor::Mode::Kalman, PredictionDecay },
+    };
+
+    printf("Mean position and rotation error of the predicted pose, and the 95th percentile position error.\n");
+    printf("Horizon %.0f ms, decay %.0f ms, %zu poses per prediction.\n\n",
+        PredictionHorizon * 1000, PredictionDecay * 1000, PredictionSamples);
+
+    for (const Trace& trace : traces)
+    {
+        Report(trace, settings);
+    }
+
+    return 0;
+}
@@ -0,0 +1,404 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Measures how long the compositor takes to reconnect to a pose server that went away,
+// on loopback with a stand-in server that is killed and restarted after a downtime.
+// Compares ServerConnection with the loop UnityCompositorInterface used before it,
+// which tried to connect every 100ms.
+//
+// Only depends on standard C++ and the sockets, build it with:
+//     cl /EHsc /O2 /I..\SharedHeaders ReconnectBenchmark.cpp
+//
+// Usage: ReconnectBenchmark
+// Port DEFAULT_PORT on this machine has to be free.
+
+#include "../UnityCompositorInterface/ServerConnection.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const char* ServerAddress = "127.0.0.1";
+    const int Runs = 10;
+    const int PollingDelayMS = 100;
+    const int PoseIntervalMS = 10;
+
+    double MillisecondsBetween(Clock::time_point start, Clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    void SleepMS(int milliseconds)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    }
+
+    // Accepts connections and sends them a framed message every PoseIntervalMS, like the pose provider.
+    // Killing it closes every socket, so the client sees the connection drop and new connects fail.
+    class StandInServer
+    {
+    public:
+        ~StandInServer()
+        {
+            Kill();
+        }
+
+        bool Start()
+        {
+            listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (listenSocket == INVALID_SOCKET)
+            {
+                return false;
+            }
+
+            // The killed server's connections linger in TIME_WAIT, which would keep the restarted one from binding.
+            int reuse = 1;
+            setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, (char*)&reuse, sizeof(reuse));
+
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(DEFAULT_PORT);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (bind(listenSocket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+                listen(listenSocket, SOMAXCONN) == SOCKET_ERROR)
+            {
+                closesocket(listenSocket);
+                listenSocket = INVALID_SOCKET;
+                return false;
+            }
+
+            killed = false;
+            thread = std::thread(&StandInServer::Serve, this);
+            return true;
+        }
+
+        void Kill()
+        {
+            {
+                std::lock_guard<std::mutex> lock(socketLock);
+                killed = true;
+                // Listener first, or the client could reconnect to it in between.
+                CloseSocket(listenSocket);
+                CloseSocket(clientSocket);
+            }
+
+            if (thread.joinable())
+            {
+                thread.join();
+            }
+        }
+
+    private:
+        SOCKET listenSocket = INVALID_SOCKET;
+        SOCKET clientSocket = INVALID_SOCKET;
+        std::mutex socketLock;
+        std::atomic<bool> killed { true };
+        std::thread thread;
+
+        static void CloseSocket(SOCKET& s)
+        {
+            if (s != INVALID_SOCKET)
+            {
+                shutdown(s, SD_BOTH);
+                closesocket(s);
+                s = INVALID_SOCKET;
+            }
+        }
+
+        void Serve()
+        {
+            SOCKET listening = listenSocket;
+            while (!killed)
+            {
+                SOCKET accepted = accept(listening, NULL, NULL);
+                if (accepted == INVALID_SOCKET)
+                {
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(socketLock);
+                    if (killed)
+                    {
+                        closesocket(accepted);
+                        return;
+                    }
+                    clientSocket = accepted;
+                }
+
+                // Type 0 with a 4 byte payload, in the framing of TCPSocket::SendMessageBytes.
+                const char message[] = { 0, 4, 1, 2, 3, 4 };
+                while (!killed && send(accepted, message, sizeof(message), SEND_FLAGS) == sizeof(message))
+                {
+                    SleepMS(PoseIntervalMS);
+                }
+            }
+        }
+    };
+
+    // Counts connections, so the benchmark can wait for the next one.
+    class ConnectionCounter
+    {
+    public:
+        void Connected()
+        {
+            {
+                std::lock_guard<std::mutex> lock(countLock);
+                connections++;
+                lastConnected = Clock::now();
+            }
+            changed.notify_all();
+        }
+
+        int GetConnections()
+        {
+            std::lock_guard<std::mutex> lock(countLock);
+            return connections;
+        }
+
+        // Time of the connection after the first previous ones, false if it does not come in time.
+        bool WaitForConnection(int previous, Clock::time_point& time)
+        {
+            std::unique_lock<std::mutex> lock(countLock);
+            if (!changed.wait_for(lock, std::chrono::seconds(30), [&]() { return connections > previous; }))
+            {
+                return false;
+            }
+
+            time = lastConnected;
+            return true;
+        }
+
+    private:
+        std::mutex countLock;
+        std::condition_variable changed;
+        int connections = 0;
+        Clock::time_point lastConnected;
+    };
+
+    bool Receive(TCPSocket& tcp)
+    {
+        int type;
+        byte* payload;
+        int length;
+        return tcp.ReceiveMessage(type, payload, length);
+    }
+
+    // The loop UnityCompositorInterface used before ServerConnection.
+    class PollingClient
+    {
+    public:
+        PollingClient(ConnectionCounter& counter)
+            : counter(counter)
+            , thread(&PollingClient::Run, this)
+        {
+        }
+
+        ~PollingClient()
+        {
+            stopping = true;
+            tcp.Shutdown();
+            thread.join();
+        }
+
+        int GetConnectAttempts()
+        {
+            return connectAttempts;
+        }
+
+    private:
+        TCPSocket tcp;
+        ConnectionCounter& counter;
+        std::atomic<bool> stopping { false };
+        std::atomic<int> connectAttempts { 0 };
+        std::thread thread;
+
+        void Run()
+        {
+            while (!stopping)
+            {
+                connectAttempts++;
+                if (tcp.CreateClientListener(ServerAddress))
+                {
+                    counter.Connected();
+                    while (!stopping && Receive(tcp))
+                    {
+                    }
+                    continue;
+                }
+
+                SleepMS(PollingDelayMS);
+            }
+        }
+    };
+
+    class StateMachineClient
+    {
+    public:
+        StateMachineClient(ConnectionCounter& counter)
+            : connection(tcp, [&counter]() { counter.Connected(); return true; }, [this]() { return Receive(tcp); })
+        {
+            connection.SetServer(ServerAddress);
+            connection.Start();
+        }
+
+        ~StateMachineClient()
+        {
+            connection.Stop();
+        }
+
+        int GetConnectAttempts()
+        {
+            return connection.GetConnectAttempts();
+        }
+
+        void WakeUp()
+        {
+            connection.WakeUp();
+        }
+
+    private:
+        TCPSocket tcp;
+        ServerConnection connection;
+    };
+
+    struct Result
+    {
+        std::vector<double> LagMS;          // from the server being back to the client being connected
+        std::vector<double> AttemptsPerS;   // connects tried while the server was down
+    };
+
+    double Mean(const std::vector<double>& values)
+    {
+        double sum = 0;
+        for (double value : values)
+        {
+            sum += value;
+        }
+        return values.empty() ? 0 : sum / values.size();
+    }
+
+    double Max(const std::vector<double>& values)
+    {
+        return values.empty() ? 0 : *std::max_element(values.begin(), values.end());
+    }
+
+    // Kills the server for downtimeMS and restarts it, Runs times.
+    template <typename Client>
+    bool Measure(int downtimeMS, bool wakeUpOnRestart, Result& result)
+    {
+        StandInServer server;
+        if (!server.Start())
+        {
+            printf("Could not listen on port %d.\n", DEFAULT_PORT);
+            return false;
+        }
+
+        ConnectionCounter counter;
+        Client client(counter);
+
+        Clock::time_point connected;
+        if (!counter.WaitForConnection(0, connected))
+        {
+            printf("Could not connect.\n");
+            return false;
+        }
+
+        // The restart lands anywhere in the poll period, a downtime that is a multiple of it would favor polling.
+        std::mt19937 random(12345);
+        std::uniform_int_distribution<int> offsetMS(0, PollingDelayMS - 1);
+
+        for (int run = 0; run < Runs; run++)
+        {
+            int connections = counter.GetConnections();
+            server.Kill();
+            int attempts = client.GetConnectAttempts();
+
+            int downMS = (downtimeMS > 0) ? downtimeMS + offsetMS(random) : 0;
+            SleepMS(downMS);
+            Clock::time_point restarted = Clock::now();
+            int attemptsWhileDown = client.GetConnectAttempts() - attempts;
+            if (!server.Start())
+            {
+                printf("Could not restart the server.\n");
+                return false;
+            }
+
+            if (wakeUpOnRestart)
+            {
+                WakeUp(client);
+            }
+
+            if (!counter.WaitForConnection(connections, connected))
+            {
+                printf("Did not reconnect.\n");
+                return false;
+            }
+
+            result.LagMS.push_back(MillisecondsBetween(restarted, connected));
+            if (downtimeMS > 0)
+            {
+                result.AttemptsPerS.push_back(attemptsWhileDown * 1000.0 / downMS);
+            }
+
+            // Let the connection settle before killing it again.
+            SleepMS(50);
+        }
+
+        return true;
+    }
+
+    void WakeUp(PollingClient&)
+    {
+    }
+
+    void WakeUp(StateMachineClient& client)
+    {
+        client.WakeUp();
+    }
+
+    void Print(const char* name, int downtimeMS, const Result& result)
+    {
+        printf("    %-24s  %8d  %13.1f  %12.1f  %18.1f\n",
+            name, downtimeMS, Mean(result.LagMS), Max(result.LagMS), Mean(result.AttemptsPerS));
+    }
+}
+
+int main()
+{
+    WSASession session;
+    (void)session;
+
+    printf("Reconnect after the pose server restarts, %d runs each, loopback, downtime plus up to %dms\n", Runs, PollingDelayMS);
+    printf("    client                    downtime  mean lag (ms)  max lag (ms)  connects/s while down\n");
+
+    for (int downtimeMS : { 0, 250, 1000, 3000 })
+    {
+        Result polling;
+        Result stateMachine;
+        if (!Measure<PollingClient>(downtimeMS, false, polling) ||
+            !Measure<StateMachineClient>(downtimeMS, false, stateMachine))
+        {
+            return 1;
+        }
+
+        Print("polling every 100ms", downtimeMS, polling);
+        Print("ServerConnection", downtimeMS, stateMachine);
+    }
+
+    // What ForceAnchorReconnect does while the connection is down.
+    Result wokenUp;
+    if (!Measure<StateMachineClient>(3000, true, wokenUp))
+    {
+        return 1;
+    }
+    Print("ServerConnection, WakeUp", 3000, wokenUp);
+
+    return 0;
+}
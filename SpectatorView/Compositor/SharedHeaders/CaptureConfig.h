@@ -0,0 +1,112 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+#include "CompositorConstants.h"
+
+enum class FrameProviderType : int
+{
+    DeckLink,
+    DeckLinkShuttle,
+    Elgato,
+    OpenCV,
+    Synthetic
+};
+
+enum class CapturePixelFormat : int
+{
+    YUV,    // UYVY, FRAME_BPP_RAW bytes per pixel
+    BGRA    // FRAME_BPP bytes per pixel
+};
+
+// Capture settings that can change without rebuilding the compositor.
+// The defaults come from CompositorConstants.h.
+// Only 32 bit fields are used, so Unity can pass a struct with the same layout.
+struct CaptureConfig
+{
+    int FrameWidth = FRAME_WIDTH;
+    int FrameHeight = FRAME_HEIGHT;
+
+    // Format to request from the camera. DeckLink still switches to the format it detects,
+    // Elgato always captures UYVY and OpenCV always captures BGRA.
+    CapturePixelFormat PixelFormat = CapturePixelFormat::YUV;
+
+    // Camera frame rate for providers that cannot read it from the device, 0 for the provider's default.
+    int CaptureFPS = 0;
+    // Frame rate of recorded videos.
+    int VideoFPS = VIDEO_FPS;
+
+    // Captured frames kept for the compositor to pick from, each one holds a full RGBA frame.
+    int CachedFrames = MAX_NUM_CACHED_BUFFERS;
+
+    FrameProviderType Provider =
+#if USE_DECKLINK
+        FrameProviderType::DeckLink;
+#elif USE_DECKLINK_SHUTTLE
+        FrameProviderType::DeckLinkShuttle;
+#elif USE_ELGATO
+        FrameProviderType::Elgato;
+#elif USE_OPENCV
+        FrameProviderType::OpenCV;
+#else
+        FrameProviderType::Synthetic;
+#endif
+
+    // Frame buffers and the color texture are always sized for RGBA, YUV frames use the first half.
+    int GetFrameStride() const
+    {
+        return FrameWidth * FRAME_BPP;
+    }
+
+    int GetFrameBufferSize() const
+    {
+        return FrameWidth * FrameHeight * FRAME_BPP;
+    }
+
+    int GetRawFrameBufferSize() const
+    {
+        return FrameWidth * FrameHeight * FRAME_BPP_RAW;
+    }
+
+    // Size of an NV12 frame for the video encoder.
+    int GetVideoBufferSize() const
+    {
+        return (int)(1.5f * FrameWidth * FrameHeight);
+    }
+
+    // Frame duration for a provider whose own default rate is defaultFPS.
+    long long GetCaptureDurationHNS(int defaultFPS) const
+    {
+        return S2HNS / ((CaptureFPS > 0) ? CaptureFPS : defaultFPS);
+    }
+
+    static bool IsProviderAvailable(FrameProviderType provider)
+    {
+        switch (provider)
+        {
+        case FrameProviderType::DeckLink:
+        case FrameProviderType::DeckLinkShuttle:
+            // Both run on the DeckLink SDK, the Shuttle only starts from other display modes.
+            return USE_DECKLINK || USE_DECKLINK_SHUTTLE;
+        case FrameProviderType::Elgato:
+            return USE_ELGATO;
+        case FrameProviderType::OpenCV:
+            return USE_OPENCV;
+        case FrameProviderType::Synthetic:
+            return USE_SYNTHETIC_FRAMES;
+        }
+
+        return false;
+    }
+
+    bool IsValid() const
+    {
+        // UYVY and NV12 store chroma for pixel pairs.
+        return FrameWidth > 0 && FrameHeight > 0 &&
+            FrameWidth % 2 == 0 && FrameHeight % 2 == 0 &&
+            CaptureFPS >= 0 && VideoFPS > 0 &&
+            CachedFrames >= 2 &&
+            (PixelFormat == CapturePixelFormat::YUV || PixelFormat == CapturePixelFormat::BGRA) &&
+            IsProviderAvailable(Provider);
+    }
+};
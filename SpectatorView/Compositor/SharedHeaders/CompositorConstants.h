@@ -3,7 +3,8 @@
 
 #pragma once
 
-// FrameProvider type - Exactly 1 of these should be true:
+// FrameProviders to build - At least 1 of these should be true.
+// The first one set is the default, CaptureConfig::Provider picks one of them at runtime.
 //TODO: Set this to true if using a BlackMagic DeckLink capture card.
 #define USE_DECKLINK            TRUE
 //TODO: Set this to true if using a USB 3 external BlackMagic Shuttle capture card.
@@ -12,11 +13,20 @@
 #define USE_ELGATO              FALSE
 //TODO: Set this to true if using OpenCV to get frames from a camera or capture card.
 #define USE_OPENCV              FALSE
+//TODO: Set this to true to run without capture hardware, using a raw frame file or a test pattern.
+#define USE_SYNTHETIC_FRAMES    FALSE
 
-static_assert((USE_ELGATO + USE_DECKLINK + USE_DECKLINK_SHUTTLE + USE_OPENCV == 1),
-    "Exactly 1 FrameProvider must be set");
+static_assert((USE_ELGATO + USE_DECKLINK + USE_DECKLINK_SHUTTLE + USE_OPENCV + USE_SYNTHETIC_FRAMES >= 1),
+    "At least 1 FrameProvider must be set");
+
+// Synthetic frames
+// Raw frames to play in a loop, in the capture resolution and pixel format. Leave empty for a scrolling color bar pattern.
+#define SYNTHETIC_FRAME_FILE    L""
+// Default rate, CaptureConfig::CaptureFPS overrides it.
+#define SYNTHETIC_FRAME_FPS     60
 
 // Frame Dimensions and buffer lengths
+// These are the defaults for CaptureConfig, which can change them at runtime.
 //TODO: change this to match video dimensions from your camera.
 #define FRAME_WIDTH    1920
 #define FRAME_HEIGHT   1080
@@ -78,4 +88,37 @@ static_assert((USE_ELGATO + USE_DECKLINK + USE_DECKLINK_SHUTTLE + USE_OPENCV ==
 
 #define VIDEO_FPS 30
 
+// Photos
+// PNG is lossless, JPEG files are smaller and faster to encode.
+#define PHOTO_FORMAT_PNG        0
+#define PHOTO_FORMAT_JPEG       1
+#define PHOTO_FORMAT            PHOTO_FORMAT_PNG
+// 0..1, higher is better quality and larger files.
+#define PHOTO_JPEG_QUALITY      0.9f
+
+// Spatial mapping
+// Bits per coordinate of the compact spatial mapping format, the error is at most half
+// a surface's size divided by 2^bits - 1. 12 bits keep it under a millimeter on a 3m surface.
+#define SPATIAL_MAPPING_POSITION_BITS   12
+// Range codes the compact format, smaller but slower to encode and decode.
+#define SPATIAL_MAPPING_ENTROPY_CODING  TRUE
+
+// Pose prediction
+// How GetPose fills in a pose that is newer than the latest one received, see PosePredictor.h.
+#define POSE_PREDICTION_NONE                0
+#define POSE_PREDICTION_CONSTANT_VELOCITY   1
+#define POSE_PREDICTION_KALMAN              2
+#define POSE_PREDICTION                     POSE_PREDICTION_KALMAN
+// Furthest in seconds GetPose extrapolates past the latest pose.
+#define POSE_PREDICTION_HORIZON             0.1f
+// Seconds over which the estimated velocity fades out, 0 keeps it constant.
+#define POSE_PREDICTION_DECAY               0.3f
+// Latest poses the prediction is made from.
+#define POSE_PREDICTION_SAMPLES             30
+
+// Pose channel
+// Asks the HoloLens for poses over UDP, see PoseChannel.h. TCP still carries everything else,
+// and the poses too when the HoloLens does not know about UDP or its datagrams do not arrive.
+#define USE_UDP_POSES                       TRUE
+
 #define MAX_NUM_CACHED_BUFFERS 20
\ No newline at end of file
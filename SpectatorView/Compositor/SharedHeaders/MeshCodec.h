@@ -0,0 +1,675 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/*
+Compact encoding of spatial mapping surfaces.
+
+Positions are quantized to a number of bits relative to the surface's
+bounds. Triangles that are not in a good order already are reordered
+in fans, so each one is close to the previous ones. Vertices are
+renumbered in the order the triangles first use them. Then each
+position is written as the difference to the previous one, and each
+index as how far it is behind the highest index so far, 0 for a vertex
+that has not been used yet. Both come out as small varints, which an
+adaptive range coder can shrink further.
+
+Encoded meshes can be concatenated, every one starts with its length.
+
+Only standard C++ is used here, so the codec can be built and measured
+outside of the Windows build, see MeshCodecBenchmark.
+*/
+
+#define MESH_CODEC_VERSION 1
+
+// One surface, with the transform the legacy spatial mapping format sends along.
+struct CodecMesh
+{
+    float Translation[3] = { 0, 0, 0 };
+    float Rotation[4] = { 0, 0, 0, 1 };
+    float Scale[3] = { 1, 1, 1 };
+
+    std::vector<float> Positions;       // x, y, z per vertex
+    std::vector<uint16_t> Indices;      // three per triangle
+};
+
+struct MeshCodecOptions
+{
+    // Bits per coordinate, 1 to 24. The error is at most half the bounds divided by 2^bits - 1.
+    int PositionBits = 16;
+    // Range codes the varints, about a third smaller and several times slower.
+    bool EntropyCoding = true;
+};
+
+struct MeshCodecHeader
+{
+    uint32_t Length;                // of the encoded mesh, this header included
+    uint8_t Version;
+    uint8_t Flags;
+    uint8_t PositionBits;
+    uint8_t Reserved;
+    uint32_t NumVertices;
+    uint32_t NumIndices;
+    float Translation[3];
+    float Rotation[4];
+    float Scale[3];
+    float BoundsMin[3];
+    float BoundsMax[3];
+    uint32_t PositionBytes;         // varint bytes before entropy coding
+    uint32_t IndexBytes;
+};
+
+class MeshCodec
+{
+public:
+    static const uint8_t EntropyCodedFlag = 1;
+
+    // Appends the encoded mesh to output, false if an index is out of range.
+    // The triangles keep their winding but not their order, and vertices no triangle uses are dropped.
+    static bool Encode(const CodecMesh& mesh, const MeshCodecOptions& options, std::vector<uint8_t>& output)
+    {
+        int bits = options.PositionBits < 1 ? 1 : (options.PositionBits > 24 ? 24 : options.PositionBits);
+        uint32_t numVertices = (uint32_t)(mesh.Positions.size() / 3);
+        uint32_t numIndices = (uint32_t)(mesh.Indices.size() / 3 * 3);
+
+        MeshCodecHeader header = {};
+        header.Version = MESH_CODEC_VERSION;
+        header.Flags = options.EntropyCoding ? EntropyCodedFlag : 0;
+        header.PositionBits = (uint8_t)bits;
+        header.NumIndices = numIndices;
+        memcpy(header.Translation, mesh.Translation, sizeof(header.Translation));
+        memcpy(header.Rotation, mesh.Rotation, sizeof(header.Rotation));
+        memcpy(header.Scale, mesh.Scale, sizeof(header.Scale));
+
+        for (uint32_t i = 0; i < numIndices; i++)
+        {
+            uint16_t index = mesh.Indices[i];
+            if (index >= numVertices)
+            {
+                return false;
+            }
+
+            for (int c = 0; c < 3; c++)
+            {
+                float value = mesh.Positions[index * 3 + c];
+                header.BoundsMin[c] = (i == 0 || value < header.BoundsMin[c]) ? value : header.BoundsMin[c];
+                header.BoundsMax[c] = (i == 0 || value > header.BoundsMax[c]) ? value : header.BoundsMax[c];
+            }
+        }
+
+        // Surfaces that are triangulated in order code best as they are, others once their triangles are reordered.
+        std::vector<uint8_t> streams;
+        header.PositionBytes = WriteStreams(mesh, mesh.Indices.data(), header, streams);
+
+        std::vector<uint16_t> reordered;
+        OrderTriangles(mesh.Indices.data(), numIndices, numVertices, reordered);
+
+        std::vector<uint8_t> reorderedStreams;
+        uint32_t reorderedPositionBytes = WriteStreams(mesh, reordered.data(), header, reorderedStreams);
+        if (reorderedStreams.size() < streams.size())
+        {
+            streams.swap(reorderedStreams);
+            header.PositionBytes = reorderedPositionBytes;
+        }
+
+        header.IndexBytes = (uint32_t)streams.size() - header.PositionBytes;
+
+        size_t start = output.size();
+        output.resize(start + sizeof(MeshCodecHeader));
+
+        if (options.EntropyCoding)
+        {
+            RangeEncoder encoder(output);
+            StreamModels models;
+            for (size_t i = 0; i < streams.size(); i++)
+            {
+                encoder.EncodeByte(models.Select(i < header.PositionBytes ? 0 : 1), streams[i]);
+                models.Update(streams[i]);
+            }
+            encoder.Flush();
+        }
+        else
+        {
+            output.insert(output.end(), streams.begin(), streams.end());
+        }
+
+        header.Length = (uint32_t)(output.size() - start);
+        memcpy(&output[start], &header, sizeof(header));
+        return true;
+    }
+
+    // Decodes the mesh at offset and moves offset past it, false if the data is not a valid mesh.
+    static bool Decode(const uint8_t* data, size_t length, size_t& offset, CodecMesh& mesh)
+    {
+        MeshCodecHeader header;
+        if (offset + sizeof(header) > length)
+        {
+            return false;
+        }
+
+        memcpy(&header, data + offset, sizeof(header));
+        if (header.Version != MESH_CODEC_VERSION ||
+            header.Length < sizeof(header) ||
+            header.Length > length - offset ||
+            header.PositionBits < 1 || header.PositionBits > 24 ||
+            header.NumIndices % 3 != 0 ||
+            header.NumVertices > header.NumIndices)
+        {
+            return false;
+        }
+
+        const uint8_t* payload = data + offset + sizeof(header);
+        size_t payloadLength = header.Length - sizeof(header);
+        size_t streamLength = (size_t)header.PositionBytes + header.IndexBytes;
+
+        // Every varint is at least a byte.
+        if (header.PositionBytes < (size_t)header.NumVertices * 3 || header.IndexBytes < header.NumIndices)
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> decoded;
+        const uint8_t* streams = payload;
+        if (header.Flags & EntropyCodedFlag)
+        {
+            decoded.resize(streamLength);
+            RangeDecoder decoder(payload, payloadLength);
+            StreamModels models;
+            for (size_t i = 0; i < streamLength; i++)
+            {
+                decoded[i] = decoder.DecodeByte(models.Select(i < header.PositionBytes ? 0 : 1));
+                models.Update(decoded[i]);
+            }
+
+            if (decoder.IsOverrun())
+            {
+                return false;
+            }
+
+            streams = decoded.data();
+        }
+        else if (payloadLength != streamLength)
+        {
+            return false;
+        }
+
+        memcpy(mesh.Translation, header.Translation, sizeof(mesh.Translation));
+        memcpy(mesh.Rotation, header.Rotation, sizeof(mesh.Rotation));
+        memcpy(mesh.Scale, header.Scale, sizeof(mesh.Scale));
+
+        // Positions
+        int32_t maxQuantized = (int32_t)((1u << header.PositionBits) - 1);
+        float step[3];
+        for (int c = 0; c < 3; c++)
+        {
+            step[c] = (float)(((double)header.BoundsMax[c] - header.BoundsMin[c]) / maxQuantized);
+        }
+
+        mesh.Positions.resize((size_t)header.NumVertices * 3);
+        size_t read = 0;
+        int32_t previous[3] = { 0, 0, 0 };
+        for (uint32_t i = 0; i < header.NumVertices; i++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                uint32_t value;
+                if (!ReadVarint(streams, header.PositionBytes, read, value))
+                {
+                    return false;
+                }
+
+                int32_t quantized = previous[c] + UnZigZag(value);
+                if (quantized < 0 || quantized > maxQuantized)
+                {
+                    return false;
+                }
+
+                mesh.Positions[i * 3 + c] = header.BoundsMin[c] + quantized * step[c];
+                previous[c] = quantized;
+            }
+        }
+
+        // Indices
+        mesh.Indices.resize(header.NumIndices);
+        read = header.PositionBytes;
+        uint32_t next = 0;
+        for (uint32_t i = 0; i < header.NumIndices; i++)
+        {
+            uint32_t value;
+            if (!ReadVarint(streams, streamLength, read, value) ||
+                value > next ||
+                (value == 0 && next >= header.NumVertices))
+            {
+                return false;
+            }
+
+            mesh.Indices[i] = (uint16_t)(value == 0 ? next++ : next - value);
+        }
+
+        offset += header.Length;
+        return true;
+    }
+
+private:
+    // Writes the position and index varints for the triangles in indices, returns how many bytes the positions took.
+    // Sets the header's vertex count, the bounds and bits have to be set already.
+    static uint32_t WriteStreams(const CodecMesh& mesh, const uint16_t* indices, MeshCodecHeader& header, std::vector<uint8_t>& streams)
+    {
+        uint32_t numVertices = (uint32_t)(mesh.Positions.size() / 3);
+
+        // Renumber the vertices in order of first use.
+        std::vector<uint32_t> remap(numVertices, UINT32_MAX);
+        std::vector<uint32_t> order;
+        order.reserve(numVertices);
+        for (uint32_t i = 0; i < header.NumIndices; i++)
+        {
+            if (remap[indices[i]] == UINT32_MAX)
+            {
+                remap[indices[i]] = (uint32_t)order.size();
+                order.push_back(indices[i]);
+            }
+        }
+
+        header.NumVertices = (uint32_t)order.size();
+        streams.reserve(order.size() * 6 + header.NumIndices * 2);
+
+        // Positions
+        uint32_t maxQuantized = (1u << header.PositionBits) - 1;
+        double scale[3];
+        for (int c = 0; c < 3; c++)
+        {
+            double range = (double)header.BoundsMax[c] - header.BoundsMin[c];
+            scale[c] = (range > 0) ? maxQuantized / range : 0;
+        }
+
+        int32_t previous[3] = { 0, 0, 0 };
+        for (uint32_t vertex : order)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                double value = ((double)mesh.Positions[vertex * 3 + c] - header.BoundsMin[c]) * scale[c];
+                int32_t quantized = (int32_t)(value + 0.5);
+                quantized = quantized > (int32_t)maxQuantized ? (int32_t)maxQuantized : quantized;
+
+                WriteVarint(streams, ZigZag(quantized - previous[c]));
+                previous[c] = quantized;
+            }
+        }
+
+        uint32_t positionBytes = (uint32_t)streams.size();
+
+        // Indices
+        uint32_t next = 0;
+        for (uint32_t i = 0; i < header.NumIndices; i++)
+        {
+            uint32_t index = remap[indices[i]];
+            if (index == next)
+            {
+                WriteVarint(streams, 0);
+                next++;
+            }
+            else
+            {
+                WriteVarint(streams, next - index);
+            }
+        }
+
+        return positionBytes;
+    }
+
+    // Orders the triangles in fans around one vertex after the other, moving on to a vertex
+    // that was used recently, so neighbors end up close together whatever order the surface
+    // was triangulated in. This is Tipsify from Sander et al., Fast Triangle Reordering for
+    // Vertex Locality and Reduced Overdraw, 2007.
+    static void OrderTriangles(const uint16_t* indices, uint32_t numIndices, uint32_t numVertices, std::vector<uint16_t>& ordered)
+    {
+        const int32_t cacheSize = 16;
+        uint32_t numTriangles = numIndices / 3;
+
+        // Triangles of vertex v are vertexTriangles[firstTriangle[v], firstTriangle[v + 1]).
+        std::vector<uint32_t> firstTriangle(numVertices + 1, 0);
+        for (uint32_t i = 0; i < numIndices; i++)
+        {
+            firstTriangle[indices[i] + 1]++;
+        }
+        for (uint32_t v = 0; v < numVertices; v++)
+        {
+            firstTriangle[v + 1] += firstTriangle[v];
+        }
+
+        std::vector<uint32_t> vertexTriangles(numIndices);
+        std::vector<uint32_t> liveTriangles(numVertices, 0);
+        for (uint32_t i = 0; i < numIndices; i++)
+        {
+            uint16_t vertex = indices[i];
+            vertexTriangles[firstTriangle[vertex] + liveTriangles[vertex]++] = i / 3;
+        }
+
+        std::vector<bool> emitted(numTriangles, false);
+        std::vector<int32_t> cacheTime(numVertices, -cacheSize - 1);
+        std::vector<uint32_t> deadEnds;
+        std::vector<uint32_t> candidates;
+        int32_t time = 0;
+        uint32_t cursor = 0;
+
+        ordered.clear();
+        ordered.reserve(numIndices);
+
+        int64_t fan = numVertices > 0 ? 0 : -1;
+        while (fan >= 0)
+        {
+            candidates.clear();
+            for (uint32_t t = firstTriangle[fan]; t < firstTriangle[fan + 1]; t++)
+            {
+                uint32_t triangle = vertexTriangles[t];
+                if (emitted[triangle])
+                {
+                    continue;
+                }
+
+                emitted[triangle] = true;
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    uint16_t vertex = indices[triangle * 3 + corner];
+                    ordered.push_back(vertex);
+                    deadEnds.push_back(vertex);
+                    candidates.push_back(vertex);
+                    liveTriangles[vertex]--;
+
+                    if (time - cacheTime[vertex] > cacheSize)
+                    {
+                        cacheTime[vertex] = time++;
+                    }
+                }
+            }
+
+            // Next fan: the candidate that stays in the cache the longest while its triangles are emitted.
+            fan = -1;
+            int32_t bestPriority = -1;
+            for (uint32_t vertex : candidates)
+            {
+                if (liveTriangles[vertex] == 0)
+                {
+                    continue;
+                }
+
+                int32_t priority = 0;
+                if (time - cacheTime[vertex] + 2 * (int32_t)liveTriangles[vertex] <= cacheSize)
+                {
+                    priority = time - cacheTime[vertex];
+                }
+
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    fan = vertex;
+                }
+            }
+
+            // Otherwise a recently used vertex that still has triangles, or the next one in order.
+            while (fan < 0 && !deadEnds.empty())
+            {
+                uint32_t vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[vertex] > 0)
+                {
+                    fan = vertex;
+                }
+            }
+
+            while (fan < 0 && cursor < numVertices)
+            {
+                if (liveTriangles[cursor] > 0)
+                {
+                    fan = cursor;
+                }
+                cursor++;
+            }
+        }
+    }
+
+    static uint32_t ZigZag(int32_t value)
+    {
+        return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    }
+
+    static int32_t UnZigZag(uint32_t value)
+    {
+        return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    }
+
+    static void WriteVarint(std::vector<uint8_t>& output, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            output.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        output.push_back((uint8_t)value);
+    }
+
+    static bool ReadVarint(const uint8_t* data, size_t length, size_t& offset, uint32_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 35 && offset < length; shift += 7)
+        {
+            uint8_t byte = data[offset++];
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Adaptive probabilities of the bits of a byte, as a binary tree.
+    struct ByteModel
+    {
+        uint16_t Probabilities[256];
+
+        ByteModel()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                Probabilities[i] = ProbabilityOne / 2;
+            }
+        }
+    };
+
+    // Picks a model from the stream, which coordinate a position byte belongs to,
+    // and whether the byte starts a varint or continues one.
+    class StreamModels
+    {
+    public:
+        // Model for the next byte, which belongs to stream 0 (positions) or 1 (indices).
+        ByteModel* Select(int stream)
+        {
+            if (stream != currentStream)
+            {
+                currentStream = stream;
+                component = 0;
+                continuation = false;
+            }
+
+            int context = (stream == 0) ? component * 2 : 6;
+            return &models[context + (continuation ? 1 : 0)];
+        }
+
+        // Moves past the byte that was just coded.
+        void Update(uint8_t byte)
+        {
+            continuation = (byte & 0x80) != 0;
+            if (!continuation)
+            {
+                component = (component + 1) % 3;
+            }
+        }
+
+    private:
+        ByteModel models[8];
+        int currentStream = 0;
+        int component = 0;
+        bool continuation = false;
+    };
+
+    static const uint32_t ProbabilityBits = 11;
+    static const uint32_t ProbabilityOne = 1u << ProbabilityBits;
+    static const uint32_t AdaptShift = 5;
+    static const uint32_t TopValue = 1u << 24;
+
+    class RangeEncoder
+    {
+    public:
+        RangeEncoder(std::vector<uint8_t>& output) : output(output) { }
+
+        void EncodeByte(ByteModel* model, uint8_t byte)
+        {
+            uint32_t node = 1;
+            for (int i = 7; i >= 0; i--)
+            {
+                int bit = (byte >> i) & 1;
+                EncodeBit(model->Probabilities[node], bit);
+                node = (node << 1) | bit;
+            }
+        }
+
+        void Flush()
+        {
+            for (int i = 0; i < 5; i++)
+            {
+                ShiftLow();
+            }
+        }
+
+    private:
+        std::vector<uint8_t>& output;
+        uint64_t low = 0;
+        uint32_t range = 0xFFFFFFFF;
+        uint8_t cache = 0;
+        uint64_t cacheSize = 1;
+
+        void EncodeBit(uint16_t& probability, int bit)
+        {
+            uint32_t bound = (range >> ProbabilityBits) * probability;
+            if (bit == 0)
+            {
+                range = bound;
+                probability += (uint16_t)((ProbabilityOne - probability) >> AdaptShift);
+            }
+            else
+            {
+                low += bound;
+                range -= bound;
+                probability -= (uint16_t)(probability >> AdaptShift);
+            }
+
+            while (range < TopValue)
+            {
+                range <<= 8;
+                ShiftLow();
+            }
+        }
+
+        void ShiftLow()
+        {
+            if ((uint32_t)low < 0xFF000000u || (low >> 32) != 0)
+            {
+                uint8_t carry = (uint8_t)(low >> 32);
+                uint8_t pending = cache;
+                do
+                {
+                    output.push_back((uint8_t)(pending + carry));
+                    pending = 0xFF;
+                } while (--cacheSize != 0);
+                cache = (uint8_t)(low >> 24);
+            }
+
+            cacheSize++;
+            low = (low & 0x00FFFFFF) << 8;
+        }
+    };
+
+    class RangeDecoder
+    {
+    public:
+        RangeDecoder(const uint8_t* data, size_t length) : data(data), length(length)
+        {
+            for (int i = 0; i < 5; i++)
+            {
+                code = (code << 8) | NextByte();
+            }
+        }
+
+        uint8_t DecodeByte(ByteModel* model)
+        {
+            uint32_t node = 1;
+            for (int i = 0; i < 8; i++)
+            {
+                node = (node << 1) | DecodeBit(model->Probabilities[node]);
+            }
+
+            return (uint8_t)node;
+        }
+
+        // True if the data ended before everything was decoded.
+        bool IsOverrun()
+        {
+            return overrun;
+        }
+
+    private:
+        const uint8_t* data;
+        size_t length;
+        size_t position = 0;
+        uint32_t code = 0;
+        uint32_t range = 0xFFFFFFFF;
+        bool overrun = false;
+
+        uint8_t NextByte()
+        {
+            if (position < length)
+            {
+                return data[position++];
+            }
+
+            overrun = true;
+            return 0;
+        }
+
+        uint32_t DecodeBit(uint16_t& probability)
+        {
+            uint32_t bound = (range >> ProbabilityBits) * probability;
+            uint32_t bit;
+            if (code < bound)
+            {
+                range = bound;
+                probability += (uint16_t)((ProbabilityOne - probability) >> AdaptShift);
+                bit = 0;
+            }
+            else
+            {
+                code -= bound;
+                range -= bound;
+                probability -= (uint16_t)(probability >> AdaptShift);
+                bit = 1;
+            }
+
+            while (range < TopValue)
+            {
+                range <<= 8;
+                code = (code << 8) | NextByte();
+            }
+
+            return bit;
+        }
+    };
+};
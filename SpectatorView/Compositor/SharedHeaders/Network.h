@@ -5,16 +5,71 @@
 
 // https://msdn.microsoft.com/en-us/library/windows/desktop/ms737889(v=vs.85).aspx
 
+#include <cstdint>
+#include <cstring>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#if defined(_WIN32)
 #include <ws2tcpip.h>
 #include <winsock2.h>
+#include <mstcpip.h>
 
 #pragma comment (lib, "Ws2_32.lib")
+#else
+// POSIX sockets behind the winsock names used below, so the sockets can be built and tested off Windows.
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+typedef int SOCKET;
+typedef unsigned char byte;
+typedef long long LONGLONG;
+
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define SD_SEND SHUT_WR
+#define SD_BOTH SHUT_RDWR
+#define closesocket close
+#define ZeroMemory(destination, length) memset((destination), 0, (length))
+#define OutputDebugStringW OutputDebugString
+
+inline int WSAGetLastError()
+{
+    return errno;
+}
+
+inline void OutputDebugString(const wchar_t* message)
+{
+    fputws(message, stderr);
+}
+#endif
 
 #define DEFAULT_BUFLEN 80
 #define SPATIAL_MAPPING_BUFSIZE 60
 
+// Size of the receive buffer. It grows to fit a larger message and shrinks back once that has been read.
+#define RECEIVE_BUFLEN (64 * 1024)
+// Larger messages are treated as a corrupt stream.
+#define MAX_MESSAGE_LENGTH (64 * 1024 * 1024)
+// Most buffers a single message can be gathered from.
+#define MAX_MESSAGE_PARTS 16
+
+// A closed connection should fail the send, not raise SIGPIPE.
+#if defined(MSG_NOSIGNAL)
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
 // Use an unassigned port in the 9000 range.
 // https://www.iana.org/assignments/service-names-port-numbers/service-names-port-numbers.xhtml?=&skey=-2&page=17
 // This must match between SpectatorViewPoseProvider and UnityCompositorInterface.
@@ -22,6 +77,7 @@
 
 class WSASession
 {
+#if defined(_WIN32)
 public:
     WSASession()
     {
@@ -39,11 +95,64 @@ public:
 
 private:
     WSADATA wsaData;
+#endif
 };
 
-//TODO: base class and UDP class.
+// What a connection is used for, see SocketOptions::ForProfile.
+// Spatial mapping shares the pose connection and keeps only SPATIAL_MAPPING_WINDOW bytes in flight,
+// so it needs no larger kernel buffers. They would only queue more of the mesh ahead of the poses,
+// and setting them turns off the auto tuning of the operating system.
+enum class SocketProfile
+{
+    // Operating system defaults, Nagle's algorithm included.
+    Default,
+    // Small packets that are only useful while they are fresh, like poses.
+    LowLatency,
+};
+
+struct SocketOptions
+{
+    // Disables Nagle's algorithm, so small packets are sent right away instead of waiting for an ACK.
+    bool NoDelay = false;
+    // Probes an idle connection, so a peer that went away without closing it is noticed.
+    bool KeepAlive = false;
+    int KeepAliveIdleS = 0;
+    int KeepAliveIntervalS = 0;
+
+    static SocketOptions ForProfile(SocketProfile profile)
+    {
+        SocketOptions options;
+
+        switch (profile)
+        {
+        case SocketProfile::LowLatency:
+            options.NoDelay = true;
+            // The HoloLens can drop off Wi-Fi without closing the connection, notice that quickly.
+            options.KeepAlive = true;
+            options.KeepAliveIdleS = 2;
+            options.KeepAliveIntervalS = 1;
+            break;
+        default:
+            break;
+        }
+
+        return options;
+    }
+};
+
+//TODO: base class.
+// Carries either fixed size packets (SendData, ReceiveData) or framed messages (SendMessageBytes, ReceiveMessage).
+// A framed message is a type byte, the payload length as a varint and the payload.
+// Both kinds of reads come out of one buffer, so data that was peeked at during a handshake is not lost.
 class TCPSocket
 {
+public:
+    struct MessagePart
+    {
+        const void* Data;
+        int Length;
+    };
+
 private:
     // See here for explanation of error codes:
     // https://msdn.microsoft.com/en-us/library/windows/desktop/ms740668(v=vs.85).aspx
@@ -56,7 +165,9 @@ private:
     }
 
 public:
-    TCPSocket()
+    TCPSocket(SocketProfile profile = SocketProfile::LowLatency) :
+        options(SocketOptions::ForProfile(profile)),
+        recvBuffer(RECEIVE_BUFLEN)
     {
     }
 
@@ -68,8 +179,12 @@ public:
         closesocket(connectSocket);
     }
 
-    bool CreateClientListener(PCSTR serverIP)
+    // timeoutMS < 0 waits for as long as the operating system tries to connect, which can be 20 seconds.
+    bool CreateClientListener(const char* serverIP, int timeoutMS = -1)
     {
+        // Drop the last connection, in case the caller did not.
+        Close();
+
         struct addrinfo *result = NULL;
         struct addrinfo *ptr = NULL;
         struct addrinfo hints;
@@ -92,25 +207,26 @@ public:
             return false;
         }
 
-        // Attempt to connect to an address until one succeeds
+        // Attempt to connect to an address until one succeeds.
+        // Senders only see the socket once it is connected.
+        SOCKET connecting = INVALID_SOCKET;
         for (ptr = result; ptr != NULL; ptr = ptr->ai_next)
         {
             // Create a SOCKET for connecting to server
-            connectSocket = socket(ptr->ai_family, ptr->ai_socktype, ptr->ai_protocol);
-            if (connectSocket == INVALID_SOCKET)
+            connecting = socket(ptr->ai_family, ptr->ai_socktype, ptr->ai_protocol);
+            if (connecting == INVALID_SOCKET)
             {
                 PrintSocketError(L"Create ConnectSocket");
                 return false;
             }
 
             // Connect to server.
-            // Blocks.
-            iResult = connect(connectSocket, ptr->ai_addr, (int)ptr->ai_addrlen);
-            if (iResult == SOCKET_ERROR)
+            // Blocks, for at most timeoutMS if it is set.
+            if (!Connect(connecting, ptr->ai_addr, (int)ptr->ai_addrlen, timeoutMS))
             {
                 PrintSocketError(L"ConnectSocket");
-                closesocket(connectSocket);
-                connectSocket = INVALID_SOCKET;
+                closesocket(connecting);
+                connecting = INVALID_SOCKET;
                 continue;
             }
 
@@ -120,14 +236,17 @@ public:
 
         freeaddrinfo(result);
 
-        if (connectSocket == INVALID_SOCKET)
+        if (connecting == INVALID_SOCKET)
         {
             OutputDebugString(L"Unable to connect to server!\n");
             return false;
         }
 
-        bool bOptVal = TRUE;
-        setsockopt(connectSocket, SOL_SOCKET, TCP_NODELAY, (char *)&bOptVal, sizeof(bool));
+        SetConnectSocket(connecting);
+        ApplyOptions();
+
+        recvStart = 0;
+        recvEnd = 0;
 
         return true;
     }
@@ -182,49 +301,121 @@ public:
         }
 
         // Accept a client socket
-        connectSocket = accept(listenSocket, NULL, NULL);
-        if (connectSocket == INVALID_SOCKET)
+        SOCKET accepted = accept(listenSocket, NULL, NULL);
+        if (accepted == INVALID_SOCKET)
         {
             PrintSocketError(L"Accept");
             closesocket(listenSocket);
             return;
         }
 
-        bool bOptVal = TRUE;
-        setsockopt(connectSocket, SOL_SOCKET, TCP_NODELAY, (char *)&bOptVal, sizeof(bool));
+        SetConnectSocket(accepted);
+        ApplyOptions();
+
+        recvStart = 0;
+        recvEnd = 0;
 
         // No longer need server socket
         closesocket(listenSocket);
     }
 
+    // Ends the connection from any thread, a receive blocked on it returns false.
+    // The socket stays open until the next connection, so it can not be reused while still in use.
+    void Shutdown()
+    {
+        std::lock_guard<std::mutex> lock(socketLock);
+        if (connectSocket != INVALID_SOCKET)
+        {
+            shutdown(connectSocket, SD_BOTH);
+        }
+    }
+
+    // Address of the other end of the connection.
+    bool GetPeerAddress(sockaddr_storage& address, int& addressLength)
+    {
+        std::lock_guard<std::mutex> lock(socketLock);
+        socklen_t length = sizeof(address);
+        if (connectSocket == INVALID_SOCKET ||
+            getpeername(connectSocket, (sockaddr*)&address, &length) == SOCKET_ERROR)
+        {
+            return false;
+        }
+
+        addressLength = (int)length;
+        return true;
+    }
+
     // TODO: fast fail if connection has not been made yet.
     // TODO: caller should re-establish connection if failed.
     bool ReceiveData(byte*& bytes, int numBytes)
     {
-        if (connectSocket == INVALID_SOCKET)
+        if (!FillReceiveBuffer(numBytes, -1))
         {
             return false;
         }
 
-        int iResult = recv(connectSocket, recvbuf, numBytes, MSG_WAITALL);
-        if (iResult < 0)
+        memcpy(bytes, &recvBuffer[recvStart], numBytes);
+        recvStart += numBytes;
+        return true;
+    }
+
+    // Copies the next bytes without consuming them. timeoutMS < 0 waits until they arrive.
+    bool PeekData(byte* bytes, int numBytes, int timeoutMS = -1)
+    {
+        if (!FillReceiveBuffer(numBytes, timeoutMS))
         {
-            PrintSocketError(L"Receive");
             return false;
         }
-        else if (iResult == 0)
+
+        memcpy(bytes, &recvBuffer[recvStart], numBytes);
+        return true;
+    }
+
+    // Consumes bytes that were looked at with PeekData.
+    void SkipData(int numBytes)
+    {
+        size_t buffered = recvEnd - recvStart;
+        recvStart += ((size_t)numBytes < buffered) ? numBytes : buffered;
+    }
+
+    // Reads the next framed message. The payload points into the receive buffer
+    // and stays valid until the next receive.
+    bool ReceiveMessage(int& type, byte*& payload, int& length)
+    {
+        // Type and length take 2 to 6 bytes.
+        uint32_t messageLength = 0;
+        size_t headerLength = 1;
+        for (int shift = 0;; shift += 7)
         {
-            // Connection closed.
-            iResult = shutdown(connectSocket, SD_SEND);
-            if (iResult == SOCKET_ERROR)
+            if (shift > 28 || !FillReceiveBuffer(headerLength + 1, -1))
+            {
+                return false;
+            }
+
+            byte lengthByte = recvBuffer[recvStart + headerLength++];
+            messageLength |= (uint32_t)(lengthByte & 0x7F) << shift;
+            if ((lengthByte & 0x80) == 0)
             {
-                PrintSocketError(L"Shutdown after 0 byte recv");
-                closesocket(connectSocket);
+                break;
             }
+        }
+
+        if (messageLength > MAX_MESSAGE_LENGTH)
+        {
+            OutputDebugString(L"Error, received message is too large.\n");
+            return false;
+        }
+
+        if (!FillReceiveBuffer(headerLength + messageLength, -1))
+        {
             return false;
         }
 
-        memcpy(bytes, recvbuf, iResult);
+        type = recvBuffer[recvStart];
+        payload = &recvBuffer[recvStart + headerLength];
+        length = (int)messageLength;
+
+        recvStart += headerLength + messageLength;
         return true;
     }
 
@@ -240,7 +431,13 @@ public:
             return false;
         }
 
-        int iResult = send(connectSocket, (char*)bytes, len, 0);
+        std::lock_guard<std::mutex> lock(sendLock);
+        if (connectSocket == INVALID_SOCKET)
+        {
+            return false;
+        }
+
+        int iResult = send(connectSocket, (char*)bytes, len, SEND_FLAGS);
         if (iResult == SOCKET_ERROR)
         {
             PrintSocketError(L"Send");
@@ -250,12 +447,453 @@ public:
         return true;
     }
 
+    bool SendMessageBytes(int type, const void* payload, int length)
+    {
+        MessagePart part = { payload, length };
+        return SendMessageParts(type, &part, 1);
+    }
+
+    // Sends one framed message gathered from several buffers, without copying them.
+    // Safe to call from several threads, messages are never interleaved.
+    bool SendMessageParts(int type, const MessagePart* parts, int numParts)
+    {
+        if (numParts > MAX_MESSAGE_PARTS)
+        {
+            OutputDebugString(L"Error, too many message parts.\n");
+            return false;
+        }
+
+        uint32_t messageLength = 0;
+        for (int i = 0; i < numParts; i++)
+        {
+            messageLength += parts[i].Length;
+        }
+
+        if (messageLength > MAX_MESSAGE_LENGTH)
+        {
+            OutputDebugString(L"Error, message is too large.\n");
+            return false;
+        }
+
+        byte header[6];
+        int headerLength = 0;
+        header[headerLength++] = (byte)type;
+        do
+        {
+            byte lengthByte = messageLength & 0x7F;
+            messageLength >>= 7;
+            header[headerLength++] = lengthByte | (messageLength != 0 ? 0x80 : 0);
+        } while (messageLength != 0);
+
+        MessagePart buffers[MAX_MESSAGE_PARTS + 1];
+        buffers[0].Data = header;
+        buffers[0].Length = headerLength;
+        for (int i = 0; i < numParts; i++)
+        {
+            buffers[i + 1] = parts[i];
+        }
+
+        std::lock_guard<std::mutex> lock(sendLock);
+        if (connectSocket == INVALID_SOCKET)
+        {
+            return false;
+        }
+
+        if (!SendGathered(buffers, numParts + 1))
+        {
+            PrintSocketError(L"Send");
+            return false;
+        }
+
+        return true;
+    }
+
 private:
     // Socket to establish connection.
-    SOCKET listenSocket;
+    SOCKET listenSocket = INVALID_SOCKET;
 
     // Socket to send data to connected peer.
-    SOCKET connectSocket;
+    // Only the thread that connects and receives changes it, see SetConnectSocket.
+    SOCKET connectSocket = INVALID_SOCKET;
+
+    SocketOptions options;
+
+    // Serializes sends, so messages from different threads do not interleave.
+    // Also held to change connectSocket, so it is not closed or replaced under a send.
+    std::mutex sendLock;
+    // Held to change connectSocket and by Shutdown and GetPeerAddress, which never block on the connection.
+    std::mutex socketLock;
+
+    // Received bytes that have not been read yet are recvBuffer[recvStart, recvEnd).
+    std::vector<byte> recvBuffer;
+    size_t recvStart = 0;
+    size_t recvEnd = 0;
+
+    // Receives until at least numBytes are buffered. timeoutMS < 0 waits until they arrive.
+    bool FillReceiveBuffer(size_t numBytes, int timeoutMS)
+    {
+        if (recvEnd - recvStart >= numBytes)
+        {
+            return true;
+        }
+
+        if (connectSocket == INVALID_SOCKET)
+        {
+            return false;
+        }
+
+        // A large message grew the buffer and has been read, give the memory back before receiving more.
+        // Nothing points into the buffer any more, payloads are only valid until the next receive.
+        if (recvBuffer.size() > RECEIVE_BUFLEN && numBytes <= RECEIVE_BUFLEN && recvEnd - recvStart <= RECEIVE_BUFLEN)
+        {
+            std::vector<byte> smallBuffer(RECEIVE_BUFLEN);
+            memcpy(smallBuffer.data(), recvBuffer.data() + recvStart, recvEnd - recvStart);
+            recvBuffer.swap(smallBuffer);
+            recvEnd -= recvStart;
+            recvStart = 0;
+        }
+
+        // Move unread bytes to the front, grow the buffer for messages that do not fit.
+        if (recvStart + numBytes > recvBuffer.size())
+        {
+            memmove(recvBuffer.data(), recvBuffer.data() + recvStart, recvEnd - recvStart);
+            recvEnd -= recvStart;
+            recvStart = 0;
+
+            if (numBytes > recvBuffer.size())
+            {
+                recvBuffer.resize(numBytes);
+            }
+        }
 
-    char recvbuf[DEFAULT_BUFLEN];
+        while (recvEnd - recvStart < numBytes)
+        {
+            if (timeoutMS >= 0)
+            {
+                fd_set readSet;
+                FD_ZERO(&readSet);
+                FD_SET(connectSocket, &readSet);
+
+                timeval timeout = { timeoutMS / 1000, (timeoutMS % 1000) * 1000 };
+                if (select((int)connectSocket + 1, &readSet, NULL, NULL, &timeout) <= 0)
+                {
+                    return false;
+                }
+            }
+
+            // Take whatever has arrived, up to the free space in the buffer.
+            int iResult = recv(connectSocket, (char*)&recvBuffer[recvEnd], (int)(recvBuffer.size() - recvEnd), 0);
+            if (iResult < 0)
+            {
+                PrintSocketError(L"Receive");
+                return false;
+            }
+            else if (iResult == 0)
+            {
+                // Connection closed.
+                // The socket is closed by Close, closing it here would leave connectSocket to a handle that can be reused.
+                iResult = shutdown(connectSocket, SD_SEND);
+                if (iResult == SOCKET_ERROR)
+                {
+                    PrintSocketError(L"Shutdown after 0 byte recv");
+                }
+                return false;
+            }
+
+            recvEnd += iResult;
+        }
+
+        return true;
+    }
+
+    // Only called by the thread that connects and receives, while other threads can be sending.
+    void Close()
+    {
+        if (connectSocket == INVALID_SOCKET)
+        {
+            return;
+        }
+
+        // Fails a send that is blocked on the connection, so it lets go of sendLock.
+        Shutdown();
+
+        SOCKET closing = connectSocket;
+        SetConnectSocket(INVALID_SOCKET);
+        closesocket(closing);
+    }
+
+    // Waits for a running send, so the socket it sends on is not closed or replaced under it.
+    void SetConnectSocket(SOCKET newSocket)
+    {
+        std::lock_guard<std::mutex> sendGuard(sendLock);
+        std::lock_guard<std::mutex> socketGuard(socketLock);
+        connectSocket = newSocket;
+    }
+
+    // Connects s, giving up after timeoutMS unless it is negative.
+    bool Connect(SOCKET s, const sockaddr* address, int addressLength, int timeoutMS)
+    {
+        if (timeoutMS < 0)
+        {
+            return connect(s, address, addressLength) != SOCKET_ERROR;
+        }
+
+        SetBlocking(s, false);
+        bool connected = connect(s, address, addressLength) != SOCKET_ERROR;
+        if (!connected)
+        {
+#if defined(_WIN32)
+            bool pending = WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+            bool pending = errno == EINPROGRESS;
+#endif
+            if (pending)
+            {
+                fd_set writeSet;
+                fd_set errorSet;
+                FD_ZERO(&writeSet);
+                FD_ZERO(&errorSet);
+                FD_SET(s, &writeSet);
+                FD_SET(s, &errorSet);
+
+                // Windows reports a failed connect in the error set, POSIX as writable with SO_ERROR set.
+                timeval timeout = { timeoutMS / 1000, (timeoutMS % 1000) * 1000 };
+                if (select((int)s + 1, NULL, &writeSet, &errorSet, &timeout) > 0 &&
+                    !FD_ISSET(s, &errorSet))
+                {
+                    int error = 0;
+                    socklen_t errorLength = sizeof(error);
+                    connected = getsockopt(s, SOL_SOCKET, SO_ERROR, (char*)&error, &errorLength) != SOCKET_ERROR &&
+                        error == 0;
+                }
+            }
+        }
+
+        SetBlocking(s, true);
+        return connected;
+    }
+
+    void SetBlocking(SOCKET s, bool blocking)
+    {
+#if defined(_WIN32)
+        u_long nonBlocking = blocking ? 0 : 1;
+        ioctlsocket(s, FIONBIO, &nonBlocking);
+#else
+        int flags = fcntl(s, F_GETFL, 0);
+        fcntl(s, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+#endif
+    }
+
+    bool ApplyOptions()
+    {
+        // TCP_NODELAY is a TCP level option, at the socket level it sets something else.
+        int noDelay = options.NoDelay ? 1 : 0;
+        bool succeeded = setsockopt(connectSocket, IPPROTO_TCP, TCP_NODELAY, (char*)&noDelay, sizeof(noDelay)) != SOCKET_ERROR;
+
+        int keepAlive = options.KeepAlive ? 1 : 0;
+        succeeded &= setsockopt(connectSocket, SOL_SOCKET, SO_KEEPALIVE, (char*)&keepAlive, sizeof(keepAlive)) != SOCKET_ERROR;
+
+        if (options.KeepAlive && options.KeepAliveIdleS > 0)
+        {
+#if defined(_WIN32)
+            tcp_keepalive keepAliveValues = {};
+            keepAliveValues.onoff = 1;
+            keepAliveValues.keepalivetime = options.KeepAliveIdleS * 1000;
+            keepAliveValues.keepaliveinterval = options.KeepAliveIntervalS * 1000;
+
+            DWORD bytesReturned = 0;
+            succeeded &= WSAIoctl(connectSocket, SIO_KEEPALIVE_VALS, &keepAliveValues, sizeof(keepAliveValues),
+                NULL, 0, &bytesReturned, NULL, NULL) != SOCKET_ERROR;
+#elif defined(TCP_KEEPIDLE)
+            succeeded &= setsockopt(connectSocket, IPPROTO_TCP, TCP_KEEPIDLE, &options.KeepAliveIdleS, sizeof(int)) != SOCKET_ERROR;
+            succeeded &= setsockopt(connectSocket, IPPROTO_TCP, TCP_KEEPINTVL, &options.KeepAliveIntervalS, sizeof(int)) != SOCKET_ERROR;
+#endif
+        }
+
+        if (!succeeded)
+        {
+            PrintSocketError(L"Set socket options");
+        }
+
+        return succeeded;
+    }
+
+    // Sends every buffer, in order, with a single call where the platform allows it.
+    bool SendGathered(MessagePart* buffers, int numBuffers)
+    {
+#if defined(_WIN32)
+        WSABUF wsaBuffers[MAX_MESSAGE_PARTS + 1];
+        for (int i = 0; i < numBuffers; i++)
+        {
+            wsaBuffers[i].buf = (char*)buffers[i].Data;
+            wsaBuffers[i].len = buffers[i].Length;
+        }
+
+        // Blocking sockets do not return before everything is sent.
+        DWORD bytesSent = 0;
+        return WSASend(connectSocket, wsaBuffers, numBuffers, &bytesSent, 0, NULL, NULL) != SOCKET_ERROR;
+#else
+        iovec vectors[MAX_MESSAGE_PARTS + 1];
+        for (int i = 0; i < numBuffers; i++)
+        {
+            vectors[i].iov_base = (void*)buffers[i].Data;
+            vectors[i].iov_len = buffers[i].Length;
+        }
+
+        msghdr message = {};
+        message.msg_iov = vectors;
+        message.msg_iovlen = numBuffers;
+
+        // sendmsg can return early, continue after the last byte that went out.
+        while (message.msg_iovlen > 0)
+        {
+            ssize_t bytesSent = sendmsg(connectSocket, &message, SEND_FLAGS);
+            if (bytesSent < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                return false;
+            }
+
+            while (message.msg_iovlen > 0 && (size_t)bytesSent >= message.msg_iov->iov_len)
+            {
+                bytesSent -= message.msg_iov->iov_len;
+                message.msg_iov++;
+                message.msg_iovlen--;
+            }
+
+            if (message.msg_iovlen > 0)
+            {
+                message.msg_iov->iov_base = (byte*)message.msg_iov->iov_base + bytesSent;
+                message.msg_iov->iov_len -= bytesSent;
+            }
+        }
+
+        return true;
+#endif
+    }
+};
+
+// Datagrams, which can be lost, duplicated or arrive out of order, but never wait for each other.
+// One thread can receive while others send.
+class UDPSocket
+{
+public:
+    ~UDPSocket()
+    {
+        Close();
+    }
+
+    bool Open(int family = AF_INET)
+    {
+        Close();
+
+        udpSocket = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+        if (udpSocket == INVALID_SOCKET)
+        {
+            PrintSocketError(L"Create UDP socket");
+            return false;
+        }
+
+        return true;
+    }
+
+    // Opens and binds to port on every IPv4 interface, 0 picks a free port.
+    // Returns the port bound to, 0 if it failed.
+    int Bind(int port = 0)
+    {
+        if (!Open(AF_INET))
+        {
+            return 0;
+        }
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons((uint16_t)port);
+
+        socklen_t length = sizeof(address);
+        if (bind(udpSocket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+            getsockname(udpSocket, (sockaddr*)&address, &length) == SOCKET_ERROR)
+        {
+            PrintSocketError(L"Bind UDP socket");
+            Close();
+            return 0;
+        }
+
+        return ntohs(address.sin_port);
+    }
+
+    bool SendTo(const void* bytes, int length, const sockaddr* address, int addressLength)
+    {
+        return udpSocket != INVALID_SOCKET &&
+            sendto(udpSocket, (const char*)bytes, length, SEND_FLAGS, address, addressLength) == length;
+    }
+
+    // Length of the datagram received, 0 if none arrived within timeoutMS, -1 on errors.
+    // timeoutMS < 0 waits until one arrives. A datagram longer than capacity is cut off.
+    int Receive(void* bytes, int capacity, int timeoutMS = -1)
+    {
+        if (udpSocket == INVALID_SOCKET)
+        {
+            return -1;
+        }
+
+        if (timeoutMS >= 0)
+        {
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(udpSocket, &readSet);
+
+            timeval timeout = { timeoutMS / 1000, (timeoutMS % 1000) * 1000 };
+            int ready = select((int)udpSocket + 1, &readSet, NULL, NULL, &timeout);
+            if (ready <= 0)
+            {
+                return ready;
+            }
+        }
+
+        int received = recvfrom(udpSocket, (char*)bytes, capacity, 0, NULL, NULL);
+        if (received < 0)
+        {
+#if defined(_WIN32)
+            // Windows reports a datagram that did not fit, and an ICMP error for an earlier send, as failures.
+            int error = WSAGetLastError();
+            if (error == WSAEMSGSIZE)
+            {
+                return capacity;
+            }
+            if (error == WSAECONNRESET)
+            {
+                return 0;
+            }
+#endif
+            PrintSocketError(L"Receive UDP");
+        }
+
+        return received;
+    }
+
+    void Close()
+    {
+        if (udpSocket != INVALID_SOCKET)
+        {
+            closesocket(udpSocket);
+            udpSocket = INVALID_SOCKET;
+        }
+    }
+
+private:
+    SOCKET udpSocket = INVALID_SOCKET;
+
+    void PrintSocketError(const wchar_t* function)
+    {
+        OutputDebugStringW(function);
+        OutputDebugStringW(L" failed with error: ");
+        OutputDebugStringW(std::to_wstring(WSAGetLastError()).c_str());
+        OutputDebugStringW(L"\n");
+    }
 };
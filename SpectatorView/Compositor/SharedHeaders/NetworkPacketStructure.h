@@ -2,16 +2,45 @@
 // Licensed under the MIT License. See LICENSE in the project root for license information.
 
 #pragma once
+#if defined(_WIN32)
 #include <windows.h>
+#endif
 #include "Network.h"
 
 #define IP_LENGTH 15
 #define ANCHOR_NAME_LENGTH 36
 
+// Version 0 peers only know the fixed size packets below.
+// From version 1 on, the packets are sent as framed messages after a handshake.
+// Version 1 sends spatial mapping as one message, version 2 streams it in SpatialMappingChunks.
+// Version 3 streams it in the compact format of MeshCodec.h.
+// Version 4 only sends the meshes of surfaces that changed, see SpatialMappingUpdateHeader.
+// Version 5 can send poses over UDP instead, see PoseChannelRequestPacket.
+#define PROTOCOL_VERSION 5
+// Bytes FF 'S' 'V' 'F', which can not start an IP address in a ClientToServerPacket.
+#define PROTOCOL_MAGIC 0x465653FF
+// How long the server waits for the client's hello before it falls back to version 0.
+#define HANDSHAKE_TIMEOUT_MS 1000
+// Spatial mapping bytes per SpatialMappingChunk.
+#define SPATIAL_MAPPING_CHUNK_SIZE (16 * 1024)
+// Spatial mapping bytes the server sends ahead of the client's SpatialMappingAck.
+// A pose queues behind at most this much, instead of behind everything the socket buffers.
+#define SPATIAL_MAPPING_WINDOW (128 * 1024)
+
+// Header of fixed size packets, and type of framed messages.
 enum PacketType
 {
     Pose = 0,
     SpatialMapping = 1,
+    Hello = 2,
+    // Framed ClientToServerPacket, fixed size ones have no header.
+    ClientRequest = 3,
+    // SpatialMappingChunkHeader followed by the chunk's bytes.
+    SpatialMappingChunk = 4,
+    // Client to server, for every SpatialMappingChunk received.
+    SpatialMappingAck = 5,
+    // Client to server, PoseChannelRequestPacket.
+    PoseChannelRequest = 6,
 };
 
 struct SVPose
@@ -49,6 +78,51 @@ static_assert(sizeof(SpatialMappingPacket) <= DEFAULT_BUFLEN,
     "SpatialMappingPacket cannot exceed network buffer size limit.");
 
 
+// Precedes every chunk of streamed spatial mapping.
+struct SpatialMappingChunkHeader
+{
+    // Changes with every mesh sent, a new ID drops a mesh that has not been completed.
+    int transferID;
+    int offset;
+    int totalBytes;
+};
+
+struct SpatialMappingAckPacket
+{
+    int transferID;
+    int bytesReceived;
+};
+
+// Asks the server to send poses as PoseChannel.h datagrams to this UDP port on the client's
+// address, instead of over TCP. Port 0 asks for poses over TCP again.
+struct PoseChannelRequestPacket
+{
+    int channelID;
+    int port;
+};
+
+// Spatial mapping from protocol version 4 on: this header, an entry for every surface the
+// server has, then the MeshCodec mesh of every entry with hasMesh set, in the same order.
+// Surfaces without an entry are gone, entries without a mesh keep the mesh the client has.
+struct SpatialMappingUpdateHeader
+{
+    int numSurfaces;
+    int numMeshes;
+};
+
+struct SpatialMappingSurfaceEntry
+{
+    // SpatialSurfaceInfo::Id, stable for as long as the surface exists.
+    byte surfaceID[16];
+    int hasMesh;
+
+    // A surface can move without its mesh changing, so the transform is always sent.
+    float translation[3];
+    float rotation[4];
+    float scale[3];
+};
+
+
 struct ClientToServerPacket
 {
     // Connect to anchor owner if:
@@ -70,4 +144,73 @@ struct ClientToServerPacket
     bool requestSpatialMapping;
 };
 static_assert(sizeof(ClientToServerPacket) <= DEFAULT_BUFLEN,
-    "ClientToServerPacket cannot exceed network buffer size limit.");
\ No newline at end of file
+    "ClientToServerPacket cannot exceed network buffer size limit.");
+
+
+// Server to client, right after connecting.
+// Same size as SVPose, so a version 0 client reads it as a single packet and skips the unknown header.
+struct ServerHello
+{
+    int header = (int)PacketType::Hello;
+    int magic = PROTOCOL_MAGIC;
+    int version = PROTOCOL_VERSION;
+    byte padding[sizeof(SVPose) - 3 * sizeof(int)] = {};
+};
+static_assert(sizeof(ServerHello) == sizeof(SVPose),
+    "ServerHello has to look like an SVPose to version 0 clients.");
+
+// Client to server, in answer to ServerHello.
+// Same size as ClientToServerPacket, which is what a version 0 server reads.
+struct ClientHello
+{
+    int magic = PROTOCOL_MAGIC;
+    int version = PROTOCOL_VERSION;
+    byte padding[sizeof(ClientToServerPacket) - 2 * sizeof(int)] = {};
+};
+static_assert(sizeof(ClientHello) == sizeof(ClientToServerPacket),
+    "ClientHello has to look like a ClientToServerPacket to version 0 servers.");
+
+// Protocol version both peers speak, call right after accepting a connection.
+// A version 0 client never answers the hello, or answers with its first request,
+// which is left in the socket for ReceiveData.
+inline int ServerHandshake(TCPSocket& tcp)
+{
+    ServerHello hello;
+    if (!tcp.SendData((byte*)&hello, sizeof(hello)))
+    {
+        return 0;
+    }
+
+    ClientHello reply;
+    if (!tcp.PeekData((byte*)&reply, sizeof(reply), HANDSHAKE_TIMEOUT_MS) ||
+        reply.magic != PROTOCOL_MAGIC)
+    {
+        return 0;
+    }
+
+    tcp.SkipData(sizeof(reply));
+    return (reply.version < PROTOCOL_VERSION) ? reply.version : PROTOCOL_VERSION;
+}
+
+// Protocol version both peers speak, call right after connecting.
+// A version 0 server starts with a pose, which is left in the socket for ReceiveData.
+inline int ClientHandshake(TCPSocket& tcp)
+{
+    ServerHello hello;
+    if (!tcp.PeekData((byte*)&hello, sizeof(hello)) ||
+        hello.header != PacketType::Hello ||
+        hello.magic != PROTOCOL_MAGIC)
+    {
+        return 0;
+    }
+
+    tcp.SkipData(sizeof(hello));
+
+    ClientHello reply;
+    if (!tcp.SendData((byte*)&reply, sizeof(reply)))
+    {
+        return 0;
+    }
+
+    return (hello.version < PROTOCOL_VERSION) ? hello.version : PROTOCOL_VERSION;
+}
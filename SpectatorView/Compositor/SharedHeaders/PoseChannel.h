@@ -0,0 +1,247 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "Network.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <thread>
+
+/*
+Poses over UDP, next to the TCP connection that keeps carrying control
+messages and spatial mapping.
+
+Over TCP a pose waits for every byte queued ahead of it, and for the
+retransmit of any of them that got lost. A datagram waits for nothing, and
+a lost one is simply replaced by the next pose.
+
+Every datagram starts with a PoseDatagramHeader. The channel ID is picked
+by the receiver for every connection, so datagrams meant for an earlier
+one are dropped. The sequence number counts up with every pose, so a pose
+that arrives after a newer one is dropped instead of moving the camera
+back, and the gaps tell how many were lost. The pose itself carries the
+sender's timestamp.
+
+Only standard C++ and Network.h are used here, so the channel can be
+measured outside of the Windows build, see PoseChannelBenchmark.
+*/
+
+// Bytes FF 'S' 'V' 'P'.
+#define POSE_DATAGRAM_MAGIC 0x505653FF
+// Largest pose a datagram carries.
+#define MAX_POSE_DATAGRAM_PAYLOAD 256
+// The receiver gives up on the channel after this long without a pose, and asks for poses over TCP.
+#define POSE_CHANNEL_TIMEOUT_MS 1000
+
+struct PoseDatagramHeader
+{
+    uint32_t magic;
+    uint32_t channelID;
+    uint32_t sequence;
+};
+
+// Sends poses to the client that asked for them. Open and Close can be called while another thread sends.
+class PoseChannelSender
+{
+public:
+    // Sends to port on the host at peer, usually the other end of the TCP connection.
+    bool Open(const sockaddr_storage& peer, int peerLength, int port, uint32_t channelID)
+    {
+        std::lock_guard<std::mutex> lock(sendLock);
+
+        address = peer;
+        addressLength = peerLength;
+        if (address.ss_family == AF_INET)
+        {
+            ((sockaddr_in*)&address)->sin_port = htons((uint16_t)port);
+        }
+        else if (address.ss_family == AF_INET6)
+        {
+            ((sockaddr_in6*)&address)->sin6_port = htons((uint16_t)port);
+        }
+        else
+        {
+            return false;
+        }
+
+        if (!udp.Open(address.ss_family))
+        {
+            return false;
+        }
+
+        header.magic = POSE_DATAGRAM_MAGIC;
+        header.channelID = channelID;
+        header.sequence = 0;
+        open = true;
+        return true;
+    }
+
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(sendLock);
+        open = false;
+        udp.Close();
+    }
+
+    bool IsOpen()
+    {
+        return open;
+    }
+
+    // A failed send only loses this pose, the channel stays open.
+    bool Send(const void* pose, int length)
+    {
+        if (length > MAX_POSE_DATAGRAM_PAYLOAD)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(sendLock);
+        if (!open)
+        {
+            return false;
+        }
+
+        header.sequence++;
+
+        byte datagram[sizeof(PoseDatagramHeader) + MAX_POSE_DATAGRAM_PAYLOAD];
+        memcpy(datagram, &header, sizeof(header));
+        memcpy(datagram + sizeof(header), pose, length);
+
+        return udp.SendTo(datagram, (int)sizeof(header) + length, (sockaddr*)&address, addressLength);
+    }
+
+private:
+    UDPSocket udp;
+    std::mutex sendLock;
+    std::atomic<bool> open { false };
+
+    // Guarded by sendLock.
+    sockaddr_storage address = {};
+    int addressLength = 0;
+    PoseDatagramHeader header = {};
+};
+
+// Receives the poses of one channel at a time on a port that stays bound. Receive is called from a
+// single thread, Listen and Stop can be called from any other one.
+class PoseChannelReceiver
+{
+public:
+    PoseChannelReceiver()
+        : random(std::random_device()())
+    {
+    }
+
+    // Binds a free port and returns it, 0 if that failed.
+    int Open()
+    {
+        port = udp.Bind(0);
+        return port;
+    }
+
+    int GetPort()
+    {
+        return port;
+    }
+
+    // Starts accepting a new channel, and returns its ID for the sender.
+    uint32_t Listen()
+    {
+        std::lock_guard<std::mutex> lock(channelLock);
+        channelID = (uint32_t)random();
+        lastSequence = 0;
+        lastAccepted = Clock::now();
+        listening = true;
+        return channelID;
+    }
+
+    // Drops every datagram from here on.
+    void Stop()
+    {
+        std::lock_guard<std::mutex> lock(channelLock);
+        listening = false;
+    }
+
+    bool IsListening()
+    {
+        return listening;
+    }
+
+    // Waits up to timeoutMS for a pose of the channel that is newer than every one before it,
+    // and copies it to pose. Returns false if none arrived, other datagrams are dropped.
+    bool Receive(void* pose, int length, int timeoutMS)
+    {
+        byte datagram[sizeof(PoseDatagramHeader) + MAX_POSE_DATAGRAM_PAYLOAD];
+        int received = udp.Receive(datagram, sizeof(datagram), timeoutMS);
+        if (received < (int)sizeof(PoseDatagramHeader) + length)
+        {
+            if (received < 0)
+            {
+                // Do not spin on a socket that keeps failing.
+                std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMS > 0 ? timeoutMS : 1));
+            }
+            return false;
+        }
+
+        PoseDatagramHeader header;
+        memcpy(&header, datagram, sizeof(header));
+
+        std::lock_guard<std::mutex> lock(channelLock);
+        if (!listening || header.magic != POSE_DATAGRAM_MAGIC || header.channelID != channelID)
+        {
+            return false;
+        }
+
+        // Wraps around, so compare the distance instead of the numbers.
+        int32_t ahead = (int32_t)(header.sequence - lastSequence);
+        if (ahead <= 0 && lastSequence != 0)
+        {
+            Stale++;
+            return false;
+        }
+
+        if (lastSequence != 0)
+        {
+            Lost += ahead - 1;
+        }
+        Accepted++;
+
+        lastSequence = header.sequence;
+        lastAccepted = Clock::now();
+
+        memcpy(pose, datagram + sizeof(header), length);
+        return true;
+    }
+
+    // Time since the last pose was accepted, or since Listen.
+    int GetSilenceMS()
+    {
+        std::lock_guard<std::mutex> lock(channelLock);
+        return (int)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - lastAccepted).count();
+    }
+
+    // Poses accepted, dropped because a newer one came first, and never received.
+    // Lost counts the gaps in the sequence, a pose that arrives late after all is counted as lost and stale.
+    std::atomic<int> Accepted { 0 };
+    std::atomic<int> Stale { 0 };
+    std::atomic<int> Lost { 0 };
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    UDPSocket udp;
+    int port = 0;
+    std::mt19937 random;
+
+    std::mutex channelLock;
+    std::atomic<bool> listening { false };
+    // Guarded by channelLock.
+    uint32_t channelID = 0;
+    uint32_t lastSequence = 0;
+    Clock::time_point lastAccepted;
+};
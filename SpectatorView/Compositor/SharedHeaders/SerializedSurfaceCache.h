@@ -0,0 +1,188 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <vector>
+
+/*
+Serialized spatial mapping surfaces, kept between requests.
+
+Surfaces stop changing soon after the observer goes idle, so most of
+them can be sent again as they were serialized last time. A surface is
+looked up by its ID and the update time of the mesh it was serialized
+from; a different update time means the mesh was swapped and the bytes
+have to be serialized again. Only the transform changes without the
+mesh changing, it is written over the cached one on every lookup.
+
+The concatenation of every surface is kept as well, and only put
+together again when a surface in it was serialized again, added or
+removed.
+
+Only standard C++ is used here, so the cache can be measured outside of
+the Windows build, see SurfaceCacheBenchmark.
+*/
+
+// Translation, rotation and scale, as SerializedSurface and MeshCodecHeader keep them.
+#define SERIALIZED_SURFACE_TRANSFORM_FLOATS 10
+
+template <typename Key>
+class SerializedSurfaceCache
+{
+public:
+    // transformOffset is where the format keeps the transform in a surface's bytes.
+    explicit SerializedSurfaceCache(size_t transformOffset) :
+        transformOffset(transformOffset)
+    {
+    }
+
+    // Bytes of surface id serialized at updateTime, with transform written into them.
+    // nullptr if the surface has to be serialized again, see Store.
+    const std::vector<uint8_t>* Find(const Key& id, long long updateTime, const float* transform)
+    {
+        auto entry = entries.find(id);
+        if (entry == entries.end() || entry->second.UpdateTime != updateTime)
+        {
+            Misses++;
+            return nullptr;
+        }
+
+        Hits++;
+        WriteTransform(entry->second.Bytes, transform);
+        return &entry->second.Bytes;
+    }
+
+    // Empty buffer for the bytes of surface id serialized at updateTime, in place of the ones cached before.
+    // It stays where it is until id is stored again or dropped, so surfaces can be serialized into their
+    // buffers in parallel. Bytes left empty are cached too, for a surface that can not be serialized.
+    std::vector<uint8_t>& Store(const Key& id, long long updateTime)
+    {
+        Entry& entry = entries[id];
+        entry.UpdateTime = updateTime;
+        entry.Generation = ++generation;
+        entry.Bytes.clear();
+
+        return entry.Bytes;
+    }
+
+    // Drops every surface but the ones in ids, which are the ones the observer still has.
+    void Retain(const std::vector<Key>& ids)
+    {
+        std::set<Key> retained(ids.begin(), ids.end());
+        for (auto entry = entries.begin(); entry != entries.end(); )
+        {
+            if (retained.count(entry->first) == 0)
+            {
+                entry = entries.erase(entry);
+            }
+            else
+            {
+                ++entry;
+            }
+        }
+    }
+
+    // Bytes of the surfaces in ids one after the other, every one of them cached. The last concatenation is
+    // returned again if it has the same surfaces serialized from the same meshes, with the transforms copied over.
+    const std::vector<uint8_t>& Payload(const std::vector<Key>& ids)
+    {
+        bool current = ids.size() == slots.size();
+        for (size_t i = 0; current && i < ids.size(); i++)
+        {
+            auto entry = entries.find(ids[i]);
+            current = entry != entries.end() &&
+                slots[i].Id == ids[i] &&
+                slots[i].Generation == entry->second.Generation;
+        }
+
+        if (current)
+        {
+            PayloadsReused++;
+            for (const Slot& slot : slots)
+            {
+                const std::vector<uint8_t>& bytes = entries[slot.Id].Bytes;
+                if (bytes.size() >= transformOffset + TransformBytes)
+                {
+                    memcpy(&payload[slot.Offset + transformOffset], &bytes[transformOffset], TransformBytes);
+                }
+            }
+
+            return payload;
+        }
+
+        PayloadsBuilt++;
+        payload.clear();
+        slots.clear();
+
+        size_t length = 0;
+        for (const Key& id : ids)
+        {
+            length += entries[id].Bytes.size();
+        }
+        payload.reserve(length);
+
+        for (const Key& id : ids)
+        {
+            const Entry& entry = entries[id];
+            slots.push_back({ id, entry.Generation, payload.size() });
+            payload.insert(payload.end(), entry.Bytes.begin(), entry.Bytes.end());
+        }
+
+        return payload;
+    }
+
+    void Clear()
+    {
+        entries.clear();
+        slots.clear();
+        payload.clear();
+    }
+
+    size_t Count() const { return entries.size(); }
+
+    // Lookups that found the surface serialized from the same mesh, and ones that did not.
+    long long Hits = 0;
+    long long Misses = 0;
+    // Payloads returned as they were, and ones put together again.
+    long long PayloadsReused = 0;
+    long long PayloadsBuilt = 0;
+
+private:
+    static const size_t TransformBytes = SERIALIZED_SURFACE_TRANSFORM_FLOATS * sizeof(float);
+
+    struct Entry
+    {
+        long long UpdateTime = 0;
+        unsigned long long Generation = 0;
+        std::vector<uint8_t> Bytes;
+    };
+
+    // Where a surface is in the payload, and which bytes of it were copied there.
+    struct Slot
+    {
+        Key Id;
+        unsigned long long Generation;
+        size_t Offset;
+    };
+
+    void WriteTransform(std::vector<uint8_t>& bytes, const float* transform)
+    {
+        // A surface that could not be serialized has no transform to update.
+        if (bytes.size() >= transformOffset + TransformBytes)
+        {
+            memcpy(&bytes[transformOffset], transform, TransformBytes);
+        }
+    }
+
+    size_t transformOffset;
+    unsigned long long generation = 0;
+
+    std::map<Key, Entry> entries;
+    std::vector<Slot> slots;
+    std::vector<uint8_t> payload;
+};
@@ -0,0 +1,175 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "MeshCodec.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SURFACE_SERIALIZER_SSE2
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SURFACE_SERIALIZER_NEON
+#endif
+
+/*
+Writes spatial mapping surfaces in the legacy format Unity reads with
+protocol versions below 3: the byte lengths of the vertices and indices,
+the transform, float3 positions and the 16 bit indices.
+
+Serializing takes two passes. The first one measures every surface and
+places it in the output, so the caller can allocate a single buffer. The
+second one writes the surfaces into it, each one on its own so they can
+be written in parallel. The 16 bit positions of a surface are converted
+to floats four lanes at a time with SSE2 or NEON where available.
+
+The same surfaces can also be encoded in the compact format of MeshCodec.h.
+
+Only standard C++ is used here, so the serializer can be measured outside
+of the Windows build, see SurfaceSerializerBenchmark.
+*/
+
+// Points into a surface's vertex and index buffers, which have to stay alive until it is written.
+struct SerializedSurface
+{
+    float Translation[3];
+    float Rotation[4];
+    float Scale[3];
+
+    const int16_t* Positions = nullptr;     // x, y, z, w per vertex
+    int NumVertices = 0;
+    const uint16_t* Indices = nullptr;
+    int NumIndices = 0;
+
+    // Where the surface goes in the output, set by SurfaceSerializer::Layout.
+    size_t Offset = 0;
+};
+
+static_assert(offsetof(SerializedSurface, Scale) == offsetof(SerializedSurface, Translation) + 7 * sizeof(float),
+    "The transform is copied as 10 floats in a row.");
+
+namespace SurfaceSerializer
+{
+    // Bytes the legacy format takes for surface, 0 for a surface without triangles, which is not sent.
+    inline size_t Measure(const SerializedSurface& surface)
+    {
+        if (surface.NumIndices == 0)
+        {
+            return 0;
+        }
+
+        return 2 * sizeof(int) + 10 * sizeof(float) +
+            (size_t)surface.NumVertices * 3 * sizeof(float) +
+            (size_t)surface.NumIndices * sizeof(uint16_t);
+    }
+
+    // Places the surfaces one after the other and returns the total length.
+    inline size_t Layout(SerializedSurface* surfaces, int count)
+    {
+        size_t length = 0;
+        for (int i = 0; i < count; i++)
+        {
+            surfaces[i].Offset = length;
+            length += Measure(surfaces[i]);
+        }
+
+        return length;
+    }
+
+    // x, y, z of count x, y, z, w positions as floats. destination does not have to be aligned,
+    // indices can leave the next surface in the buffer 2 bytes off.
+    inline void ConvertPositions(const int16_t* positions, int count, void* destination)
+    {
+        uint8_t* bytes = (uint8_t*)destination;
+        const size_t vertexBytes = 3 * sizeof(float);
+        int i = 0;
+
+#if defined(SURFACE_SERIALIZER_SSE2)
+        // Every store writes a fourth lane, which the next vertex overwrites. The last vertex is left
+        // for the scalar loop, so nothing is written past it.
+        for (; i + 2 < count; i += 2)
+        {
+            __m128i packed = _mm_loadu_si128((const __m128i*)&positions[i * 4]);
+            // Sign extends each 16 bit lane into the high half of a 32 bit one, and shifts it back down.
+            __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+            __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+            _mm_storeu_ps((float*)&bytes[i * vertexBytes], _mm_cvtepi32_ps(low));
+            _mm_storeu_ps((float*)&bytes[(i + 1) * vertexBytes], _mm_cvtepi32_ps(high));
+        }
+#elif defined(SURFACE_SERIALIZER_NEON)
+        for (; i + 1 < count; i++)
+        {
+            int32x4_t widened = vmovl_s16(vld1_s16(&positions[i * 4]));
+            vst1q_u8(&bytes[i * vertexBytes], vreinterpretq_u8_f32(vcvtq_f32_s32(widened)));
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            float vertex[3] = { (float)positions[i * 4], (float)positions[i * 4 + 1], (float)positions[i * 4 + 2] };
+            memcpy(&bytes[i * vertexBytes], vertex, vertexBytes);
+        }
+    }
+
+    // Writes surface at its Offset in buffer, which has to be as long as Layout returned.
+    inline void Write(const SerializedSurface& surface, uint8_t* buffer)
+    {
+        if (Measure(surface) == 0)
+        {
+            return;
+        }
+
+        uint8_t* destination = buffer + surface.Offset;
+
+        // The vertices length counts the transform, which goes in front of the positions.
+        int verticesLength = (int)((10 + surface.NumVertices * 3) * sizeof(float));
+        int indicesLength = (int)(surface.NumIndices * sizeof(uint16_t));
+        memcpy(destination, &verticesLength, sizeof(int));
+        memcpy(destination + sizeof(int), &indicesLength, sizeof(int));
+        destination += 2 * sizeof(int);
+
+        memcpy(destination, surface.Translation, sizeof(surface.Translation));
+        destination += sizeof(surface.Translation);
+        memcpy(destination, surface.Rotation, sizeof(surface.Rotation));
+        destination += sizeof(surface.Rotation);
+        memcpy(destination, surface.Scale, sizeof(surface.Scale));
+        destination += sizeof(surface.Scale);
+
+        ConvertPositions(surface.Positions, surface.NumVertices, destination);
+        destination += surface.NumVertices * 3 * sizeof(float);
+
+        memcpy(destination, surface.Indices, indicesLength);
+    }
+
+    // Appends surface in the MeshCodec format to output, false if an index is out of range.
+    inline bool EncodeCompact(const SerializedSurface& surface, const MeshCodecOptions& options, std::vector<uint8_t>& output)
+    {
+        CodecMesh mesh;
+        memcpy(mesh.Translation, surface.Translation, sizeof(mesh.Translation));
+        memcpy(mesh.Rotation, surface.Rotation, sizeof(mesh.Rotation));
+        memcpy(mesh.Scale, surface.Scale, sizeof(mesh.Scale));
+
+        mesh.Positions.resize((size_t)surface.NumVertices * 3);
+        ConvertPositions(surface.Positions, surface.NumVertices, mesh.Positions.data());
+        mesh.Indices.assign(surface.Indices, surface.Indices + surface.NumIndices);
+
+        return MeshCodec::Encode(mesh, options, output);
+    }
+
+    // Writes every surface with parallelFor(count, function), which calls function(i) for 0 <= i < count
+    // on any number of threads.
+    template <typename ParallelFor>
+    inline void WriteAll(const SerializedSurface* surfaces, int count, uint8_t* buffer, ParallelFor parallelFor)
+    {
+        parallelFor(count, [surfaces, buffer](int i)
+        {
+            Write(surfaces[i], buffer);
+        });
+    }
+}
@@ -0,0 +1,472 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Replays a session of spatial mapping requests against RealtimeSurfaceMeshRenderer's
+// SerializedSurfaceCache, and compares it with serializing every surface for every request.
+// Each request starts the surface observer for another 10 seconds, like SpectatorViewPoseProviderMain
+// does, and while it runs some surfaces get new meshes. The transforms move a little on every request.
+// Reports how many surfaces came out of the cache and the time from a request to the bytes to send in
+// the compact format, and checks that both ways send the same bytes. The legacy format is not cached,
+// writing it with SurfaceSerializer takes about as long as copying it would.
+//
+// The surfaces are generated, or read from a recording of spatial mapping in the legacy format,
+// the bytes SerializeMeshes returns for protocol versions below 3.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 SurfaceCacheBenchmark.cpp
+//
+// Usage: SurfaceCacheBenchmark [recording]
+
+#include "../SharedHeaders/SerializedSurfaceCache.h"
+#include "../SharedHeaders/SurfaceSerializer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Same as SPATIAL_MAPPING_POSITION_BITS and SPATIAL_MAPPING_ENTROPY_CODING.
+    const int PositionBits = 16;
+    const bool EntropyCoding = true;
+
+    // SpatialMappingManager::surfaceObserverActiveTime.
+    const double ObserverActiveSeconds = 10;
+    // How often a surface gets a new mesh while the observer runs, on average, once the space is scanned
+    // and while someone is still walking around in it.
+    const double SettledRemeshSeconds = 120;
+    const double ScanningRemeshSeconds = 15;
+    const double TickSeconds = 0.5;
+    const int Requests = 20;
+    const double MinRequestInterval = 1;
+    const double MaxRequestInterval = 15;
+    // The session is played this many times, each with a cache of its own.
+    const int Sessions = 3;
+
+    // What SpatialSurfaceMesh hands out for a surface.
+    struct Surface
+    {
+        int Id;
+        long long UpdateTime;
+        std::vector<int16_t> Positions;
+        std::vector<uint16_t> Indices;
+        float Translation[3];
+        float Rotation[4];
+        float Scale[3];
+    };
+
+    // A bumpy width x height grid of vertices, triangulated row by row like the surface observer does.
+    Surface GenerateSurface(std::mt19937& random, int id, int width, int height)
+    {
+        std::uniform_int_distribution<int> noise(-40, 40);
+        std::uniform_real_distribution<float> placement(-5, 5);
+
+        Surface surface;
+        surface.Id = id;
+        surface.UpdateTime = 1;
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                surface.Positions.push_back((int16_t)(x * 400 - 16000));
+                surface.Positions.push_back((int16_t)(y * 400 - 16000));
+                surface.Positions.push_back((int16_t)(int)(2000 * std::sin(x * 0.3) * std::cos(y * 0.2) + noise(random)));
+                surface.Positions.push_back(1);
+            }
+        }
+
+        for (int y = 0; y + 1 < height; y++)
+        {
+            for (int x = 0; x + 1 < width; x++)
+            {
+                uint16_t a = (uint16_t)(y * width + x);
+                uint16_t b = (uint16_t)(a + 1);
+                uint16_t c = (uint16_t)(a + width);
+                uint16_t d = (uint16_t)(c + 1);
+
+                uint16_t triangles[] = { a, c, b, b, c, d };
+                surface.Indices.insert(surface.Indices.end(), triangles, triangles + 6);
+            }
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            surface.Translation[i] = placement(random);
+            surface.Scale[i] = 8192;
+        }
+        surface.Rotation[0] = 0;
+        surface.Rotation[1] = 0.38268f;
+        surface.Rotation[2] = 0;
+        surface.Rotation[3] = 0.92388f;
+
+        return surface;
+    }
+
+    std::vector<Surface> GenerateSurfaces(int count, int minSide, int maxSide)
+    {
+        std::mt19937 random(count);
+        std::uniform_int_distribution<int> side(minSide, maxSide);
+
+        std::vector<Surface> surfaces;
+        for (int i = 0; i < count; i++)
+        {
+            surfaces.push_back(GenerateSurface(random, i, side(random), side(random)));
+        }
+
+        return surfaces;
+    }
+
+    // Surfaces in the legacy format, where the positions are the 16 bit ones as floats.
+    bool ReadRecording(const char* path, std::vector<Surface>& surfaces)
+    {
+        FILE* file = fopen(path, "rb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> bytes;
+        uint8_t chunk[65536];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        {
+            bytes.insert(bytes.end(), chunk, chunk + read);
+        }
+        fclose(file);
+
+        const size_t transformLength = 10 * sizeof(float);
+        size_t offset = 0;
+        while (offset + 2 * sizeof(int) <= bytes.size())
+        {
+            int verticesLength;
+            int indicesLength;
+            memcpy(&verticesLength, &bytes[offset], sizeof(int));
+            memcpy(&indicesLength, &bytes[offset + sizeof(int)], sizeof(int));
+            offset += 2 * sizeof(int);
+
+            if (verticesLength < (int)transformLength || indicesLength < 0 ||
+                offset + verticesLength + indicesLength > bytes.size())
+            {
+                printf("%s is not legacy spatial mapping, it ends at byte %zu.\n", path, offset);
+                return false;
+            }
+
+            Surface surface;
+            surface.Id = (int)surfaces.size();
+            surface.UpdateTime = 1;
+            memcpy(surface.Translation, &bytes[offset], 3 * sizeof(float));
+            memcpy(surface.Rotation, &bytes[offset + 3 * sizeof(float)], 4 * sizeof(float));
+            memcpy(surface.Scale, &bytes[offset + 7 * sizeof(float)], 3 * sizeof(float));
+            offset += transformLength;
+
+            int numVertices = (int)((verticesLength - transformLength) / (3 * sizeof(float)));
+            for (int i = 0; i < numVertices * 3; i++)
+            {
+                float position;
+                memcpy(&position, &bytes[offset + i * sizeof(float)], sizeof(float));
+                surface.Positions.push_back((int16_t)std::lround(position));
+                if (i % 3 == 2)
+                {
+                    surface.Positions.push_back(1);
+                }
+            }
+            offset += verticesLength - transformLength;
+
+            surface.Indices.resize(indicesLength / sizeof(uint16_t));
+            memcpy(surface.Indices.data(), &bytes[offset], surface.Indices.size() * sizeof(uint16_t));
+            offset += indicesLength;
+
+            surfaces.push_back(surface);
+        }
+
+        return !surfaces.empty();
+    }
+
+    SerializedSurface Describe(const Surface& surface)
+    {
+        SerializedSurface described;
+        memcpy(described.Translation, surface.Translation, sizeof(described.Translation));
+        memcpy(described.Rotation, surface.Rotation, sizeof(described.Rotation));
+        memcpy(described.Scale, surface.Scale, sizeof(described.Scale));
+        described.Positions = surface.Positions.data();
+        described.NumVertices = (int)surface.Positions.size() / 4;
+        described.Indices = surface.Indices.data();
+        described.NumIndices = (int)surface.Indices.size();
+
+        return described;
+    }
+
+    MeshCodecOptions CodecOptions()
+    {
+        MeshCodecOptions options;
+        options.PositionBits = PositionBits;
+        options.EntropyCoding = EntropyCoding;
+        return options;
+    }
+
+    // What concurrency::parallel_for does on the HoloLens, a thread per core taking the next surface.
+    void ThreadedFor(int count, const std::function<void(int)>& function)
+    {
+        unsigned int threads = std::thread::hardware_concurrency();
+        threads = (threads > 0) ? threads : 1;
+
+        std::atomic<int> next { 0 };
+        auto work = [&]()
+        {
+            for (int i = next++; i < count; i = next++)
+            {
+                function(i);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned int t = 1; t < threads; t++)
+        {
+            workers.emplace_back(work);
+        }
+        work();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    // RealtimeSurfaceMeshRenderer::SerializeMeshes before the cache, every surface encoded one after the other.
+    std::vector<uint8_t> SerializeUncached(const std::vector<Surface>& surfaces)
+    {
+        std::vector<uint8_t> bytes;
+        MeshCodecOptions options = CodecOptions();
+        for (const Surface& surface : surfaces)
+        {
+            SerializedSurface described = Describe(surface);
+
+            std::vector<uint8_t> encoded;
+            if (described.NumVertices > 0 && described.NumIndices > 0 &&
+                SurfaceSerializer::EncodeCompact(described, options, encoded))
+            {
+                bytes.insert(bytes.end(), encoded.begin(), encoded.end());
+            }
+        }
+
+        return bytes;
+    }
+
+    // RealtimeSurfaceMeshRenderer::SerializeMeshes, after taking the surfaces out of the collection.
+    std::vector<uint8_t> SerializeCached(SerializedSurfaceCache<int>& cache, const std::vector<Surface>& surfaces)
+    {
+        std::vector<SerializedSurface> described;
+        std::vector<const std::vector<uint8_t>*> bytes;
+        std::vector<std::pair<const SerializedSurface*, std::vector<uint8_t>*>> misses;
+        described.reserve(surfaces.size());
+
+        for (const Surface& surface : surfaces)
+        {
+            described.push_back(Describe(surface));
+            const std::vector<uint8_t>* cached = cache.Find(surface.Id, surface.UpdateTime, described.back().Translation);
+            if (cached == nullptr)
+            {
+                std::vector<uint8_t>& stored = cache.Store(surface.Id, surface.UpdateTime);
+                misses.push_back(std::make_pair(&described.back(), &stored));
+                cached = &stored;
+            }
+            bytes.push_back(cached);
+        }
+
+        MeshCodecOptions options = CodecOptions();
+        ThreadedFor((int)misses.size(), [&](int i)
+        {
+            const SerializedSurface& surface = *misses[i].first;
+            std::vector<uint8_t>& surfaceBytes = *misses[i].second;
+
+            if (surface.NumVertices > 0 && surface.NumIndices > 0 &&
+                !SurfaceSerializer::EncodeCompact(surface, options, surfaceBytes))
+            {
+                surfaceBytes.clear();
+            }
+        });
+
+        std::vector<int> ids;
+        std::vector<int> payloadIds;
+        for (size_t i = 0; i < surfaces.size(); i++)
+        {
+            ids.push_back(surfaces[i].Id);
+            if (!bytes[i]->empty())
+            {
+                payloadIds.push_back(surfaces[i].Id);
+            }
+        }
+        cache.Retain(ids);
+
+        // Copied, like into the new byte[] SerializeMeshes returns.
+        const std::vector<uint8_t>& payload = cache.Payload(payloadIds);
+        return std::vector<uint8_t>(payload.begin(), payload.end());
+    }
+
+    // The surface observer found a slightly different mesh for surface, at updateTime.
+    void Remesh(std::mt19937& random, Surface& surface, long long updateTime)
+    {
+        std::uniform_int_distribution<int> noise(-40, 40);
+        for (size_t i = 2; i < surface.Positions.size(); i += 4)
+        {
+            int z = surface.Positions[i] + noise(random);
+            surface.Positions[i] = (int16_t)(z < -32768 ? -32768 : (z > 32767 ? 32767 : z));
+        }
+        surface.UpdateTime = updateTime;
+    }
+
+    double Percentile(std::vector<double> values, double percentile)
+    {
+        std::sort(values.begin(), values.end());
+        size_t index = (size_t)(percentile * (values.size() - 1) + 0.5);
+        return values[index];
+    }
+
+    double Mean(const std::vector<double>& values)
+    {
+        double sum = 0;
+        for (double value : values)
+        {
+            sum += value;
+        }
+        return sum / values.size();
+    }
+
+    bool Run(const char* name, const std::vector<Surface>& recorded, double remeshSeconds)
+    {
+        std::vector<double> uncachedMS;
+        std::vector<double> cachedMS;
+        long long hits = 0;
+        long long misses = 0;
+        long long payloadsReused = 0;
+        long long payloadsBuilt = 0;
+        long long remeshed = 0;
+        size_t bytesSent = 0;
+
+        for (int session = 0; session < Sessions; session++)
+        {
+            std::mt19937 random(session + 1);
+            std::uniform_real_distribution<double> interval(MinRequestInterval, MaxRequestInterval);
+            std::uniform_real_distribution<double> chance(0, 1);
+            std::normal_distribution<float> drift(0, 0.0005f);
+
+            std::vector<Surface> surfaces = recorded;
+            SerializedSurfaceCache<int> cache(offsetof(MeshCodecHeader, Translation));
+
+            double time = 0;
+            double observerStopped = 0;
+            long long updateTime = 1;
+            for (int request = 0; request < Requests; request++)
+            {
+                // Every request starts the observer again.
+                double next = time + (request == 0 ? 0 : interval(random));
+                for (; time < next; time += TickSeconds)
+                {
+                    if (time >= observerStopped)
+                    {
+                        continue;
+                    }
+
+                    for (Surface& surface : surfaces)
+                    {
+                        if (chance(random) < TickSeconds / remeshSeconds)
+                        {
+                            Remesh(random, surface, ++updateTime);
+                            remeshed++;
+                        }
+                    }
+                }
+                time = next;
+                observerStopped = time + ObserverActiveSeconds;
+
+                // The anchor the transforms are relative to keeps being refined.
+                for (Surface& surface : surfaces)
+                {
+                    for (int i = 0; i < 3; i++)
+                    {
+                        surface.Translation[i] += drift(random);
+                    }
+                }
+
+                Clock::time_point start = Clock::now();
+                std::vector<uint8_t> uncached = SerializeUncached(surfaces);
+                Clock::time_point middle = Clock::now();
+                std::vector<uint8_t> cached = SerializeCached(cache, surfaces);
+                Clock::time_point end = Clock::now();
+
+                uncachedMS.push_back(std::chrono::duration<double, std::milli>(middle - start).count());
+                cachedMS.push_back(std::chrono::duration<double, std::milli>(end - middle).count());
+                bytesSent += cached.size();
+
+                if (cached != uncached)
+                {
+                    printf("%s: request %d of session %d sends different bytes from the cache\n", name, request, session);
+                    return false;
+                }
+            }
+
+            hits += cache.Hits;
+            misses += cache.Misses;
+            payloadsReused += cache.PayloadsReused;
+            payloadsBuilt += cache.PayloadsBuilt;
+        }
+
+        int requests = Sessions * Requests;
+        printf("%s, a new mesh every %.0f s: %d requests, %.2f MB per request, %.1f of %zu surfaces remeshed in between\n",
+            name, remeshSeconds, requests, bytesSent / 1e6 / requests,
+            (double)remeshed / requests, recorded.size());
+        printf("    surfaces from the cache   %5.1f%%\n", 100.0 * hits / (hits + misses));
+        printf("    payloads reused           %5.1f%%\n", 100.0 * payloadsReused / (payloadsReused + payloadsBuilt));
+        printf("    %-24s %8s %8s %8s\n", "request to send", "mean", "p50", "p95");
+        printf("    %-24s %8.3f %8.3f %8.3f ms\n", "every surface", Mean(uncachedMS), Percentile(uncachedMS, 0.5), Percentile(uncachedMS, 0.95));
+        printf("    %-24s %8.3f %8.3f %8.3f ms  %5.1fx\n", "cached", Mean(cachedMS), Percentile(cachedMS, 0.5), Percentile(cachedMS, 0.95),
+            Mean(uncachedMS) / Mean(cachedMS));
+
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    printf("Spatial mapping requests, observer active for %.0f s after each, %u hardware threads\n\n",
+        ObserverActiveSeconds, std::thread::hardware_concurrency());
+
+    std::vector<std::pair<const char*, std::vector<Surface>>> samples;
+    if (argc > 1)
+    {
+        std::vector<Surface> recorded;
+        if (!ReadRecording(argv[1], recorded))
+        {
+            printf("Could not read spatial mapping from %s.\n", argv[1]);
+            return 1;
+        }
+        samples.push_back(std::make_pair(argv[1], recorded));
+    }
+    else
+    {
+        samples.push_back(std::make_pair("room", GenerateSurfaces(40, 20, 60)));
+        samples.push_back(std::make_pair("large space", GenerateSurfaces(150, 30, 90)));
+    }
+
+    for (const auto& sample : samples)
+    {
+        for (double remeshSeconds : { SettledRemeshSeconds, ScanningRemeshSeconds })
+        {
+            if (!Run(sample.first, sample.second, remeshSeconds))
+            {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,368 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Compares the legacy spatial mapping serialization of SurfaceSerializer.h with the way
+// SurfaceMesh::Serialize and RealtimeSurfaceMeshRenderer::SerializeMeshes did it before:
+// a buffer per surface filled one vertex at a time, then copied into one buffer for all of them.
+// Runs on generated surfaces in the 16 bit x, y, z, w layout of SpatialSurfaceMesh, and checks
+// that every way writes the same bytes.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 SurfaceSerializerBenchmark.cpp
+//
+// Usage: SurfaceSerializerBenchmark
+
+#include "../SharedHeaders/SurfaceSerializer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const double MinimumSeconds = 0.5;
+
+    // What SpatialSurfaceMesh hands out for a surface.
+    struct Surface
+    {
+        std::vector<int16_t> Positions;
+        std::vector<uint16_t> Indices;
+        float Translation[3];
+        float Rotation[4];
+        float Scale[3];
+    };
+
+    struct Sample
+    {
+        const char* Name;
+        std::vector<Surface> Surfaces;
+    };
+
+    // A bumpy width x height grid of vertices, triangulated row by row like the surface observer does.
+    Surface GenerateSurface(std::mt19937& random, int width, int height)
+    {
+        std::uniform_int_distribution<int> noise(-40, 40);
+        std::uniform_real_distribution<float> placement(-5, 5);
+
+        Surface surface;
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                surface.Positions.push_back((int16_t)(x * 400 - 16000));
+                surface.Positions.push_back((int16_t)(y * 400 - 16000));
+                surface.Positions.push_back((int16_t)(int)(2000 * std::sin(x * 0.3) * std::cos(y * 0.2) + noise(random)));
+                surface.Positions.push_back(1);
+            }
+        }
+
+        for (int y = 0; y + 1 < height; y++)
+        {
+            for (int x = 0; x + 1 < width; x++)
+            {
+                uint16_t a = (uint16_t)(y * width + x);
+                uint16_t b = (uint16_t)(a + 1);
+                uint16_t c = (uint16_t)(a + width);
+                uint16_t d = (uint16_t)(c + 1);
+
+                uint16_t triangles[] = { a, c, b, b, c, d };
+                surface.Indices.insert(surface.Indices.end(), triangles, triangles + 6);
+            }
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            surface.Translation[i] = placement(random);
+            surface.Scale[i] = 8192;
+        }
+        surface.Rotation[0] = 0;
+        surface.Rotation[1] = 0.38268f;
+        surface.Rotation[2] = 0;
+        surface.Rotation[3] = 0.92388f;
+
+        return surface;
+    }
+
+    Sample GenerateSample(const char* name, int surfaces, int minSide, int maxSide)
+    {
+        std::mt19937 random(surfaces);
+        std::uniform_int_distribution<int> side(minSide, maxSide);
+
+        Sample sample;
+        sample.Name = name;
+        for (int i = 0; i < surfaces; i++)
+        {
+            sample.Surfaces.push_back(GenerateSurface(random, side(random), side(random)));
+        }
+
+        return sample;
+    }
+
+    // SurfaceMesh::Serialize before SurfaceSerializer, for a single surface.
+    uint8_t* SerializeOneVertexAtATime(const Surface& surface, int& length)
+    {
+        int transformLength = 10 * sizeof(float);
+        int numVertices = (int)surface.Positions.size() / 4;
+        int verticesLength = numVertices * 3 * sizeof(float) + transformLength;
+        int indicesLength = (int)(surface.Indices.size() * sizeof(uint16_t));
+        if (indicesLength == 0)
+        {
+            return nullptr;
+        }
+
+        length = (2 * sizeof(int)) + verticesLength + indicesLength;
+        uint8_t* buffer = new uint8_t[length];
+
+        int startIndex = 0;
+        memcpy(&buffer[startIndex], &verticesLength, sizeof(int));
+        startIndex += sizeof(int);
+        memcpy(&buffer[startIndex], &indicesLength, sizeof(int));
+        startIndex += sizeof(int);
+
+        memcpy(&buffer[startIndex], surface.Translation, 3 * sizeof(float));
+        startIndex += 3 * sizeof(float);
+        memcpy(&buffer[startIndex], surface.Rotation, 4 * sizeof(float));
+        startIndex += 4 * sizeof(float);
+        memcpy(&buffer[startIndex], surface.Scale, 3 * sizeof(float));
+        startIndex += 3 * sizeof(float);
+
+        const int16_t* positions = surface.Positions.data();
+        for (int i = 0; i < numVertices; i++)
+        {
+            float vertex[3] = { (float)positions[i * 4], (float)positions[i * 4 + 1], (float)positions[i * 4 + 2] };
+            memcpy(&buffer[startIndex], vertex, sizeof(vertex));
+            startIndex += sizeof(vertex);
+        }
+
+        memcpy(&buffer[startIndex], surface.Indices.data(), indicesLength);
+        return buffer;
+    }
+
+    // RealtimeSurfaceMeshRenderer::SerializeMeshes before SurfaceSerializer.
+    std::vector<uint8_t> SerializeBefore(const std::vector<Surface>& surfaces)
+    {
+        std::vector<uint8_t*> meshBytes;
+        std::vector<int> meshLengths;
+        int length = 0;
+        for (const Surface& surface : surfaces)
+        {
+            int meshLength = 0;
+            uint8_t* bytes = SerializeOneVertexAtATime(surface, meshLength);
+            if (bytes != nullptr)
+            {
+                length += meshLength;
+                meshBytes.push_back(bytes);
+                meshLengths.push_back(meshLength);
+            }
+        }
+
+        std::vector<uint8_t> all(length);
+        int dst = 0;
+        for (size_t i = 0; i < meshBytes.size(); i++)
+        {
+            memcpy(&all[dst], meshBytes[i], meshLengths[i]);
+            delete[] meshBytes[i];
+            dst += meshLengths[i];
+        }
+
+        return all;
+    }
+
+    std::vector<SerializedSurface> Describe(const std::vector<Surface>& surfaces)
+    {
+        std::vector<SerializedSurface> described(surfaces.size());
+        for (size_t i = 0; i < surfaces.size(); i++)
+        {
+            SerializedSurface& surface = described[i];
+            memcpy(surface.Translation, surfaces[i].Translation, sizeof(surface.Translation));
+            memcpy(surface.Rotation, surfaces[i].Rotation, sizeof(surface.Rotation));
+            memcpy(surface.Scale, surfaces[i].Scale, sizeof(surface.Scale));
+            surface.Positions = surfaces[i].Positions.data();
+            surface.NumVertices = (int)surfaces[i].Positions.size() / 4;
+            surface.Indices = surfaces[i].Indices.data();
+            surface.NumIndices = (int)surfaces[i].Indices.size();
+        }
+
+        return described;
+    }
+
+    void SerialFor(int count, const std::function<void(int)>& function)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            function(i);
+        }
+    }
+
+    // What concurrency::parallel_for does on the HoloLens, a thread per core taking the next surface.
+    void ThreadedFor(int count, const std::function<void(int)>& function)
+    {
+        unsigned int threads = std::thread::hardware_concurrency();
+        threads = (threads > 0) ? threads : 1;
+
+        std::atomic<int> next { 0 };
+        auto work = [&]()
+        {
+            for (int i = next++; i < count; i = next++)
+            {
+                function(i);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned int t = 1; t < threads; t++)
+        {
+            workers.emplace_back(work);
+        }
+        work();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    // Everything SerializeLegacyMeshes does after taking the surfaces out of the collection.
+    std::vector<uint8_t> SerializeTwoPass(const std::vector<Surface>& surfaces, void (*parallelFor)(int, const std::function<void(int)>&))
+    {
+        std::vector<SerializedSurface> described = Describe(surfaces);
+        size_t length = SurfaceSerializer::Layout(described.data(), (int)described.size());
+
+        // Not value initialized, like the new byte[] SerializeLegacyMeshes returns.
+        std::unique_ptr<uint8_t[]> buffer(new uint8_t[length]);
+        SurfaceSerializer::WriteAll(described.data(), (int)described.size(), buffer.get(), parallelFor);
+
+        return std::vector<uint8_t>(buffer.get(), buffer.get() + length);
+    }
+
+    // Milliseconds per call of serialize, which returns the bytes of every surface.
+    template <typename Serialize>
+    double Time(Serialize serialize, std::vector<uint8_t>& bytes)
+    {
+        bytes = serialize();
+
+        int runs = 0;
+        Clock::time_point start = Clock::now();
+        double seconds = 0;
+        while (seconds < MinimumSeconds)
+        {
+            serialize();
+            runs++;
+            seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        return seconds * 1000 / runs;
+    }
+
+    // Conversion alone, over every vertex of the sample.
+    double TimeConversion(const std::vector<Surface>& surfaces, bool vectorized, std::vector<float>& converted)
+    {
+        size_t vertices = 0;
+        for (const Surface& surface : surfaces)
+        {
+            vertices += surface.Positions.size() / 4;
+        }
+        converted.assign(vertices * 3, 0);
+
+        auto convert = [&]()
+        {
+            float* destination = converted.data();
+            for (const Surface& surface : surfaces)
+            {
+                int count = (int)surface.Positions.size() / 4;
+                const int16_t* positions = surface.Positions.data();
+                if (vectorized)
+                {
+                    SurfaceSerializer::ConvertPositions(positions, count, destination);
+                }
+                else
+                {
+                    for (int i = 0; i < count; i++)
+                    {
+                        destination[i * 3] = (float)positions[i * 4];
+                        destination[i * 3 + 1] = (float)positions[i * 4 + 1];
+                        destination[i * 3 + 2] = (float)positions[i * 4 + 2];
+                    }
+                }
+                destination += count * 3;
+            }
+            return 0;
+        };
+
+        int runs = 0;
+        Clock::time_point start = Clock::now();
+        double seconds = 0;
+        while (seconds < MinimumSeconds)
+        {
+            convert();
+            runs++;
+            seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        return seconds * 1000 / runs;
+    }
+
+    bool Run(const Sample& sample)
+    {
+        size_t vertices = 0;
+        size_t indices = 0;
+        for (const Surface& surface : sample.Surfaces)
+        {
+            vertices += surface.Positions.size() / 4;
+            indices += surface.Indices.size();
+        }
+
+        std::vector<uint8_t> before;
+        std::vector<uint8_t> serial;
+        std::vector<uint8_t> threaded;
+        double beforeMS = Time([&]() { return SerializeBefore(sample.Surfaces); }, before);
+        double serialMS = Time([&]() { return SerializeTwoPass(sample.Surfaces, SerialFor); }, serial);
+        double threadedMS = Time([&]() { return SerializeTwoPass(sample.Surfaces, ThreadedFor); }, threaded);
+
+        std::vector<float> scalar;
+        std::vector<float> vectorized;
+        double scalarMS = TimeConversion(sample.Surfaces, false, scalar);
+        double vectorizedMS = TimeConversion(sample.Surfaces, true, vectorized);
+
+        printf("%s: %zu surfaces, %zu vertices, %zu indices, %.2f MB\n",
+            sample.Name, sample.Surfaces.size(), vertices, indices, before.size() / 1e6);
+        printf("    %-44s %8.3f ms\n", "buffer per surface, one vertex at a time", beforeMS);
+        printf("    %-44s %8.3f ms  %5.2fx\n", "two pass, one thread", serialMS, beforeMS / serialMS);
+        printf("    %-44s %8.3f ms  %5.2fx\n", "two pass, parallel", threadedMS, beforeMS / threadedMS);
+        printf("    %-44s %8.3f ms\n", "positions only, scalar", scalarMS);
+        printf("    %-44s %8.3f ms  %5.2fx\n", "positions only, ConvertPositions", vectorizedMS, scalarMS / vectorizedMS);
+
+        if (serial != before || threaded != before || vectorized != scalar)
+        {
+            printf("    the serialized bytes differ\n");
+            return false;
+        }
+
+        return true;
+    }
+}
+
+int main()
+{
+#if defined(SURFACE_SERIALIZER_SSE2)
+    const char* instructions = "SSE2";
+#elif defined(SURFACE_SERIALIZER_NEON)
+    const char* instructions = "NEON";
+#else
+    const char* instructions = "no SIMD";
+#endif
+    printf("Legacy spatial mapping serialization, %s, %u hardware threads\n\n", instructions, std::thread::hardware_concurrency());
+
+    bool same = Run(GenerateSample("room", 40, 20, 60)) &&
+        Run(GenerateSample("large space", 150, 30, 90)) &&
+        Run(GenerateSample("many small surfaces", 400, 5, 20));
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,285 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Reports frame timing, pose alignment and dropped frames from a telemetry file
+// recorded by the compositor (StartTelemetry in UnityCompositorInterface).
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 TelemetryAnalyzer.cpp
+//
+// Usage: TelemetryAnalyzer <n>_Telemetry.svtl
+
+#include "../CompositorDLL/Telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    struct Summary
+    {
+        size_t Count = 0;
+        double Mean = 0;
+        double Deviation = 0;
+        double Median = 0;
+        double P95 = 0;
+        double Max = 0;
+    };
+
+    Summary Summarize(std::vector<double> values)
+    {
+        Summary summary;
+        summary.Count = values.size();
+        if (values.empty())
+        {
+            return summary;
+        }
+
+        double sum = 0;
+        for (double value : values)
+        {
+            sum += value;
+        }
+        summary.Mean = sum / values.size();
+
+        double sumSquares = 0;
+        for (double value : values)
+        {
+            sumSquares += (value - summary.Mean) * (value - summary.Mean);
+        }
+        summary.Deviation = std::sqrt(sumSquares / values.size());
+
+        std::sort(values.begin(), values.end());
+        summary.Median = values[values.size() / 2];
+        summary.P95 = values[std::min(values.size() - 1, values.size() * 95 / 100)];
+        summary.Max = values.back();
+
+        return summary;
+    }
+
+    void PrintSummary(const char* name, const Summary& summary, const char* unit)
+    {
+        if (summary.Count == 0)
+        {
+            printf("  %-28s no samples\n", name);
+            return;
+        }
+
+        printf("  %-28s mean %8.2f  stddev %8.2f  median %8.2f  p95 %8.2f  max %8.2f %s\n",
+            name, summary.Mean, summary.Deviation, summary.Median, summary.P95, summary.Max, unit);
+    }
+
+    bool ReadRecords(const char* path, TelemetryHeader& header, std::vector<TelemetryRecord>& records)
+    {
+        FILE* file = nullptr;
+#if defined(_MSC_VER)
+        fopen_s(&file, path, "rb");
+#else
+        file = fopen(path, "rb");
+#endif
+        if (file == nullptr)
+        {
+            fprintf(stderr, "Can not open %s.\n", path);
+            return false;
+        }
+
+        bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+            header.Magic == TELEMETRY_MAGIC &&
+            header.Version == TELEMETRY_VERSION &&
+            header.RecordSize == sizeof(TelemetryRecord) &&
+            header.Capacity > 0;
+
+        std::vector<TelemetryRecord> ring;
+        if (valid)
+        {
+            ring.resize(header.Capacity);
+            valid = fread(ring.data(), sizeof(TelemetryRecord), ring.size(), file) == ring.size();
+        }
+
+        fclose(file);
+
+        if (!valid)
+        {
+            fprintf(stderr, "%s is not a telemetry file of this version.\n", path);
+            return false;
+        }
+
+        // Oldest record first.
+        uint64_t count = std::min<uint64_t>(header.RecordsWritten, header.Capacity);
+        uint64_t first = header.RecordsWritten - count;
+        records.clear();
+        for (uint64_t i = first; i < header.RecordsWritten; i++)
+        {
+            records.push_back(ring[i % header.Capacity]);
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: TelemetryAnalyzer <telemetry file>\n");
+        return 1;
+    }
+
+    TelemetryHeader header;
+    std::vector<TelemetryRecord> records;
+    if (!ReadRecords(argv[1], header, records))
+    {
+        return 1;
+    }
+
+    if (records.size() < 2)
+    {
+        printf("%zu records, nothing to analyze.\n", records.size());
+        return 0;
+    }
+
+    const double ticksToMs = 1000.0 / header.TimeFrequency;
+    const TelemetryRecord& firstRecord = records.front();
+    const TelemetryRecord& lastRecord = records.back();
+
+    printf("%s: %zu records over %.1f s", argv[1], records.size(), (lastRecord.Time - firstRecord.Time) * ticksToMs / 1000.0);
+    if (header.RecordsWritten > header.Capacity)
+    {
+        printf(", the oldest %llu were overwritten", (unsigned long long)(header.RecordsWritten - header.Capacity));
+    }
+    printf("\n\n");
+
+    // Frame timing.
+    std::vector<double> frameIntervals;
+    std::vector<double> compositeLag;
+    int repeatedFrames = 0;
+    int skippedFrames = 0;
+    int resyncs = 0;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const TelemetryRecord& record = records[i];
+        if (i > 0)
+        {
+            frameIntervals.push_back((record.Time - records[i - 1].Time) * ticksToMs);
+        }
+
+        if (record.CaptureFrame > 0)
+        {
+            compositeLag.push_back(record.CaptureFrame - record.CompositeFrame);
+        }
+
+        if (record.FrameStep == 0 && i > 0 && record.CaptureFrame != records[i - 1].CaptureFrame)
+        {
+            repeatedFrames++;
+        }
+        else if (record.FrameStep > 1)
+        {
+            skippedFrames += record.FrameStep - 1;
+            resyncs++;
+        }
+    }
+
+    Summary intervalSummary = Summarize(frameIntervals);
+    int longFrames = 0;
+    for (double interval : frameIntervals)
+    {
+        longFrames += (interval > 1.5 * intervalSummary.Median) ? 1 : 0;
+    }
+
+    printf("Frames\n");
+    PrintSummary("render interval", intervalSummary, "ms");
+    printf("  %-28s %d (over 1.5x the median interval)\n", "long frames", longFrames);
+    PrintSummary("capture - composite frame", Summarize(compositeLag), "frames");
+    printf("  %-28s %d (composite frame held while capture moved on)\n", "repeated frames", repeatedFrames);
+    printf("  %-28s %d in %d catch ups\n", "skipped capture frames", skippedFrames, resyncs);
+
+    if (firstRecord.CapturedFrames >= 0 && lastRecord.CapturedFrames >= 0)
+    {
+        printf("  %-28s %d captured, %d dropped by the provider\n", "capture",
+            lastRecord.CapturedFrames - firstRecord.CapturedFrames,
+            lastRecord.DroppedFrames - firstRecord.DroppedFrames);
+    }
+    else
+    {
+        printf("  %-28s not counted by this provider\n", "capture");
+    }
+
+    // Pose alignment.
+    std::vector<double> poseAge;
+    std::vector<double> stalePose;
+    std::vector<double> interpolationSpans;
+    std::vector<double> predictionTimes;
+    std::vector<double> poseIntervals;
+    std::vector<double> uncertainty;
+    int posesHeld = 0;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const TelemetryRecord& record = records[i];
+        if (record.LatestPoseIndex < 0 || record.CaptureFrame <= 0)
+        {
+            continue;
+        }
+
+        // Positive when the requested pose is older than the newest one, which is what GetPose aims for.
+        double age = (record.LatestPoseTime - record.PoseTime) * 1000.0;
+        poseAge.push_back(age);
+
+        // The requested pose had not arrived yet, so it was predicted from the newest poses.
+        if (age < 0)
+        {
+            stalePose.push_back(-age);
+        }
+
+        if (record.InterpolationSpan > 0)
+        {
+            interpolationSpans.push_back(record.InterpolationSpan * 1000.0);
+        }
+
+        if (record.PredictionTime > 0)
+        {
+            predictionTimes.push_back(record.PredictionTime * 1000.0);
+        }
+
+        uncertainty.push_back(record.PoseTimeUncertainty * 1000.0);
+
+        if (i > 0 && records[i - 1].LatestPoseIndex >= 0)
+        {
+            if (record.LatestPoseIndex == records[i - 1].LatestPoseIndex)
+            {
+                posesHeld++;
+            }
+            else if (record.LatestPoseIndex > records[i - 1].LatestPoseIndex)
+            {
+                poseIntervals.push_back((record.LatestPoseTime - records[i - 1].LatestPoseTime) * 1000.0 /
+                    (record.LatestPoseIndex - records[i - 1].LatestPoseIndex));
+            }
+        }
+    }
+
+    printf("\nPoses\n");
+    PrintSummary("pose age", Summarize(poseAge), "ms");
+    PrintSummary("alignment error (stale)", Summarize(stalePose), "ms");
+    printf("  %-28s %zu of %zu frames\n", "frames with a stale pose", stalePose.size(), poseAge.size());
+    PrintSummary("clock mapping uncertainty", Summarize(uncertainty), "ms");
+    PrintSummary("interpolation span", Summarize(interpolationSpans), "ms");
+    PrintSummary("prediction", Summarize(predictionTimes), "ms");
+    PrintSummary("pose interval", Summarize(poseIntervals), "ms");
+    printf("  %-28s %d (no new pose since the previous frame)\n", "frames without a new pose", posesHeld);
+
+    // Recording.
+    std::vector<double> queueDepth;
+    for (const TelemetryRecord& record : records)
+    {
+        if (record.EncoderQueueDepth >= 0)
+        {
+            queueDepth.push_back(record.EncoderQueueDepth);
+        }
+    }
+
+    printf("\nRecording\n");
+    PrintSummary("encoder queue depth", Summarize(queueDepth), "samples");
+
+    return 0;
+}
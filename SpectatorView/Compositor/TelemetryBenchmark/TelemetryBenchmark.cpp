@@ -0,0 +1,161 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Measures what recording telemetry costs CompositorInterface::GetPose, one TelemetryRing::Write per frame.
+// Three cases: records written back to back, the first lap through a ring of fresh memory, where
+// every page is touched for the first time like a newly mapped file, and records written at 60 fps,
+// where a frame of other work has pushed the ring out of the cache between two records.
+// Then checks that the ring holds the newest records in order.
+//
+// Only depends on standard C++, build it with:
+//     cl /EHsc /O2 TelemetryBenchmark.cpp
+//
+// Usage: TelemetryBenchmark [records at 60 fps]
+
+#include "../CompositorDLL/Telemetry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // TELEMETRY_RING_RECORDS in TelemetryRecorder.h, 10 minutes at 60 fps.
+    const uint32_t Capacity = 60 * 60 * 10;
+
+    const double FrameNS = 1e9 / 60;
+
+    // More than the last level cache, walked between two records at 60 fps.
+    const size_t OtherWorkBytes = 64 * 1024 * 1024;
+
+    double NS(Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::nano>(duration).count();
+    }
+
+    TelemetryRecord MakeRecord(int frame)
+    {
+        TelemetryRecord record = {};
+        record.Time = frame * 166667LL;
+        record.CompositeFrame = frame;
+        record.CaptureFrame = frame + 1;
+        record.FrameStep = 1;
+        record.CapturedFrames = frame + 1;
+        record.EncoderQueueDepth = -1;
+        record.LatestPoseIndex = frame * 2;
+        record.CameraTime = frame / 60.0f;
+        record.PoseTime = frame / 60.0f - 0.05f;
+        record.LatestPoseTime = frame / 60.0f - 0.04f;
+        record.InterpolationSpan = 1 / 60.0f;
+        record.LatestRotation[3] = 1;
+        return record;
+    }
+
+    double Percentile(std::vector<double> values, double p)
+    {
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(p * (values.size() - 1))];
+    }
+
+    // Shortest time the clock can measure, taken off single record times.
+    double ClockOverheadNS()
+    {
+        std::vector<double> samples;
+        for (int i = 0; i < 10000; i++)
+        {
+            Clock::time_point start = Clock::now();
+            samples.push_back(NS(Clock::now() - start));
+        }
+        return Percentile(samples, 0.5);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int pacedRecords = argc > 1 ? atoi(argv[1]) : 500;
+    if (pacedRecords <= 0)
+    {
+        fprintf(stderr, "Usage: TelemetryBenchmark [records at 60 fps]\n");
+        return 1;
+    }
+
+    size_t memorySize = TelemetryRing::GetMemorySize(Capacity);
+    printf("%u records of %zu bytes, %.1f MB ring.\n\n", Capacity, sizeof(TelemetryRecord), memorySize / (1024.0 * 1024.0));
+
+    std::vector<TelemetryRecord> records;
+    for (uint32_t i = 0; i < Capacity; i++)
+    {
+        records.push_back(MakeRecord((int)i));
+    }
+
+    // First lap through memory no page of which was touched yet.
+    uint8_t* memory = new uint8_t[memorySize];
+    TelemetryRing ring(memory, Capacity, 10000000);
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < Capacity; i++)
+    {
+        ring.Write(records[i]);
+    }
+    double firstLapNS = NS(Clock::now() - start) / Capacity;
+
+    // Back to back, with the ring already in memory.
+    const int laps = 10;
+    start = Clock::now();
+    for (int lap = 0; lap < laps; lap++)
+    {
+        for (uint32_t i = 0; i < Capacity; i++)
+        {
+            ring.Write(records[i]);
+        }
+    }
+    double hotNS = NS(Clock::now() - start) / (laps * (double)Capacity);
+
+    // One record per frame, with the cache cold from the frame's other work.
+    std::vector<uint8_t> otherWork(OtherWorkBytes, 1);
+    double overhead = ClockOverheadNS();
+    std::vector<double> pacedNS;
+    uint64_t sink = 0;
+    for (int i = 0; i < pacedRecords; i++)
+    {
+        for (size_t j = 0; j < otherWork.size(); j += 64)
+        {
+            otherWork[j]++;
+        }
+        sink += otherWork[(size_t)i * 64 % otherWork.size()];
+
+        TelemetryRecord record = records[(size_t)i % Capacity];
+        start = Clock::now();
+        ring.Write(record);
+        pacedNS.push_back(std::max(NS(Clock::now() - start) - overhead, 0.0));
+    }
+
+    printf("Time per record:\n");
+    printf("    back to back            %8.1f ns\n", hotNS);
+    printf("    first lap, fresh pages  %8.1f ns\n", firstLapNS);
+    printf("    60 fps, cold cache      %8.1f ns median, %.1f ns p99, %.1f ns max (%d records)\n",
+        Percentile(pacedNS, 0.5), Percentile(pacedNS, 0.99), Percentile(pacedNS, 1.0), pacedRecords);
+    printf("    worst case is %.4f%% of a 60 fps frame\n", 100 * std::max(Percentile(pacedNS, 1.0), firstLapNS) / FrameNS + (sink == 0 ? 1e-9 : 0));
+
+    // The newest Capacity records are in the ring, the oldest of them where the next one goes.
+    const TelemetryHeader* header = (const TelemetryHeader*)memory;
+    const TelemetryRecord* stored = (const TelemetryRecord*)(header + 1);
+    uint64_t written = (laps + 1) * (uint64_t)Capacity + pacedRecords;
+
+    bool passed = header->Magic == TELEMETRY_MAGIC && header->RecordSize == sizeof(TelemetryRecord) &&
+        header->Capacity == Capacity && header->RecordsWritten == written;
+    for (uint64_t i = written - Capacity; i < written && passed; i++)
+    {
+        uint64_t source = (i < (laps + 1) * (uint64_t)Capacity) ? i % Capacity : (i - (laps + 1) * (uint64_t)Capacity) % Capacity;
+        passed = stored[i % Capacity].CompositeFrame == records[(size_t)source].CompositeFrame;
+    }
+
+    printf("\nRing contents %s.\n", passed ? "are the newest records in order" : "are WRONG");
+
+    delete[] memory;
+    return passed ? 0 : 1;
+}
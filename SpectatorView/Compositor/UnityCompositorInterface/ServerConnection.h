@@ -0,0 +1,234 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "Network.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+/*
+Keeps the connection to the pose server up.
+
+One thread owns the connection. It connects, lets the caller run the
+handshake, then receives until the connection drops, and starts over.
+A failed connect is retried after a wait that doubles up to a maximum,
+with jitter, so an offline HoloLens is not hammered and many compositors
+do not retry in lockstep. The wait starts over once a connection is made.
+Anything that makes a retry worthwhile, like a new server address or the
+app asking for a reconnect, ends the wait right away.
+
+Other threads only send on the socket and read the state.
+
+Only standard C++ and Network.h are used here, so the reconnect times can
+be measured outside of the Windows build, see ReconnectBenchmark.
+*/
+
+// Wait after the first failed connect, it doubles with every failure up to the maximum.
+// The maximum bounds how long a restarted pose server goes unnoticed, it is the 100ms the
+// connection used to be polled at. A refused connect costs next to nothing, and one to a
+// HoloLens that is not there takes CONNECT_TIMEOUT_MS, so retrying this often does not flood it.
+#define RECONNECT_MIN_DELAY_MS  50
+#define RECONNECT_MAX_DELAY_MS  100
+// A HoloLens on the local network answers a connect in milliseconds, longer means it is not there.
+#define CONNECT_TIMEOUT_MS      2000
+
+enum class ConnectionState
+{
+    Idle,               // No server address yet.
+    Connecting,         // Connecting or running the handshake.
+    Connected,
+    WaitingToRetry,
+    Stopped,
+};
+
+class ServerConnection
+{
+public:
+    // onConnected runs on the connection thread before anything is received, false drops the connection.
+    // receive is called in a loop while connected, and returns false once the connection is gone.
+    ServerConnection(TCPSocket& tcp, std::function<bool()> onConnected, std::function<bool()> receive)
+        : tcp(tcp)
+        , onConnected(onConnected)
+        , receive(receive)
+        , random(std::random_device()())
+    {
+    }
+
+    ~ServerConnection()
+    {
+        Stop();
+    }
+
+    void Start()
+    {
+        std::lock_guard<std::mutex> lock(stateLock);
+        if (!thread.joinable())
+        {
+            thread = std::thread(&ServerConnection::Run, this);
+        }
+    }
+
+    // Returns once the connection thread is done, which can take up to CONNECT_TIMEOUT_MS.
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(stateLock);
+            stopping = true;
+            tcp.Shutdown();
+        }
+
+        wakeUp.notify_all();
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+
+    // Connects to address, dropping a connection to any other server.
+    void SetServer(const std::string& serverAddress)
+    {
+        {
+            std::lock_guard<std::mutex> lock(stateLock);
+            if (serverAddress == address)
+            {
+                return;
+            }
+
+            address = serverAddress;
+            retryRequested = true;
+            if (state == ConnectionState::Connected)
+            {
+                tcp.Shutdown();
+            }
+        }
+
+        wakeUp.notify_all();
+    }
+
+    // Connects right away if the connection is down, instead of waiting for the next retry.
+    void WakeUp()
+    {
+        {
+            std::lock_guard<std::mutex> lock(stateLock);
+            retryRequested = true;
+        }
+
+        wakeUp.notify_all();
+    }
+
+    ConnectionState GetState()
+    {
+        return state;
+    }
+
+    bool IsConnected()
+    {
+        return state == ConnectionState::Connected;
+    }
+
+    // From noticing the last dropped connection to being connected again, -1 before the first reconnect.
+    int GetLastReconnectMS()
+    {
+        return lastReconnectMS;
+    }
+
+    int GetConnectAttempts()
+    {
+        return connectAttempts;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    TCPSocket& tcp;
+    std::function<bool()> onConnected;
+    std::function<bool()> receive;
+
+    std::thread thread;
+    std::mutex stateLock;
+    std::condition_variable wakeUp;
+    std::mt19937 random;
+
+    // Guarded by stateLock.
+    std::string address;
+    bool retryRequested = false;
+    bool stopping = false;
+
+    std::atomic<ConnectionState> state { ConnectionState::Idle };
+    std::atomic<int> lastReconnectMS { -1 };
+    std::atomic<int> connectAttempts { 0 };
+
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock(stateLock);
+        int delayMS = RECONNECT_MIN_DELAY_MS;
+        bool dropped = false;
+        Clock::time_point droppedTime;
+
+        while (!stopping)
+        {
+            if (address.empty())
+            {
+                state = ConnectionState::Idle;
+                wakeUp.wait(lock, [this]() { return stopping || !address.empty(); });
+                continue;
+            }
+
+            std::string server = address;
+            state = ConnectionState::Connecting;
+            // Requests from here on are for after this attempt.
+            retryRequested = false;
+            lock.unlock();
+
+            connectAttempts++;
+            bool connected = tcp.CreateClientListener(server.c_str(), CONNECT_TIMEOUT_MS) && onConnected();
+
+            lock.lock();
+            if (connected && !stopping && server == address)
+            {
+                state = ConnectionState::Connected;
+                delayMS = RECONNECT_MIN_DELAY_MS;
+                if (dropped)
+                {
+                    lastReconnectMS = (int)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - droppedTime).count();
+                    OutputDebugString((L"Reconnected to the pose server after " + std::to_wstring(lastReconnectMS.load()) + L" ms.\n").c_str());
+                }
+                lock.unlock();
+
+                while (receive())
+                {
+                }
+
+                lock.lock();
+                OutputDebugString(L"Connection to the pose server was lost.\n");
+                dropped = true;
+                droppedTime = Clock::now();
+
+                // The server is often back already, like after its app restarted, so try again right away.
+                continue;
+            }
+
+            if (stopping)
+            {
+                break;
+            }
+
+            // Anywhere from half the delay to all of it.
+            state = ConnectionState::WaitingToRetry;
+            int waitMS = delayMS / 2 + (int)(random() % (delayMS / 2 + 1));
+            wakeUp.wait_for(lock, std::chrono::milliseconds(waitMS), [this]() { return stopping || retryRequested; });
+
+            delayMS = (delayMS * 2 < RECONNECT_MAX_DELAY_MS) ? delayMS * 2 : RECONNECT_MAX_DELAY_MS;
+        }
+
+        state = ConnectionState::Stopped;
+    }
+};
@@ -14,6 +14,12 @@
 
 #include "Common\DirectXHelper.h"
 #include "RealtimeSurfaceMeshRenderer.h"
+#include "NetworkPacketStructure.h"
+
+#include "CompositorConstants.h"
+#include "MeshCodec.h"
+
+#include <ppl.h>
 
 using namespace SpectatorViewPoseProvider;
 
@@ -27,7 +33,8 @@ using namespace Windows::Perception::Spatial::Surfaces;
 using namespace Platform;
 
 RealtimeSurfaceMeshRenderer::RealtimeSurfaceMeshRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
-    m_deviceResources(deviceResources)
+    m_deviceResources(deviceResources),
+    m_compactSurfaces(offsetof(MeshCodecHeader, Translation))
 {
     m_meshCollection.clear();
     CreateDeviceDependentResources();
@@ -130,50 +137,243 @@ void RealtimeSurfaceMeshRenderer::ClearSurfaces()
     m_meshCollection.clear();
 }
 
-byte* RealtimeSurfaceMeshRenderer::SerializeMeshes(int& length, Windows::Perception::Spatial::SpatialCoordinateSystem^ cs)
+byte* RealtimeSurfaceMeshRenderer::SerializeMeshes(int& length, Windows::Perception::Spatial::SpatialCoordinateSystem^ cs, bool compact)
 {
-    std::lock_guard<std::mutex> guard(m_meshCollectionLock);
+    if (!compact)
+    {
+        return SerializeLegacyMeshes(length, cs);
+    }
+
+    std::lock_guard<std::mutex> cacheGuard(m_serializedSurfacesLock);
     length = 0;
 
-    std::vector<byte*> meshBytes;
-    std::vector<int> meshLengths;
+    long long hits = m_compactSurfaces.Hits;
 
-    for (auto& pair : m_meshCollection)
-    {
-        Platform::Guid id = pair.first;
-        SurfaceMesh& surfaceMesh = pair.second;
+    std::vector<SurfaceToSerialize> surfaces;
+    GetSurfacesToSerialize(cs, surfaces);
 
-        int meshLength;
-        byte* bytes = surfaceMesh.Serialize(meshLength, cs);
+    std::vector<const std::vector<byte>*> surfaceBytes;
+    SerializeSurfaces(surfaces, surfaceBytes);
 
-        if (bytes != nullptr && meshLength > 0)
+    // Surfaces that are gone are dropped, the ones that could not be encoded are left out.
+    std::vector<Guid> ids;
+    std::vector<Guid> payloadIds;
+    for (size_t i = 0; i < surfaces.size(); i++)
+    {
+        ids.push_back(surfaces[i].Id);
+        if (!surfaceBytes[i]->empty())
         {
-            length += meshLength;
-
-            meshBytes.push_back(bytes);
-            meshLengths.push_back(meshLength);
+            payloadIds.push_back(surfaces[i].Id);
         }
     }
+    m_compactSurfaces.Retain(ids);
+
+    const std::vector<byte>& payload = m_compactSurfaces.Payload(payloadIds);
+
+    OutputDebugString((L"Serialized spatial mapping, " + std::to_wstring(m_compactSurfaces.Hits - hits) + L" of "
+        + std::to_wstring(surfaces.size()) + L" surfaces cached.\n").c_str());
 
-    if (length == 0)
+    if (payload.empty())
     {
         return nullptr;
     }
 
+    length = (int)payload.size();
     byte* allMeshBytes = new byte[length];
+    memcpy(allMeshBytes, payload.data(), length);
 
-    int dst = 0;
-    for (unsigned int i = 0; i < meshBytes.size(); i++)
+    return allMeshBytes;
+}
+
+byte* RealtimeSurfaceMeshRenderer::SerializeLegacyMeshes(int& length, Windows::Perception::Spatial::SpatialCoordinateSystem^ cs)
+{
+    length = 0;
+
+    std::vector<SerializedSurface> surfaces;
+    std::vector<SpatialSurfaceMesh^> meshes;
     {
-        int size = meshLengths[i];
-        memcpy(&allMeshBytes[dst], meshBytes[i], size);
-        delete[] meshBytes[i];
-        dst += size;
+        // Only the transforms are computed under the lock, the meshes keep their buffers alive after it.
+        std::lock_guard<std::mutex> guard(m_meshCollectionLock);
+        surfaces.reserve(m_meshCollection.size());
+        meshes.reserve(m_meshCollection.size());
+
+        for (auto& pair : m_meshCollection)
+        {
+            SerializedSurface surface;
+            SpatialSurfaceMesh^ mesh = pair.second.GetSerializedSurface(cs, surface);
+            if (mesh != nullptr)
+            {
+                surfaces.push_back(surface);
+                meshes.push_back(mesh);
+            }
+        }
     }
 
+    size_t totalLength = SurfaceSerializer::Layout(surfaces.data(), (int)surfaces.size());
+    if (totalLength == 0)
+    {
+        return nullptr;
+    }
+
+    byte* allMeshBytes = new byte[totalLength];
+    SurfaceSerializer::WriteAll(surfaces.data(), (int)surfaces.size(), allMeshBytes, [](int count, std::function<void(int)> write)
+    {
+        concurrency::parallel_for(0, count, write);
+    });
+
+    length = (int)totalLength;
     return allMeshBytes;
 }
 
+void RealtimeSurfaceMeshRenderer::GetSurfacesToSerialize(
+    Windows::Perception::Spatial::SpatialCoordinateSystem^ cs,
+    std::vector<SurfaceToSerialize>& surfaces)
+{
+    // Only the transforms are computed under the lock, the meshes keep their buffers alive after it.
+    std::lock_guard<std::mutex> guard(m_meshCollectionLock);
+    surfaces.reserve(m_meshCollection.size());
+
+    for (auto& pair : m_meshCollection)
+    {
+        SurfaceToSerialize surface;
+        surface.Mesh = pair.second.GetSerializedSurface(cs, surface.Surface);
+        if (surface.Mesh != nullptr)
+        {
+            surface.Id = pair.first;
+            surface.UpdateTime = pair.second.GetSerializedUpdateTime();
+            surfaces.push_back(surface);
+        }
+    }
+}
+
+void RealtimeSurfaceMeshRenderer::SerializeSurfaces(
+    const std::vector<SurfaceToSerialize>& surfaces,
+    std::vector<const std::vector<byte>*>& bytes)
+{
+    bytes.resize(surfaces.size());
+
+    std::vector<std::pair<const SerializedSurface*, std::vector<byte>*>> misses;
+    for (size_t i = 0; i < surfaces.size(); i++)
+    {
+        const SurfaceToSerialize& surface = surfaces[i];
+        bytes[i] = m_compactSurfaces.Find(surface.Id, surface.UpdateTime, surface.Surface.Translation);
+        if (bytes[i] == nullptr)
+        {
+            std::vector<byte>& stored = m_compactSurfaces.Store(surface.Id, surface.UpdateTime);
+            misses.push_back(std::make_pair(&surface.Surface, &stored));
+            bytes[i] = &stored;
+        }
+    }
+
+    MeshCodecOptions options;
+    options.PositionBits = SPATIAL_MAPPING_POSITION_BITS;
+    options.EntropyCoding = (SPATIAL_MAPPING_ENTROPY_CODING == TRUE);
+
+    // Every surface goes into its own buffer, which Store does not move.
+    concurrency::parallel_for(0, (int)misses.size(), [&](int i)
+    {
+        const SerializedSurface& surface = *misses[i].first;
+        std::vector<byte>& surfaceBytes = *misses[i].second;
+
+        if (surface.NumVertices > 0 && surface.NumIndices > 0 &&
+            !SurfaceSerializer::EncodeCompact(surface, options, surfaceBytes))
+        {
+            OutputDebugString(L"Spatial mapping surface has an index out of range, skipping it.\n");
+            surfaceBytes.clear();
+        }
+    });
+}
+
+byte* RealtimeSurfaceMeshRenderer::SerializeMeshUpdate(
+    int& length,
+    Windows::Perception::Spatial::SpatialCoordinateSystem^ cs,
+    const SurfaceUpdateTimes& clientSurfaces,
+    SurfaceUpdateTimes& surfaces)
+{
+    static_assert(sizeof(Platform::Guid) == sizeof(SpatialMappingSurfaceEntry::surfaceID),
+        "Surface IDs are sent as the bytes of a Guid.");
+
+    std::lock_guard<std::mutex> cacheGuard(m_serializedSurfacesLock);
+    length = 0;
+
+    std::vector<SurfaceToSerialize> readySurfaces;
+    GetSurfacesToSerialize(cs, readySurfaces);
+
+    // Only the meshes the client does not have are serialized, every surface is retained in the cache.
+    std::vector<bool> sendMesh(readySurfaces.size());
+    std::vector<SurfaceToSerialize> meshSurfaces;
+    for (size_t i = 0; i < readySurfaces.size(); i++)
+    {
+        auto clientSurface = clientSurfaces.find(readySurfaces[i].Id);
+        sendMesh[i] = clientSurface == clientSurfaces.end() || clientSurface->second != readySurfaces[i].UpdateTime;
+        if (sendMesh[i])
+        {
+            meshSurfaces.push_back(readySurfaces[i]);
+        }
+    }
+
+    std::vector<const std::vector<byte>*> meshBytes;
+    SerializeSurfaces(meshSurfaces, meshBytes);
+
+    std::vector<Guid> ids;
+    for (const SurfaceToSerialize& surface : readySurfaces)
+    {
+        ids.push_back(surface.Id);
+    }
+    m_compactSurfaces.Retain(ids);
+
+    SpatialMappingUpdateHeader header = {};
+    std::vector<SpatialMappingSurfaceEntry> entries;
+    std::vector<byte> meshes;
+
+    size_t mesh = 0;
+    for (size_t i = 0; i < readySurfaces.size(); i++)
+    {
+        const SurfaceToSerialize& surface = readySurfaces[i];
+
+        SpatialMappingSurfaceEntry entry = {};
+        memcpy(entry.surfaceID, &surface.Id, sizeof(entry.surfaceID));
+        memcpy(entry.translation, surface.Surface.Translation, sizeof(entry.translation));
+        memcpy(entry.rotation, surface.Surface.Rotation, sizeof(entry.rotation));
+        memcpy(entry.scale, surface.Surface.Scale, sizeof(entry.scale));
+
+        if (sendMesh[i])
+        {
+            const std::vector<byte>& bytes = *meshBytes[mesh++];
+            if (bytes.empty())
+            {
+                continue;
+            }
+
+            meshes.insert(meshes.end(), bytes.begin(), bytes.end());
+
+            entry.hasMesh = 1;
+            header.numMeshes++;
+        }
+
+        entries.push_back(entry);
+        surfaces[surface.Id] = surface.UpdateTime;
+    }
+
+    header.numSurfaces = (int)entries.size();
+
+    int entriesLength = (int)(entries.size() * sizeof(SpatialMappingSurfaceEntry));
+    length = (int)sizeof(header) + entriesLength + (int)meshes.size();
+    byte* buffer = new byte[length];
+
+    memcpy(buffer, &header, sizeof(header));
+    if (entriesLength > 0)
+    {
+        memcpy(&buffer[sizeof(header)], entries.data(), entriesLength);
+    }
+    if (!meshes.empty())
+    {
+        memcpy(&buffer[sizeof(header) + entriesLength], meshes.data(), meshes.size());
+    }
+
+    return buffer;
+}
+
 void RealtimeSurfaceMeshRenderer::HideInactiveMeshes(IMapView<Guid, SpatialSurfaceInfo^>^ const& surfaceCollection)
 {
     std::lock_guard<std::mutex> guard(m_meshCollectionLock);
@@ -15,11 +15,15 @@
 #include "Common\StepTimer.h"
 #include "SurfaceMesh.h"
 #include "Content\ShaderStructures.h"
+#include "SerializedSurfaceCache.h"
 
 #include <memory>
 #include <map>
 #include <ppltasks.h>
 
+// SpatialSurfaceInfo::UpdateTime of every surface, by SpatialSurfaceInfo::Id.
+typedef std::map<Platform::Guid, long long> SurfaceUpdateTimes;
+
 class RealtimeSurfaceMeshRenderer
 {
 public:
@@ -37,7 +41,15 @@ public:
     void UpdateSurface(Platform::Guid id, Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo^ newSurface);
     void RemoveSurface(Platform::Guid id);
     void ClearSurfaces();
-    byte* SerializeMeshes(int& length, Windows::Perception::Spatial::SpatialCoordinateSystem^ cs);
+    // compact uses the MeshCodec format instead of the one Unity reads with protocol versions below 3.
+    byte* SerializeMeshes(int& length, Windows::Perception::Spatial::SpatialCoordinateSystem^ cs, bool compact);
+    // SpatialMappingUpdateHeader format, with the meshes of surfaces that are not in clientSurfaces
+    // at the same update time. surfaces gets the update time of every surface in the update.
+    byte* SerializeMeshUpdate(
+        int& length,
+        Windows::Perception::Spatial::SpatialCoordinateSystem^ cs,
+        const SurfaceUpdateTimes& clientSurfaces,
+        SurfaceUpdateTimes& surfaces);
 
     Windows::Foundation::DateTime GetLastUpdateTime(Platform::Guid id);
 
@@ -46,6 +58,28 @@ public:
         Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo^>^ const& surfaceCollection);
 
 private:
+    // Legacy format of every surface, written in parallel into one buffer.
+    byte* SerializeLegacyMeshes(int& length, Windows::Perception::Spatial::SpatialCoordinateSystem^ cs);
+
+    // A surface taken out of the collection to be serialized, with the mesh its buffers belong to.
+    struct SurfaceToSerialize
+    {
+        Platform::Guid Id;
+        long long UpdateTime;
+        SerializedSurface Surface;
+        Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh^ Mesh;
+    };
+
+    // Every surface that is ready, taken under the collection lock so the rest can be done without it.
+    void GetSurfacesToSerialize(
+        Windows::Perception::Spatial::SpatialCoordinateSystem^ cs,
+        std::vector<SurfaceToSerialize>& surfaces);
+    // MeshCodec format of every surface, from m_compactSurfaces or encoded in parallel if it is not there.
+    // bytes gets them in the order of surfaces, empty for a surface that can not be encoded.
+    void SerializeSurfaces(
+        const std::vector<SurfaceToSerialize>& surfaces,
+        std::vector<const std::vector<byte>*>& bytes);
+
     Concurrency::task<void> AddOrUpdateSurfaceAsync(Platform::Guid id, Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo^ newSurface);
 
     // Cached pointer to device resources.
@@ -64,6 +98,12 @@ private:
     // A way to lock map access.
     std::mutex                                      m_meshCollectionLock;
 
+    // Surfaces in the MeshCodec format, so the ones that did not change since the last request are not
+    // encoded again. Only used under m_serializedSurfacesLock. The legacy format is not cached, writing it
+    // takes about as long as copying it.
+    SerializedSurfaceCache<Platform::Guid>          m_compactSurfaces;
+    std::mutex                                      m_serializedSurfacesLock;
+
     // Total number of surface meshes.
     unsigned int                                    m_surfaceMeshCount;
 
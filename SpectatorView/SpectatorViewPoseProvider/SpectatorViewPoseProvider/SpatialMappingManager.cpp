@@ -66,7 +66,7 @@ void SpatialMappingManager::StartSurfaceObserver()
     isSpatialMappingActive = true;
 }
 
-byte* SpatialMappingManager::GetMeshData(int& length, SpatialCoordinateSystem^ cs)
+byte* SpatialMappingManager::GetMeshData(int& length, SpatialCoordinateSystem^ cs, bool compact)
 {
     std::lock_guard<std::mutex> lock(m_resetMutex);
     if (m_meshRenderer == nullptr)
@@ -74,7 +74,18 @@ byte* SpatialMappingManager::GetMeshData(int& length, SpatialCoordinateSystem^ c
         return nullptr;
     }
 
-    return m_meshRenderer->SerializeMeshes(length, cs);
+    return m_meshRenderer->SerializeMeshes(length, cs, compact);
+}
+
+byte* SpatialMappingManager::GetMeshUpdate(int& length, SpatialCoordinateSystem^ cs, const SurfaceUpdateTimes& clientSurfaces, SurfaceUpdateTimes& surfaces)
+{
+    std::lock_guard<std::mutex> lock(m_resetMutex);
+    if (m_meshRenderer == nullptr)
+    {
+        return nullptr;
+    }
+
+    return m_meshRenderer->SerializeMeshUpdate(length, cs, clientSurfaces, surfaces);
 }
 
 void SpatialMappingManager::OnSurfacesChanged(
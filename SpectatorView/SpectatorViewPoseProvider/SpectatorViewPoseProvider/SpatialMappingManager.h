@@ -68,7 +68,8 @@ public:
     void CreateDeviceDependentResources();
     void ReleaseDeviceDependentResources();
 
-    byte* GetMeshData(int& length, SpatialCoordinateSystem^ cs);
+    byte* GetMeshData(int& length, SpatialCoordinateSystem^ cs, bool compact);
+    byte* GetMeshUpdate(int& length, SpatialCoordinateSystem^ cs, const SurfaceUpdateTimes& clientSurfaces, SurfaceUpdateTimes& surfaces);
 
     void StartSurfaceObserver();
 };
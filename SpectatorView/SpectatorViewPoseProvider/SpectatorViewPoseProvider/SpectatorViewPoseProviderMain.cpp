@@ -152,19 +152,24 @@ void SpectatorViewPoseProviderMain::ConnectToAnchorOwner()
 void SpectatorViewPoseProviderMain::SendSpatialMappingData()
 {
     // Get spatial mapping data relative to coordinate system.
-    int length;
-    byte* bytes = nullptr;
+    SpatialCoordinateSystem^ cs = m_referenceFrame->CoordinateSystem;
     SpatialCoordinateSystem^ anchorCoordSystem = anchorImporter.GetSharedAnchorCoordinateSystem();
     if (anchorCoordSystem != nullptr &&
         anchorCoordSystem->TryGetTransformTo(m_referenceFrame->CoordinateSystem) != nullptr)
     {
-        bytes = m_spatialMappingManager.GetMeshData(length, anchorCoordSystem);
+        cs = anchorCoordSystem;
     }
-    else
+
+    if (SVSocket.GetProtocolVersion() >= 4)
     {
-        bytes = m_spatialMappingManager.GetMeshData(length, m_referenceFrame->CoordinateSystem);
+        SendSpatialMappingUpdate(cs);
+        return;
     }
 
+    // Clients from protocol version 3 on read the compact format.
+    int length = 0;
+    byte* bytes = m_spatialMappingManager.GetMeshData(length, cs, SVSocket.GetProtocolVersion() >= 3);
+
     if (length == 0 || bytes == nullptr)
     {
         return;
@@ -179,6 +184,58 @@ void SpectatorViewPoseProviderMain::SendSpatialMappingData()
     delete[] bytes;
 }
 
+void SpectatorViewPoseProviderMain::SendSpatialMappingUpdate(SpatialCoordinateSystem^ cs)
+{
+    std::lock_guard<std::mutex> lock(m_clientSurfacesLock);
+
+    // A compositor that just connected has no surfaces.
+    int connection = SVSocket.GetConnectionID();
+    if (connection != m_clientSurfacesConnection)
+    {
+        m_clientSurfaces.clear();
+        m_clientSurfacesConnection = connection;
+    }
+
+    int length = 0;
+    SurfaceUpdateTimes surfaces;
+    byte* bytes = m_spatialMappingManager.GetMeshUpdate(length, cs, m_clientSurfaces, surfaces);
+    if (length == 0 || bytes == nullptr)
+    {
+        return;
+    }
+
+    // Until this update arrives the compositor could have either set of surfaces,
+    // so only the ones that are the same in both can go without their mesh next time.
+    for (auto surface = m_clientSurfaces.begin(); surface != m_clientSurfaces.end();)
+    {
+        auto sent = surfaces.find(surface->first);
+        if (sent == surfaces.end() || sent->second != surface->second)
+        {
+            surface = m_clientSurfaces.erase(surface);
+        }
+        else
+        {
+            surface++;
+        }
+    }
+
+    OutputDebugString((L"Sending " + std::to_wstring(length) + L" bytes of spatial mapping for "
+        + std::to_wstring(surfaces.size()) + L" surfaces.\n").c_str());
+
+    int update = ++m_latestSurfaceUpdate;
+    auto sentSurfaces = std::make_shared<SurfaceUpdateTimes>(std::move(surfaces));
+    SVSocket.SendSpatialMapping(bytes, length, [this, sentSurfaces, update, connection]()
+    {
+        // Once an older update arrives the newer one can still replace it, so only the latest counts.
+        std::lock_guard<std::mutex> lock(m_clientSurfacesLock);
+        if (update == m_latestSurfaceUpdate && connection == m_clientSurfacesConnection)
+        {
+            m_clientSurfaces = *sentSurfaces;
+        }
+    });
+    delete[] bytes;
+}
+
 // Updates the application state once per frame.
 HolographicFrame^ SpectatorViewPoseProviderMain::Update()
 {
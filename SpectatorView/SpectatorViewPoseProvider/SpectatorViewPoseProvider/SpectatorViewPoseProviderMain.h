@@ -107,7 +107,15 @@ namespace SpectatorViewPoseProvider
         AnchorImporter anchorImporter;
         SpatialMappingManager m_spatialMappingManager;
 
+        // Surfaces the compositor has, whichever of the updates in flight it ends up with.
+        // Only these are sent without their mesh.
+        SurfaceUpdateTimes m_clientSurfaces;
+        int m_clientSurfacesConnection = -1;
+        int m_latestSurfaceUpdate = 0;
+        std::mutex m_clientSurfacesLock;
+
         void ConnectToAnchorOwner();
         void SendSpatialMappingData();
+        void SendSpatialMappingUpdate(Windows::Perception::Spatial::SpatialCoordinateSystem^ cs);
     };
 }
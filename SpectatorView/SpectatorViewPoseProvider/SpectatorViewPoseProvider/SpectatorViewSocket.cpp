@@ -24,6 +24,15 @@ SpectatorViewSocket::SpectatorViewSocket()
             tcp.ServerEstablishConnection();
             OutputDebugString(L"Connection Created!\n");
 
+            // The previous connection, and anything still being sent on it, is gone.
+            connectionEstablished = false;
+            connectionID++;
+            poseChannel.Close();
+
+            // Nothing else is sent or received until the handshake is done.
+            protocolVersion = ServerHandshake(tcp);
+            OutputDebugString((L"Protocol version: " + std::to_wstring(protocolVersion) + L"\n").c_str());
+
             connectionEstablished = true;
         }
     });
@@ -47,39 +56,46 @@ bool SpectatorViewSocket::Listen()
     {
         if (connectionEstablished)
         {
-            int recvLen = sizeof(ClientToServerPacket);
-            if (tcp.ReceiveData(recvbuf, recvLen))
+            bool received = false;
+            if (protocolVersion > 0)
             {
-                memcpy(&packet, recvbuf, recvLen);
-
-                // Get anchor owner information
-                std::string ip = std::string(packet.anchorOwnerIP, packet.anchorIPLength);
-                std::string name = std::string(packet.anchorName, packet.anchorNameLength);
-                if (ip != anchorOwnerIP 
-                    || name != anchorName 
-                    || packet.forceAnchorReconnect)
+                int type;
+                byte* payload;
+                int length;
+                received = tcp.ReceiveMessage(type, payload, length);
+
+                // Skip messages this version does not know about.
+                if (received && type == PacketType::ClientRequest && length >= (int)sizeof(ClientToServerPacket))
                 {
-                    OutputDebugString(L"Found a new anchor owner: ");
-                    OutputDebugString(StringHelper::s2ws(ip).c_str());
-                    OutputDebugString(L", On port: ");
-                    OutputDebugString(std::to_wstring(packet.anchorPort).c_str());
-                    OutputDebugString(L", Named: ");
-                    OutputDebugString(StringHelper::s2ws(name).c_str());
-                    OutputDebugString(L"\n");
-
-                    anchorOwnerIP = ip;
-                    anchorName = name;
-                    anchorPort = packet.anchorPort;
-
-                    ConnectToAnchorOwner = true;
+                    memcpy(&packet, payload, sizeof(ClientToServerPacket));
+                    HandleClientPacket();
                 }
-
-                if (packet.requestSpatialMapping)
+                else if (received && type == PacketType::SpatialMappingAck && length >= (int)sizeof(SpatialMappingAckPacket))
                 {
-                    OutputDebugString(L"Sending Spatial Mapping Information.\n");
-                    SendSpatialMappingData = true;
+                    SpatialMappingAckPacket ack;
+                    memcpy(&ack, payload, sizeof(ack));
+                    HandleSpatialMappingAck(ack);
                 }
+                else if (received && type == PacketType::PoseChannelRequest && length >= (int)sizeof(PoseChannelRequestPacket))
+                {
+                    PoseChannelRequestPacket request;
+                    memcpy(&request, payload, sizeof(request));
+                    HandlePoseChannelRequest(request);
+                }
+            }
+            else
+            {
+                int recvLen = sizeof(ClientToServerPacket);
+                received = tcp.ReceiveData(recvbuf, recvLen);
+                if (received)
+                {
+                    memcpy(&packet, recvbuf, recvLen);
+                    HandleClientPacket();
+                }
+            }
 
+            if (received)
+            {
                 return true;
             }
             else
@@ -93,6 +109,84 @@ bool SpectatorViewSocket::Listen()
     return false;
 }
 
+void SpectatorViewSocket::HandleClientPacket()
+{
+    // Get anchor owner information
+    std::string ip = std::string(packet.anchorOwnerIP, packet.anchorIPLength);
+    std::string name = std::string(packet.anchorName, packet.anchorNameLength);
+    if (ip != anchorOwnerIP 
+        || name != anchorName 
+        || packet.forceAnchorReconnect)
+    {
+        OutputDebugString(L"Found a new anchor owner: ");
+        OutputDebugString(StringHelper::s2ws(ip).c_str());
+        OutputDebugString(L", On port: ");
+        OutputDebugString(std::to_wstring(packet.anchorPort).c_str());
+        OutputDebugString(L", Named: ");
+        OutputDebugString(StringHelper::s2ws(name).c_str());
+        OutputDebugString(L"\n");
+
+        anchorOwnerIP = ip;
+        anchorName = name;
+        anchorPort = packet.anchorPort;
+
+        ConnectToAnchorOwner = true;
+    }
+
+    if (packet.requestSpatialMapping)
+    {
+        OutputDebugString(L"Sending Spatial Mapping Information.\n");
+        SendSpatialMappingData = true;
+    }
+}
+
+void SpectatorViewSocket::HandleSpatialMappingAck(const SpatialMappingAckPacket& ack)
+{
+    std::function<void()> received;
+    {
+        std::lock_guard<std::mutex> lock(ackLock);
+        if (ack.transferID != spatialMappingTransferID)
+        {
+            return;
+        }
+
+        spatialMappingBytesAcked = ack.bytesReceived;
+        if (spatialMappingBytesAcked >= spatialMappingBytesToAck)
+        {
+            received.swap(spatialMappingReceived);
+        }
+    }
+
+    ackReceived.notify_all();
+
+    if (received)
+    {
+        received();
+    }
+}
+
+void SpectatorViewSocket::HandlePoseChannelRequest(const PoseChannelRequestPacket& request)
+{
+    poseChannel.Close();
+    if (request.port <= 0)
+    {
+        OutputDebugString(L"Sending poses over TCP.\n");
+        return;
+    }
+
+    // The datagrams go to the address the client connected from.
+    sockaddr_storage address;
+    int addressLength;
+    if (!tcp.GetPeerAddress(address, addressLength) ||
+        !poseChannel.Open(address, addressLength, request.port, (uint32_t)request.channelID))
+    {
+        OutputDebugString(L"Can not open the pose channel, sending poses over TCP.\n");
+        return;
+    }
+
+    OutputDebugString((L"Sending poses over UDP to port " + std::to_wstring(request.port) + L".\n").c_str());
+}
+
 void SpectatorViewSocket::GetPose(SpatialCoordinateSystem^ cs, int nsPast)
 {
     try
@@ -168,7 +262,21 @@ void SpectatorViewSocket::SendPose(SpatialCoordinateSystem^ cs)
         if (connectionEstablished)
         {
             GetPose(cs, 0);
-            if (!tcp.SendData((byte*)&currentPose, sizeof(currentPose)))
+
+            // A datagram that does not arrive only loses this pose, the client asks for TCP if none do.
+            if (poseChannel.IsOpen())
+            {
+                poseChannel.Send(&currentPose, sizeof(currentPose));
+                return;
+            }
+
+            posesWaiting++;
+            bool sent = (protocolVersion > 0) ?
+                tcp.SendMessageBytes(PacketType::Pose, &currentPose, sizeof(currentPose)) :
+                tcp.SendData((byte*)&currentPose, sizeof(currentPose));
+            posesWaiting--;
+
+            if (!sent)
             {
                 connectionEstablished = false;
             }
@@ -177,42 +285,177 @@ void SpectatorViewSocket::SendPose(SpatialCoordinateSystem^ cs)
     catch (...) { }
 }
 
-void SpectatorViewSocket::SendSpatialMapping(byte* bytes, int length)
+void SpectatorViewSocket::SendSpatialMapping(byte* bytes, int length, std::function<void()> received)
 {
-    // Segment bytes into packet sized chunks.
-    SpatialMappingPacket packet;
+    if (!connectionEstablished || bytes == nullptr || length <= 0)
+    {
+        return;
+    }
 
-    int numPackets = (int)ceil((float)length / (float)SPATIAL_MAPPING_BUFSIZE);
-    int numBytesWritten = 0;
+    // The caller's buffer is copied, since the transfer takes many frames.
+    std::shared_ptr<std::vector<byte>> mesh = std::make_shared<std::vector<byte>>(bytes, bytes + length);
+    int transferID = ++spatialMappingTransferID;
+    int connection = connectionID;
 
-    try
+    create_task([this, mesh, transferID, connection, received]
     {
-        if (connectionEstablished)
+        // Waits for an older transfer to see the new ID and stop.
+        std::lock_guard<std::mutex> lock(spatialMappingLock);
+        if (!IsTransferCurrent(transferID, connection))
+        {
+            return;
+        }
+
+        LARGE_INTEGER startTime, endTime;
+        QueryPerformanceCounter(&startTime);
+
+        SpatialMappingBytesTotal = (int)mesh->size();
+        SpatialMappingBytesSent = 0;
+
+        try
         {
-            for (int i = 0; i < numPackets; i++)
+            if (protocolVersion >= 2)
             {
-                int currentPacketLength = SPATIAL_MAPPING_BUFSIZE;
-                if (numBytesWritten + currentPacketLength > length)
+                SendSpatialMappingChunks(*mesh, transferID, connection, received);
+            }
+            else if (protocolVersion == 1)
+            {
+                if (tcp.SendMessageBytes(PacketType::SpatialMapping, mesh->data(), (int)mesh->size()))
+                {
+                    SpatialMappingBytesSent = (int)mesh->size();
+                }
+                else
                 {
-                    currentPacketLength = length - numBytesWritten;
+                    connectionEstablished = false;
                 }
+            }
+            else
+            {
+                SendSpatialMappingPackets(*mesh, transferID, connection);
+            }
+        }
+        catch (...) {}
+
+        QueryPerformanceCounter(&endTime);
+        float ms = (float)(endTime.QuadPart - startTime.QuadPart) * 1000.0f / (float)freq;
+
+        OutputDebugString((L"Sent " + std::to_wstring(SpatialMappingBytesSent.load())
+            + L" of " + std::to_wstring(mesh->size())
+            + L" bytes of spatial mapping in " + std::to_wstring(ms) + L" ms.\n").c_str());
+
+        SpatialMappingBytesSent = 0;
+        SpatialMappingBytesTotal = 0;
+    });
+}
+
+bool SpectatorViewSocket::IsTransferCurrent(int transferID, int connection)
+{
+    return connectionEstablished &&
+        transferID == spatialMappingTransferID &&
+        connection == connectionID;
+}
 
-                packet.packetStartIndex = numBytesWritten;
-                packet.bytesWrittenThisPacket = currentPacketLength;
-                packet.totalSpatialMappingBytes = length;
-                packet.numSpatialMappingPackets = numPackets;
+void SpectatorViewSocket::SendSpatialMappingChunks(const std::vector<byte>& bytes, int transferID, int connection, std::function<void()> received)
+{
+    SpatialMappingChunkHeader header;
+    header.transferID = transferID;
+    header.totalBytes = (int)bytes.size();
 
-                memcpy(&packet.payload[0], &bytes[packet.packetStartIndex], currentPacketLength);
-                numBytesWritten += currentPacketLength;
+    {
+        std::lock_guard<std::mutex> lock(ackLock);
+        spatialMappingBytesAcked = 0;
+        spatialMappingBytesToAck = header.totalBytes;
+        spatialMappingReceived = received;
+    }
 
-                if (!tcp.SendData((byte*)&packet, sizeof(packet)))
+    for (int offset = 0; offset < header.totalBytes; offset += SPATIAL_MAPPING_CHUNK_SIZE)
+    {
+        // Keep the bytes in flight within the window, the socket would otherwise buffer
+        // the whole mesh ahead of the next pose.
+        {
+            std::unique_lock<std::mutex> lock(ackLock);
+            while (offset + SPATIAL_MAPPING_CHUNK_SIZE - spatialMappingBytesAcked > SPATIAL_MAPPING_WINDOW)
+            {
+                ackReceived.wait_for(lock, std::chrono::milliseconds(100));
+                if (!IsTransferCurrent(transferID, connection))
                 {
-                    connectionEstablished = false;
+                    return;
                 }
             }
         }
+
+        // Let poses that are about to be sent go first, so they only ever wait for one chunk.
+        while (posesWaiting > 0)
+        {
+            std::this_thread::yield();
+        }
+
+        if (!IsTransferCurrent(transferID, connection))
+        {
+            return;
+        }
+
+        int chunkLength = header.totalBytes - offset;
+        if (chunkLength > SPATIAL_MAPPING_CHUNK_SIZE)
+        {
+            chunkLength = SPATIAL_MAPPING_CHUNK_SIZE;
+        }
+
+        header.offset = offset;
+        TCPSocket::MessagePart parts[] =
+        {
+            { &header, sizeof(header) },
+            { &bytes[offset], chunkLength },
+        };
+
+        if (!tcp.SendMessageParts(PacketType::SpatialMappingChunk, parts, 2))
+        {
+            connectionEstablished = false;
+            return;
+        }
+
+        SpatialMappingBytesSent = offset + chunkLength;
+    }
+}
+
+void SpectatorViewSocket::SendSpatialMappingPackets(const std::vector<byte>& bytes, int transferID, int connection)
+{
+    // Version 0 clients need the bytes segmented into packet sized chunks.
+    SpatialMappingPacket packet;
+
+    int length = (int)bytes.size();
+    int numPackets = (int)ceil((float)length / (float)SPATIAL_MAPPING_BUFSIZE);
+    int numBytesWritten = 0;
+
+    for (int i = 0; i < numPackets; i++)
+    {
+        if (!IsTransferCurrent(transferID, connection))
+        {
+            return;
+        }
+
+        int currentPacketLength = SPATIAL_MAPPING_BUFSIZE;
+        if (numBytesWritten + currentPacketLength > length)
+        {
+            currentPacketLength = length - numBytesWritten;
+        }
+
+        packet.packetStartIndex = numBytesWritten;
+        packet.bytesWrittenThisPacket = currentPacketLength;
+        packet.totalSpatialMappingBytes = length;
+        packet.numSpatialMappingPackets = numPackets;
+
+        memcpy(&packet.payload[0], &bytes[packet.packetStartIndex], currentPacketLength);
+        numBytesWritten += currentPacketLength;
+
+        if (!tcp.SendData((byte*)&packet, sizeof(packet)))
+        {
+            connectionEstablished = false;
+            return;
+        }
+
+        SpatialMappingBytesSent = numBytesWritten;
     }
-    catch (...) {}
 }
 
 
@@ -4,10 +4,16 @@
 #pragma once
 #include "Network.h"
 #include "NetworkPacketStructure.h"
+#include "PoseChannel.h"
 #include "CompositorConstants.h"
 #include "StringHelper.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
 #include <ppltasks.h>
+#include <thread>
 using namespace concurrency;
 
 using namespace Windows::Perception;
@@ -22,19 +28,33 @@ public:
     SpectatorViewSocket();
     ~SpectatorViewSocket();
 
-    void SendSpatialMapping(byte* bytes, int length);
+    // Sends in the background next to the poses, bytes can be deleted right away.
+    // A new call stops a transfer that has not finished.
+    // From protocol version 2 on, received runs on the network thread once the client has all of it.
+    void SendSpatialMapping(byte* bytes, int length, std::function<void()> received = nullptr);
     void SendPose(SpatialCoordinateSystem^ cs);
     bool Listen();
 
+    // Negotiated with the current client, 0 for fixed size packets.
+    int GetProtocolVersion() { return protocolVersion; }
+    // Changes whenever a client connects.
+    int GetConnectionID() { return connectionID; }
+
     std::string anchorOwnerIP;
     std::string anchorName;
     int anchorPort;
     bool ConnectToAnchorOwner = false;
     bool SendSpatialMappingData = false;
 
+    // Progress of the spatial mapping being sent, 0 of 0 when none is.
+    std::atomic<int> SpatialMappingBytesSent { 0 };
+    std::atomic<int> SpatialMappingBytesTotal { 0 };
+
 private:
     WSASession session;
     TCPSocket tcp;
+    // Carries the poses instead of tcp while the client asks for it.
+    PoseChannelSender poseChannel;
 
     Windows::Globalization::Calendar^ calendar = nullptr;
     SpatialLocator^ locator;
@@ -42,12 +62,37 @@ private:
     SVPose currentPose;
 
     bool connectionEstablished = false;
+    // Negotiated when the connection is established, 0 for fixed size packets.
+    int protocolVersion = 0;
+    // Counts accepted connections, so a transfer stops when its connection is replaced.
+    std::atomic<int> connectionID { 0 };
+
+    // Poses about to be sent, spatial mapping chunks wait for them.
+    std::atomic<int> posesWaiting { 0 };
+    // ID of the newest spatial mapping transfer, the running one stops when it changes.
+    std::atomic<int> spatialMappingTransferID { 0 };
+    std::mutex spatialMappingLock;
+
+    // Bytes of the running transfer the client has received.
+    int spatialMappingBytesAcked = 0;
+    int spatialMappingBytesToAck = 0;
+    std::function<void()> spatialMappingReceived;
+    std::mutex ackLock;
+    std::condition_variable ackReceived;
 
     LONGLONG freq;
 
     byte* recvbuf = new byte[DEFAULT_BUFLEN];
     ClientToServerPacket packet;
 
+    void HandleClientPacket();
+    void HandleSpatialMappingAck(const SpatialMappingAckPacket& ack);
+    void HandlePoseChannelRequest(const PoseChannelRequestPacket& request);
+
+    bool IsTransferCurrent(int transferID, int connection);
+    void SendSpatialMappingChunks(const std::vector<byte>& bytes, int transferID, int connection, std::function<void()> received);
+    void SendSpatialMappingPackets(const std::vector<byte>& bytes, int transferID, int connection);
+
     // Get time from compositor peer, find past pose, send pose back to peer.
     void GetPose(SpatialCoordinateSystem^ cs, int nsPast);
 };
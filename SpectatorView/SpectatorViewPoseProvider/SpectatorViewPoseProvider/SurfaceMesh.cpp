@@ -18,6 +18,9 @@
 #include "GetDataFromIBuffer.h"
 #include "SurfaceMesh.h"
 
+#include "CompositorConstants.h"
+#include "MeshCodec.h"
+
 using namespace DirectX;
 using namespace Windows::Perception::Spatial;
 using namespace Windows::Perception::Spatial::Surfaces;
@@ -275,15 +278,17 @@ void SurfaceMesh::CreateVertexResources(
 
     // Surface mesh resources are created off-thread, so that they don't affect rendering latency.'
     auto taskOptions = Concurrency::task_options();
-    auto task = concurrency::create_task([this, device]()
+    // The mesh can be replaced again before the task runs, the buffers have to go with the one they come from.
+    SpatialSurfaceMesh^ surfaceMesh = m_surfaceMesh;
+    auto task = concurrency::create_task([this, device, surfaceMesh]()
     {
         // Create new Direct3D device resources for the updated buffers. These will be set aside
         // for now, and then swapped into the active slot next time the render loop is ready to draw.
 
         // First, we acquire the raw data buffers.
-        Windows::Storage::Streams::IBuffer^ positions = m_surfaceMesh->VertexPositions->Data;
-        Windows::Storage::Streams::IBuffer^ normals = m_surfaceMesh->VertexNormals->Data;
-        Windows::Storage::Streams::IBuffer^ indices = m_surfaceMesh->TriangleIndices->Data;
+        Windows::Storage::Streams::IBuffer^ positions = surfaceMesh->VertexPositions->Data;
+        Windows::Storage::Streams::IBuffer^ normals = surfaceMesh->VertexNormals->Data;
+        Windows::Storage::Streams::IBuffer^ indices = surfaceMesh->TriangleIndices->Data;
 
         // Then, we create Direct3D device buffers with the mesh data provided by HoloLens.
         Microsoft::WRL::ComPtr<ID3D11Buffer> updatedVertexPositions;
@@ -297,7 +302,7 @@ void SurfaceMesh::CreateVertexResources(
         {
             std::lock_guard<std::mutex> lock(m_meshResourcesMutex);
 
-            auto meshUpdateTime = m_surfaceMesh->SurfaceInfo->UpdateTime;
+            auto meshUpdateTime = surfaceMesh->SurfaceInfo->UpdateTime;
             if (meshUpdateTime.UniversalTime > m_lastUpdateTime.UniversalTime)
             {
 
@@ -308,10 +313,12 @@ void SurfaceMesh::CreateVertexResources(
                 m_updatedTriangleIndices.Swap(updatedTriangleIndices);
 
                 // Cache properties for the buffers we will now use.
-                m_updatedMeshProperties.vertexStride = m_surfaceMesh->VertexPositions->Stride;
-                m_updatedMeshProperties.normalStride = m_surfaceMesh->VertexNormals->Stride;
-                m_updatedMeshProperties.indexCount = m_surfaceMesh->TriangleIndices->ElementCount;
-                m_updatedMeshProperties.indexFormat = static_cast<DXGI_FORMAT>(m_surfaceMesh->TriangleIndices->Format);
+                m_updatedMeshProperties.vertexStride = surfaceMesh->VertexPositions->Stride;
+                m_updatedMeshProperties.normalStride = surfaceMesh->VertexNormals->Stride;
+                m_updatedMeshProperties.indexCount = surfaceMesh->TriangleIndices->ElementCount;
+                m_updatedMeshProperties.indexFormat = static_cast<DXGI_FORMAT>(surfaceMesh->TriangleIndices->Format);
+                m_updatedSurfaceMesh = surfaceMesh;
+                m_updatedUpdateTime = meshUpdateTime.UniversalTime;
 
                 // Send a signal to the render loop indicating that new resources are available to use.
                 m_updateReady = true;
@@ -349,57 +356,105 @@ void SurfaceMesh::ReleaseVertexResources()
 
 byte* SurfaceMesh::Serialize(int& length, Windows::Perception::Spatial::SpatialCoordinateSystem^ baseCoordinateSystem)
 {
-    if (!m_constantBufferCreated || !m_loadingComplete)
+    SerializedSurface surface;
+    SpatialSurfaceMesh^ mesh = GetSerializedSurface(baseCoordinateSystem, surface);
+    if (mesh == nullptr)
     {
-        // Resources are still being initialized.
         return nullptr;
     }
 
-    if (!m_isActive)
+    length = (int)SurfaceSerializer::Layout(&surface, 1);
+    if (length == 0)
     {
-        // Mesh is not active this frame, and should not be drawn.
         return nullptr;
     }
 
-    // Add transform information to beginning of vertex list.
-    int transformLength = 10 * sizeof(float);
-    int verticesLength = m_surfaceMesh->VertexPositions->ElementCount * 3 * sizeof(float) + transformLength;
-    if (verticesLength == 0)
+    byte* buffer = new byte[length];
+    SurfaceSerializer::Write(surface, buffer);
+
+    return buffer;
+}
+
+SpatialSurfaceMesh^ SurfaceMesh::GetSerializedSurface(
+    Windows::Perception::Spatial::SpatialCoordinateSystem^ baseCoordinateSystem,
+    SerializedSurface& surface)
+{
+    if (!IsReadyToSerialize())
     {
+        // Resources are still being initialized, or the mesh is not active this frame.
         return nullptr;
     }
-    short* vertexPositions = GetDataFromIBuffer<short>(m_surfaceMesh->VertexPositions->Data);
 
-    int indicesLength = m_surfaceMesh->TriangleIndices->Data->Length;
-    if (indicesLength == 0)
+    // Held on to, so the buffers stay valid if the surface is updated in the meantime.
+    SpatialSurfaceMesh^ mesh = m_currentSurfaceMesh;
+
+    XMFLOAT3 meshTranslation;
+    XMFLOAT4 meshRotation;
+    XMFLOAT3 meshScale;
+    GetSerializedTransform(baseCoordinateSystem, meshTranslation, meshRotation, meshScale);
+    memcpy(surface.Translation, &meshTranslation, sizeof(XMFLOAT3));
+    memcpy(surface.Rotation, &meshRotation, sizeof(XMFLOAT4));
+    memcpy(surface.Scale, &meshScale, sizeof(XMFLOAT3));
+
+    surface.Positions = GetDataFromIBuffer<int16_t>(mesh->VertexPositions->Data);
+    surface.NumVertices = mesh->VertexPositions->ElementCount;
+    surface.Indices = GetDataFromIBuffer<uint16_t>(mesh->TriangleIndices->Data);
+    surface.NumIndices = (int)(mesh->TriangleIndices->Data->Length / sizeof(uint16_t));
+
+    return mesh;
+}
+
+byte* SurfaceMesh::SerializeCompact(int& length, Windows::Perception::Spatial::SpatialCoordinateSystem^ baseCoordinateSystem)
+{
+    SerializedSurface surface;
+    SpatialSurfaceMesh^ mesh = GetSerializedSurface(baseCoordinateSystem, surface);
+    if (mesh == nullptr || surface.NumVertices == 0 || surface.NumIndices == 0)
     {
         return nullptr;
     }
-    short* vertexIndices = GetDataFromIBuffer<short>(m_surfaceMesh->TriangleIndices->Data);
 
-    length = (2 * sizeof(int)) + verticesLength + indicesLength;
+    MeshCodecOptions options;
+    options.PositionBits = SPATIAL_MAPPING_POSITION_BITS;
+    options.EntropyCoding = (SPATIAL_MAPPING_ENTROPY_CODING == TRUE);
+
+    // Same positions as Serialize, ignoring the w component.
+    std::vector<uint8_t> encoded;
+    if (!SurfaceSerializer::EncodeCompact(surface, options, encoded))
+    {
+        OutputDebugString(L"Spatial mapping surface has an index out of range, skipping it.\n");
+        return nullptr;
+    }
+
+    length = (int)encoded.size();
     byte* buffer = new byte[length];
-    
-    // First serialize number of vertices and indices.
-    int startIndex = 0;
-    memcpy(&buffer[startIndex], &verticesLength, sizeof(int));
-    startIndex += sizeof(int);
+    memcpy(buffer, encoded.data(), length);
 
-    memcpy(&buffer[startIndex], &indicesLength, sizeof(int));
-    startIndex += sizeof(int);
+    return buffer;
+}
 
-    // Then serialize byte arrays for vertices and indices.
+// Transform that takes the serialized positions to baseCoordinateSystem, in Unity space.
+// Scale is inverted, the identity if the surface can not be located.
+void SurfaceMesh::GetSerializedTransform(
+    Windows::Perception::Spatial::SpatialCoordinateSystem^ baseCoordinateSystem,
+    XMFLOAT3& meshTranslation,
+    XMFLOAT4& meshRotation,
+    XMFLOAT3& meshScale)
+{
+    meshTranslation = XMFLOAT3(0, 0, 0);
+    meshRotation = XMFLOAT4(0, 0, 0, 1);
+    meshScale = XMFLOAT3(1, 1, 1);
 
-    XMFLOAT3 meshTranslation = XMFLOAT3(0, 0, 0);
-    XMFLOAT4 meshRotation = XMFLOAT4(0, 0, 0, 1);
-    XMFLOAT3 meshScale = XMFLOAT3(1, 1, 1);
+    if (m_currentSurfaceMesh == nullptr)
+    {
+        return;
+    }
 
     XMMATRIX transform = XMMatrixIdentity();
-    auto tryTransform = m_surfaceMesh->CoordinateSystem->TryGetTransformTo(baseCoordinateSystem);
+    auto tryTransform = m_currentSurfaceMesh->CoordinateSystem->TryGetTransformTo(baseCoordinateSystem);
     if (tryTransform != nullptr)
     {
         transform = XMLoadFloat4x4(&tryTransform->Value);
-        Windows::Foundation::Numerics::float3 vps = m_surfaceMesh->VertexPositionScale;
+        Windows::Foundation::Numerics::float3 vps = m_currentSurfaceMesh->VertexPositionScale;
 
         XMMATRIX _scaleMat = XMMatrixScalingFromVector(XMLoadFloat3(&vps));
         transform = _scaleMat * transform;
@@ -423,41 +478,6 @@ byte* SurfaceMesh::Serialize(int& length, Windows::Perception::Spatial::SpatialC
 
         meshTranslation.z = -1 * meshTranslation.z;
     }
-
-    // Add transform information to vertex list
-    // Position
-    memcpy(&buffer[startIndex], &meshTranslation, sizeof(XMFLOAT3));
-    startIndex += sizeof(XMFLOAT3);
-
-    // Rotation
-    memcpy(&buffer[startIndex], &meshRotation, sizeof(XMFLOAT4));
-    startIndex += sizeof(XMFLOAT4);
-
-    // Scale
-    memcpy(&buffer[startIndex], &meshScale, sizeof(XMFLOAT3));
-    startIndex += sizeof(XMFLOAT3);
-
-    // Vertices
-    int numVertices = m_surfaceMesh->VertexPositions->ElementCount;
-    for (int i = 0; i < numVertices; i++)
-    {
-        // Ignoring w component.
-        int vertexStartIndex = i * 4;
-
-        XMFLOAT3 vertex = XMFLOAT3(
-            (float)vertexPositions[vertexStartIndex],
-            (float)vertexPositions[vertexStartIndex + 1],
-            (float)vertexPositions[vertexStartIndex + 2]
-        );
-
-        memcpy(&buffer[startIndex], &vertex, sizeof(XMFLOAT3));
-        startIndex += sizeof(XMFLOAT3);
-    }
-
-    // Indices
-    memcpy(&buffer[startIndex], vertexIndices, indicesLength);
-
-    return buffer;
 }
 
 void SurfaceMesh::SwapVertexBuffers()
@@ -471,6 +491,12 @@ void SurfaceMesh::SwapVertexBuffers()
     // Swap out the metadata: index count, index format, .
     m_meshProperties = m_updatedMeshProperties;
 
+    // Along with the mesh they came from, so anything serialized from the previous one is out of date.
+    m_currentSurfaceMesh = m_updatedSurfaceMesh;
+    m_currentUpdateTime = m_updatedUpdateTime;
+    m_updatedSurfaceMesh = nullptr;
+    m_updatedUpdateTime = 0;
+
     ZeroMemory(&m_updatedMeshProperties, sizeof(SurfaceMeshProperties));
     m_updatedVertexPositions.Reset();
     m_updatedVertexNormals.Reset();
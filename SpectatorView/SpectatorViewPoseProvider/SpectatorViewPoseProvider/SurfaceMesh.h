@@ -13,6 +13,7 @@
 
 #include "Common\DeviceResources.h"
 #include "Content\ShaderStructures.h"
+#include "SurfaceSerializer.h"
 
 using namespace SpectatorViewPoseProvider;
 
@@ -49,11 +50,30 @@ public:
     const bool&                             GetIsActive()       const { return m_isActive; }
     const float&                            GetLastActiveTime() const { return m_lastActiveTime; }
     const Windows::Foundation::DateTime&    GetLastUpdateTime() const { return m_lastUpdateTime; }
+    // Update time of the mesh that is drawn and serialized, which only changes in SwapVertexBuffers.
+    long long                               GetSerializedUpdateTime() const { return m_currentUpdateTime; }
 
     void SetIsActive(const bool& isActive) { m_isActive = isActive; }
     void SetColorFadeTimer(const float& duration) { m_colorFadeTimeout = duration; m_colorFadeTimer = 0.f; }
 
     byte* Serialize(int& length, Windows::Perception::Spatial::SpatialCoordinateSystem^ baseCoordinateSystem);
+    // MeshCodec format of the same surface, see SPATIAL_MAPPING_POSITION_BITS.
+    byte* SerializeCompact(int& length, Windows::Perception::Spatial::SpatialCoordinateSystem^ baseCoordinateSystem);
+    bool IsReadyToSerialize() const { return m_constantBufferCreated && m_loadingComplete && m_isActive && m_currentSurfaceMesh != nullptr; }
+    // Fills in surface for SurfaceSerializer, and returns the mesh its buffers belong to, which has to be
+    // kept until surface is written. nullptr if the surface is not ready.
+    Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh^ GetSerializedSurface(
+        Windows::Perception::Spatial::SpatialCoordinateSystem^ baseCoordinateSystem,
+        SerializedSurface& surface
+    );
+
+    // Transform that takes the serialized positions to baseCoordinateSystem, in Unity space.
+    void GetSerializedTransform(
+        Windows::Perception::Spatial::SpatialCoordinateSystem^ baseCoordinateSystem,
+        DirectX::XMFLOAT3& meshTranslation,
+        DirectX::XMFLOAT4& meshRotation,
+        DirectX::XMFLOAT3& meshScale
+    );
 
 private:
     void SwapVertexBuffers();
@@ -65,6 +85,12 @@ private:
     );
 
     Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh^ m_surfaceMesh = nullptr;
+    // Meshes the current and updated buffers were created from. Surfaces are serialized from the current
+    // one, so they are sent as they are drawn, and cached bytes stay valid until the buffers are swapped.
+    Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh^ m_currentSurfaceMesh = nullptr;
+    Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh^ m_updatedSurfaceMesh = nullptr;
+    long long m_currentUpdateTime = 0;
+    long long m_updatedUpdateTime = 0;
 
     Microsoft::WRL::ComPtr<ID3D11Buffer> m_vertexPositions;
     Microsoft::WRL::ComPtr<ID3D11Buffer> m_vertexNormals;
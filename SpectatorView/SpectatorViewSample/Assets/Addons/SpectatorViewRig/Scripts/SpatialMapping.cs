@@ -17,6 +17,9 @@ namespace SpectatorView
         [DllImport("UnityCompositorInterface")]
         private static extern bool GetSpatialMappingDataBufferLengths(int index, out int numVertices, out int numIndices);
 
+        [DllImport("UnityCompositorInterface")]
+        private static extern bool GetSpatialMappingSurface(int index, out Guid id, out int changed);
+
         [DllImport("UnityCompositorInterface")]
         private static extern bool GetSpatialMappingData(int index, out Vector3 translation, out Quaternion rotation, out Vector3 scale, out IntPtr vertices, out IntPtr indices);
 
@@ -26,6 +29,8 @@ namespace SpectatorView
 
         GameObject spatialMappingParent = null;
         public List<GameObject> spatialMappingMeshes = new List<GameObject>();
+        // Meshes by surface, the ones that did not change are kept between updates.
+        private Dictionary<Guid, GameObject> surfaceMeshes = new Dictionary<Guid, GameObject>();
 
         private string SpatialMappingParentName = "SV_SpatialMapping";
 
@@ -46,15 +51,14 @@ namespace SpectatorView
             int numSpatialMappingMeshes = 0;
             if (IsSpatialMappingDataReady(out numSpatialMappingMeshes))
             {
-                // Set parent transform and remove previous meshes.
+                // Set parent transform.
                 spatialMappingParent.transform.SetParent(parent);
                 spatialMappingParent.transform.localPosition = Vector3.zero;
                 spatialMappingParent.transform.localRotation = Quaternion.identity;
 
-                foreach (GameObject go in spatialMappingMeshes)
-                {
-                    GameObject.DestroyImmediate(go);
-                }
+                // Surfaces left in here at the end are not in this update and get removed.
+                Dictionary<Guid, GameObject> previousSurfaceMeshes = surfaceMeshes;
+                surfaceMeshes = new Dictionary<Guid, GameObject>();
                 spatialMappingMeshes.Clear();
 
                 // Find largest sizes for index and vertex buffers.
@@ -83,6 +87,37 @@ namespace SpectatorView
 
                 for (int i = 0; i < numSpatialMappingMeshes; i++)
                 {
+                    Guid surfaceID;
+                    int changed;
+                    GameObject previous;
+                    if (GetSpatialMappingSurface(i, out surfaceID, out changed) &&
+                        previousSurfaceMeshes.TryGetValue(surfaceID, out previous))
+                    {
+                        previousSurfaceMeshes.Remove(surfaceID);
+                        if (changed == 0)
+                        {
+                            // Only the transform can have changed.
+                            Vector3 previousTrans;
+                            Quaternion previousRot;
+                            Vector3 previousScale;
+                            if (GetSpatialMappingData(i, out previousTrans, out previousRot, out previousScale, out nativeVertices, out nativeIndices))
+                            {
+                                TransformValidation.ValidateVector(ref previousTrans);
+                                TransformValidation.ValidateVector(ref previousScale);
+
+                                previous.transform.localPosition = previousTrans;
+                                previous.transform.localRotation = TransformValidation.GetNormalizedQuaternion(previousRot);
+                                previous.transform.localScale = previousScale / 5.0f;
+                            }
+
+                            surfaceMeshes[surfaceID] = previous;
+                            spatialMappingMeshes.Add(previous);
+                            continue;
+                        }
+
+                        GameObject.DestroyImmediate(previous);
+                    }
+
                     if (GetSpatialMappingDataBufferLengths(i, out numVertices, out numIndices))
                     {
                         float[] vertexElements = new float[numVertices * 3];
@@ -90,7 +125,7 @@ namespace SpectatorView
 
                         if (numVertices <= 0 || numIndices <= 0)
                         {
-                            return;
+                            continue;
                         }
 
                         Vector3 meshTrans;
@@ -139,6 +174,7 @@ namespace SpectatorView
                                 go.GetComponent<Renderer>().material = SpatialMappingMaterial;
                             }
 
+                            surfaceMeshes[surfaceID] = go;
                             spatialMappingMeshes.Add(go);
 
                             GameObject.DestroyImmediate(go.GetComponent<Collider>());
@@ -160,6 +196,11 @@ namespace SpectatorView
                     }
                 }
 
+                foreach (GameObject go in previousSurfaceMeshes.Values)
+                {
+                    GameObject.DestroyImmediate(go);
+                }
+
                 //TODO: We should be freeing the memory we allocated for the index and vertex buffers, but this was deadlocking.
                 //Marshal.FreeHGlobal(nativeVertices);
                 //Marshal.FreeHGlobal(nativeIndices);